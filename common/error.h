@@ -52,6 +52,7 @@ namespace njudb {
  * @a NJUDB_PAGE_MISS: used for table manager to check if RID.page is valid
  * @a NJUDB_FILE_READ_ERROR: unix error when failing to read file
  * @a NJUDB_FILE_WRITE_ERROR: unix error when failing to write file
+ * @a NJUDB_PAGE_CORRUPTED: the checksum of a page read from disk does not match its content
  * @a NJUDB_INVALID_SQL: invalid SQL statement, syntax error
  * @a NJUDB_TXN_ABORTED: transaction aborted, used for transaction manager
  * @a NJUDB_DB_EXISTS: database already exists when attempting to create a new database
@@ -82,6 +83,7 @@ namespace njudb {
   ENUM(NJUDB_PAGE_MISS)         \
   ENUM(NJUDB_FILE_READ_ERROR)   \
   ENUM(NJUDB_FILE_WRITE_ERROR)  \
+  ENUM(NJUDB_PAGE_CORRUPTED)    \
   ENUM(NJUDB_INVALID_SQL)       \
   ENUM(NJUDB_TXN_ABORTED)       \
   ENUM(NJUDB_DB_EXISTS)         \
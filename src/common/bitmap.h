@@ -22,10 +22,17 @@
 #ifndef NJUDB_BITMAP_H
 #define NJUDB_BITMAP_H
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <cstring>
 #include "../../common/error.h"
 #include "../../common/micro.h"
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 namespace njudb {
 #define BITMAP_WIDTH 8
 #define BITMAP_SIZE(bit_num) ((bit_num + BITMAP_WIDTH - 1) / BITMAP_WIDTH)
@@ -56,15 +63,176 @@ public:
 
   static void Set(char *bitmap, size_t bit_num) { memset(bitmap, 0xff, BITMAP_SIZE(bit_num)); }
 
+  /**
+   * @return the index of the first bit from start on that equals value, bit_num if there is none
+   */
   static auto FindFirst(const char *bitmap, size_t bit_num, size_t start, bool value) -> size_t
   {
-    for (size_t i = start; i < bit_num; i++) {
-      if (GetBit(bitmap, i) == value) {
-        return i;
+    if (start >= bit_num) {
+      return bit_num;
+    }
+    // a dense page moving to the next slot, testing one bit keeps the hot path free of the word dependency chain
+    if (GetBit(bitmap, start) == value) {
+      return start;
+    }
+    // searching for a clear bit is searching for a set bit in the complement
+    const uint64_t flip      = value ? 0 : ~uint64_t{0};
+    const size_t   num_words = (bit_num + WORD_BITS - 1) / WORD_BITS;
+    size_t         word_idx  = start / WORD_BITS;
+    uint64_t       word      = (LoadWord(bitmap, bit_num, word_idx) ^ flip) & (~uint64_t{0} << (start % WORD_BITS));
+    if (word == 0) {
+#if defined(__x86_64__)
+      // a long run without a match, e.g. the free slot of a page that is almost full
+      if ((num_words - word_idx) * WORD_BITS >= AVX2_MIN_BITS && HasAvx2()) {
+        word_idx = SkipBlocksAvx2(bitmap, bit_num, (word_idx + 1) * WORD_BITS, value) / WORD_BITS - 1;
       }
+#endif
+      while (word == 0) {
+        if (++word_idx >= num_words) {
+          return bit_num;
+        }
+        word = LoadWord(bitmap, bit_num, word_idx) ^ flip;
+      }
+    }
+    // the bits past bit_num in the last word are not part of the bitmap
+    return std::min(bit_num, word_idx * WORD_BITS + std::countr_zero(word));
+  }
+
+  /**
+   * @return the number of set bits among the first bit_num
+   */
+  static auto CountSet(const char *bitmap, size_t bit_num) -> size_t
+  {
+    size_t count = 0;
+    size_t start = 0;
+#if defined(__x86_64__)
+    if (bit_num >= AVX2_MIN_BITS && HasAvx2()) {
+      count = CountSetAvx2(bitmap, bit_num / AVX2_BLOCK_BITS);
+      start = bit_num / AVX2_BLOCK_BITS * AVX2_BLOCK_BITS;
+    }
+#endif
+    for (size_t word_idx = start / WORD_BITS; word_idx * WORD_BITS < bit_num; ++word_idx) {
+      count += std::popcount(LoadWord(bitmap, bit_num, word_idx) & TailMask(bit_num, word_idx));
+    }
+    return count;
+  }
+
+  /**
+   * Call fn with the index of every set bit among the first bit_num in ascending order
+   */
+  template <typename Fn>
+  static void ForEachSet(const char *bitmap, size_t bit_num, Fn &&fn)
+  {
+    for (size_t word_idx = 0; word_idx * WORD_BITS < bit_num; ++word_idx) {
+      uint64_t word = LoadWord(bitmap, bit_num, word_idx) & TailMask(bit_num, word_idx);
+      while (word != 0) {
+        fn(word_idx * WORD_BITS + std::countr_zero(word));
+        word &= word - 1;
+      }
+    }
+  }
+
+private:
+  static constexpr size_t WORD_BITS       = 64;
+  static constexpr size_t AVX2_BLOCK_BITS = 256;
+  // one block, the bitmaps of pages of records up to about 15 bytes are wider, see bitmap_benchmark
+  static constexpr size_t AVX2_MIN_BITS = 256;
+
+  /**
+   * Load the word_idx-th 64 bits of the bitmap, bit i of the word is bit word_idx * 64 + i of the bitmap. The last
+   * word is filled up with zero bytes instead of reading past the bitmap
+   */
+  static auto LoadWord(const char *bitmap, size_t bit_num, size_t word_idx) -> uint64_t
+  {
+    size_t   offset = word_idx * sizeof(uint64_t);
+    size_t   size   = BITMAP_SIZE(bit_num);
+    uint64_t word   = 0;
+    if (offset + sizeof(uint64_t) <= size) {
+      memcpy(&word, bitmap + offset, sizeof(uint64_t));
+      if constexpr (std::endian::native == std::endian::big) {
+        word = __builtin_bswap64(word);
+      }
+      return word;
+    }
+    if constexpr (std::endian::native == std::endian::little) {
+      // fixed size copies of the 1 to 7 bytes left, a copy of variable size is a call to memcpy
+      const char *src   = bitmap + offset;
+      size_t      bytes = size - offset;
+      size_t      shift = 0;
+      if (bytes & 4) {
+        uint32_t part;
+        memcpy(&part, src, sizeof(part));
+        word |= static_cast<uint64_t>(part);
+        src += 4;
+        shift += 32;
+      }
+      if (bytes & 2) {
+        uint16_t part;
+        memcpy(&part, src, sizeof(part));
+        word |= static_cast<uint64_t>(part) << shift;
+        src += 2;
+        shift += 16;
+      }
+      if (bytes & 1) {
+        word |= static_cast<uint64_t>(static_cast<uint8_t>(*src)) << shift;
+      }
+    } else {
+      for (size_t i = offset; i < size; ++i) {
+        word |= static_cast<uint64_t>(static_cast<uint8_t>(bitmap[i])) << ((i - offset) * 8);
+      }
+    }
+    return word;
+  }
+
+  // the bits of the word_idx-th word that are among the first bit_num
+  static auto TailMask(size_t bit_num, size_t word_idx) -> uint64_t
+  {
+    size_t bits = bit_num - word_idx * WORD_BITS;
+    return bits >= WORD_BITS ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+  }
+
+#if defined(__x86_64__)
+  static auto HasAvx2() -> bool
+  {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+  }
+
+  /**
+   * Skip the 256-bit blocks from the one holding start on that have no bit equal to value
+   * @return where the word by word search goes on
+   */
+  __attribute__((target("avx2"))) static auto SkipBlocksAvx2(
+      const char *bitmap, size_t bit_num, size_t start, bool value) -> size_t
+  {
+    const __m256i ones  = _mm256_set1_epi8(-1);
+    size_t        block = start / AVX2_BLOCK_BITS;
+    for (; block < bit_num / AVX2_BLOCK_BITS; ++block) {
+      __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bitmap + block * AVX2_BLOCK_BITS / 8));
+      if (value ? !_mm256_testz_si256(bits, bits) : !_mm256_testc_si256(bits, ones)) {
+        break;
+      }
+    }
+    return std::max(start, block * AVX2_BLOCK_BITS);
+  }
+
+  // population count of 256-bit blocks, a nibble lookup table per byte summed up by sad against zero
+  __attribute__((target("avx2"))) static auto CountSetAvx2(const char *bitmap, size_t blocks) -> size_t
+  {
+    const __m256i lut = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    __m256i       sum        = _mm256_setzero_si256();
+    for (size_t block = 0; block < blocks; ++block) {
+      __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bitmap + block * AVX2_BLOCK_BITS / 8));
+      __m256i lo   = _mm256_shuffle_epi8(lut, _mm256_and_si256(bits, low_nibble));
+      __m256i hi   = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(bits, 4), low_nibble));
+      sum          = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
     }
-    return bit_num;
+    return static_cast<size_t>(_mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) +
+                               _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3));
   }
+#endif
 };
 }  // namespace njudb
 
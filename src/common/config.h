@@ -24,8 +24,29 @@
 #include <string>
 /// storage
 constexpr size_t  PAGE_SIZE        = 4096;
-constexpr size_t  BUFFER_POOL_SIZE = 8;
-const std::string REPLACER         = "LRUReplacer";
+constexpr size_t  BUFFER_POOL_SIZE = 8;  // default number of frames, override by the server flag --buffer-pool-size
+constexpr size_t  BUFFER_POOL_INSTANCES = 1;  // default number of partitions, override by --buffer-pool-instances
+const std::string REPLACER         = "LRUReplacer";  // default policy, override by the server flag --replacer
+constexpr size_t BUFFER_RING_SIZE = 4;  // frames a bulk scan or load with a BufferAccessStrategy may occupy
+constexpr size_t FSM_PARTITIONS = 8;  // latch partitions of a table free space map, inserters spread over them
+/// page cleaner, a background thread writing back dirty frames ahead of eviction
+constexpr size_t PAGE_CLEANER_CLEAN_FRAMES   = 2;     // default number of clean frames to keep at the eviction end
+constexpr size_t PAGE_CLEANER_BATCH          = 16;    // maximum pages written per instance in one round
+constexpr size_t PAGE_CLEANER_MIN_WAIT_MS    = 1;     // wait between rounds while there are dirty candidates
+constexpr size_t PAGE_CLEANER_MAX_WAIT_MS    = 100;   // wait between rounds when idle or throttled
+constexpr size_t PAGE_CLEANER_IO_LATENCY_US  = 5000;  // back off when the average write is slower than this
+/// read-ahead, a background thread loading the pages a sequential reader is about to fetch
+constexpr size_t READ_AHEAD_PAGES      = 8;   // default pages kept in flight ahead of a sequential reader
+constexpr size_t READ_AHEAD_TRIGGER    = 4;   // consecutive cold fetches of a file that start the read-ahead
+constexpr size_t READ_AHEAD_QUEUE_SIZE = 64;  // prefetch requests beyond this are dropped
+constexpr size_t READ_AHEAD_SHARDS     = 16;  // latches over the per-file sequential detection state
+/// asynchronous disk I/O
+constexpr size_t ASYNC_IO_QUEUE_DEPTH = 64;  // default maximum number of I/Os in flight
+constexpr size_t ASYNC_IO_WORKERS     = 4;   // threads issuing the I/O when io_uring is not available
+constexpr size_t FILE_EXTENT_PAGES    = 64;  // pages preallocated at a time when a table or index file grows
+/// page compression
+constexpr size_t COMPRESSED_SLOT_SIZE   = 512;  // compressed pages are stored in slots of a multiple of this size
+constexpr int    PAGE_COMPRESSION_LEVEL = 1;    // level of zstd and zlib, favors speed like lz4
 // enable this to use LRUKReplacer
 const size_t REPLACER_LRU_K = 10;
 /// system
@@ -35,11 +56,14 @@ constexpr size_t MAX_REC_SIZE = 1024;
 constexpr size_t SORT_BUFFER_SIZE = 64 * 1024 * 1024;
 // 10-way merge sort, max tmp file to use in merge sort
 constexpr size_t SORT_WAY_NUM = 10;
+// rids an index scan resolves against the table at a time, sorted by page so that every page is fetched once
+constexpr size_t IDX_SCAN_BATCH_SIZE = 256;
 
 const std::string DB_SUFFIX  = ".db";
 const std::string TAB_SUFFIX = ".tab";
 const std::string IDX_SUFFIX = ".idx";
 const std::string TMP_SUFFIX = ".tmp";
+const std::string PAGE_MAP_SUFFIX = ".pmap";  // page map of a compressed file, kept next to it
 
 const std::string DB_DIR  = "db";
 const std::string TAB_DIR = "tab";
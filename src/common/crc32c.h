@@ -0,0 +1,120 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_CRC32C_H
+#define NJUDB_CRC32C_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace njudb {
+
+/**
+ * CRC32C (Castagnoli), the checksum of iSCSI and ext4 that SSE4.2 and ARMv8 compute in hardware. The hardware path is
+ * picked at run time on x86-64, other CPUs use a table driven implementation that computes the same values.
+ */
+class Crc32c
+{
+public:
+  /**
+   * Extend crc by size bytes of data, start from 0. Extending the crc of a buffer by the next bytes gives the crc of
+   * the concatenation
+   */
+  static auto Extend(uint32_t crc, const char *data, size_t size) -> uint32_t
+  {
+#if defined(__x86_64__)
+    static const bool hardware = __builtin_cpu_supports("sse4.2");
+    if (hardware) {
+      return ExtendSse42(crc, data, size);
+    }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    return ExtendArm(crc, data, size);
+#endif
+    return ExtendTable(crc, data, size);
+  }
+
+  static auto Compute(const char *data, size_t size) -> uint32_t { return Extend(0, data, size); }
+
+  static auto ExtendTable(uint32_t crc, const char *data, size_t size) -> uint32_t
+  {
+    static const auto table = MakeTable();
+    crc                     = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+      crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+private:
+  static constexpr uint32_t POLY = 0x82f63b78;  // reversed Castagnoli polynomial
+
+  static auto MakeTable() -> std::array<uint32_t, 256>
+  {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (crc & 1 ? POLY : 0);
+      }
+      table[i] = crc;
+    }
+    return table;
+  }
+
+#if defined(__x86_64__)
+  __attribute__((target("sse4.2"))) static auto ExtendSse42(uint32_t crc, const char *data, size_t size) -> uint32_t
+  {
+    uint64_t crc64 = ~crc;
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+      uint64_t word;
+      memcpy(&word, data, sizeof(word));
+      crc64 = _mm_crc32_u64(crc64, word);
+    }
+    auto crc32 = static_cast<uint32_t>(crc64);
+    for (; size > 0; --size, ++data) {
+      crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*data));
+    }
+    return ~crc32;
+  }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+  static auto ExtendArm(uint32_t crc, const char *data, size_t size) -> uint32_t
+  {
+    crc = ~crc;
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+      uint64_t word;
+      memcpy(&word, data, sizeof(word));
+      crc = __crc32cd(crc, word);
+    }
+    for (; size > 0; --size, ++data) {
+      crc = __crc32cb(crc, static_cast<uint8_t>(*data));
+    }
+    return ~crc;
+  }
+#endif
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_CRC32C_H
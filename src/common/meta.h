@@ -86,7 +86,7 @@ struct RTField
 struct TableHeader
 {
   size_t    page_num_{0};
-  page_id_t first_free_page_{INVALID_PAGE_ID};
+  page_id_t first_free_page_{INVALID_PAGE_ID};  // no longer maintained, free pages are tracked by the free space map
   size_t    rec_num_{0};
   size_t    rec_size_{0};
   size_t    rec_per_page_{0};
@@ -22,25 +22,118 @@
 #ifndef NJUDB_PAGE_H
 #define NJUDB_PAGE_H
 
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
 #include "../../common/micro.h"
 #include "config.h"
 #include "types.h"
 #include "../../common/error.h"
+#include "crc32c.h"
+#include "rwlatch.h"
 
 #define FILE_HEADER_PAGE_ID 0
 
 #define PAGE_LSN_OFFSET 0
 #define PAGE_NEXT_FREE_PAGE_ID_OFFSET (PAGE_LSN_OFFSET + sizeof(lsn_t))
 #define PAGE_RECORD_NUM_OFFSET (PAGE_NEXT_FREE_PAGE_ID_OFFSET + sizeof(page_id_t))
-#define PAGE_HEADER_SIZE (PAGE_RECORD_NUM_OFFSET + sizeof(size_t))
+// the record number used to be a size_t, the checksum takes its upper half which is zero in pages written before
+#define PAGE_CHECKSUM_OFFSET (PAGE_RECORD_NUM_OFFSET + sizeof(uint32_t))
+#define PAGE_HEADER_SIZE (PAGE_CHECKSUM_OFFSET + sizeof(uint32_t))
 
 #define PageContentPtr(data) (data + PAGE_HEADER_SIZE)
 
+// slotted table pages, the bitmap is followed by the slot number, the tuple bytes and the live bytes, see PageHandle
+#define SLOTTED_HEADER_SIZE (3 * sizeof(uint16_t))
+// offset and size of a tuple in the slot directory
+#define SLOT_ENTRY_SIZE (2 * sizeof(uint16_t))
+// a tuple moved to another page leaves the page id and the slot id of its new place in its home slot
+#define SLOTTED_FORWARD_SIZE (sizeof(page_id_t) + sizeof(slot_id_t))
+
+/**
+ * CRC32C of a page with its checksum field taken as zero, never 0 so that 0 can mark a page without a checksum
+ */
+inline auto ComputePageChecksum(const char *data) -> uint32_t
+{
+  static constexpr char zeros[sizeof(uint32_t)]{};
+  auto crc = njudb::Crc32c::Compute(data, PAGE_CHECKSUM_OFFSET);
+  crc      = njudb::Crc32c::Extend(crc, zeros, sizeof(zeros));
+  crc      = njudb::Crc32c::Extend(crc, data + PAGE_HEADER_SIZE, PAGE_SIZE - PAGE_HEADER_SIZE);
+  return crc == 0 ? 1 : crc;
+}
+
+/**
+ * @return whether the checksum stored in the page matches its content, a page without a checksum, i.e. written with
+ * checksums disabled or never written at all, passes
+ */
+inline auto PageChecksumMatches(const char *data) -> bool
+{
+  uint32_t stored;
+  memcpy(&stored, data + PAGE_CHECKSUM_OFFSET, sizeof(stored));
+  return stored == 0 || stored == ComputePageChecksum(data);
+}
+
+inline void StampPageChecksum(char *data)
+{
+  uint32_t checksum = ComputePageChecksum(data);
+  memcpy(data + PAGE_CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+}
+
+/**
+ * Hands out zeroed, page aligned blocks of PAGE_SIZE bytes, which the O_DIRECT I/O of the DiskManager requires. The
+ * blocks are carved out of larger chunks since an aligned allocation of a single page wastes almost another page, freed
+ * blocks are reused but never returned to the system.
+ */
+class PageDataAllocator
+{
+public:
+  static auto Allocate() -> char *
+  {
+    auto            &state = GetState();
+    std::lock_guard  lock(state.latch);
+    if (state.free_blocks.empty()) {
+      auto *chunk = static_cast<char *>(::operator new(PAGE_SIZE * CHUNK_PAGES, std::align_val_t{PAGE_SIZE}));
+      for (size_t i = CHUNK_PAGES; i > 0; --i) {
+        state.free_blocks.push_back(chunk + (i - 1) * PAGE_SIZE);
+      }
+    }
+    char *data = state.free_blocks.back();
+    state.free_blocks.pop_back();
+    memset(data, 0, PAGE_SIZE);
+    return data;
+  }
+
+  static void Free(char *data)
+  {
+    auto           &state = GetState();
+    std::lock_guard lock(state.latch);
+    state.free_blocks.push_back(data);
+  }
+
+private:
+  static constexpr size_t CHUNK_PAGES = 64;
+
+  struct State
+  {
+    std::mutex          latch;
+    std::vector<char *> free_blocks;
+  };
+
+  static auto GetState() -> State &
+  {
+    // never destroyed, pages of static objects may be freed after the other statics are gone
+    static auto *state = new State;
+    return *state;
+  }
+};
+
 class Page
 {
 
 public:
   Page() = default;
+  ~Page() { PageDataAllocator::Free(data_); }
   DISABLE_COPY_MOVE_AND_ASSIGN(Page)
 
   [[nodiscard]] auto GetFileId() const -> file_id_t { return fid_; }
@@ -54,40 +147,45 @@ public:
 
   auto GetData() -> char * { return data_; }
 
+  /**
+   * The latch guarding the content of the page, taken by ReadPageGuard and WritePageGuard while they pin the page
+   */
+  auto GetLatch() -> njudb::ReaderWriterLatch & { return latch_; }
+
   auto GetLsn() -> lsn_t
   {
     NJUDB_ASSERT(pid_ != FILE_HEADER_PAGE_ID, "Can't load data from file header page");
-    return *reinterpret_cast<lsn_t *>(data_ + PAGE_LSN_OFFSET);
+    return *reinterpret_cast<lsn_t *>(GetData() + PAGE_LSN_OFFSET);
   }
 
   void SetLsn(lsn_t lsn)
   {
     NJUDB_ASSERT(pid_ != FILE_HEADER_PAGE_ID, "Can't set data from file header page");
-    *reinterpret_cast<lsn_t *>(data_ + PAGE_LSN_OFFSET) = lsn;
+    *reinterpret_cast<lsn_t *>(GetData() + PAGE_LSN_OFFSET) = lsn;
   }
 
   auto GetNextFreePageId() -> page_id_t
   {
     NJUDB_ASSERT(pid_ != FILE_HEADER_PAGE_ID, "Can't load data from file header page");
-    return *reinterpret_cast<page_id_t *>(data_ + PAGE_NEXT_FREE_PAGE_ID_OFFSET);
+    return *reinterpret_cast<page_id_t *>(GetData() + PAGE_NEXT_FREE_PAGE_ID_OFFSET);
   }
 
   void SetNextFreePageId(page_id_t next_free_page_id)
   {
     NJUDB_ASSERT(pid_ != FILE_HEADER_PAGE_ID, "Can't set data from file header page");
-    *reinterpret_cast<page_id_t *>(data_ + PAGE_NEXT_FREE_PAGE_ID_OFFSET) = next_free_page_id;
+    *reinterpret_cast<page_id_t *>(GetData() + PAGE_NEXT_FREE_PAGE_ID_OFFSET) = next_free_page_id;
   }
 
   auto GetRecordNum() -> size_t
   {
     NJUDB_ASSERT(pid_ != FILE_HEADER_PAGE_ID, "Can't load data from file header page");
-    return *reinterpret_cast<size_t *>(data_ + PAGE_RECORD_NUM_OFFSET);
+    return *reinterpret_cast<uint32_t *>(GetData() + PAGE_RECORD_NUM_OFFSET);
   }
 
   void SetRecordNum(size_t record_num)
   {
     NJUDB_ASSERT(pid_ != FILE_HEADER_PAGE_ID, "Can't set data from file header page");
-    *reinterpret_cast<size_t *>(data_ + PAGE_RECORD_NUM_OFFSET) = record_num;
+    *reinterpret_cast<uint32_t *>(GetData() + PAGE_RECORD_NUM_OFFSET) = static_cast<uint32_t>(record_num);
   }
 
   void Clear()
@@ -100,7 +198,9 @@ public:
 private:
   file_id_t fid_{INVALID_FILE_ID};
   page_id_t pid_{INVALID_PAGE_ID};
-  char      data_[PAGE_SIZE]{};
+  char     *data_{PageDataAllocator::Allocate()};  // page aligned, see PageDataAllocator
+
+  njudb::ReaderWriterLatch latch_;
 };
 
 #endif  // NJUDB_PAGE_H
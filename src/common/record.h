@@ -289,7 +289,8 @@ public:
             *reinterpret_cast<float *>(data_ + cursor) = value->Get();
             break;
           }
-          case FieldType::TYPE_STRING: {
+          case FieldType::TYPE_STRING:
+          case FieldType::TYPE_VARCHAR: {
             auto value = std::dynamic_pointer_cast<StringValue>(values[i]);
             if (value == nullptr)
               NJUDB_THROW(NJUDB_TYPE_MISSMATCH,
@@ -473,6 +474,7 @@ public:
           hash ^= std::hash<float>{}(*reinterpret_cast<const float *>(data_ + schema_->offsets_[i]));
           break;
         case FieldType::TYPE_STRING:
+        case FieldType::TYPE_VARCHAR:
           hash ^= std::hash<std::string>{}(std::string(data_ + schema_->offsets_[i], field.field_.field_size_));
           break;
         default: NJUDB_FATAL("Unsupported field type to hash");
@@ -513,6 +515,13 @@ public:
 
   [[nodiscard]] auto GetNullMap() const -> const char * { return nullmap_; }
 
+  /**
+   * Buffers of the record for readers that fill it in place, see TableHandle::GetRecord
+   */
+  auto GetMutableData() -> char * { return data_; }
+
+  auto GetMutableNullMap() -> char * { return nullmap_; }
+
   static auto Compare(const Record &lrec, const Record &rrec) -> int
   {
     // compare two records,
@@ -0,0 +1,105 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_RWLATCH_H
+#define NJUDB_RWLATCH_H
+
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include "../../common/micro.h"
+
+namespace njudb {
+
+/**
+ * A reader/writer latch whose shared holder can be upgraded to the exclusive one in place. Writers are preferred, a
+ * reader waits while a writer holds or waits for the latch, so a stream of readers cannot starve them, and an upgrade
+ * waits only for the other readers to leave. Only one reader may be upgrading at a time, a second one would wait for
+ * the first to release its shared latch and the first for the second, so TryUpgrade fails instead.
+ */
+class ReaderWriterLatch
+{
+public:
+  ReaderWriterLatch() = default;
+  DISABLE_COPY_MOVE_AND_ASSIGN(ReaderWriterLatch)
+
+  void LockShared()
+  {
+    std::unique_lock lock(mutex_);
+    reader_cv_.wait(lock, [this]() { return !writer_ && !upgrading_ && waiting_writers_ == 0; });
+    readers_++;
+  }
+
+  void UnlockShared()
+  {
+    std::lock_guard lock(mutex_);
+    readers_--;
+    if (readers_ <= 1 && (waiting_writers_ > 0 || upgrading_)) {
+      writer_cv_.notify_all();
+    }
+  }
+
+  void Lock()
+  {
+    std::unique_lock lock(mutex_);
+    waiting_writers_++;
+    writer_cv_.wait(lock, [this]() { return !writer_ && !upgrading_ && readers_ == 0; });
+    waiting_writers_--;
+    writer_ = true;
+  }
+
+  void Unlock()
+  {
+    std::lock_guard lock(mutex_);
+    writer_ = false;
+    if (waiting_writers_ > 0) {
+      writer_cv_.notify_all();
+    } else {
+      reader_cv_.notify_all();
+    }
+  }
+
+  /**
+   * Turn the shared latch held by the caller into the exclusive one without releasing it in between
+   * @return false if another reader is upgrading, the caller still holds its shared latch
+   */
+  auto TryUpgrade() -> bool
+  {
+    std::unique_lock lock(mutex_);
+    if (upgrading_) {
+      return false;
+    }
+    upgrading_ = true;
+    writer_cv_.wait(lock, [this]() { return readers_ == 1; });
+    upgrading_ = false;
+    readers_   = 0;
+    writer_    = true;
+    return true;
+  }
+
+private:
+  std::mutex              mutex_;
+  std::condition_variable reader_cv_;
+  std::condition_variable writer_cv_;
+  int                     readers_{0};
+  int                     waiting_writers_{0};
+  bool                    writer_{false};
+  bool                    upgrading_{false};  // a reader waits for the others to leave to become the writer
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_RWLATCH_H
@@ -48,7 +48,8 @@ constexpr int32_t INVALID_FILE_ID  = -1;
 
 #define ENUM_ENTITIES \
   ENUM(NARY_MODEL)    \
-  ENUM(PAX_MODEL)
+  ENUM(PAX_MODEL)     \
+  ENUM(SLOTTED_MODEL)
 #define ENUM(ent) ENUMENTRY(ent)
 DECLARE_ENUM(StorageModel)
 #undef ENUM
@@ -57,13 +58,41 @@ ENUM_TO_STRING_BODY(StorageModel)
 #undef ENUM
 #undef ENUM_ENTITIES
 
+// how the pages of a table are accessed, TABLE_ACCESS_MMAP reads a table that is no longer written through a read-only
+// mapping of its file instead of the buffer pool
+#define ENUM_ENTITIES         \
+  ENUM(TABLE_ACCESS_BUFFERED) \
+  ENUM(TABLE_ACCESS_MMAP)
+#define ENUM(ent) ENUMENTRY(ent)
+DECLARE_ENUM(TableAccessMode)
+#undef ENUM
+#define ENUM(ent) ENUM2STRING(ent)
+ENUM_TO_STRING_BODY(TableAccessMode)
+#undef ENUM
+#undef ENUM_ENTITIES
+
+// codec of the pages of a compressed table file, the codecs found at build time are available, see PageCompressor
+#define ENUM_ENTITIES          \
+  ENUM(PAGE_COMPRESSION_NONE)  \
+  ENUM(PAGE_COMPRESSION_LZ4)   \
+  ENUM(PAGE_COMPRESSION_ZSTD)  \
+  ENUM(PAGE_COMPRESSION_ZLIB)
+#define ENUM(ent) ENUMENTRY(ent)
+DECLARE_ENUM(PageCompression)
+#undef ENUM
+#define ENUM(ent) ENUM2STRING(ent)
+ENUM_TO_STRING_BODY(PageCompression)
+#undef ENUM
+#undef ENUM_ENTITIES
+
 #define ENUM_ENTITIES \
   ENUM(TYPE_NULL)     \
   ENUM(TYPE_BOOL)     \
   ENUM(TYPE_INT)      \
   ENUM(TYPE_FLOAT)    \
   ENUM(TYPE_STRING)   \
-  ENUM(TYPE_ARRAY)
+  ENUM(TYPE_ARRAY)    \
+  ENUM(TYPE_VARCHAR)
 #define ENUM(ent) ENUMENTRY(ent)
 DECLARE_ENUM(FieldType)
 #undef ENUM
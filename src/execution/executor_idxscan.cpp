@@ -28,7 +28,8 @@ namespace njudb {
 
 IdxScanExecutor::IdxScanExecutor(TableHandle *tbl, IndexHandle *idx, ConditionVec conds, bool is_ascending)
     : AbstractExecutor(Basic), tbl_(tbl), idx_(idx), conds_(std::move(conds)), is_ascending_(is_ascending),
-      needs_first_record_check_(false), needs_last_record_check_(false), start_idx_(0), end_idx_(0), current_idx_(0)
+      needs_first_record_check_(false), needs_last_record_check_(false), start_idx_(0), end_idx_(0), current_idx_(0),
+      batch_begin_(0), batch_end_(0)
 {
 }
 
@@ -103,8 +104,9 @@ void IdxScanExecutor::Init()
   }
 
   current_idx_ = start_idx_;
+  batch_begin_ = batch_end_ = 0;
   if (!IsEnd()) {
-    record_ = tbl_->GetRecord(rids_[current_idx_]);
+    ReadRecord();
   }
 }
 
@@ -112,10 +114,24 @@ void IdxScanExecutor::Next()
 {
   current_idx_++;
   if (!IsEnd()) {
-    record_ = tbl_->GetRecord(rids_[current_idx_]);
+    ReadRecord();
   }
 }
 
+void IdxScanExecutor::ReadRecord()
+{
+  // the rids of a secondary index are scattered over the table, resolve a batch of them at a time so that every page
+  // is fetched once per batch
+  if (current_idx_ < batch_begin_ || current_idx_ >= batch_end_) {
+    batch_begin_ = current_idx_;
+    batch_end_   = std::min(end_idx_, current_idx_ + IDX_SCAN_BATCH_SIZE);
+    tbl_->GetRecords(std::span<const RID>(rids_).subspan(batch_begin_, batch_end_ - batch_begin_), batch_);
+  }
+  // the record of the previous row takes the place of the current one in the batch and is overwritten by the next
+  // batch, reading a row allocates nothing
+  std::swap(record_, batch_[current_idx_ - batch_begin_]);
+}
+
 auto IdxScanExecutor::IsEnd() const -> bool { return current_idx_ >= end_idx_; }
 
 auto IdxScanExecutor::GetOutSchema() const -> const RecordSchema * { return &tbl_->GetSchema(); }
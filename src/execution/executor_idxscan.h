@@ -63,9 +63,13 @@ private:
   size_t           start_idx_;                  // Start index for valid range
   size_t           end_idx_;                    // End index for valid range (exclusive)
   size_t           current_idx_;                // Current index in the valid range
+  std::vector<RecordUptr> batch_;               // records of rids_[batch_begin_, batch_end_), fetched page by page
+  size_t                  batch_begin_;
+  size_t                  batch_end_;
   
   // Helper functions
   void GenerateRangeKeys();
+  void ReadRecord();
 };
 }  // namespace njudb
 
@@ -23,18 +23,34 @@
 
 namespace njudb {
 
-SeqScanExecutor::SeqScanExecutor(TableHandle *tab) : AbstractExecutor(Basic), tab_(tab) {}
+SeqScanExecutor::SeqScanExecutor(TableHandle *tab) : AbstractExecutor(Basic), tab_(tab), cursor_(tab, &strategy_) {}
 
 void SeqScanExecutor::Init()
 {
-  rid_ = tab_->GetFirstRID();
-  
-  NJUDB_STUDENT_TODO(l2, t1);
+  cursor_.Rewind();
+  if (!cursor_.IsEnd()) {
+    ReadRecord();
+  }
 }
 
-void SeqScanExecutor::Next() { NJUDB_STUDENT_TODO(l2, t1); }
+void SeqScanExecutor::Next()
+{
+  cursor_.Next();
+  if (!cursor_.IsEnd()) {
+    ReadRecord();
+  }
+}
+
+void SeqScanExecutor::ReadRecord()
+{
+  // the record of the previous row is overwritten, reading a row allocates nothing
+  if (record_ == nullptr) {
+    record_ = std::make_unique<Record>(&tab_->GetSchema());
+  }
+  cursor_.ReadRecord(*record_);
+}
 
-auto SeqScanExecutor::IsEnd() const -> bool { NJUDB_STUDENT_TODO(l2, t1); }
+auto SeqScanExecutor::IsEnd() const -> bool { return cursor_.IsEnd(); }
 
 auto SeqScanExecutor::GetOutSchema() const -> const RecordSchema * { return &tab_->GetSchema(); }
 }  // namespace njudb
\ No newline at end of file
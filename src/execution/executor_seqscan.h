@@ -44,8 +44,11 @@ public:
   [[nodiscard]] auto GetOutSchema() const -> const RecordSchema * override;
 
 private:
-  TableHandle *tab_;
-  RID          rid_;
+  void ReadRecord();
+
+  TableHandle         *tab_;
+  BufferAccessStrategy strategy_;  // keeps the scan in a ring of frames instead of flushing the buffer pool
+  TableScanCursor      cursor_;
 };
 }  // namespace njudb
 
@@ -21,13 +21,71 @@
 
 #include "storage/storage.h"
 #include <iostream>
+#include "argparse/argparse.hpp"
 #include "system/system.h"
 
-int main()
+int main(int argc, char *argv[])
 {
+  argparse::ArgumentParser program("njudb");
+  program.add_argument("-b", "--buffer-pool-size")
+      .help("number of frames in the buffer pool")
+      .default_value(BUFFER_POOL_SIZE)
+      .scan<'u', size_t>();
+  program.add_argument("-i", "--buffer-pool-instances")
+      .help("number of independently latched partitions of the buffer pool")
+      .default_value(BUFFER_POOL_INSTANCES)
+      .scan<'u', size_t>();
+  program.add_argument("-c", "--clean-frames")
+      .help("number of clean frames the page cleaner keeps at the eviction end, 0 disables the page cleaner")
+      .default_value(PAGE_CLEANER_CLEAN_FRAMES)
+      .scan<'u', size_t>();
+  program.add_argument("-a", "--read-ahead")
+      .help("number of pages read ahead of sequential readers, 0 disables the read-ahead")
+      .default_value(READ_AHEAD_PAGES)
+      .scan<'u', size_t>();
+  program.add_argument("-d", "--direct-io")
+      .help("read and write pages with O_DIRECT so that they are only cached by the buffer pool")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("-m", "--mmap-tables")
+      .help("map the table files read-only and read the tables without the buffer pool")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("-r", "--replacer")
+      .help("replacement policy of the buffer pool: LRUReplacer, LRUKReplacer or TwoQueueReplacer")
+      .default_value(REPLACER);
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+  auto buffer_pool_size = program.get<size_t>("--buffer-pool-size");
+  if (buffer_pool_size == 0) {
+    std::cerr << "buffer pool size should be greater than 0" << std::endl;
+    return 1;
+  }
+  auto buffer_pool_instances = program.get<size_t>("--buffer-pool-instances");
+  if (buffer_pool_instances == 0 || buffer_pool_instances > buffer_pool_size) {
+    std::cerr << "buffer pool instances should be in [1, buffer pool size]" << std::endl;
+    return 1;
+  }
+
+  auto clean_frames = program.get<size_t>("--clean-frames");
+  auto read_ahead   = program.get<size_t>("--read-ahead");
+  auto direct_io    = program.get<bool>("--direct-io");
+  auto mmap_tables  = program.get<bool>("--mmap-tables");
+  auto replacer     = program.get<std::string>("--replacer");
+  if (njudb::Replacer::Create(replacer, REPLACER_LRU_K, 1) == nullptr) {
+    std::cerr << "unknown replacer: " << replacer << std::endl;
+    return 1;
+  }
+
   auto njudb_sys = njudb::SystemManager::GetInstance();
   NJUDB_LOG("Creating components");
-  njudb_sys->Init();
+  njudb_sys->Init(buffer_pool_size, buffer_pool_instances, clean_frames, replacer, read_ahead, direct_io,
+      mmap_tables ? njudb::TABLE_ACCESS_MMAP : njudb::TABLE_ACCESS_BUFFERED);
   NJUDB_LOG("System Running");
   njudb_sys->Run();
 }
\ No newline at end of file
@@ -77,6 +77,14 @@ struct TxnRollback : public TreeNode
 struct LogStaticCheckpoint : public TreeNode
 {};
 
+struct SetVariable : public TreeNode
+{
+  std::string name_;
+  std::string value_;
+
+  SetVariable(std::string name, std::string value) : name_(std::move(name)), value_(std::move(value)) {}
+};
+
 struct TypeLen : public TreeNode
 {
   FieldType type_;
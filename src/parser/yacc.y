@@ -33,7 +33,7 @@ using namespace ast;
 
 // keywords
 %token EXPLAIN SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM OPEN DATABASE ON ASC AS ORDER GROUP BY SUM AVG MAX MIN COUNT IN STATIC_CHECKPOINT USING LOOP MERGE INDEX_BPTREE HASH_KWD
-WHERE HAVING UPDATE SET SELECT INT CHAR FLOAT BOOL INDEX AND JOIN INNER OUTER EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY ENABLE_NESTLOOP ENABLE_SORTMERGE STORAGE PAX NARY LIMIT
+WHERE HAVING UPDATE SET SELECT INT CHAR FLOAT BOOL INDEX AND JOIN INNER OUTER EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY ENABLE_NESTLOOP ENABLE_SORTMERGE STORAGE PAX NARY SLOTTED VARCHAR LIMIT
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
 
@@ -44,7 +44,7 @@ WHERE HAVING UPDATE SET SELECT INT CHAR FLOAT BOOL INDEX AND JOIN INNER OUTER EX
 %token <sv_bool> VALUE_BOOL
 
 // specify types for non-terminal symbol
-%type <sv_node> stmt dbStmt ddl dml txnStmt indexStmt logStmt table
+%type <sv_node> stmt dbStmt ddl dml txnStmt indexStmt logStmt setStmt table
 %type <sv_sel> selectStmt
 %type <sv_field> field
 %type <sv_fields> fieldList
@@ -55,7 +55,7 @@ WHERE HAVING UPDATE SET SELECT INT CHAR FLOAT BOOL INDEX AND JOIN INNER OUTER EX
 %type <sv_expr> expr
 %type <sv_val> value
 %type <sv_vals> valueList
-%type <sv_str> tbName colName optAlias
+%type <sv_str> tbName colName optAlias setValue
 %type <sv_strs> colNameList
 %type <sv_node_arr> tableList
 %type <sv_col> col aggCol
@@ -107,6 +107,7 @@ stmt:
     |   txnStmt
     |   indexStmt
     |   logStmt
+    |   setStmt
     |   /*empty*/ { $$ = nullptr; }
     ;
 
@@ -135,6 +136,26 @@ logStmt:
         $$ = std::make_shared<LogStaticCheckpoint>();
     }
 
+setStmt:
+        SET IDENTIFIER '=' setValue
+    {
+        $$ = std::make_shared<SetVariable>($2, $4);
+    }
+    ;
+
+setValue:
+        VALUE_INT
+    {
+        $$ = std::to_string($1);
+    }
+    |   VALUE_STRING
+    |   IDENTIFIER
+    |   ON
+    {
+        $$ = "on";
+    }
+    ;
+
 dbStmt:
         SHOW TABLES
     {
@@ -189,6 +210,8 @@ optStorageModel:
     { $$ = NARY_MODEL; }
     | STORAGE '=' PAX
     { $$ = PAX_MODEL; }
+    | STORAGE '=' SLOTTED
+    { $$ = SLOTTED_MODEL; }
     ;
 
 dml:
@@ -267,6 +290,10 @@ type:
     {
         $$ = std::make_shared<TypeLen>(TYPE_STRING, $3);
     }
+    |   VARCHAR '(' VALUE_INT ')'
+    {
+        $$ = std::make_shared<TypeLen>(TYPE_VARCHAR, $3);
+    }
     |   FLOAT
     {
         $$ = std::make_shared<TypeLen>(TYPE_FLOAT, sizeof(float));
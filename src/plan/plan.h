@@ -67,6 +67,18 @@ public:
   std::string db_name_;
 };
 
+class SetVariablePlan : public AbstractPlan
+{
+public:
+  SetVariablePlan(std::string name, std::string value) : name_(std::move(name)), value_(std::move(value)) {}
+  auto ToString(int level) const -> std::string override
+  {
+    return fmt::format("{}SetVariablePlan [{} = {}]", TAB_STR(level), name_, value_);
+  }
+  std::string name_;
+  std::string value_;
+};
+
 class CreateTablePlan : public AbstractPlan
 {
 public:
@@ -35,6 +35,8 @@ auto Planner::PlanAST(const std::shared_ptr<ast::TreeNode> &ast, DatabaseHandle
     return std::make_shared<CreateDBPlan>(cdb->db_name_);
   } else if (const auto odb = std::dynamic_pointer_cast<ast::OpenDatabase>(ast)) {
     return std::make_shared<OpenDBPlan>(odb->db_name_);
+  } else if (const auto set = std::dynamic_pointer_cast<ast::SetVariable>(ast)) {
+    return std::make_shared<SetVariablePlan>(set->name_, set->value_);
   } else if (const auto exp = std::dynamic_pointer_cast<ast::Explain>(ast)) {
     return std::make_shared<ExplainPlan>(PlanAST(exp->stmt, db));
   }
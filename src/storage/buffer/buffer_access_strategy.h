@@ -0,0 +1,102 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_BUFFER_ACCESS_STRATEGY_H
+#define NJUDB_BUFFER_ACCESS_STRATEGY_H
+
+#include <algorithm>
+#include <vector>
+#include "common/config.h"
+#include "common/types.h"
+#include "../../../common/micro.h"
+
+namespace njudb {
+
+/**
+ * A small ring of frames of one buffer pool instance, a miss through the ring reuses the frame loaded ring size misses
+ * ago instead of taking a frame from the whole pool.
+ */
+class BufferRing
+{
+public:
+  struct Slot
+  {
+    frame_id_t frame_id;
+    file_id_t  fid;  // the page the ring loaded into the frame, the frame is only reused if it still holds it
+    page_id_t  pid;
+  };
+
+  explicit BufferRing(size_t capacity) : capacity_(capacity) { slots_.reserve(capacity); }
+
+  /**
+   * @return the slot to be reused by the next miss, nullptr if the ring is not full yet
+   */
+  auto Peek() -> const Slot * { return slots_.size() < capacity_ ? nullptr : &slots_[next_]; }
+
+  /**
+   * Record the frame the last miss loaded the page into, it takes the place of the slot returned by Peek
+   */
+  void Put(frame_id_t frame_id, file_id_t fid, page_id_t pid)
+  {
+    if (slots_.size() < capacity_) {
+      slots_.push_back({frame_id, fid, pid});
+      return;
+    }
+    slots_[next_] = {frame_id, fid, pid};
+    next_         = (next_ + 1) % capacity_;
+  }
+
+private:
+  std::vector<Slot> slots_;
+  size_t            next_{0};
+  size_t            capacity_;
+};
+
+/**
+ * BufferAccessStrategy confines a bulk operation, e.g. a sequential scan or an index build, to a private ring of frames
+ * so that it does not evict the working set of other queries. A strategy keeps one ring per buffer pool instance and is
+ * meant to be used by one operation in one thread, pass it to BufferPoolManager::FetchPage.
+ */
+class BufferAccessStrategy
+{
+public:
+  /**
+   * @param ring_size number of frames the operation may occupy, evenly distributed among the instances
+   */
+  explicit BufferAccessStrategy(size_t ring_size = BUFFER_RING_SIZE) : ring_size_(ring_size) {}
+
+  DISABLE_COPY_MOVE_AND_ASSIGN(BufferAccessStrategy)
+
+  /**
+   * @return the ring of the instance-th buffer pool instance
+   */
+  auto GetRing(size_t instance, size_t num_instances) -> BufferRing *
+  {
+    if (rings_.size() != num_instances) {
+      rings_.assign(num_instances, BufferRing(std::max<size_t>(1, (ring_size_ + num_instances - 1) / num_instances)));
+    }
+    return &rings_[instance];
+  }
+
+private:
+  size_t                  ring_size_;
+  std::vector<BufferRing> rings_;
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_BUFFER_ACCESS_STRATEGY_H
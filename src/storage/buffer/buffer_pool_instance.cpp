@@ -0,0 +1,599 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#include "buffer_pool_instance.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "../../../common/error.h"
+
+namespace njudb {
+
+BufferPoolInstance::BufferPoolInstance(DiskManager *disk_manager, LogManager *log_manager, size_t replacer_lru_k,
+    size_t pool_size, const std::string &replacer)
+    : disk_manager_(disk_manager), log_manager_(log_manager), page_table_(pool_size * 2)
+{
+  NJUDB_ASSERT(pool_size > 0, "buffer pool size should be greater than 0");
+  replacer_ = Replacer::Create(replacer, replacer_lru_k, pool_size);
+  if (replacer_ == nullptr) {
+    NJUDB_FATAL("Unknown replacer: " + replacer);
+  }
+  // init frames_ and free_list_
+  frames_.reserve(pool_size);
+  for (frame_id_t i = 0; i < static_cast<frame_id_t>(pool_size); i++) {
+    frames_.push_back(std::make_unique<Frame>());
+    free_list_.push_back(i);
+  }
+  // at least twice as many hint slots as frames, the table is not resized with the pool
+  hint_bits_   = std::bit_width(pool_size * 2 - 1);
+  frame_hints_ = std::make_unique<std::atomic<Frame *>[]>(static_cast<size_t>(1) << hint_bits_);
+}
+
+auto BufferPoolInstance::FetchFrame(file_id_t fid, page_id_t pid, BufferRing *ring, bool *cold) -> Frame *
+{
+  std::unique_lock lock(latch_);
+  frame_id_t       frame_id = page_table_.Find(fid, pid);
+  while (frame_id != INVALID_FRAME_ID) {
+    Frame *frame = frames_[frame_id].get();
+    if (!frame->IsIoInProgress()) {
+      frame->Pin();
+      replacer_->Pin(frame_id);
+      hits_++;
+      TakePrefetched(frame, cold);
+      return frame;
+    }
+    // the page is being loaded, or is the victim being written back, wait for it and look it up again
+    WaitFrameIo(frame_id, lock);
+    if (IsMapped(frame_id, fid, pid)) {
+      hits_++;
+      TakePrefetched(frame, cold);
+      return frame;
+    }
+    ReleaseFrame(frame_id);
+    frame_id = page_table_.Find(fid, pid);
+  }
+  misses_++;
+  if (cold != nullptr) {
+    *cold = true;
+  }
+  try {
+    frame_id = ring != nullptr ? GetRingFrame(ring) : INVALID_FRAME_ID;
+    if (frame_id == INVALID_FRAME_ID) {
+      frame_id = GetAvailableFrame();
+    }
+    UpdateFrame(frame_id, fid, pid, lock);
+    if (ring != nullptr) {
+      ring->Put(frame_id, fid, pid);
+    }
+    return frames_[frame_id].get();
+  } catch (const NJUDBException_ &e) {
+    return nullptr;
+  }
+}
+
+auto BufferPoolInstance::PrefetchPage(file_id_t fid, page_id_t pid) -> bool
+{
+  std::unique_lock lock(latch_);
+  if (page_table_.Find(fid, pid) != INVALID_FRAME_ID) {
+    return false;
+  }
+  try {
+    frame_id_t frame_id = GetAvailableFrame();
+    UpdateFrame(frame_id, fid, pid, lock);
+    frames_[frame_id]->SetPrefetched(true);
+    ReleaseFrame(frame_id);
+    prefetches_++;
+    return true;
+  } catch (const NJUDBException_ &e) {
+    return false;
+  }
+}
+
+auto BufferPoolInstance::ReadPageOptimistic(file_id_t fid, page_id_t pid, char *data, PageVersion *version) -> bool
+{
+  Frame *frame = frame_hints_[HintSlot(fid, pid)].load(std::memory_order_acquire);
+  if (frame == nullptr) {
+    return false;
+  }
+  auto frame_version = frame->ReadVersion();
+  if (frame_version % 2 == 1) {
+    return false;
+  }
+  Page *page = frame->GetPage();
+  if (page->GetFileId() != fid || page->GetPageId() != pid) {
+    return false;
+  }
+  memcpy(data, page->GetData(), PAGE_SIZE);
+  if (!frame->Validate(frame_version)) {
+    return false;
+  }
+  if (version != nullptr) {
+    *version = {frame, frame_version};
+  }
+  return true;
+}
+
+auto BufferPoolInstance::ValidatePage(const PageVersion &version) -> bool
+{
+  return version.frame != nullptr && version.frame->Validate(version.version);
+}
+
+auto BufferPoolInstance::UnpinPage(file_id_t fid, page_id_t pid, bool is_dirty) -> bool
+{
+  std::scoped_lock lock(latch_);
+
+  frame_id_t frame_id = page_table_.Find(fid, pid);
+  if (frame_id == INVALID_FRAME_ID) {
+    return false;
+  }
+
+  Frame *frame = frames_[frame_id].get();
+
+  if (frame->GetPinCount() <= 0 || frame->IsIoInProgress()) {
+    return false;
+  }
+
+  if (is_dirty) {
+    frame->SetDirty(true);
+  }
+
+  frame->Unpin();
+  if (frame->GetPinCount() == 0) {
+    replacer_->Unpin(frame_id);
+  }
+
+  return true;
+}
+
+auto BufferPoolInstance::DeletePage(file_id_t fid, page_id_t pid) -> bool
+{
+  std::unique_lock lock(latch_);
+  WaitPageIdle(fid, pid, lock);
+
+  frame_id_t frame_id = page_table_.Find(fid, pid);
+  if (frame_id == INVALID_FRAME_ID) {
+    return true;
+  }
+
+  Frame *frame = frames_[frame_id].get();
+
+  if (frame->GetPinCount() > 0) {
+    return false;
+  }
+
+  if (frame->IsDirty()) {
+    disk_manager_->WritePage(fid, pid, frame->GetPage()->GetData());
+  }
+
+  page_table_.Erase(fid, pid);
+
+  replacer_->Pin(frame_id);
+
+  frame->Reset();
+  free_list_.push_back(frame_id);
+
+  return true;
+}
+
+auto BufferPoolInstance::DeleteAllPages(file_id_t fid) -> bool
+{
+  std::unique_lock lock(latch_);
+  WaitFileIdle(fid, lock);
+  WriteDirtyPages(fid);
+
+  for (const auto &[pid, frame_id] : page_table_.GetFilePages(fid)) {
+    Frame *frame = frames_[frame_id].get();
+
+    if (frame->GetPinCount() > 0) {
+      return false;
+    }
+
+    replacer_->Pin(frame_id);
+
+    frame->Reset();
+    free_list_.push_back(frame_id);
+
+    page_table_.Erase(fid, pid);
+  }
+  return true;
+}
+
+auto BufferPoolInstance::FlushPage(file_id_t fid, page_id_t pid) -> bool
+{
+  std::unique_lock lock(latch_);
+  WaitPageIdle(fid, pid, lock);
+
+  frame_id_t frame_id = page_table_.Find(fid, pid);
+  if (frame_id == INVALID_FRAME_ID) {
+    return false;
+  }
+
+  Frame *frame = frames_[frame_id].get();
+
+  if (frame->IsDirty()) {
+    disk_manager_->WritePage(fid, pid, frame->GetPage()->GetData());
+    frame->SetDirty(false);
+  }
+
+  return true;
+}
+
+auto BufferPoolInstance::FlushAllPages(file_id_t fid) -> bool
+{
+  std::unique_lock lock(latch_);
+  WaitFileIdle(fid, lock);
+  WriteDirtyPages(fid);
+  return true;
+}
+
+auto BufferPoolInstance::Resize(size_t pool_size) -> bool
+{
+  std::unique_lock lock(latch_);
+  if (pool_size == 0) {
+    return false;
+  }
+  pending_cv_.wait(lock, [this]() { return pending_writes_.empty(); });
+  size_t old_size = frames_.size();
+  if (pool_size >= old_size) {
+    frames_.reserve(pool_size);
+    for (size_t i = old_size; i < pool_size; i++) {
+      if (retired_frames_.empty()) {
+        frames_.push_back(std::make_unique<Frame>());
+      } else {
+        frames_.push_back(std::move(retired_frames_.back()));
+        retired_frames_.pop_back();
+      }
+      free_list_.push_back(static_cast<frame_id_t>(i));
+    }
+    replacer_->Resize(pool_size);
+    return true;
+  }
+  // shrink: frames at the tail are released, none of them can be in use
+  for (size_t i = pool_size; i < old_size; i++) {
+    if (frames_[i]->InUse()) {
+      return false;
+    }
+  }
+  for (size_t i = pool_size; i < old_size; i++) {
+    auto   frame_id = static_cast<frame_id_t>(i);
+    Frame *frame    = frames_[i].get();
+    Page  *page     = frame->GetPage();
+    if (page_table_.Find(page->GetFileId(), page->GetPageId()) == frame_id) {
+      if (frame->IsDirty()) {
+        disk_manager_->WritePage(page->GetFileId(), page->GetPageId(), page->GetData());
+      }
+      page_table_.Erase(page->GetFileId(), page->GetPageId());
+    }
+    replacer_->Remove(frame_id);
+    // optimistic readers may still be looking at the frame, keep it alive
+    frame->Reset();
+    retired_frames_.push_back(std::move(frames_[i]));
+  }
+  free_list_.remove_if([pool_size](frame_id_t frame_id) { return frame_id >= static_cast<frame_id_t>(pool_size); });
+  frames_.resize(pool_size);
+  replacer_->Resize(pool_size);
+  return true;
+}
+
+auto BufferPoolInstance::GetPoolSize() -> size_t
+{
+  std::scoped_lock lock(latch_);
+  return frames_.size();
+}
+
+auto BufferPoolInstance::CleanPages(size_t clean_target, size_t max_writes) -> size_t
+{
+  std::unique_lock       lock(latch_);
+  std::vector<fid_pid_t> keys;
+  std::vector<char>      buffer;
+  for (auto frame_id : replacer_->Candidates(clean_target)) {
+    if (keys.size() >= max_writes) {
+      break;
+    }
+    Frame *frame = frames_[frame_id].get();
+    Page  *page  = frame->GetPage();
+    if (!frame->IsDirty() || frame->InUse() || frame->IsIoInProgress() ||
+        pending_writes_.count({page->GetFileId(), page->GetPageId()}) > 0) {
+      continue;
+    }
+    // write a copy so that the frame stays available to fetchers and the replacer order is untouched
+    keys.push_back({page->GetFileId(), page->GetPageId()});
+    buffer.insert(buffer.end(), page->GetData(), page->GetData() + PAGE_SIZE);
+    frame->SetDirty(false);
+    pending_writes_.insert(keys.back());
+    BeginFileIo(page->GetFileId());
+  }
+  if (keys.empty()) {
+    return 0;
+  }
+
+  lock.unlock();
+  std::vector<bool> written(keys.size(), false);
+  for (size_t i = 0; i < keys.size(); i++) {
+    try {
+      disk_manager_->WritePage(keys[i].fid, keys[i].pid, buffer.data() + i * PAGE_SIZE);
+      written[i] = true;
+    } catch (const NJUDBException_ &e) {
+      // leave the page to the foreground
+    }
+  }
+  lock.lock();
+
+  size_t num_written = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (written[i]) {
+      num_written++;
+      continue;
+    }
+    frame_id_t frame_id = page_table_.Find(keys[i].fid, keys[i].pid);
+    if (frame_id != INVALID_FRAME_ID && IsMapped(frame_id, keys[i].fid, keys[i].pid)) {
+      frames_[frame_id]->SetDirty(true);
+    }
+  }
+  for (const auto &key : keys) {
+    pending_writes_.erase(key);
+    EndFileIo(key.fid);
+  }
+  background_flushes_ += num_written;
+  pending_cv_.notify_all();
+  return num_written;
+}
+
+auto BufferPoolInstance::GetStats() -> BufferPoolStats
+{
+  std::scoped_lock lock(latch_);
+  return {hits_, misses_, foreground_flushes_, background_flushes_, prefetches_};
+}
+
+auto BufferPoolInstance::GetAvailableFrame() -> frame_id_t
+{
+  if (!free_list_.empty()) {
+    frame_id_t frame_id = free_list_.front();
+    free_list_.pop_front();
+    return frame_id;
+  }
+
+  frame_id_t victim_id;
+  if (replacer_->Victim(&victim_id)) {
+    return victim_id;
+  }
+
+  NJUDB_THROW(NJUDB_NO_FREE_FRAME, "No free frame available in buffer pool");
+}
+
+auto BufferPoolInstance::GetRingFrame(BufferRing *ring) -> frame_id_t
+{
+  const auto *slot = ring->Peek();
+  if (slot == nullptr || slot->frame_id >= static_cast<frame_id_t>(frames_.size())) {
+    return INVALID_FRAME_ID;
+  }
+  Frame *frame = frames_[slot->frame_id].get();
+  // the frame may have been evicted and reused by others, or be pinned by another query
+  if (!IsMapped(slot->frame_id, slot->fid, slot->pid) || frame->InUse() || frame->IsIoInProgress()) {
+    return INVALID_FRAME_ID;
+  }
+  replacer_->Remove(slot->frame_id);
+  return slot->frame_id;
+}
+
+void BufferPoolInstance::UpdateFrame(frame_id_t frame_id, file_id_t fid, page_id_t pid, std::unique_lock<std::mutex> &lock)
+{
+  Frame    *frame  = frames_[frame_id].get();
+  Page     *page   = frame->GetPage();
+  fid_pid_t victim = {page->GetFileId(), page->GetPageId()};
+
+  // reserve the frame, fetchers of both the victim and the new page find it and wait for the I/O
+  frame->Pin();
+  frame->SetPrefetched(false);
+  replacer_->Bind(frame_id, fid, pid);
+  replacer_->Pin(frame_id);
+  frame->SetIoInProgress(true);
+  page_table_.Insert(fid, pid, frame_id);
+  BeginFileIo(fid);
+  bool victim_io = victim.fid != INVALID_FILE_ID;
+  if (victim_io) {
+    BeginFileIo(victim.fid);
+  }
+
+  // an older copy of either page may still be on its way to disk by the page cleaner
+  pending_cv_.wait(lock, [&]() { return pending_writes_.count(victim) == 0 && pending_writes_.count({fid, pid}) == 0; });
+  bool write_back = frame->IsDirty();
+  frame->SetDirty(false);
+  if (write_back) {
+    foreground_flushes_++;
+  } else {
+    page_table_.Erase(victim.fid, victim.pid);
+    if (victim_io) {
+      EndFileIo(victim.fid);
+      victim_io = false;
+    }
+  }
+
+  // optimistic readers of either page back off until the frame holds the new page
+  frame->BeginUpdate();
+  lock.unlock();
+  bool written = false;
+  try {
+    if (write_back) {
+      disk_manager_->WritePage(victim.fid, victim.pid, page->GetData());
+    }
+    written = true;
+    memset(page->GetData(), 0, PAGE_SIZE);
+    disk_manager_->ReadPage(fid, pid, page->GetData());
+  } catch (const NJUDBException_ &e) {
+    lock.lock();
+    page_table_.Erase(fid, pid);
+    if (write_back && !written) {
+      // the victim is still cached and dirty
+      frame->SetDirty(true);
+    } else {
+      if (write_back) {
+        page_table_.Erase(victim.fid, victim.pid);
+      }
+      page->SetFilePageId(INVALID_FILE_ID, INVALID_PAGE_ID);
+    }
+    frame->EndUpdate();
+    frame->SetIoInProgress(false);
+    frame->NotifyIo();
+    EndFileIo(fid);
+    if (victim_io) {
+      EndFileIo(victim.fid);
+    }
+    ReleaseFrame(frame_id);
+    throw;
+  }
+  lock.lock();
+
+  if (write_back) {
+    page_table_.Erase(victim.fid, victim.pid);
+  }
+  page->SetFilePageId(fid, pid);
+  frame->EndUpdate();
+  frame_hints_[HintSlot(fid, pid)].store(frame, std::memory_order_release);
+  frame->SetIoInProgress(false);
+  frame->NotifyIo();
+  EndFileIo(fid);
+  if (victim_io) {
+    EndFileIo(victim.fid);
+  }
+}
+
+void BufferPoolInstance::WriteDirtyPages(file_id_t fid)
+{
+  auto pages = page_table_.GetFilePages(fid);
+  std::sort(pages.begin(), pages.end());
+  std::vector<Frame *>      run;
+  std::vector<const char *> data;
+  auto                      write_run = [&]() {
+    if (run.empty()) {
+      return;
+    }
+    for (Frame *frame : run) {
+      data.push_back(frame->GetPage()->GetData());
+    }
+    // a failed write throws with the frames still dirty
+    disk_manager_->WritePages(fid, run.front()->GetPage()->GetPageId(), data);
+    for (Frame *frame : run) {
+      frame->SetDirty(false);
+    }
+    run.clear();
+    data.clear();
+  };
+  for (const auto &[pid, frame_id] : pages) {
+    Frame *frame = frames_[frame_id].get();
+    if (!frame->IsDirty()) {
+      continue;
+    }
+    if (!run.empty() && pid != run.back()->GetPage()->GetPageId() + 1) {
+      write_run();
+    }
+    run.push_back(frame);
+  }
+  write_run();
+}
+
+void BufferPoolInstance::WaitFrameIo(frame_id_t frame_id, std::unique_lock<std::mutex> &lock)
+{
+  Frame *frame = frames_[frame_id].get();
+  frame->Pin();
+  replacer_->Pin(frame_id);
+  frame->WaitIo(lock);
+}
+
+void BufferPoolInstance::WaitPageIdle(file_id_t fid, page_id_t pid, std::unique_lock<std::mutex> &lock)
+{
+  while (true) {
+    if (pending_writes_.count({fid, pid}) > 0) {
+      pending_cv_.wait(lock);
+      continue;
+    }
+    frame_id_t frame_id = page_table_.Find(fid, pid);
+    if (frame_id != INVALID_FRAME_ID && frames_[frame_id]->IsIoInProgress()) {
+      WaitFrameIo(frame_id, lock);
+      ReleaseFrame(frame_id);
+      continue;
+    }
+    return;
+  }
+}
+
+void BufferPoolInstance::WaitFileIdle(file_id_t fid, std::unique_lock<std::mutex> &lock)
+{
+  pending_cv_.wait(lock, [&]() { return file_io_.count(fid) == 0; });
+}
+
+void BufferPoolInstance::BeginFileIo(file_id_t fid) { file_io_[fid]++; }
+
+void BufferPoolInstance::EndFileIo(file_id_t fid)
+{
+  auto iter = file_io_.find(fid);
+  if (--iter->second == 0) {
+    file_io_.erase(iter);
+    pending_cv_.notify_all();
+  }
+}
+
+void BufferPoolInstance::ReleaseFrame(frame_id_t frame_id)
+{
+  Frame *frame = frames_[frame_id].get();
+  frame->Unpin();
+  if (frame->GetPinCount() > 0) {
+    return;
+  }
+  Page *page = frame->GetPage();
+  if (IsMapped(frame_id, page->GetFileId(), page->GetPageId())) {
+    replacer_->Unpin(frame_id);
+  } else {
+    // the load failed, nobody else can reach the frame
+    frame->Reset();
+    free_list_.push_back(frame_id);
+  }
+}
+
+void BufferPoolInstance::TakePrefetched(Frame *frame, bool *cold)
+{
+  if (cold != nullptr) {
+    *cold = frame->IsPrefetched();
+  }
+  frame->SetPrefetched(false);
+}
+
+auto BufferPoolInstance::HintSlot(file_id_t fid, page_id_t pid) const -> size_t
+{
+  // BufferPoolManager routes pages by the high half of the same hash and the page table probes from the lowest bits,
+  // use the top bits of the low half
+  auto low = static_cast<uint32_t>(std::hash<fid_pid_t>()({fid, pid}));
+  return low >> (32 - hint_bits_);
+}
+
+auto BufferPoolInstance::IsMapped(frame_id_t frame_id, file_id_t fid, page_id_t pid) -> bool
+{
+  Page *page = frames_[frame_id]->GetPage();
+  if (page->GetFileId() != fid || page->GetPageId() != pid) {
+    return false;
+  }
+  return page_table_.Find(fid, pid) == frame_id;
+}
+
+auto BufferPoolInstance::GetFrame(file_id_t fid, page_id_t pid) -> Frame *
+{
+  frame_id_t frame_id = page_table_.Find(fid, pid);
+  return frame_id == INVALID_FRAME_ID ? nullptr : frames_[frame_id].get();
+}
+
+}  // namespace njudb
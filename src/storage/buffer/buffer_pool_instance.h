@@ -0,0 +1,324 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_BUFFER_POOL_INSTANCE_H
+#define NJUDB_BUFFER_POOL_INSTANCE_H
+
+#include <condition_variable>  // NOLINT
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "storage/disk/disk_manager.h"
+#include "log/log_manager.h"
+#include "replacer/replacer.h"
+#include "buffer_access_strategy.h"
+#include "page_table.h"
+#include "frame.h"
+#include "common/page.h"
+
+namespace njudb {
+
+/**
+ * Counters of a buffer pool, a flush is a write back of a dirty page that is about to be victimized
+ */
+struct BufferPoolStats
+{
+  size_t hits{0};                // fetches served by a cached page
+  size_t misses{0};              // fetches that read the page from disk
+  size_t foreground_flushes{0};  // written back on the miss path by the thread that needs the frame
+  size_t background_flushes{0};  // written back ahead of eviction by the page cleaner
+  size_t prefetches{0};          // read from disk by read-ahead, the first fetch of such a page counts as a hit
+};
+
+/**
+ * The frame and its version an optimistic read was taken at, see BufferPoolInstance::ReadPageOptimistic
+ */
+struct PageVersion
+{
+  const Frame *frame{nullptr};
+  uint64_t     version{0};
+};
+
+/**
+ * One partition of the buffer pool. Every instance owns its latch, frames, free list, replacer and lookup table, so
+ * instances never contend with each other. BufferPoolManager routes each page to exactly one instance.
+ */
+class BufferPoolInstance
+{
+public:
+  /**
+   * @param disk_manager
+   * @param log_manager
+   * @param replacer_lru_k k for LRUKReplacer, ignored by other replacers
+   * @param pool_size number of frames in this instance
+   * @param replacer class name of the replacement policy, see Replacer::Create
+   */
+  BufferPoolInstance(DiskManager *disk_manager, LogManager *log_manager, size_t replacer_lru_k, size_t pool_size,
+      const std::string &replacer);
+
+  ~BufferPoolInstance() = default;
+
+  DISABLE_COPY_MOVE_AND_ASSIGN(BufferPoolInstance)
+
+  /**
+   * Fetch the requested page from disk.
+   * 1. grant the latch
+   * 2. check if the page is in the frame
+   * 3. if the page is not in the frame, GetAvailableFrame and UpdateFrame, the latch is released during the disk I/O
+   * 4. else pin the frame both in the buffer and the replacer, if the frame has I/O in progress, wait for it and
+   *    check again that the frame holds the page
+   * 5. return the page
+   * a miss through a ring reuses the frame of the ring (GetRingFrame) if possible, and puts the frame into the ring
+   * @param fid file that the page belongs to
+   * @param pid page id
+   * @param ring the ring of the caller's BufferAccessStrategy, nullptr to use the whole pool
+   * @param cold set to true if the page was read from disk for this fetch or by read-ahead ahead of it, i.e. the
+   * fetch would have missed without read-ahead
+   * @return the frame holding the page, nullptr if no frame is available
+   */
+  auto FetchFrame(file_id_t fid, page_id_t pid, BufferRing *ring = nullptr, bool *cold = nullptr) -> Frame *;
+
+  /**
+   * Load the page into an available frame without pinning it, called by the read-ahead thread
+   * 1. grant the latch, return false if the page is already cached
+   * 2. GetAvailableFrame and UpdateFrame, mark the frame prefetched
+   * 3. unpin the frame so that it can be victimized
+   * @return true if the page is read from disk
+   */
+  auto PrefetchPage(file_id_t fid, page_id_t pid) -> bool;
+
+  /**
+   * Copy the page without pinning it or granting any latch, see Frame::BeginUpdate
+   * 1. find the frame in frame_hints_, return false if the slot is empty
+   * 2. read the version of the frame, return false if it is odd or the frame holds another page
+   * 3. copy the page and validate the version
+   * The replacer is not told about the access, a page only ever read optimistically may be victimized.
+   * @param data buffer of PAGE_SIZE bytes
+   * @param version set to the frame and the version the copy was taken at, for ValidatePage
+   * @return true if data holds a consistent copy, otherwise the caller should fall back to FetchFrame
+   */
+  auto ReadPageOptimistic(file_id_t fid, page_id_t pid, char *data, PageVersion *version = nullptr) -> bool;
+
+  /**
+   * @return true if the page has not changed since the optimistic read that returned the version
+   */
+  static auto ValidatePage(const PageVersion &version) -> bool;
+
+  /**
+   * Unpin the page indicating that it can be victimized
+   * 1. grant the latch
+   * 2. if the frame is not in the buffer or the frame is not in use, return false
+   * 3. unpin the frame, after that if the frame is not in use, unpin the frame in the replacer
+   * 4. set the frame dirty if the page is dirty
+   * @param fid
+   * @param pid
+   * @param is_dirty
+   * @return true if the page is unpinned successfully
+   */
+  auto UnpinPage(file_id_t fid, page_id_t pid, bool is_dirty) -> bool;
+
+  /**
+   * Delete the page from the buffer pool
+   * 1. grant the latch
+   * 2. if the page is not in the buffer, return true
+   * 3. if the page is in use, return false
+   * 4. flush the page to disk, reset the frame, add the frame to the free list and unpin the frame in the replacer
+   * 5. update the page_table_
+   * @param fid
+   * @param pid
+   * @return true if the page is deleted successfully
+   */
+  auto DeletePage(file_id_t fid, page_id_t pid) -> bool;
+
+  /**
+   * Delete all pages belong to the file
+   * @param fid
+   * @return true if all pages are deleted successfully
+   */
+  auto DeleteAllPages(file_id_t fid) -> bool;
+
+  /**
+   * Flush the page to disk
+   * 1. grant the latch
+   * 2. if the page is not in the buffer, return false
+   * 3. flush the page to disk if the page is dirty
+   * @param fid
+   * @param pid
+   * @return true if the page is flushed successfully
+   */
+  auto FlushPage(file_id_t fid, page_id_t pid) -> bool;
+
+  /**
+   * Flush all pages of the file to disk
+   * 1. grant the latch and wait until no page of the file has I/O in progress
+   * 2. write the dirty pages in the order of their page ids, each run of contiguous pages with one vectored write
+   * @param fid
+   * @return
+   */
+  auto FlushAllPages(file_id_t fid) -> bool;
+
+  /**
+   * Grow or shrink the instance online
+   * 1. grant the latch
+   * 2. if growing, append new frames and add them to the free list
+   * 3. if shrinking, all frames to be released must not be pinned, otherwise return false and leave the pool unchanged
+   * 4. flush the dirty frames to be released, remove them from page_table_, the free list and the replacer
+   * @param pool_size the new number of frames, must be greater than 0
+   * @return true if the instance is resized successfully
+   */
+  auto Resize(size_t pool_size) -> bool;
+
+  /**
+   * @return the current number of frames in this instance
+   */
+  auto GetPoolSize() -> size_t;
+
+  /**
+   * Write back dirty frames that are about to be victimized, called by the page cleaner
+   * 1. grant the latch and peek clean_target candidates from the replacer
+   * 2. copy at most max_writes dirty and unpinned candidates, mark them clean and add them to pending_writes_
+   * 3. release the latch and write the copies to disk
+   * 4. grant the latch again, mark the pages failed to write dirty again, clear pending_writes_ and wake up the waiters
+   * @param clean_target number of frames at the head of the eviction order that should be clean
+   * @param max_writes maximum number of pages written by this call
+   * @return number of pages written
+   */
+  auto CleanPages(size_t clean_target, size_t max_writes) -> size_t;
+
+  auto GetStats() -> BufferPoolStats;
+
+  /**
+   * Get the frame, used for test
+   */
+  auto GetFrame(file_id_t fid, page_id_t pid) -> Frame *;
+
+private:
+  /// sub procedures used by public APIs, should not be locked by latch
+
+  /**
+   * Get the available frame
+   * 1. if the free list is not empty, get the frame id from the free list
+   * 2. else use the replacer to get the frame id, the victim is written back later by UpdateFrame
+   * 3. if no frame can be evicted, throw NJUDB_NO_FREE_FRAME
+   * @return the frame id
+   */
+  auto GetAvailableFrame() -> frame_id_t;
+
+  /**
+   * Get the frame to reuse from the ring
+   * 1. if the ring is not full, return INVALID_FRAME_ID
+   * 2. if the frame in the slot no longer holds the page the ring loaded, or is in use, return INVALID_FRAME_ID
+   * 3. remove the frame from the replacer and return it, its page is the victim of UpdateFrame
+   * @return the frame id, INVALID_FRAME_ID if the caller should GetAvailableFrame
+   */
+  auto GetRingFrame(BufferRing *ring) -> frame_id_t;
+
+  /**
+   * Update the frame
+   * 1. pin the frame in the buffer and the replacer, mark it I/O in progress and map the new page to it, the victim
+   *    stays mapped so that its fetchers wait instead of reading a stale page
+   * 2. wait until the page cleaner is not writing either page, unmap the victim if it is clean
+   * 3. release the latch, flush the victim to disk if it is dirty and read the new page
+   * 4. grant the latch again, update the page_table_ and wake up the waiters of the frame
+   * if the I/O fails, the frame is restored (or released if the victim is already written) and the error is rethrown
+   * @param frame_id the frame to update
+   * @param fid the file needs to be updated to the frame
+   * @param pid the page needs to be updated to the frame
+   * @param lock the lock holding latch_
+   */
+  void UpdateFrame(frame_id_t frame_id, file_id_t fid, page_id_t pid, std::unique_lock<std::mutex> &lock);
+
+  /**
+   * Write the dirty pages of the file sorted by page id, coalescing contiguous pages into DiskManager::WritePages
+   */
+  void WriteDirtyPages(file_id_t fid);
+
+  /**
+   * Pin the frame and wait for its I/O to finish, the caller should ReleaseFrame it if the page is not wanted
+   */
+  void WaitFrameIo(frame_id_t frame_id, std::unique_lock<std::mutex> &lock);
+
+  /**
+   * Wait until the page is neither written by the page cleaner nor has I/O in progress
+   */
+  void WaitPageIdle(file_id_t fid, page_id_t pid, std::unique_lock<std::mutex> &lock);
+
+  /**
+   * Wait until no page of the file is written by the page cleaner or has I/O in progress, see file_io_
+   */
+  void WaitFileIdle(file_id_t fid, std::unique_lock<std::mutex> &lock);
+
+  /**
+   * Count a write or a read of a page of the file that runs without the latch
+   */
+  void BeginFileIo(file_id_t fid);
+
+  /**
+   * Finish a write or a read counted by BeginFileIo, wake up the waiters of WaitFileIdle once the file is idle
+   */
+  void EndFileIo(file_id_t fid);
+
+  /**
+   * Drop a pin taken by WaitFrameIo, a frame left unmapped by a failed load goes back to the free list
+   */
+  void ReleaseFrame(frame_id_t frame_id);
+
+  /**
+   * Clear the prefetched mark of a frame being fetched, the first fetch of a prefetched page is reported as cold
+   */
+  void TakePrefetched(Frame *frame, bool *cold);
+
+  /**
+   * @return true if the frame holds the page and page_table_ maps the page to the frame
+   */
+  auto IsMapped(frame_id_t frame_id, file_id_t fid, page_id_t pid) -> bool;
+
+  /**
+   * Slot of the page in frame_hints_
+   */
+  auto HintSlot(file_id_t fid, page_id_t pid) const -> size_t;
+
+private:
+  std::mutex                                latch_;
+  DiskManager                              *disk_manager_;
+  LogManager                               *log_manager_;
+  std::unique_ptr<Replacer>                 replacer_;
+  std::vector<std::unique_ptr<Frame>>       frames_;  // frames are never moved, pages handed out stay valid
+  std::vector<std::unique_ptr<Frame>>       retired_frames_;  // released by shrinking, optimistic readers may see them
+  // direct-mapped hints from pages to frames for optimistic readers, written under the latch, a stale hint is
+  // detected by checking the page held by the frame
+  std::unique_ptr<std::atomic<Frame *>[]>   frame_hints_;
+  size_t                                    hint_bits_;
+  std::list<frame_id_t>                     free_list_;
+  PageTable                                 page_table_;
+  std::unordered_set<fid_pid_t>             pending_writes_;  // pages being written from a copy by the page cleaner
+  std::unordered_map<file_id_t, size_t>     file_io_;  // writes and reads in flight of each file, idle files absent
+  std::condition_variable                   pending_cv_;
+  size_t                                    hits_{0};
+  size_t                                    misses_{0};
+  size_t                                    foreground_flushes_{0};
+  size_t                                    background_flushes_{0};
+  size_t                                    prefetches_{0};
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_BUFFER_POOL_INSTANCE_H
@@ -20,230 +20,351 @@
 //
 #include "buffer_pool_manager.h"
 #include "page_guard.h"
-#include "replacer/lru_replacer.h"
-#include "replacer/lru_k_replacer.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
 
 #include "../../../common/error.h"
 
 namespace njudb {
 
-BufferPoolManager::BufferPoolManager(DiskManager *disk_manager, njudb::LogManager *log_manager, size_t replacer_lru_k)
-    : disk_manager_(disk_manager), log_manager_(log_manager)
-{
-  if (REPLACER == "LRUReplacer") {
-    replacer_ = std::make_unique<LRUReplacer>();
-  } else if (REPLACER == "LRUKReplacer") {
-    replacer_ = std::make_unique<LRUKReplacer>(replacer_lru_k);
-  } else {
-    NJUDB_FATAL("Unknown replacer: " + REPLACER);
-  }
-  // init free_list_
-  for (frame_id_t i = 0; i < static_cast<int>(BUFFER_POOL_SIZE); i++) {
-    free_list_.push_back(i);
-  }
-}
-
-auto BufferPoolManager::FetchPage(file_id_t fid, page_id_t pid) -> Page * {
-  std::scoped_lock lock(latch_);
-  auto iter = page_frame_lookup_.find({fid, pid});
-  
-  if (iter != page_frame_lookup_.end()) {
-    frame_id_t frame_id = iter->second;
-    Frame *frame = &frames_[frame_id];
-    
-    frame->Pin();
-    replacer_->Pin(frame_id);
-    return frame->GetPage();
-  } else {
-    try {
-      frame_id_t frame_id = GetAvailableFrame();
-      UpdateFrame(frame_id, fid, pid);
-      return frames_[frame_id].GetPage();
-    } catch (const NJUDBException_ &e) {
-      return nullptr;
-    }
+BufferPoolManager::BufferPoolManager(DiskManager *disk_manager, njudb::LogManager *log_manager, size_t replacer_lru_k,
+    size_t pool_size, size_t num_instances, const std::string &replacer)
+    : disk_manager_(disk_manager)
+{
+  NJUDB_ASSERT(num_instances > 0, "number of buffer pool instances should be greater than 0");
+  NJUDB_ASSERT(pool_size >= num_instances, "each buffer pool instance should have at least one frame");
+  instances_.reserve(num_instances);
+  for (size_t i = 0; i < num_instances; i++) {
+    instances_.push_back(std::make_unique<BufferPoolInstance>(
+        disk_manager, log_manager, replacer_lru_k, InstanceSize(pool_size, num_instances, i), replacer));
   }
 }
 
-auto BufferPoolManager::UnpinPage(file_id_t fid, page_id_t pid, bool is_dirty) -> bool {
-  std::scoped_lock lock(latch_);
-  
-  auto iter = page_frame_lookup_.find({fid, pid});
-  if (iter == page_frame_lookup_.end()) {
-    return false;
-  }
-  
-  frame_id_t frame_id = iter->second;
-  Frame *frame = &frames_[frame_id];
-  
-  if (frame->GetPinCount() <= 0) {
-    return false;
+BufferPoolManager::~BufferPoolManager()
+{
+  StopReadAhead();
+  StopPageCleaner();
+}
+
+auto BufferPoolManager::FetchPage(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy) -> Page *
+{
+  Frame *frame = FetchFrame(fid, pid, strategy);
+  return frame == nullptr ? nullptr : frame->GetPage();
+}
+
+auto BufferPoolManager::ReadPageOptimistic(file_id_t fid, page_id_t pid, char *data, PageVersion *version) -> bool
+{
+  return GetInstance(fid, pid)->ReadPageOptimistic(fid, pid, data, version);
+}
+
+auto BufferPoolManager::ValidatePage(const PageVersion &version) -> bool
+{
+  return BufferPoolInstance::ValidatePage(version);
+}
+
+auto BufferPoolManager::UnpinPage(file_id_t fid, page_id_t pid, bool is_dirty) -> bool
+{
+  return GetInstance(fid, pid)->UnpinPage(fid, pid, is_dirty);
+}
+
+auto BufferPoolManager::DeletePage(file_id_t fid, page_id_t pid) -> bool
+{
+  return GetInstance(fid, pid)->DeletePage(fid, pid);
+}
+
+auto BufferPoolManager::DeleteAllPages(file_id_t fid) -> bool
+{
+  {
+    auto            &shard = read_ahead_shards_[static_cast<size_t>(fid) % READ_AHEAD_SHARDS];
+    std::scoped_lock lock(shard.latch);
+    shard.states.erase(fid);
   }
-  
-  if (is_dirty) {
-    frame->SetDirty(true);
+  {
+    // the file is going away, make sure the read-ahead does not load its pages again
+    std::unique_lock lock(read_ahead_latch_);
+    std::erase_if(prefetch_queue_, [fid](const PrefetchRequest &request) { return request.fid == fid; });
+    read_ahead_cv_.wait(lock, [this, fid]() { return prefetching_fid_ != fid; });
   }
-  
-  frame->Unpin();
-  if (frame->GetPinCount() == 0) {
-    replacer_->Unpin(frame_id);
+  bool success = true;
+  for (auto &instance : instances_) {
+    success = instance->DeleteAllPages(fid) && success;
   }
-  
-  return true;
+  return success;
 }
 
-auto BufferPoolManager::DeletePage(file_id_t fid, page_id_t pid) -> bool {
-  std::scoped_lock lock(latch_);
-  
-  auto iter = page_frame_lookup_.find({fid, pid});
-  if (iter == page_frame_lookup_.end()) {
-    return true;
+auto BufferPoolManager::FlushPage(file_id_t fid, page_id_t pid) -> bool
+{
+  return GetInstance(fid, pid)->FlushPage(fid, pid);
+}
+
+auto BufferPoolManager::FlushAllPages(file_id_t fid) -> bool
+{
+  bool success = true;
+  for (auto &instance : instances_) {
+    success = instance->FlushAllPages(fid) && success;
   }
-  
-  frame_id_t frame_id = iter->second;
-  Frame *frame = &frames_[frame_id];
-  
-  if (frame->GetPinCount() > 0) {
+  return success;
+}
+
+auto BufferPoolManager::Resize(size_t pool_size) -> bool
+{
+  std::scoped_lock lock(resize_latch_);
+  if (pool_size < instances_.size()) {
     return false;
   }
-  
-  if (frame->IsDirty()) {
-      disk_manager_->WritePage(fid, pid, frame->GetPage()->GetData());
+  std::vector<size_t> old_sizes;
+  old_sizes.reserve(instances_.size());
+  for (size_t i = 0; i < instances_.size(); i++) {
+    old_sizes.push_back(instances_[i]->GetPoolSize());
+    if (!instances_[i]->Resize(InstanceSize(pool_size, instances_.size(), i))) {
+      // roll back the instances already resized, growing never fails
+      for (size_t j = 0; j < i; j++) {
+        instances_[j]->Resize(old_sizes[j]);
+      }
+      return false;
+    }
   }
-  
-  page_frame_lookup_.erase(iter);
-  
-  replacer_->Pin(frame_id);
-
-  frame->Reset();
-  free_list_.push_back(frame_id);
-  
+  std::scoped_lock read_ahead_lock(read_ahead_latch_);
+  ClampReadAhead(pool_size);
   return true;
 }
 
-auto BufferPoolManager::DeleteAllPages(file_id_t fid) -> bool {
-  std::scoped_lock lock(latch_);
-  
-  for (auto it = page_frame_lookup_.begin(); it != page_frame_lookup_.end(); ) {
-    if (it->first.fid == fid) {
-      frame_id_t frame_id = it->second;
-      Frame *frame = &frames_[frame_id];
-      
-      if (frame->GetPinCount() > 0) {
-          return false;
-      }
-      
-      if (frame->IsDirty()) {
-          disk_manager_->WritePage(fid, it->first.pid, frame->GetPage()->GetData());
-      }
-      
-      replacer_->Pin(frame_id);
-      
-      frame->Reset();
-      free_list_.push_back(frame_id);
-      
-      it = page_frame_lookup_.erase(it);
-    } else {
-      ++it;
+auto BufferPoolManager::GetPoolSize() -> size_t
+{
+  size_t pool_size = 0;
+  for (auto &instance : instances_) {
+    pool_size += instance->GetPoolSize();
+  }
+  return pool_size;
+}
+
+void BufferPoolManager::StartPageCleaner(size_t clean_frames)
+{
+  std::scoped_lock lock(cleaner_latch_);
+  if (cleaner_.joinable()) {
+    clean_frames_ = clean_frames;
+    return;
+  }
+  cleaner_stop_ = false;
+  clean_frames_ = clean_frames;
+  cleaner_      = std::thread(&BufferPoolManager::PageCleanerLoop, this);
+}
+
+void BufferPoolManager::StopPageCleaner()
+{
+  {
+    std::scoped_lock lock(cleaner_latch_);
+    if (!cleaner_.joinable()) {
+      return;
     }
+    cleaner_stop_ = true;
   }
-  return true;
+  cleaner_cv_.notify_all();
+  cleaner_.join();
 }
 
-auto BufferPoolManager::FlushPage(file_id_t fid, page_id_t pid) -> bool {
-  std::scoped_lock lock(latch_);
-  auto iter = page_frame_lookup_.find({fid, pid});
-  if (iter == page_frame_lookup_.end()) {
-    return false;
+void BufferPoolManager::PrefetchPages(file_id_t fid, page_id_t first_pid, size_t count)
+{
+  std::scoped_lock lock(read_ahead_latch_);
+  if (!read_ahead_.joinable() || count == 0 || prefetch_queue_.size() >= READ_AHEAD_QUEUE_SIZE) {
+    return;
   }
-  
-  frame_id_t frame_id = iter->second;
-  Frame *frame = &frames_[frame_id];
-  
-  if (frame->IsDirty()) {
-    disk_manager_->WritePage(fid, pid, frame->GetPage()->GetData());
-    frame->SetDirty(false);
+  prefetch_queue_.push_back({fid, first_pid, count});
+  read_ahead_cv_.notify_all();
+}
+
+void BufferPoolManager::StartReadAhead(size_t read_ahead_pages)
+{
+  std::scoped_lock lock(read_ahead_latch_);
+  if (!read_ahead_.joinable()) {
+    read_ahead_stop_ = false;
+    read_ahead_      = std::thread(&BufferPoolManager::ReadAheadLoop, this);
   }
-  
-  return true;
+  read_ahead_window_ = read_ahead_pages;
+  ClampReadAhead(GetPoolSize());
 }
 
-auto BufferPoolManager::FlushAllPages(file_id_t fid) -> bool {
-  std::scoped_lock lock(latch_);
-  for (const auto& pair : page_frame_lookup_) {
-    if (pair.first.fid == fid) {
-      frame_id_t frame_id = pair.second;
-      Frame *frame = &frames_[frame_id];
-      if (frame->IsDirty()) {
-        disk_manager_->WritePage(fid, pair.first.pid, frame->GetPage()->GetData());
-        frame->SetDirty(false);
-      }
+void BufferPoolManager::StopReadAhead()
+{
+  {
+    std::scoped_lock lock(read_ahead_latch_);
+    if (!read_ahead_.joinable()) {
+      return;
     }
+    read_ahead_stop_   = true;
+    read_ahead_window_ = 0;
+    read_ahead_pages_.store(0, std::memory_order_relaxed);
   }
-  return true;
+  read_ahead_cv_.notify_all();
+  read_ahead_.join();
+  {
+    std::scoped_lock lock(read_ahead_latch_);
+    prefetch_queue_.clear();
+  }
+  for (auto &shard : read_ahead_shards_) {
+    std::scoped_lock lock(shard.latch);
+    shard.states.clear();
+  }
+}
+
+auto BufferPoolManager::GetStats() -> BufferPoolStats
+{
+  BufferPoolStats stats;
+  for (auto &instance : instances_) {
+    auto instance_stats = instance->GetStats();
+    stats.hits += instance_stats.hits;
+    stats.misses += instance_stats.misses;
+    stats.foreground_flushes += instance_stats.foreground_flushes;
+    stats.background_flushes += instance_stats.background_flushes;
+    stats.prefetches += instance_stats.prefetches;
+  }
+  return stats;
 }
 
-auto BufferPoolManager::GetAvailableFrame() -> frame_id_t {
-  if (!free_list_.empty()) {
-    frame_id_t frame_id = free_list_.front();
-    free_list_.pop_front();
-    return frame_id;
-  }
-  
-  frame_id_t victim_id;
-  if (replacer_->Victim(&victim_id)) {
-    Frame *victim_frame = &frames_[victim_id];
-    
-    if (victim_frame->IsDirty()) {
-      disk_manager_->WritePage(victim_frame->GetPage()->GetFileId(), 
-                               victim_frame->GetPage()->GetPageId(), 
-                               victim_frame->GetPage()->GetData());
-      victim_frame->SetDirty(false);
+void BufferPoolManager::PageCleanerLoop()
+{
+  auto             wait = std::chrono::milliseconds(PAGE_CLEANER_MAX_WAIT_MS);
+  std::unique_lock lock(cleaner_latch_);
+  while (!cleaner_stop_) {
+    size_t clean_frames = clean_frames_;
+    lock.unlock();
+
+    size_t written = 0;
+    auto   begin   = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < instances_.size(); i++) {
+      written += instances_[i]->CleanPages(InstanceSize(clean_frames, instances_.size(), i), PAGE_CLEANER_BATCH);
     }
-    
-    page_frame_lookup_.erase({victim_frame->GetPage()->GetFileId(), victim_frame->GetPage()->GetPageId()});
-    victim_frame->Reset();
-    
-    return victim_id;
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    if (written == 0) {
+      wait = std::chrono::milliseconds(PAGE_CLEANER_MAX_WAIT_MS);
+    } else if (elapsed / written > std::chrono::microseconds(PAGE_CLEANER_IO_LATENCY_US)) {
+      // the disk is slow, leave it to the foreground for a while
+      wait = std::min(wait * 2, std::chrono::milliseconds(PAGE_CLEANER_MAX_WAIT_MS));
+    } else {
+      wait = std::chrono::milliseconds(PAGE_CLEANER_MIN_WAIT_MS);
+    }
+
+    lock.lock();
+    cleaner_cv_.wait_for(lock, wait, [this]() { return cleaner_stop_; });
   }
-  
-  throw NJUDBException_(NJUDB_NO_FREE_FRAME, "BufferPoolManager", "GetAvailableFrame", "No free frame available in buffer pool");
 }
 
-void BufferPoolManager::UpdateFrame(frame_id_t frame_id, file_id_t fid, page_id_t pid) {
-  Frame *frame = &frames_[frame_id];
-  
-  if (frame->IsDirty()) {
-     disk_manager_->WritePage(frame->GetPage()->GetFileId(), frame->GetPage()->GetPageId(), frame->GetPage()->GetData());
+void BufferPoolManager::ReadAhead(file_id_t fid, page_id_t pid)
+{
+  // cold fetches with the read-ahead off take no latch at all
+  auto window = static_cast<page_id_t>(read_ahead_pages_.load(std::memory_order_relaxed));
+  if (window == 0) {
+    return;
+  }
+  auto            &shard = read_ahead_shards_[static_cast<size_t>(fid) % READ_AHEAD_SHARDS];
+  std::scoped_lock lock(shard.latch);
+  auto            &state = shard.states[fid];
+  state.run      = pid == state.last_pid + 1 ? state.run + 1 : 1;
+  state.last_pid = pid;
+  if (state.run == 1 || state.next_pid - pid > window) {
+    // a new scan, or a jump back, what was requested for an earlier one says nothing about the pages ahead of it
+    state.next_pid = pid + 1;
+  }
+  if (state.run < READ_AHEAD_TRIGGER) {
+    return;
   }
+  // top up the window once the reader has consumed half of it, so that requests are issued in batches
+  state.next_pid = std::max(state.next_pid, pid + 1);
+  if (state.next_pid - pid > std::max(window / 2, 1)) {
+    return;
+  }
+  std::scoped_lock queue_lock(read_ahead_latch_);
+  if (read_ahead_stop_ || prefetch_queue_.size() >= READ_AHEAD_QUEUE_SIZE) {
+    return;
+  }
+  prefetch_queue_.push_back({fid, state.next_pid, static_cast<size_t>(pid + 1 + window - state.next_pid)});
+  state.next_pid = pid + 1 + window;
+  read_ahead_cv_.notify_all();
+}
 
-  frame->Reset();
-  frame->GetPage()->SetFilePageId(fid, pid);
-  
-  disk_manager_->ReadPage(fid, pid, frame->GetPage()->GetData());
-  
-  frame->Pin();
-  replacer_->Pin(frame_id);
-  
-  page_frame_lookup_[{fid, pid}] = frame_id;
+void BufferPoolManager::ClampReadAhead(size_t pool_size)
+{
+  // prefetched pages should not evict each other before the reader gets to them
+  read_ahead_pages_.store(std::min(read_ahead_window_, pool_size / 2), std::memory_order_relaxed);
+}
+
+void BufferPoolManager::ReadAheadLoop()
+{
+  std::unique_lock lock(read_ahead_latch_);
+  while (true) {
+    read_ahead_cv_.wait(lock, [this]() { return read_ahead_stop_ || !prefetch_queue_.empty(); });
+    if (read_ahead_stop_) {
+      break;
+    }
+    auto request = prefetch_queue_.front();
+    prefetch_queue_.pop_front();
+    prefetching_fid_ = request.fid;
+    lock.unlock();
+
+    try {
+      auto page_num = static_cast<page_id_t>(disk_manager_->GetFileSize(request.fid) / PAGE_SIZE);
+      auto end_pid  = std::min(page_num, static_cast<page_id_t>(request.first_pid + request.count));
+      for (auto pid = request.first_pid; pid < end_pid; pid++) {
+        GetInstance(request.fid, pid)->PrefetchPage(request.fid, pid);
+      }
+    } catch (const NJUDBException_ &e) {
+      // the file is closed, drop the request
+    }
+
+    lock.lock();
+    prefetching_fid_ = INVALID_FILE_ID;
+    read_ahead_cv_.notify_all();
+  }
 }
 
 auto BufferPoolManager::GetFrame(file_id_t fid, page_id_t pid) -> Frame *
 {
-  const auto it = page_frame_lookup_.find({fid, pid});
-  return it == page_frame_lookup_.end() ? nullptr : &frames_[it->second];
+  return GetInstance(fid, pid)->GetFrame(fid, pid);
+}
+
+auto BufferPoolManager::FetchPageRead(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy) -> ReadPageGuard
+{
+  return {this, FetchFrame(fid, pid, strategy), fid, pid};
 }
 
-auto BufferPoolManager::FetchPageRead(file_id_t fid, page_id_t pid) -> ReadPageGuard
+auto BufferPoolManager::FetchPageWrite(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy) -> WritePageGuard
 {
-  Page *page = FetchPage(fid, pid);
-  return {this, page, fid, pid};
+  return {this, FetchFrame(fid, pid, strategy), fid, pid};
+}
+
+auto BufferPoolManager::FetchFrame(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy) -> Frame *
+{
+  auto   i     = GetInstanceIndex(fid, pid);
+  bool   cold  = false;
+  Frame *frame = instances_[i]->FetchFrame(
+      fid, pid, strategy == nullptr ? nullptr : strategy->GetRing(i, instances_.size()), &cold);
+  if (cold && frame != nullptr) {
+    ReadAhead(fid, pid);
+  }
+  return frame;
+}
+
+auto BufferPoolManager::GetInstance(file_id_t fid, page_id_t pid) -> BufferPoolInstance *
+{
+  return instances_[GetInstanceIndex(fid, pid)].get();
+}
+
+auto BufferPoolManager::GetInstanceIndex(file_id_t fid, page_id_t pid) -> size_t
+{
+  if (instances_.size() == 1) {
+    return 0;
+  }
+  // route on the high half of the hash, the page table of the instance takes the home slot from the low bits, a
+  // power-of-two number of instances would otherwise leave every page of an instance the same low bits
+  uint64_t high = std::hash<fid_pid_t>()({fid, pid}) >> 32;
+  return static_cast<size_t>((high * instances_.size()) >> 32);
 }
 
-auto BufferPoolManager::FetchPageWrite(file_id_t fid, page_id_t pid) -> WritePageGuard
+auto BufferPoolManager::InstanceSize(size_t pool_size, size_t num_instances, size_t i) -> size_t
 {
-  Page *page = FetchPage(fid, pid);
-  return {this, page, fid, pid};
+  return pool_size / num_instances + (i < pool_size % num_instances ? 1 : 0);
 }
 
 }  // namespace njudb
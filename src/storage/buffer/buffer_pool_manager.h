@@ -22,70 +22,75 @@
 #ifndef NJUDB_BUFFER_POOL_MANAGER_H
 #define NJUDB_BUFFER_POOL_MANAGER_H
 
-#include <list>
+#include <array>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
 #include <vector>
-#include <array>
-#include "storage/disk/disk_manager.h"
-#include "log/log_manager.h"
-#include "replacer/replacer.h"
-#include "frame.h"
-#include "common/page.h"
+#include "buffer_pool_instance.h"
 
 namespace njudb {
 
 class ReadPageGuard;
 class WritePageGuard;
-struct fid_pid_t
-{
-  file_id_t fid;
-  page_id_t pid;
-
-  bool operator==(const fid_pid_t &rhs) const { return fid == rhs.fid && pid == rhs.pid; }
-};
-}  // namespace njudb
-
-namespace std {
-template <>
-struct hash<njudb::fid_pid_t>
-{
-  size_t operator()(const njudb::fid_pid_t &fp) const
-  {
-    return std::hash<table_id_t>()(fp.fid) ^ std::hash<frame_id_t>()(fp.pid);
-  }
-};
-}  // namespace std
-
-namespace njudb {
 
+/**
+ * The buffer pool is partitioned into several BufferPoolInstances, a page is always cached by the instance chosen by
+ * hashing its fid_pid_t, so threads touching pages of different instances never contend on the same latch.
+ */
 class BufferPoolManager
 {
 public:
-  explicit BufferPoolManager(DiskManager *disk_manager, LogManager *log_manager = nullptr, size_t replacer_lru_k = 0);
+  /**
+   * @param disk_manager
+   * @param log_manager
+   * @param replacer_lru_k k for LRUKReplacer, ignored by other replacers
+   * @param pool_size number of frames in the buffer pool, can be changed later by Resize
+   * @param num_instances number of partitions, frames are evenly distributed among them
+   * @param replacer class name of the replacement policy, see Replacer::Create
+   */
+  explicit BufferPoolManager(DiskManager *disk_manager, LogManager *log_manager = nullptr, size_t replacer_lru_k = 0,
+      size_t pool_size = BUFFER_POOL_SIZE, size_t num_instances = BUFFER_POOL_INSTANCES,
+      const std::string &replacer = REPLACER);
 
-  ~BufferPoolManager() = default;
+  ~BufferPoolManager();
 
   DISABLE_COPY_MOVE_AND_ASSIGN(BufferPoolManager)
 
   /**
-   * Fetch the requested page from disk.
-   * 1. grant the latch
-   * 2. check if the page is in the frame
-   * 3. if the page is not in the frame, GetAvailableFrame and UpdateFrame
-   * 4. else pin the frame both in the buffer and the replacer and return the page
+   * Fetch the requested page from the instance it belongs to, see BufferPoolInstance::FetchFrame. If the read-ahead is
+   * running, a cold fetch is reported to ReadAhead to detect sequential access.
    * @param fid file that the page belongs to
    * @param pid page id
-   * @return the page
+   * @param strategy bulk operations pass their strategy to confine misses to a ring of frames, nullptr by default
+   * @return the page, nullptr if no frame is available in the instance
+   */
+  auto FetchPage(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy = nullptr) -> Page *;
+
+  /**
+   * Copy a cached page without pinning it or granting any latch, see BufferPoolInstance::ReadPageOptimistic. Meant
+   * for hot read-only pages such as B+ tree inner nodes, the caller falls back to FetchPageRead on failure. The copy
+   * fails while a WritePageGuard holds the page.
+   * @param fid
+   * @param pid
+   * @param data buffer of PAGE_SIZE bytes
+   * @param version set to what ValidatePage checks later, if not nullptr
+   * @return true if data holds a consistent copy of the page
    */
-  auto FetchPage(file_id_t fid, page_id_t pid) -> Page *;
+  auto ReadPageOptimistic(file_id_t fid, page_id_t pid, char *data, PageVersion *version = nullptr) -> bool;
 
   /**
-   * Unpin the page indicating that it can be victimized
-   * 1. grant the latch
-   * 2. if the frame is not in the buffer or the frame is not in use, return false
-   * 3. unpin the frame, after that if the frame is not in use, unpin the frame in the replacer
-   * 4. set the frame dirty if the page is dirty
+   * @return true if the page has not been written, evicted or latched by a WritePageGuard since the optimistic read
+   * that set the version
+   */
+  auto ValidatePage(const PageVersion &version) -> bool;
+
+  /**
+   * Unpin the page indicating that it can be victimized, see BufferPoolInstance::UnpinPage
    * @param fid
    * @param pid
    * @param is_dirty
@@ -94,12 +99,7 @@ public:
   auto UnpinPage(file_id_t fid, page_id_t pid, bool is_dirty) -> bool;
 
   /**
-   * Delete the page from the buffer pool
-   * 1. grant the latch
-   * 2. if the page is not in the buffer, return true
-   * 3. if the page is in use, return false
-   * 4. flush the page to disk, reset the frame, add the frame to the free list and unpin the frame in the replacer
-   * 5. update the page_frame_lookup_
+   * Delete the page from the buffer pool, see BufferPoolInstance::DeletePage
    * @param fid
    * @param pid
    * @return true if the page is deleted successfully
@@ -107,17 +107,14 @@ public:
   auto DeletePage(file_id_t fid, page_id_t pid) -> bool;
 
   /**
-   * Delete all pages belong to the file
+   * Delete all pages belong to the file from every instance
    * @param fid
    * @return true if all pages are deleted successfully
    */
   auto DeleteAllPages(file_id_t fid) -> bool;
 
   /**
-   * Flush the page to disk
-   * 1. grant the latch
-   * 2. if the page is not in the buffer, return false
-   * 3. flush the page to disk if the page is dirty
+   * Flush the page to disk, see BufferPoolInstance::FlushPage
    * @param fid
    * @param pid
    * @return true if the page is flushed successfully
@@ -125,65 +122,176 @@ public:
   auto FlushPage(file_id_t fid, page_id_t pid) -> bool;
 
   /**
-   * Flush all pages to disk
+   * Flush all pages belong to the file in every instance to disk
    * @param fid
    * @return
    */
   auto FlushAllPages(file_id_t fid) -> bool;
 
- /**
+  /**
+   * Grow or shrink the buffer pool online, the new size is evenly distributed among the instances, see
+   * BufferPoolInstance::Resize. If any instance fails to shrink, the instances already resized are restored.
+   * @param pool_size the new number of frames, must be no less than the number of instances
+   * @return true if the buffer pool is resized successfully
+   */
+  auto Resize(size_t pool_size) -> bool;
+
+  /**
+   * @return the current number of frames in the buffer pool
+   */
+  auto GetPoolSize() -> size_t;
+
+  /**
+   * Start the page cleaner, a background thread that keeps the frames at the eviction end of every instance clean so
+   * that a miss rarely pays for writing back someone else's page. It writes at most PAGE_CLEANER_BATCH pages per
+   * instance in a round, and waits longer between rounds when there is nothing to do or the writes are slow.
+   * @param clean_frames number of clean frames to keep, evenly distributed among the instances
+   */
+  void StartPageCleaner(size_t clean_frames = PAGE_CLEANER_CLEAN_FRAMES);
+
+  /**
+   * Stop the page cleaner and wait for it to exit, called by the destructor as well
+   */
+  void StopPageCleaner();
+
+  /**
+   * Ask the read-ahead thread to load count pages starting from first_pid, pages beyond the end of the file are
+   * skipped. This is only a hint, it does nothing if the read-ahead is not running or too many requests are queued.
+   * @param fid
+   * @param first_pid
+   * @param count
+   */
+  void PrefetchPages(file_id_t fid, page_id_t first_pid, size_t count);
+
+  /**
+   * Start the read-ahead thread. Once a file is fetched cold, i.e. missed or hit on a prefetched page, at
+   * READ_AHEAD_TRIGGER consecutive page ids, the pages ahead of the reader are prefetched so that at least half of
+   * read_ahead_pages of them are always loaded or being loaded. PrefetchPages requests are served by the same thread.
+   * @param read_ahead_pages number of pages to read ahead, no more than half of the pool size is used, the limit
+   * follows Resize
+   */
+  void StartReadAhead(size_t read_ahead_pages = READ_AHEAD_PAGES);
+
+  /**
+   * Stop the read-ahead thread and wait for it to exit, queued requests are dropped, called by the destructor as well
+   */
+  void StopReadAhead();
+
+  /**
+   * @return the counters summed over all instances
+   */
+  auto GetStats() -> BufferPoolStats;
+
+  /**
+   * @return the number of instances
+   */
+  auto GetInstanceNum() const -> size_t { return instances_.size(); }
+
+  /**
    * Get the frame, used for test
    */
- auto GetFrame(file_id_t fid, page_id_t pid) -> Frame*;
+  auto GetFrame(file_id_t fid, page_id_t pid) -> Frame*;
 
   /**
    * Fetch a page and return a ReadPageGuard for read-only access
    * @param fid File ID
    * @param pid Page ID
-   * @return ReadPageGuard for the page
+   * @param strategy see FetchPage
+   * @return ReadPageGuard for the page, holding no page if FetchPage failed
    */
-  auto FetchPageRead(file_id_t fid, page_id_t pid) -> ReadPageGuard;
+  auto FetchPageRead(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy = nullptr) -> ReadPageGuard;
 
   /**
    * Fetch a page and return a WritePageGuard for read-write access
    * @param fid File ID
    * @param pid Page ID
-   * @return WritePageGuard for the page
+   * @param strategy see FetchPage
+   * @return WritePageGuard for the page, holding no page if FetchPage failed
    */
-  auto FetchPageWrite(file_id_t fid, page_id_t pid) -> WritePageGuard;
+  auto FetchPageWrite(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy = nullptr) -> WritePageGuard;
 
 private:
-  /// sub procedures used by public APIs, should not be locked by latch
+  /**
+   * Get the instance that caches the page
+   */
+  auto GetInstance(file_id_t fid, page_id_t pid) -> BufferPoolInstance *;
+
+  /**
+   * Fetch the page, see FetchPage, and return its frame
+   */
+  auto FetchFrame(file_id_t fid, page_id_t pid, BufferAccessStrategy *strategy) -> Frame *;
+
+  /**
+   * Index of the instance that caches the page
+   */
+  auto GetInstanceIndex(file_id_t fid, page_id_t pid) -> size_t;
+
+  /**
+   * Size of the i-th instance when pool_size frames are distributed among num_instances instances
+   */
+  static auto InstanceSize(size_t pool_size, size_t num_instances, size_t i) -> size_t;
 
   /**
-   * Get the available frame
-   * 1. if the free list is not empty, get the frame id from the free list
-   * 2. else use the replacer to get the frame id
-   * 3. if no frame can be evicted, throw NJUDB_NO_FREE_FRAME
-   * @return the frame id
+   * Main loop of the page cleaner
    */
-  auto GetAvailableFrame() -> frame_id_t;
+  void PageCleanerLoop();
 
   /**
-   * Update the frame
-   * 1. if the frame is dirty, flush the page to disk
-   * 2. update the frame with the new page
-   * 3. pin the frame in the buffer and the replacer
-   * 4. update the page_frame_lookup_
-   * @param frame_id the frame to update
-   * @param fid the file needs to be updated to the frame
-   * @param pid the page needs to be updated to the frame
+   * Track the cold fetches of the file and queue a prefetch request when the reader is sequential. The state of the
+   * file is kept in its shard of read_ahead_shards_, read_ahead_latch_ is only taken to queue a request.
    */
-  void UpdateFrame(frame_id_t frame_id, file_id_t fid, page_id_t pid);
+  void ReadAhead(file_id_t fid, page_id_t pid);
+
+  /**
+   * Set the read-ahead window to the requested one, no more than half of pool_size, with read_ahead_latch_ held
+   */
+  void ClampReadAhead(size_t pool_size);
+
+  /**
+   * Main loop of the read-ahead thread
+   */
+  void ReadAheadLoop();
+
+  struct PrefetchRequest
+  {
+    file_id_t fid;
+    page_id_t first_pid;
+    size_t    count;
+  };
+
+  struct ReadAheadState
+  {
+    page_id_t last_pid{INVALID_PAGE_ID};  // page of the last cold fetch
+    size_t    run{0};                     // number of consecutive page ids fetched cold up to last_pid
+    page_id_t next_pid{0};                // pages before next_pid are already requested
+  };
+
+  struct ReadAheadShard
+  {
+    std::mutex                                    latch;
+    std::unordered_map<file_id_t, ReadAheadState> states;
+  };
 
 private:
-  std::mutex                                latch_;
-  DiskManager                              *disk_manager_;
-  LogManager                               *log_manager_;
-  std::unique_ptr<Replacer>                 replacer_;
-  std::array<Frame, BUFFER_POOL_SIZE>       frames_;
-  std::list<frame_id_t>                     free_list_;
-  std::unordered_map<fid_pid_t, frame_id_t> page_frame_lookup_;
+  std::mutex                                       resize_latch_;  // serialize Resize across instances
+  std::vector<std::unique_ptr<BufferPoolInstance>> instances_;
+
+  std::thread             cleaner_;
+  std::mutex              cleaner_latch_;
+  std::condition_variable cleaner_cv_;
+  bool                    cleaner_stop_{false};
+  size_t                  clean_frames_{0};
+
+  DiskManager                                  *disk_manager_;
+  std::thread                                   read_ahead_;
+  std::mutex                                    read_ahead_latch_;
+  std::condition_variable                       read_ahead_cv_;
+  bool                                          read_ahead_stop_{false};
+  size_t                                        read_ahead_window_{0};  // pages requested by StartReadAhead
+  std::atomic<size_t>                           read_ahead_pages_{0};   // window in use, 0 if read-ahead is off
+  std::deque<PrefetchRequest>                   prefetch_queue_;
+  std::array<ReadAheadShard, READ_AHEAD_SHARDS> read_ahead_shards_;  // indexed by file id
+  file_id_t                                     prefetching_fid_{INVALID_FILE_ID};  // file of the request being served
 };
 
 }  // namespace njudb
@@ -22,6 +22,9 @@
 #ifndef NJUDB_FRAME_H
 #define NJUDB_FRAME_H
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
 #include "common/types.h"
 #include "common/config.h"
 #include "common/page.h"
@@ -51,17 +54,65 @@ public:
     pin_count_--;
   }
 
+  [[nodiscard]] inline auto IsIoInProgress() const -> bool { return io_in_progress_; }
+
+  inline void SetIoInProgress(bool io_in_progress) { io_in_progress_ = io_in_progress; }
+
+  /**
+   * Block until the disk I/O on this frame finishes, the lock must hold the latch of the owning buffer pool
+   */
+  inline void WaitIo(std::unique_lock<std::mutex> &lock)
+  {
+    io_cv_.wait(lock, [this]() { return !io_in_progress_; });
+  }
+
+  inline void NotifyIo() { io_cv_.notify_all(); }
+
+  [[nodiscard]] inline auto IsPrefetched() const -> bool { return prefetched_; }
+
+  inline void SetPrefetched(bool prefetched) { prefetched_ = prefetched; }
+
+  /**
+   * The version works as a seqlock over the page identity and content: it is odd while a WritePageGuard holds the page
+   * or the frame is being loaded or reset. Optimistic readers read an even version, copy the page, then check that the
+   * version has not changed. Writers that modify a pinned page without a WritePageGuard are not seen by them.
+   */
+  inline void BeginUpdate()
+  {
+    version_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  inline void EndUpdate() { version_.fetch_add(1, std::memory_order_release); }
+
+  [[nodiscard]] inline auto ReadVersion() const -> uint64_t { return version_.load(std::memory_order_acquire); }
+
+  [[nodiscard]] inline auto Validate(uint64_t version) const -> bool
+  {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
   inline void Reset()
   {
+    BeginUpdate();
     page_.Clear();
-    is_dirty_  = false;
-    pin_count_ = 0;
+    is_dirty_   = false;
+    pin_count_  = 0;
+    prefetched_ = false;
+    EndUpdate();
   }
 
 private:
-  Page page_{};
-  bool is_dirty_{false};
-  int  pin_count_{0};
+  Page                    page_{};
+  bool                    is_dirty_{false};
+  int                     pin_count_{0};
+  // set while the frame is loading a page or writing back its victim without holding the buffer pool latch
+  bool                    io_in_progress_{false};
+  std::condition_variable io_cv_;
+  // set when the page was loaded by read-ahead and nobody has fetched it since
+  bool                    prefetched_{false};
+  std::atomic<uint64_t>   version_{0};
 };
 
 #endif  // NJUDB_FRAME_H
@@ -25,31 +25,54 @@
 namespace njudb {
 
 // PageGuard implementation
-PageGuard::PageGuard(
-    BufferPoolManager *buffer_pool_manager, Page *page, file_id_t file_id, page_id_t page_id, bool is_dirty)
+PageGuard::PageGuard(BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id,
+    bool is_dirty, bool exclusive, bool adopt_latch)
     : buffer_pool_manager_(buffer_pool_manager),
-      page_(page),
+      frame_(frame),
+      page_(frame != nullptr ? frame->GetPage() : nullptr),
+      data_(page_ != nullptr ? page_->GetData() : nullptr),
       file_id_(file_id),
       page_id_(page_id),
       is_dirty_(is_dirty),
+      exclusive_(exclusive),
       is_valid_(true)
-{}
-
-PageGuard::~PageGuard()
 {
-  if (is_valid_ && buffer_pool_manager_ != nullptr && page_ != nullptr) {
-    buffer_pool_manager_->UnpinPage(file_id_, page_id_, is_dirty_);
+  if (page_ != nullptr && !adopt_latch) {
+    exclusive_ ? page_->GetLatch().Lock() : page_->GetLatch().LockShared();
+  }
+  if (page_ != nullptr && exclusive_) {
+    frame_->BeginUpdate();
   }
 }
 
+PageGuard::PageGuard(file_id_t file_id, page_id_t page_id, char *data)
+    : buffer_pool_manager_(nullptr),
+      frame_(nullptr),
+      page_(nullptr),
+      data_(data),
+      file_id_(file_id),
+      page_id_(page_id),
+      is_dirty_(false),
+      exclusive_(false),
+      is_valid_(true)
+{}
+
+PageGuard::~PageGuard() { Drop(); }
+
 PageGuard::PageGuard(PageGuard &&other) noexcept
     : buffer_pool_manager_(other.buffer_pool_manager_),
+      frame_(other.frame_),
       page_(other.page_),
+      data_(other.data_),
       file_id_(other.file_id_),
       page_id_(other.page_id_),
       is_dirty_(other.is_dirty_),
+      exclusive_(other.exclusive_),
       is_valid_(other.is_valid_)
 {
+  other.frame_    = nullptr;
+  other.page_     = nullptr;
+  other.data_     = nullptr;
   other.is_valid_ = false;
 }
 
@@ -61,40 +84,50 @@ PageGuard &PageGuard::operator=(PageGuard &&other) noexcept
 
     // Move from other
     buffer_pool_manager_ = other.buffer_pool_manager_;
+    frame_               = other.frame_;
     page_                = other.page_;
+    data_                = other.data_;
     file_id_             = other.file_id_;
     page_id_             = other.page_id_;
     is_dirty_            = other.is_dirty_;
+    exclusive_           = other.exclusive_;
     is_valid_            = other.is_valid_;
 
+    other.frame_    = nullptr;
+    other.page_     = nullptr;
+    other.data_     = nullptr;
     other.is_valid_ = false;
   }
   return *this;
 }
 
-auto PageGuard::IsValid() const -> bool { return is_valid_; }
-
-auto PageGuard::GetPage() -> Page * { return page_; }
-
-auto PageGuard::GetData() -> char * { return is_valid_ && page_ != nullptr ? page_->GetData() : nullptr; }
-
-auto PageGuard::GetPageId() const -> page_id_t { return page_id_; }
-
-auto PageGuard::GetFileId() const -> file_id_t { return file_id_; }
-
-auto PageGuard::IsDirty() const -> bool { return is_dirty_; }
-
 void PageGuard::Drop()
 {
-  if (is_valid_ && buffer_pool_manager_ != nullptr && page_ != nullptr) {
-    buffer_pool_manager_->UnpinPage(file_id_, page_id_, is_dirty_);
-    is_valid_ = false;
+  if (is_valid_ && page_ != nullptr) {
+    // release the latch before the pin, an unpinned page may be evicted and its frame reused
+    if (exclusive_) {
+      frame_->EndUpdate();
+      page_->GetLatch().Unlock();
+    } else {
+      page_->GetLatch().UnlockShared();
+    }
+    if (buffer_pool_manager_ != nullptr) {
+      buffer_pool_manager_->UnpinPage(file_id_, page_id_, is_dirty_);
+    }
   }
+  frame_    = nullptr;
+  page_     = nullptr;
+  data_     = nullptr;
+  is_valid_ = false;
 }
 
 // ReadPageGuard implementation
-ReadPageGuard::ReadPageGuard(BufferPoolManager *buffer_pool_manager, Page *page, file_id_t file_id, page_id_t page_id)
-    : PageGuard(buffer_pool_manager, page, file_id, page_id, false)
+ReadPageGuard::ReadPageGuard(BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id)
+    : PageGuard(buffer_pool_manager, frame, file_id, page_id, false, false)
+{}
+
+ReadPageGuard::ReadPageGuard(file_id_t file_id, page_id_t page_id, const char *data)
+    : PageGuard(file_id, page_id, const_cast<char *>(data))
 {}
 
 ReadPageGuard::~ReadPageGuard() = default;
@@ -107,14 +140,35 @@ ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&other) noexcept
   return *this;
 }
 
-auto ReadPageGuard::GetData() const -> const char *
+auto ReadPageGuard::UpgradeToWrite(bool *in_place) -> WritePageGuard
 {
-  return is_valid_ && page_ != nullptr ? page_->GetData() : nullptr;
+  NJUDB_ASSERT(is_valid_ && page_ != nullptr, "only a latched page of the buffer pool can be upgraded");
+  auto &latch    = page_->GetLatch();
+  bool  upgraded = latch.TryUpgrade();
+  if (!upgraded) {
+    latch.UnlockShared();
+    latch.Lock();
+  }
+  if (in_place != nullptr) {
+    *in_place = upgraded;
+  }
+  // the pin and the latch are handed over to the write guard
+  WritePageGuard guard(buffer_pool_manager_, frame_, file_id_, page_id_, std::adopt_lock);
+  frame_    = nullptr;
+  page_     = nullptr;
+  data_     = nullptr;
+  is_valid_ = false;
+  return guard;
 }
 
 // WritePageGuard implementation
-WritePageGuard::WritePageGuard(BufferPoolManager *buffer_pool_manager, Page *page, file_id_t file_id, page_id_t page_id)
-    : PageGuard(buffer_pool_manager, page, file_id, page_id, false)
+WritePageGuard::WritePageGuard(BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id)
+    : PageGuard(buffer_pool_manager, frame, file_id, page_id, true, true)
+{}
+
+WritePageGuard::WritePageGuard(
+    BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id, std::adopt_lock_t)
+    : PageGuard(buffer_pool_manager, frame, file_id, page_id, true, true, true)
 {}
 
 WritePageGuard::~WritePageGuard() = default;
@@ -127,11 +181,4 @@ WritePageGuard &WritePageGuard::operator=(WritePageGuard &&other) noexcept
   return *this;
 }
 
-auto WritePageGuard::GetMutableData() -> char *
-{
-  is_dirty_ = true;
-  return is_valid_ && page_ != nullptr ? page_->GetData() : nullptr;
-}
-
-void WritePageGuard::UnsetDirty() { is_dirty_ = false; }
 }  // namespace njudb
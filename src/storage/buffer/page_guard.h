@@ -20,6 +20,7 @@
 #ifndef NJUDB_PAGE_GUARD_H
 #define NJUDB_PAGE_GUARD_H
 
+#include <mutex>  // NOLINT
 #include "../../common/page.h"
 #include "buffer_pool_manager.h"
 
@@ -28,25 +29,21 @@ namespace njudb {
 class BufferPoolManager;
 
 /**
- * @brief Base page guard class that provides RAII-style automatic unpinning
+ * @brief Base page guard class that provides RAII-style automatic unlatching and unpinning
  * 
- * This class ensures that pages are properly unpinned when the guard goes out of scope,
+ * This class ensures that pages are properly unlatched and unpinned when the guard goes out of scope,
  * preventing buffer pool leaks and making the code exception-safe.
+ * A guard is meant to live on the stack, it allocates nothing and its accessors are inlined.
+ * A guard holds the latch of its page, shared for a ReadPageGuard and exclusive for a WritePageGuard, so a thread
+ * must not fetch a page it already guards. Guards are only moved, which hands the pin and the latch over, e.g. to
+ * keep the ancestors of a B+ tree node latched while descending.
+ * A WritePageGuard keeps the version of the frame odd while it holds the page, see Frame::BeginUpdate, so that
+ * optimistic readers never take a copy of a page being modified.
  */
 class PageGuard {
 public:
   /**
-   * @brief Constructor for PageGuard
-   * @param buffer_pool_manager Pointer to the buffer pool manager
-   * @param page Pointer to the page being guarded
-   * @param file_id File ID of the page
-   * @param page_id Page ID of the page
-   * @param is_dirty Whether the page is dirty
-   */
-  PageGuard(BufferPoolManager *buffer_pool_manager, Page *page, file_id_t file_id, page_id_t page_id, bool is_dirty = false);
-
-  /**
-   * @brief Destructor that automatically unpins the page
+   * @brief Destructor that automatically unlatches and unpins the page
    */
   ~PageGuard();
 
@@ -68,68 +65,99 @@ public:
    * @brief Check if the guard is valid (not moved or dropped)
    * @return True if the guard is valid
    */
-  auto IsValid() const -> bool;
+  auto IsValid() const -> bool { return is_valid_; }
 
   /**
    * @brief Get the page pointer
-   * @return Pointer to the page
+   * @return Pointer to the page, nullptr for a guard over a page not held by the buffer pool
    */
-  auto GetPage() -> Page *;
+  auto GetPage() -> Page * { return page_; }
 
   /**
    * @brief Get the page data
    * @return Pointer to the page data
    */
-  auto GetData() -> char *;
+  auto GetData() -> char * { return is_valid_ ? data_ : nullptr; }
 
   /**
    * @brief Get the page ID
    * @return Page ID
    */
-  auto GetPageId() const -> page_id_t;
+  auto GetPageId() const -> page_id_t { return page_id_; }
 
   /**
    * @brief Get the file ID
    * @return File ID
    */
-  auto GetFileId() const -> file_id_t;
+  auto GetFileId() const -> file_id_t { return file_id_; }
 
   /**
    * @brief Check if the page is dirty
    * @return True if the page is dirty
    */
-  auto IsDirty() const -> bool;
+  auto IsDirty() const -> bool { return is_dirty_; }
 
   /**
-   * @brief Manually drop the guard (unpin the page)
+   * @brief Manually drop the guard (unlatch and unpin the page)
    * This can be called to release the page before the destructor
    */
   void Drop();
 
 protected:
+  /**
+   * @brief Constructor for PageGuard, the page is latched unless adopt_latch is set
+   * @param buffer_pool_manager Pointer to the buffer pool manager
+   * @param frame Frame holding the page being guarded, nullptr if the buffer pool has no frame for it
+   * @param file_id File ID of the page
+   * @param page_id Page ID of the page
+   * @param is_dirty Whether the page is dirty
+   * @param exclusive Whether the latch of the page is held exclusively
+   * @param adopt_latch Whether the caller already holds the latch
+   */
+  PageGuard(BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id, bool is_dirty,
+      bool exclusive, bool adopt_latch = false);
+
+  /**
+   * @brief Constructor for a guard over the data of a page that is not held by the buffer pool, e.g. a page of a
+   * mapped file, nothing is unpinned
+   */
+  PageGuard(file_id_t file_id, page_id_t page_id, char *data);
+
   BufferPoolManager *buffer_pool_manager_;
+  Frame *frame_;  // frame of page_, nullptr for a view guard
   Page *page_;
+  char *data_;  // data of page_, or of the page a view guard points to
   file_id_t file_id_;
   page_id_t page_id_;
   bool is_dirty_;
+  bool exclusive_;  // whether the latch of page_ is held exclusively
   bool is_valid_;  // Whether the guard is still valid (not moved or dropped)
 };
 
+class WritePageGuard;
+
 /**
  * @brief Read page guard for read-only access
  * 
- * This guard ensures that the page is unpinned as non-dirty when it goes out of scope.
+ * This guard holds the page latched in shared mode and ensures that the page is unpinned as non-dirty when it goes
+ * out of scope.
  */
 class ReadPageGuard : public PageGuard {
 public:
   /**
    * @brief Constructor for ReadPageGuard
    * @param buffer_pool_manager Pointer to the buffer pool manager
-   * @param page Pointer to the page being guarded
+   * @param frame Frame holding the page being guarded
    * @param file_id File ID of the page
    * @param page_id Page ID of the page
    */
-  ReadPageGuard(BufferPoolManager *buffer_pool_manager, Page *page, file_id_t file_id, page_id_t page_id);
+  ReadPageGuard(BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id);
+
+  /**
+   * @brief Constructor for a read-only view of a page that is not held by the buffer pool
+   * @param data Data of the page, it must outlive the guard
+   */
+  ReadPageGuard(file_id_t file_id, page_id_t page_id, const char *data);
 
   /**
    * @brief Destructor that unpins the page as non-dirty
@@ -154,24 +182,35 @@ public:
    * @brief Get const page data for read-only access
    * @return Const pointer to the page data
    */
-  auto GetData() const -> const char *;
+  auto GetData() const -> const char * { return is_valid_ ? data_ : nullptr; }
+
+  /**
+   * @brief Upgrade the shared latch to the exclusive one and hand the page over to a write guard, this guard becomes
+   * invalid. The page stays pinned. The upgrade is atomic unless another reader of the page is upgrading at the same
+   * time, the shared latch is then released before the exclusive one is granted and the page may have been modified
+   * in between, the caller has to check again what it read.
+   * @param[out] in_place set to whether the upgrade was atomic
+   * @return the write guard of the page
+   */
+  auto UpgradeToWrite(bool *in_place = nullptr) -> WritePageGuard;
 };
 
 /**
  * @brief Write page guard for read-write access
  * 
- * This guard ensures that the page is unpinned as dirty when it goes out of scope.
+ * This guard holds the page latched in exclusive mode and ensures that the page is unpinned as dirty when it goes
+ * out of scope.
  */
 class WritePageGuard : public PageGuard {
 public:
   /**
    * @brief Constructor for WritePageGuard, by default, is_dirty is set to true
    * @param buffer_pool_manager Pointer to the buffer pool manager
-   * @param page Pointer to the page being guarded
+   * @param frame Frame holding the page being guarded
    * @param file_id File ID of the page
    * @param page_id Page ID of the page
    */
-  WritePageGuard(BufferPoolManager *buffer_pool_manager, Page *page, file_id_t file_id, page_id_t page_id);
+  WritePageGuard(BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id);
 
   /**
    * @brief Destructor that unpins the page as dirty
@@ -196,13 +235,26 @@ public:
    * @brief Get mutable page data for read-write access
    * @return Mutable pointer to the page data
    */
-  auto GetMutableData() -> char *;
+  auto GetMutableData() -> char *
+  {
+    is_dirty_ = true;
+    return is_valid_ ? data_ : nullptr;
+  }
 
   /**
    * @brief set dirty = false, should carefully use it if the page is sure to be clean
    * 
    */
-  void UnsetDirty();
+  void UnsetDirty() { is_dirty_ = false; }
+
+private:
+  friend class ReadPageGuard;
+
+  /**
+   * @brief Constructor for a write guard taking over a page the caller already latched exclusively
+   */
+  WritePageGuard(
+      BufferPoolManager *buffer_pool_manager, Frame *frame, file_id_t file_id, page_id_t page_id, std::adopt_lock_t);
 };
 
 }  // namespace njudb
@@ -0,0 +1,133 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#include "page_table.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "../../../common/error.h"
+
+namespace njudb {
+
+PageTable::PageTable(size_t max_entries)
+    : table_(std::make_unique<Table>(std::bit_ceil(std::max<size_t>(max_entries * 2, 16))))
+{}
+
+auto PageTable::Find(file_id_t fid, page_id_t pid) const -> frame_id_t
+{
+  uint64_t key = Pack(fid, pid);
+  if (key == EMPTY_KEY) {
+    return INVALID_FRAME_ID;
+  }
+  for (size_t i = Hash(key) & table_->mask;; i = (i + 1) & table_->mask) {
+    const Slot &slot = table_->slots[i];
+    if (slot.key == key) {
+      return slot.frame_id;
+    }
+    if (slot.key == EMPTY_KEY) {
+      return INVALID_FRAME_ID;
+    }
+  }
+}
+
+void PageTable::Insert(file_id_t fid, page_id_t pid, frame_id_t frame_id)
+{
+  NJUDB_ASSERT(Pack(fid, pid) != EMPTY_KEY, "the invalid page can not be mapped");
+  if ((size_ + 1) * 2 > table_->mask + 1) {
+    Grow();
+  }
+  uint64_t key = Pack(fid, pid);
+  for (size_t i = Hash(key) & table_->mask;; i = (i + 1) & table_->mask) {
+    Slot &slot = table_->slots[i];
+    if (slot.key == key) {
+      slot.frame_id = frame_id;
+      return;
+    }
+    if (slot.key == EMPTY_KEY) {
+      slot.key      = key;
+      slot.frame_id = frame_id;
+      size_++;
+      return;
+    }
+  }
+}
+
+auto PageTable::Erase(file_id_t fid, page_id_t pid) -> bool
+{
+  Table   *table = table_.get();
+  uint64_t key   = Pack(fid, pid);
+  size_t   hole  = Hash(key) & table->mask;
+  if (key == EMPTY_KEY) {
+    return false;
+  }
+  while (true) {
+    if (table->slots[hole].key == key) {
+      break;
+    }
+    if (table->slots[hole].key == EMPTY_KEY) {
+      return false;
+    }
+    hole = (hole + 1) & table->mask;
+  }
+  // backward shift: move an entry into the hole unless its home lies cyclically in (hole, i]
+  for (size_t i = (hole + 1) & table->mask;; i = (i + 1) & table->mask) {
+    uint64_t slot_key = table->slots[i].key;
+    if (slot_key == EMPTY_KEY) {
+      break;
+    }
+    size_t home = Hash(slot_key) & table->mask;
+    if (((i - home) & table->mask) >= ((i - hole) & table->mask)) {
+      table->slots[hole] = table->slots[i];
+      hole               = i;
+    }
+  }
+  table->slots[hole].key = EMPTY_KEY;
+  size_--;
+  return true;
+}
+
+auto PageTable::GetFilePages(file_id_t fid) const -> std::vector<std::pair<page_id_t, frame_id_t>>
+{
+  std::vector<std::pair<page_id_t, frame_id_t>> pages;
+  for (size_t i = 0; i <= table_->mask; i++) {
+    const Slot &slot = table_->slots[i];
+    if (slot.key != EMPTY_KEY && static_cast<file_id_t>(slot.key >> 32) == fid) {
+      pages.emplace_back(static_cast<page_id_t>(slot.key), slot.frame_id);
+    }
+  }
+  return pages;
+}
+
+void PageTable::Grow()
+{
+  auto new_table = std::make_unique<Table>((table_->mask + 1) * 2);
+  for (size_t i = 0; i <= table_->mask; i++) {
+    const Slot &slot = table_->slots[i];
+    if (slot.key == EMPTY_KEY) {
+      continue;
+    }
+    size_t j = Hash(slot.key) & new_table->mask;
+    while (new_table->slots[j].key != EMPTY_KEY) {
+      j = (j + 1) & new_table->mask;
+    }
+    new_table->slots[j] = slot;
+  }
+  table_ = std::move(new_table);
+}
+
+}  // namespace njudb
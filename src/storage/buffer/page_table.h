@@ -0,0 +1,136 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_PAGE_TABLE_H
+#define NJUDB_PAGE_TABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "common/types.h"
+#include "../../../common/micro.h"
+
+namespace njudb {
+
+struct fid_pid_t
+{
+  file_id_t fid;
+  page_id_t pid;
+
+  bool operator==(const fid_pid_t &rhs) const { return fid == rhs.fid && pid == rhs.pid; }
+};
+
+/**
+ * Open-addressing hash table from pages to frames with linear probing. Keys are packed into 64 bits and stored inline
+ * in the slots, so a lookup touches one or two cache lines and never allocates.
+ *
+ * The table is not thread-safe, every call is serialized by the owner, i.e. the latch of the buffer pool instance.
+ */
+class PageTable
+{
+public:
+  /**
+   * @param max_entries expected maximum number of entries, the table grows when it gets half full anyway
+   */
+  explicit PageTable(size_t max_entries);
+
+  DISABLE_COPY_MOVE_AND_ASSIGN(PageTable)
+
+  /**
+   * @return the frame holding the page, INVALID_FRAME_ID if the page is not in the table
+   */
+  auto Find(file_id_t fid, page_id_t pid) const -> frame_id_t;
+
+  /**
+   * Map the page to the frame, overwrite the existing mapping if any
+   */
+  void Insert(file_id_t fid, page_id_t pid, frame_id_t frame_id);
+
+  /**
+   * Remove the page from the table, the entries after it in the probe sequence are shifted back so that no tombstone
+   * is left behind
+   * @return true if the page was in the table
+   */
+  auto Erase(file_id_t fid, page_id_t pid) -> bool;
+
+  /**
+   * @return all entries of the file, by scanning the whole table
+   */
+  auto GetFilePages(file_id_t fid) const -> std::vector<std::pair<page_id_t, frame_id_t>>;
+
+  [[nodiscard]] auto Size() const -> size_t { return size_; }
+
+  static auto Pack(file_id_t fid, page_id_t pid) -> uint64_t
+  {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(fid)) << 32) | static_cast<uint32_t>(pid);
+  }
+
+  /**
+   * Finalizer of MurmurHash3, every bit of the key affects every bit of the hash
+   */
+  static auto Hash(uint64_t key) -> uint64_t
+  {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+private:
+  // the key of (INVALID_FILE_ID, INVALID_PAGE_ID), the page held by an empty frame
+  static constexpr uint64_t EMPTY_KEY = ~static_cast<uint64_t>(0);
+
+  struct Slot
+  {
+    uint64_t   key{EMPTY_KEY};
+    frame_id_t frame_id{INVALID_FRAME_ID};
+  };
+
+  struct Table
+  {
+    explicit Table(size_t capacity) : mask(capacity - 1), slots(std::make_unique<Slot[]>(capacity)) {}
+
+    size_t                  mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  /**
+   * Move the entries into a table twice as large and free the old one
+   */
+  void Grow();
+
+  std::unique_ptr<Table> table_;
+  size_t                 size_{0};
+};
+
+}  // namespace njudb
+
+namespace std {
+template <>
+struct hash<njudb::fid_pid_t>
+{
+  size_t operator()(const njudb::fid_pid_t &fp) const
+  {
+    return njudb::PageTable::Hash(njudb::PageTable::Pack(fp.fid, fp.pid));
+  }
+};
+}  // namespace std
+
+#endif  // NJUDB_PAGE_TABLE_H
@@ -26,95 +26,88 @@
 
 namespace njudb {
 
-LRUKReplacer::LRUKReplacer(size_t k) : max_size_(BUFFER_POOL_SIZE), k_(k) {}
+LRUKReplacer::LRUKReplacer(size_t k, size_t max_size) : max_size_(max_size), k_(k) {}
 
 auto LRUKReplacer::Victim(frame_id_t *frame_id) -> bool {
   std::scoped_lock lock(latch_);
-  
-  if (cur_size_ == 0) {
+
+  auto &evict_set = less_k_history_.empty() ? k_history_ : less_k_history_;
+  if (evict_set.empty()) {
     return false;
   }
-  
-  frame_id_t victim_fid = INVALID_FRAME_ID;
-  unsigned long long max_dist = 0;
-  timestamp_t earliest_ts = std::numeric_limits<timestamp_t>::max();
-  
-  for (auto &pair : node_store_) {
-    auto &node = pair.second;
-    if (!node.IsEvictable()) {
-      continue;
-    }
-    
-    unsigned long long dist = node.GetBackwardKDistance(cur_ts_);
-    
-    if (dist == std::numeric_limits<unsigned long long>::max()) {
-      timestamp_t node_earliest = node.GetEarliestTimestamp();
-      if (max_dist != std::numeric_limits<unsigned long long>::max()) {
-         max_dist = std::numeric_limits<unsigned long long>::max();
-         victim_fid = pair.first;
-         earliest_ts = node_earliest;
-      } else {
-         if (node_earliest < earliest_ts) {
-           victim_fid = pair.first;
-           earliest_ts = node_earliest;
-         }
-      }
-    } else {
-       if (max_dist != std::numeric_limits<unsigned long long>::max()) {
-         if (dist > max_dist) {
-           max_dist = dist;
-           victim_fid = pair.first;
-         }
-       }
-    }
-  }
-  
-  if (victim_fid != INVALID_FRAME_ID) {
-    *frame_id = victim_fid;
-    node_store_.erase(victim_fid);
-    cur_size_--;
-    return true;
-  }
-  
-  return false;
+
+  *frame_id = evict_set.begin()->second;
+  evict_set.erase(evict_set.begin());
+  node_store_.erase(*frame_id);
+  cur_size_--;
+  return true;
 }
 
 void LRUKReplacer::Pin(frame_id_t frame_id) {
   std::scoped_lock lock(latch_);
-  
-  if (node_store_.find(frame_id) == node_store_.end()) {
-    node_store_.emplace(frame_id, LRUKNode(frame_id, k_));
+
+  auto iter = node_store_.find(frame_id);
+  if (iter == node_store_.end()) {
+    iter = node_store_.emplace(frame_id, LRUKNode(frame_id, k_)).first;
   }
-  
-  auto &node = node_store_[frame_id];
-  node.AddHistory(cur_ts_++);
-  
+
+  auto &node = iter->second;
   if (node.IsEvictable()) {
+    EvictSet(node).erase(node.GetEvictKey());
     node.SetEvictable(false);
     cur_size_--;
   }
+  node.AddHistory(cur_ts_++);
 }
 
 void LRUKReplacer::Unpin(frame_id_t frame_id) {
   std::scoped_lock lock(latch_);
-  
-  if (node_store_.find(frame_id) == node_store_.end()) {
-     if (node_store_.size() >= max_size_) {
-       return;
-     }
-     node_store_.emplace(frame_id, LRUKNode(frame_id, k_));
-     cur_size_++; 
-     node_store_[frame_id].SetEvictable(true);
-     return;
+
+  auto iter = node_store_.find(frame_id);
+  if (iter == node_store_.end()) {
+    if (node_store_.size() >= max_size_) {
+      return;
+    }
+    iter = node_store_.emplace(frame_id, LRUKNode(frame_id, k_)).first;
   }
-  
-  auto &node = node_store_[frame_id];
+
+  auto &node = iter->second;
   if (!node.IsEvictable()) {
     node.SetEvictable(true);
+    EvictSet(node).insert(node.GetEvictKey());
     cur_size_++;
   }
 }
 
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::scoped_lock lock(latch_);
+  auto iter = node_store_.find(frame_id);
+  if (iter == node_store_.end()) {
+    return;
+  }
+  if (iter->second.IsEvictable()) {
+    EvictSet(iter->second).erase(iter->second.GetEvictKey());
+    cur_size_--;
+  }
+  node_store_.erase(iter);
+}
+
+void LRUKReplacer::Resize(size_t max_size) {
+  std::scoped_lock lock(latch_);
+  max_size_ = max_size;
+}
+
+auto LRUKReplacer::Candidates(size_t max_num) -> std::vector<frame_id_t> {
+  std::scoped_lock lock(latch_);
+  std::vector<frame_id_t> candidates;
+  for (const auto *evict_set : {&less_k_history_, &k_history_}) {
+    for (auto iter = evict_set->begin(); iter != evict_set->end() && candidates.size() < max_num; ++iter) {
+      candidates.push_back(iter->second);
+    }
+  }
+  return candidates;
+}
+
 auto LRUKReplacer::Size() -> size_t {
   std::scoped_lock lock(latch_);
   return cur_size_;
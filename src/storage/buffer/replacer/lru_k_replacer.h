@@ -23,16 +23,26 @@
 #define NJUDB_LRU_K_REPLACER_H
 #include <list>
 #include <mutex>
+#include <set>
 #include <unordered_map>
+#include <utility>
+#include "common/config.h"
 #include "replacer.h"
 #include "../common/error.h"
 
 namespace njudb {
 
+/**
+ * LRUKReplacer evicts the frame with the largest backward k-distance, frames with less than k accesses have an
+ * infinite distance and are evicted first in the order of their earliest access.
+ * Only evictable frames are kept in two ordered sets, one for frames with less than k accesses keyed by the earliest
+ * timestamp and one for the others keyed by the k-th recent timestamp. The history of a frame only changes when it is
+ * pinned, i.e. not in a set, so the keys never change in place and Victim, Pin and Unpin are O(log n).
+ */
 class LRUKReplacer : public Replacer
 {
 public:
-  explicit LRUKReplacer(size_t k);
+  explicit LRUKReplacer(size_t k, size_t max_size = BUFFER_POOL_SIZE);
 
   ~LRUKReplacer() override = default;
 
@@ -42,6 +52,12 @@ public:
 
   void Unpin(frame_id_t frame_id) override;
 
+  void Remove(frame_id_t frame_id) override;
+
+  void Resize(size_t max_size) override;
+
+  auto Candidates(size_t max_num) -> std::vector<frame_id_t> override;
+
   auto Size() -> size_t override;
 
 private:
@@ -60,21 +76,16 @@ private:
     }
 
     /**
-     * Get the distance between the current timestamp and the k-th timestamp in the history,
-     * think: why return type is unsigned long long?
-     * @param cur_ts
-     * @return
+     * @return true if the frame has been accessed k times, its backward k-distance is finite
      */
-    auto GetBackwardKDistance(timestamp_t cur_ts) -> unsigned long long
-    {
-      if (history_.size() < k) {
-        return std::numeric_limits<unsigned long long>::max();
-      }
-      return cur_ts - history_.back();
-    }
+    [[nodiscard]] auto HasKHistory() const -> bool { return history_.size() >= k; }
 
-    auto GetEarliestTimestamp() -> timestamp_t {
-      return history_.back();
+    /**
+     * Key of the node in the evictable sets, a frame never accessed is the oldest one
+     */
+    [[nodiscard]] auto GetEvictKey() const -> std::pair<timestamp_t, frame_id_t>
+    {
+      return {history_.empty() ? 0 : history_.back(), fid_};
     }
 
     [[nodiscard]] auto IsEvictable() const -> bool { return is_evictable_; }
@@ -88,8 +99,16 @@ private:
     bool                   is_evictable_{};
   };
 
+  /** sub procedures, should be called with the latch held */
+  auto EvictSet(const LRUKNode &node) -> std::set<std::pair<timestamp_t, frame_id_t>> &
+  {
+    return node.HasKHistory() ? k_history_ : less_k_history_;
+  }
+
 private:
-  std::unordered_map<frame_id_t, LRUKNode> node_store_;  // frame_id -> LRUKNode
+  std::unordered_map<frame_id_t, LRUKNode>      node_store_;      // frame_id -> LRUKNode
+  std::set<std::pair<timestamp_t, frame_id_t>> less_k_history_;  // evictable frames with less than k accesses
+  std::set<std::pair<timestamp_t, frame_id_t>> k_history_;       // evictable frames with k accesses
   size_t                                   cur_ts_{0};
   size_t                                   cur_size_{0};  // number of evictable frames
   size_t                                   max_size_;     // maximum number of frames that can be stored
@@ -24,7 +24,7 @@
 #include "../common/error.h"
 namespace njudb {
 
-LRUReplacer::LRUReplacer() : cur_size_(0), max_size_(BUFFER_POOL_SIZE) {}
+LRUReplacer::LRUReplacer(size_t max_size) : cur_size_(0), max_size_(max_size) {}
 
 auto LRUReplacer::Victim(frame_id_t *frame_id) -> bool {
   std::scoped_lock lock(latch_);
@@ -78,6 +78,35 @@ void LRUReplacer::Unpin(frame_id_t frame_id) {
   }
 }
 
+void LRUReplacer::Remove(frame_id_t frame_id) {
+  std::scoped_lock lock(latch_);
+  auto it = lru_hash_.find(frame_id);
+  if (it == lru_hash_.end()) {
+    return;
+  }
+  if (it->second->second) {
+    cur_size_--;
+  }
+  lru_list_.erase(it->second);
+  lru_hash_.erase(it);
+}
+
+void LRUReplacer::Resize(size_t max_size) {
+  std::scoped_lock lock(latch_);
+  max_size_ = max_size;
+}
+
+auto LRUReplacer::Candidates(size_t max_num) -> std::vector<frame_id_t> {
+  std::scoped_lock lock(latch_);
+  std::vector<frame_id_t> candidates;
+  for (auto it = lru_list_.begin(); it != lru_list_.end() && candidates.size() < max_num; ++it) {
+    if (it->second) {
+      candidates.push_back(it->first);
+    }
+  }
+  return candidates;
+}
+
 auto LRUReplacer::Size() -> size_t {
   std::scoped_lock lock(latch_);
   return cur_size_;
@@ -22,6 +22,7 @@
 #include <mutex>  // NOLINT
 #include <vector>
 #include <unordered_map>
+#include "common/config.h"
 #include "replacer.h"
 
 namespace njudb {
@@ -34,8 +35,9 @@ class LRUReplacer : public Replacer
 public:
   /**
    * Create a new LRUReplacer.
+   * @param max_size maximum number of frames the replacer tracks, should be equal to the buffer pool size
    */
-  explicit LRUReplacer();
+  explicit LRUReplacer(size_t max_size = BUFFER_POOL_SIZE);
 
   /**
    * Destroys the LRUReplacer.
@@ -70,6 +72,23 @@ public:
    */
   void Unpin(frame_id_t frame_id) override;
 
+  /**
+   * Remove a frame from the LRU list whether it is evictable or not.
+   * 1. grant the latch
+   * 2. if the frame is not tracked return
+   * 3. erase the frame from the LRU list and hash map
+   * @param frame_id
+   */
+  void Remove(frame_id_t frame_id) override;
+
+  /**
+   * Update the maximum number of frames.
+   * @param max_size
+   */
+  void Resize(size_t max_size) override;
+
+  auto Candidates(size_t max_num) -> std::vector<frame_id_t> override;
+
   /**
    * Get the number of elements in the replacer that can be victimized.
    * 1. grant the latch
@@ -20,3 +20,24 @@
 //
 
 #include "replacer.h"
+#include "lru_replacer.h"
+#include "lru_k_replacer.h"
+#include "two_queue_replacer.h"
+
+namespace njudb {
+
+auto Replacer::Create(const std::string &name, size_t lru_k, size_t max_size) -> std::unique_ptr<Replacer>
+{
+  if (name == "LRUReplacer") {
+    return std::make_unique<LRUReplacer>(max_size);
+  }
+  if (name == "LRUKReplacer") {
+    return std::make_unique<LRUKReplacer>(lru_k, max_size);
+  }
+  if (name == "TwoQueueReplacer") {
+    return std::make_unique<TwoQueueReplacer>(max_size);
+  }
+  return nullptr;
+}
+
+}  // namespace njudb
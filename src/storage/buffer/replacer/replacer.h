@@ -22,6 +22,9 @@
 #ifndef NJU_DBCOURSE_REPLACER_H
 #define NJU_DBCOURSE_REPLACER_H
 
+#include <memory>
+#include <string>
+#include <vector>
 #include "common/types.h"
 
 namespace njudb {
@@ -35,6 +38,15 @@ public:
   Replacer()          = default;
   virtual ~Replacer() = default;
 
+  /**
+   * Create a replacer by its class name, e.g. "LRUReplacer", "LRUKReplacer" or "TwoQueueReplacer"
+   * @param name class name of the replacer
+   * @param lru_k k for LRUKReplacer, ignored by other replacers
+   * @param max_size maximum number of frames the replacer tracks
+   * @return the replacer, nullptr if the name is unknown
+   */
+  static auto Create(const std::string &name, size_t lru_k, size_t max_size) -> std::unique_ptr<Replacer>;
+
   /**
    * Remove the victim frame as defined by the replacement policy.
    * @param[out] frame_id id of frame that was removed, nullptr if no victim was found
@@ -54,6 +66,36 @@ public:
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Tell the replacer which page the frame holds from now on, called when a page is loaded into the frame. Policies
+   * that remember evicted pages (e.g. the ghost queue of 2Q) need it, others can ignore it.
+   * @param frame_id the id of the frame
+   * @param fid file of the page
+   * @param pid id of the page
+   */
+  virtual void Bind(frame_id_t frame_id, file_id_t fid, page_id_t pid) {}
+
+  /**
+   * Stop tracking a frame no matter whether it is pinned or not, used when the frame is released from the buffer pool.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) = 0;
+
+  /**
+   * Change the maximum number of frames the replacer can track, used when the buffer pool is resized online.
+   * Frames beyond the new capacity should have been removed by the caller.
+   * @param max_size the new capacity
+   */
+  virtual void Resize(size_t max_size) = 0;
+
+  /**
+   * Peek the frames that would be victimized next without removing them, used by the page cleaner to write back dirty
+   * frames ahead of eviction.
+   * @param max_num maximum number of frames to return
+   * @return evictable frames in eviction order
+   */
+  virtual auto Candidates(size_t max_num) -> std::vector<frame_id_t> = 0;
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual auto Size() -> size_t = 0;
 };
@@ -0,0 +1,215 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#include "two_queue_replacer.h"
+#include <algorithm>
+
+namespace njudb {
+
+TwoQueueReplacer::TwoQueueReplacer(size_t max_size)
+    : max_size_(max_size), kin_(std::max<size_t>(1, max_size / 4)), kout_(std::max<size_t>(1, max_size / 2))
+{}
+
+auto TwoQueueReplacer::Victim(frame_id_t *frame_id) -> bool
+{
+  std::scoped_lock lock(latch_);
+  if (cur_size_ == 0) {
+    return false;
+  }
+  auto in_iter = FirstEvictable(a1in_);
+  auto am_iter = FirstEvictable(am_);
+  bool from_in = in_iter != a1in_.end() && (in_size_ > kin_ || am_iter == am_.end());
+  if (!from_in && am_iter == am_.end()) {
+    return false;
+  }
+  *frame_id = from_in ? *in_iter : *am_iter;
+  if (from_in) {
+    Remember(nodes_.at(*frame_id).page_);
+  }
+  Untrack(*frame_id);
+  return true;
+}
+
+void TwoQueueReplacer::Pin(frame_id_t frame_id)
+{
+  std::scoped_lock lock(latch_);
+  auto             iter = nodes_.find(frame_id);
+  if (iter == nodes_.end()) {
+    Track(frame_id, false);
+    return;
+  }
+  auto &node = iter->second;
+  if (node.evictable_) {
+    node.evictable_ = false;
+    cur_size_--;
+  }
+  if (node.in_am_ && !node.aside_) {
+    am_.splice(am_.end(), am_, node.pos_);
+  }
+}
+
+void TwoQueueReplacer::Unpin(frame_id_t frame_id)
+{
+  std::scoped_lock lock(latch_);
+  auto             iter = nodes_.find(frame_id);
+  if (iter == nodes_.end()) {
+    if (nodes_.size() >= max_size_) {
+      return;
+    }
+    Track(frame_id, false);
+    iter = nodes_.find(frame_id);
+  }
+  auto &node = iter->second;
+  if (node.aside_) {
+    node.aside_ = false;
+    if (node.in_am_) {
+      am_.splice(am_.end(), pinned_, node.pos_);
+    } else {
+      a1in_.splice(a1in_.begin(), pinned_, node.pos_);
+    }
+  }
+  if (!node.evictable_) {
+    node.evictable_ = true;
+    cur_size_++;
+  }
+}
+
+void TwoQueueReplacer::Bind(frame_id_t frame_id, file_id_t fid, page_id_t pid)
+{
+  std::scoped_lock lock(latch_);
+  uint64_t         page  = PageKey(fid, pid);
+  auto             ghost = a1out_map_.find(page);
+  bool             in_am = ghost != a1out_map_.end();
+  if (in_am) {
+    a1out_.erase(ghost->second);
+    a1out_map_.erase(ghost);
+  }
+  Untrack(frame_id);
+  Track(frame_id, in_am);
+  nodes_.at(frame_id).page_ = page;
+}
+
+void TwoQueueReplacer::Remove(frame_id_t frame_id)
+{
+  std::scoped_lock lock(latch_);
+  Untrack(frame_id);
+}
+
+void TwoQueueReplacer::Resize(size_t max_size)
+{
+  std::scoped_lock lock(latch_);
+  max_size_ = max_size;
+  kin_      = std::max<size_t>(1, max_size / 4);
+  kout_     = std::max<size_t>(1, max_size / 2);
+  while (a1out_.size() > kout_) {
+    a1out_map_.erase(a1out_.front());
+    a1out_.pop_front();
+  }
+}
+
+auto TwoQueueReplacer::Candidates(size_t max_num) -> std::vector<frame_id_t>
+{
+  std::scoped_lock        lock(latch_);
+  std::vector<frame_id_t> candidates;
+  // follow the order Victim would take, A1in first while it is over its share
+  size_t in_size = in_size_;
+  auto   in_iter = a1in_.begin();
+  auto   am_iter = am_.begin();
+  while (candidates.size() < max_num && (in_iter != a1in_.end() || am_iter != am_.end())) {
+    bool from_in = in_iter != a1in_.end() && (in_size > kin_ || am_iter == am_.end());
+    auto frame   = from_in ? *in_iter++ : *am_iter++;
+    if (from_in) {
+      in_size--;
+    }
+    if (nodes_.at(frame).evictable_) {
+      candidates.push_back(frame);
+    }
+  }
+  return candidates;
+}
+
+auto TwoQueueReplacer::Size() -> size_t
+{
+  std::scoped_lock lock(latch_);
+  return cur_size_;
+}
+
+void TwoQueueReplacer::Track(frame_id_t frame_id, bool in_am)
+{
+  auto &queue = in_am ? am_ : a1in_;
+  queue.push_back(frame_id);
+  auto &node  = nodes_[frame_id];
+  node.pos_   = std::prev(queue.end());
+  node.in_am_ = in_am;
+  if (!in_am) {
+    in_size_++;
+  }
+}
+
+void TwoQueueReplacer::Untrack(frame_id_t frame_id)
+{
+  auto iter = nodes_.find(frame_id);
+  if (iter == nodes_.end()) {
+    return;
+  }
+  auto &node = iter->second;
+  if (node.evictable_) {
+    cur_size_--;
+  }
+  if (!node.in_am_) {
+    in_size_--;
+  }
+  QueueOf(node).erase(node.pos_);
+  nodes_.erase(iter);
+}
+
+auto TwoQueueReplacer::QueueOf(const Node &node) -> std::list<frame_id_t> &
+{
+  if (node.aside_) {
+    return pinned_;
+  }
+  return node.in_am_ ? am_ : a1in_;
+}
+
+auto TwoQueueReplacer::FirstEvictable(std::list<frame_id_t> &queue) -> std::list<frame_id_t>::iterator
+{
+  // every frame is moved aside at most once per pin
+  while (!queue.empty()) {
+    auto &node = nodes_.at(queue.front());
+    if (node.evictable_) {
+      break;
+    }
+    node.aside_ = true;
+    pinned_.splice(pinned_.end(), queue, node.pos_);
+  }
+  return queue.begin();
+}
+
+void TwoQueueReplacer::Remember(uint64_t page)
+{
+  if (page == INVALID_PAGE || a1out_map_.count(page) > 0) {
+    return;
+  }
+  a1out_.push_back(page);
+  a1out_map_[page] = std::prev(a1out_.end());
+  if (a1out_.size() > kout_) {
+    a1out_map_.erase(a1out_.front());
+    a1out_.pop_front();
+  }
+}
+
+}  // namespace njudb
@@ -0,0 +1,132 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_TWO_QUEUE_REPLACER_H
+#define NJUDB_TWO_QUEUE_REPLACER_H
+
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+#include "common/config.h"
+#include "replacer.h"
+
+namespace njudb {
+
+/**
+ * TwoQueueReplacer implements the full version of 2Q (Johnson and Shasha, VLDB'94), which is scan resistant.
+ * A page loaded for the first time enters the FIFO queue A1in, re-references while it stays in A1in are ignored,
+ * so a page touched once by a scan passes through A1in without polluting the main LRU queue Am. Pages evicted from
+ * A1in are remembered in the ghost queue A1out, and a page loaded again while it is remembered there goes to Am.
+ *
+ * A pinned frame keeps its place in its queue. When it reaches the head, Victim moves it aside to pinned_ and Unpin
+ * puts it back, at the head of A1in since it is older than every frame left there, or as the most recently used frame
+ * of Am. The frames at the heads of the queues are then evictable, so Victim is amortized O(1).
+ */
+class TwoQueueReplacer : public Replacer
+{
+public:
+  /**
+   * Create a new TwoQueueReplacer, A1in holds a quarter of the frames and A1out remembers half as many pages.
+   * @param max_size maximum number of frames the replacer tracks, should be equal to the buffer pool size
+   */
+  explicit TwoQueueReplacer(size_t max_size = BUFFER_POOL_SIZE);
+
+  ~TwoQueueReplacer() override = default;
+
+  /**
+   * Victimize a frame according to the 2Q policy.
+   * 1. grant the latch
+   * 2. move the pinned frames at the heads of A1in and Am aside
+   * 3. if A1in holds more frames than its share, evict its head and remember its page in A1out
+   * 4. else evict the least recently used frame in Am
+   * 5. fall back to the other queue if the chosen one has no evictable frame
+   * @param frame_id
+   * @return true if a victim frame was found, false otherwise
+   */
+  auto Victim(frame_id_t *frame_id) -> bool override;
+
+  /**
+   * Pin a frame, a frame in Am becomes the most recently used one, a frame in A1in keeps its position.
+   * An untracked frame enters A1in.
+   * @param frame_id
+   */
+  void Pin(frame_id_t frame_id) override;
+
+  /**
+   * Unpin a frame, indicating that it can now be victimized. A frame moved aside by Victim goes back to its queue.
+   * @param frame_id
+   */
+  void Unpin(frame_id_t frame_id) override;
+
+  /**
+   * Place the frame by the page it now holds, the frame goes to Am if the page is remembered in A1out, else to A1in.
+   * @param frame_id
+   * @param fid
+   * @param pid
+   */
+  void Bind(frame_id_t frame_id, file_id_t fid, page_id_t pid) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  void Resize(size_t max_size) override;
+
+  auto Candidates(size_t max_num) -> std::vector<frame_id_t> override;
+
+  auto Size() -> size_t override;
+
+private:
+  struct Node
+  {
+    std::list<frame_id_t>::iterator pos_;
+    bool                            in_am_{false};
+    bool                            evictable_{false};
+    bool                            aside_{false};  // moved to pinned_ by Victim
+    uint64_t                        page_{INVALID_PAGE};  // the page bound to the frame, packed by PageKey
+  };
+
+  static constexpr uint64_t INVALID_PAGE = UINT64_MAX;
+
+  static auto PageKey(file_id_t fid, page_id_t pid) -> uint64_t
+  {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(fid)) << 32) | static_cast<uint32_t>(pid);
+  }
+
+  /** sub procedures, should be called with the latch held */
+  void Track(frame_id_t frame_id, bool in_am);
+  void Untrack(frame_id_t frame_id);
+  auto QueueOf(const Node &node) -> std::list<frame_id_t> &;
+  auto FirstEvictable(std::list<frame_id_t> &queue) -> std::list<frame_id_t>::iterator;
+  void Remember(uint64_t page);
+
+  std::list<frame_id_t>                                        a1in_;    // FIFO, the front is the oldest
+  std::list<frame_id_t>                                        am_;      // LRU, the front is the least recently used
+  std::list<frame_id_t>                                        pinned_;  // pinned frames that reached a queue head
+  size_t                                                       in_size_{0};  // frames of A1in, pinned_ included
+  std::unordered_map<frame_id_t, Node>                         nodes_;
+  std::list<uint64_t>                                          a1out_;  // FIFO of evicted pages, no frame attached
+  std::unordered_map<uint64_t, std::list<uint64_t>::iterator> a1out_map_;
+  size_t                                                       cur_size_{0};  // number of evictable frames
+  size_t                                                       max_size_;
+  size_t                                                       kin_;   // share of A1in
+  size_t                                                       kout_;  // capacity of A1out
+  std::mutex                                                   latch_;
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_TWO_QUEUE_REPLACER_H
@@ -0,0 +1,376 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#include "async_disk_manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../../../common/error.h"
+#include "../../common/page.h"
+
+namespace njudb {
+
+namespace {
+
+auto IoUringSetup(unsigned entries, io_uring_params *params) -> int
+{
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+auto IoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) -> int
+{
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+void Fulfill(std::promise<void> &promise, int err, NJUDBExceptionType type, file_id_t fid, page_id_t page_id)
+{
+  if (err == 0) {
+    promise.set_value();
+    return;
+  }
+  promise.set_exception(std::make_exception_ptr(NJUDBException_(type,
+      "AsyncDiskManager",
+      "Complete",
+      fmt::format("fid: {}, page_id: {}, {}", fid, page_id, strerror(err)))));
+}
+
+}  // namespace
+
+/**
+ * The submission and completion rings shared with the kernel, the sqes are filled under latch_ and the completions are
+ * only consumed by the completion thread
+ */
+struct AsyncDiskManager::Uring
+{
+  int           fd{-1};
+  void         *sq_ring{MAP_FAILED};
+  size_t        sq_ring_size{0};
+  void         *cq_ring{MAP_FAILED};
+  size_t        cq_ring_size{0};
+  io_uring_sqe *sqes{static_cast<io_uring_sqe *>(MAP_FAILED)};
+  size_t        sqes_size{0};
+
+  unsigned     *sq_tail{nullptr};
+  unsigned     *sq_mask{nullptr};
+  unsigned     *sq_array{nullptr};
+  unsigned     *cq_head{nullptr};
+  unsigned     *cq_tail{nullptr};
+  unsigned     *cq_mask{nullptr};
+  io_uring_cqe *cqes{nullptr};
+
+  ~Uring()
+  {
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED) {
+      munmap(sq_ring, sq_ring_size);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  /**
+   * @return nullptr if io_uring is not supported by the kernel or not permitted
+   */
+  static auto Create(unsigned entries) -> std::unique_ptr<Uring>
+  {
+    io_uring_params params{};
+    auto            ring = std::make_unique<Uring>();
+    ring->fd             = IoUringSetup(entries, &params);
+    if (ring->fd < 0) {
+      return nullptr;
+    }
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring->sqes_size    = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sq_ring      = mmap(
+        nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = mmap(
+        nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = static_cast<io_uring_sqe *>(
+        mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+      return nullptr;
+    }
+    auto *sq       = static_cast<char *>(ring->sq_ring);
+    auto *cq       = static_cast<char *>(ring->cq_ring);
+    ring->sq_tail  = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    ring->sq_mask  = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    ring->sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    ring->cq_head  = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    ring->cq_tail  = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    ring->cq_mask  = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    ring->cqes     = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return ring;
+  }
+
+  /**
+   * Queue an sqe for request on fd, the caller holds latch_ and has made sure that the ring is not full
+   */
+  void Push(const Request *request, int fd = -1)
+  {
+    unsigned tail = *sq_tail;
+    unsigned idx  = tail & *sq_mask;
+    auto    *sqe  = &sqes[idx];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    if (request == nullptr) {
+      sqe->opcode = IORING_OP_NOP;
+    } else {
+      sqe->opcode    = request->write ? IORING_OP_WRITE : IORING_OP_READ;
+      sqe->fd        = fd;
+      sqe->addr      = reinterpret_cast<uint64_t>(request->data);
+      sqe->len       = PAGE_SIZE;
+      sqe->off       = static_cast<uint64_t>(request->page_id) * PAGE_SIZE;
+      sqe->user_data = reinterpret_cast<uint64_t>(request);
+    }
+    sq_array[idx] = idx;
+    std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+  }
+
+  /**
+   * Hand count queued sqes to the kernel
+   */
+  void Enter(unsigned count) const
+  {
+    while (count > 0) {
+      int ret = IoUringEnter(fd, count, 0, 0);
+      if (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (ret < 0) {
+        NJUDB_FATAL(fmt::format("io_uring_enter failed: {}", strerror(errno)));
+      }
+      count -= static_cast<unsigned>(ret);
+    }
+  }
+};
+
+AsyncDiskManager::AsyncDiskManager(DiskManager *disk_manager, size_t queue_depth, bool use_io_uring)
+    : disk_manager_(disk_manager), queue_depth_(std::max<size_t>(queue_depth, 1))
+{
+  if (use_io_uring) {
+    // one more entry for the sentinel that stops the completion thread
+    ring_ = Uring::Create(static_cast<unsigned>(queue_depth_ + 1));
+  }
+  if (ring_ != nullptr) {
+    threads_.emplace_back(&AsyncDiskManager::CompletionLoop, this);
+  } else {
+    for (size_t i = 0; i < ASYNC_IO_WORKERS; ++i) {
+      threads_.emplace_back(&AsyncDiskManager::WorkerLoop, this);
+    }
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager()
+{
+  Wait();
+  {
+    std::lock_guard lock(latch_);
+    stop_ = true;
+    if (ring_ != nullptr) {
+      ring_->Push(nullptr);
+      ring_->Enter(1);
+    }
+  }
+  cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void AsyncDiskManager::Submit(std::vector<Request> requests)
+{
+  if (ring_ != nullptr) {
+    // where a page of a compressed file lies is only known by the DiskManager, it reads and writes them synchronously
+    auto compressed = std::stable_partition(requests.begin(), requests.end(), [this](const Request &request) {
+      return disk_manager_->GetPageCompression(request.fid) == PAGE_COMPRESSION_NONE;
+    });
+    for (auto it = compressed; it != requests.end(); ++it) {
+      {
+        std::lock_guard lock(latch_);
+        in_flight_++;
+      }
+      Complete(*it, ExecuteSync(*it));
+    }
+    requests.erase(compressed, requests.end());
+    SubmitUring(requests);
+  } else {
+    SubmitThreadPool(requests);
+  }
+}
+
+auto AsyncDiskManager::ReadPage(file_id_t fid, page_id_t page_id, char *data) -> std::future<void>
+{
+  auto promise = std::make_shared<std::promise<void>>();
+  auto future  = promise->get_future();
+  Submit({{false, fid, page_id, data, [promise, fid, page_id](int err) {
+             Fulfill(*promise, err, NJUDB_FILE_READ_ERROR, fid, page_id);
+           }}});
+  return future;
+}
+
+auto AsyncDiskManager::WritePage(file_id_t fid, page_id_t page_id, const char *data) -> std::future<void>
+{
+  auto promise = std::make_shared<std::promise<void>>();
+  auto future  = promise->get_future();
+  Submit({{true, fid, page_id, const_cast<char *>(data), [promise, fid, page_id](int err) {
+             Fulfill(*promise, err, NJUDB_FILE_WRITE_ERROR, fid, page_id);
+           }}});
+  return future;
+}
+
+void AsyncDiskManager::Wait()
+{
+  std::unique_lock lock(latch_);
+  cv_.wait(lock, [this]() { return in_flight_ == 0; });
+}
+
+void AsyncDiskManager::SubmitUring(std::vector<Request> &requests)
+{
+  std::unique_lock lock(latch_);
+  unsigned         queued = 0;
+  for (auto &request : requests) {
+    if (in_flight_ == queue_depth_) {
+      // submit what has been queued so far before waiting, the ring only has room for queue_depth_ requests
+      ring_->Enter(queued);
+      queued = 0;
+      cv_.wait(lock, [this]() { return in_flight_ < queue_depth_; });
+    }
+    if (request.write && request.page_id != FILE_HEADER_PAGE_ID && disk_manager_->HasPageChecksum(request.fid)) {
+      // stamp a copy as DiskManager::StampPages does, the data is often a frame that readers holding its shared latch
+      // may be looking at. The copy is page aligned for direct I/O and freed once the write completes
+      char *copy = PageDataAllocator::Allocate();
+      memcpy(copy, request.data, PAGE_SIZE);
+      StampPageChecksum(copy);
+      request.data     = copy;
+      request.callback = [copy, callback = std::move(request.callback)](int err) {
+        PageDataAllocator::Free(copy);
+        if (callback) {
+          callback(err);
+        }
+      };
+    }
+    // the O_DIRECT fd in direct I/O mode
+    int fd = disk_manager_->GetPageFd(request.fid);
+    ring_->Push(new Request(std::move(request)), fd);
+    queued++;
+    in_flight_++;
+  }
+  ring_->Enter(queued);
+}
+
+void AsyncDiskManager::SubmitThreadPool(std::vector<Request> &requests)
+{
+  std::unique_lock lock(latch_);
+  for (auto &request : requests) {
+    cv_.wait(lock, [this]() { return in_flight_ < queue_depth_; });
+    queue_.push_back(std::move(request));
+    in_flight_++;
+    cv_.notify_all();
+  }
+}
+
+void AsyncDiskManager::CompletionLoop()
+{
+  while (true) {
+    unsigned head = *ring_->cq_head;
+    unsigned tail = std::atomic_ref<unsigned>(*ring_->cq_tail).load(std::memory_order_acquire);
+    if (head == tail) {
+      if (IoUringEnter(ring_->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+        NJUDB_FATAL(fmt::format("io_uring_enter failed: {}", strerror(errno)));
+      }
+      continue;
+    }
+    for (; head != tail; ++head) {
+      const auto &cqe       = ring_->cqes[head & *ring_->cq_mask];
+      auto       *request   = reinterpret_cast<Request *>(cqe.user_data);
+      int         res       = cqe.res;
+      std::atomic_ref<unsigned>(*ring_->cq_head).store(head + 1, std::memory_order_release);
+      if (request == nullptr) {
+        return;
+      }
+      int err = 0;
+      if (res < 0) {
+        err = -res;
+      } else if (static_cast<size_t>(res) != PAGE_SIZE) {
+        // a short read at the end of the file or a partial write, let the DiskManager finish it
+        err = ExecuteSync(*request);
+      } else if (!request->write && request->page_id != FILE_HEADER_PAGE_ID &&
+                 disk_manager_->IsPageChecksumVerified(request->fid) && !PageChecksumMatches(request->data)) {
+        err = EBADMSG;
+      }
+      Complete(*request, err);
+      delete request;
+    }
+  }
+}
+
+void AsyncDiskManager::WorkerLoop()
+{
+  std::unique_lock lock(latch_);
+  while (true) {
+    cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    auto request = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    Complete(request, ExecuteSync(request));
+    lock.lock();
+  }
+}
+
+auto AsyncDiskManager::ExecuteSync(const Request &request) -> int
+{
+  try {
+    if (request.write) {
+      disk_manager_->WritePage(request.fid, request.page_id, request.data);
+    } else {
+      disk_manager_->ReadPage(request.fid, request.page_id, request.data);
+    }
+  } catch (NJUDBException_ &e) {
+    return e.type_ == NJUDB_PAGE_CORRUPTED ? EBADMSG : EIO;
+  }
+  return 0;
+}
+
+void AsyncDiskManager::Complete(Request &request, int err)
+{
+  if (request.callback) {
+    request.callback(err);
+  }
+  {
+    std::lock_guard lock(latch_);
+    in_flight_--;
+  }
+  cv_.notify_all();
+}
+
+}  // namespace njudb
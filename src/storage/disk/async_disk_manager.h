@@ -0,0 +1,130 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_ASYNC_DISK_MANAGER_H
+#define NJUDB_ASYNC_DISK_MANAGER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "disk_manager.h"
+#include "common/config.h"
+#include "common/types.h"
+#include "../../../common/micro.h"
+
+namespace njudb {
+
+/**
+ * AsyncDiskManager issues page reads and writes without blocking the caller, so that one thread can keep many I/Os in
+ * flight. It is built on io_uring and falls back to a pool of threads issuing synchronous I/O through the DiskManager
+ * when io_uring is not available. Files are still opened and closed by the DiskManager it is created with.
+ */
+class AsyncDiskManager
+{
+public:
+  /**
+   * Called once the I/O has completed, from an I/O thread, with 0 on success or an errno value, EBADMSG if a page read
+   * from a file with verified checksums is corrupted
+   */
+  using Callback = std::function<void(int err)>;
+
+  struct Request
+  {
+    bool       write;
+    file_id_t  fid;
+    page_id_t  page_id;
+    char      *data;  // PAGE_SIZE bytes, must stay valid until the callback is called
+    Callback   callback;
+  };
+
+  /**
+   * @param queue_depth maximum number of I/Os in flight, Submit blocks when it is reached
+   * @param use_io_uring false to always use the thread pool
+   */
+  explicit AsyncDiskManager(
+      DiskManager *disk_manager, size_t queue_depth = ASYNC_IO_QUEUE_DEPTH, bool use_io_uring = true);
+
+  /**
+   * Waits for all I/O in flight
+   */
+  ~AsyncDiskManager();
+
+  DISABLE_COPY_MOVE_AND_ASSIGN(AsyncDiskManager)
+
+  /**
+   * Submit a batch of requests, with io_uring the whole batch is handed to the kernel by a single system call
+   */
+  void Submit(std::vector<Request> requests);
+
+  /**
+   * Read a page asynchronously, the future throws NJUDB_FILE_READ_ERROR if the read fails
+   */
+  auto ReadPage(file_id_t fid, page_id_t page_id, char *data) -> std::future<void>;
+
+  /**
+   * Write a page asynchronously, the future throws NJUDB_FILE_WRITE_ERROR if the write fails
+   */
+  auto WritePage(file_id_t fid, page_id_t page_id, const char *data) -> std::future<void>;
+
+  /**
+   * Block until every submitted request has completed
+   */
+  void Wait();
+
+  [[nodiscard]] auto UsesIoUring() const -> bool { return ring_ != nullptr; }
+
+private:
+  struct Uring;
+
+  void SubmitUring(std::vector<Request> &requests);
+
+  void SubmitThreadPool(std::vector<Request> &requests);
+
+  /**
+   * Reaps io_uring completions until the sentinel submitted by the destructor completes
+   */
+  void CompletionLoop();
+
+  void WorkerLoop();
+
+  /**
+   * Issue the request synchronously through the DiskManager, which handles short reads and writes
+   */
+  auto ExecuteSync(const Request &request) -> int;
+
+  void Complete(Request &request, int err);
+
+  DiskManager          *disk_manager_;
+  size_t                queue_depth_;
+  std::unique_ptr<Uring> ring_;
+
+  std::mutex              latch_;
+  std::condition_variable cv_;  // signaled when an I/O completes or a request is queued for the thread pool
+  size_t                  in_flight_{0};
+  bool                    stop_{false};
+  std::deque<Request>     queue_;  // requests waiting for a thread of the pool
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_ASYNC_DISK_MANAGER_H
@@ -19,24 +19,52 @@
 // Created by ziqi on 2024/7/17.
 //
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
 #include <filesystem>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include "disk_manager.h"
+#include "page_compressor.h"
 #include "../../common/config.h"
+#include "../../common/page.h"
 #include "../../../common/error.h"
 
 namespace njudb {
-void DiskManager::CreateFile(const std::string &fname)
+
+// pages WritePages stamps and writes at a time, bounds the copy buffer of each thread
+constexpr size_t STAMP_BATCH_PAGES = 64;
+
+// page map file: a header followed by the slots of the pages
+constexpr uint32_t PAGE_MAP_MAGIC = 0x504d4150;
+struct PageMapHeader
+{
+  uint32_t magic;
+  uint32_t compression;
+  uint64_t page_num;
+};
+
+void DiskManager::CreateFile(const std::string &fname, PageCompression compression)
 {
   if (FileExists(fname)) {
     NJUDB_THROW(NJUDB_FILE_EXISTS, fname);
   }
+  if (compression != PAGE_COMPRESSION_NONE && !PageCompressor::IsAvailable(compression)) {
+    NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("page compression {}", PageCompressionToString(compression)));
+  }
   std::ofstream file(fname);
   if (!file) {
     NJUDB_FATAL("Create file failed");
   }
   file.close();
+  if (compression != PAGE_COMPRESSION_NONE) {
+    CompressedFile map;
+    map.compression = compression;
+    SavePageMap(fname, map);
+  }
 }
 
 void DiskManager::DestroyFile(const std::string &fname)
@@ -48,73 +76,611 @@ void DiskManager::DestroyFile(const std::string &fname)
   if (ret < 0) {
     NJUDB_THROW(NJUDB_FILE_DELETE_ERROR, fname);
   }
+  if (FileExists(fname + PAGE_MAP_SUFFIX) && unlink((fname + PAGE_MAP_SUFFIX).c_str()) < 0) {
+    NJUDB_THROW(NJUDB_FILE_DELETE_ERROR, fname + PAGE_MAP_SUFFIX);
+  }
 }
 
 auto DiskManager::OpenFile(const std::string &fname) -> file_id_t
 {
   if (!FileExists(fname))
     NJUDB_THROW(NJUDB_FILE_NOT_EXISTS, fname);
+  std::unique_lock lock(latch_);
   if (name_fid_map_.find(fname) != name_fid_map_.end()) {
     NJUDB_THROW(NJUDB_FILE_REOPEN, fname);
   } else {
+    std::unique_ptr<CompressedFile> compressed;
+    if (FileExists(fname + PAGE_MAP_SUFFIX)) {
+      compressed = LoadPageMap(fname);
+    }
     int fd = open(fname.c_str(), O_RDWR);
     if (fd == -1) {
       NJUDB_THROW(NJUDB_FILE_NOT_OPEN, fname);
     }
+    if (direct_io_ && compressed == nullptr) {
+      // a second fd for page I/O, the metadata read and written through the cursor is not page aligned
+      int direct_fd = open(fname.c_str(), O_RDWR | O_DIRECT);
+      if (direct_fd == -1) {
+        close(fd);
+        NJUDB_THROW(NJUDB_FILE_NOT_OPEN, fmt::format("{}, O_DIRECT: {}", fname, strerror(errno)));
+      }
+      fid_direct_fd_map_.insert(std::make_pair(fd, direct_fd));
+    }
+    struct stat st{};
+    fstat(fd, &st);
     name_fid_map_.insert(std::make_pair(fname, fd));
     fid_name_map_.insert(std::make_pair(fd, fname));
+    fid_offset_map_.insert(std::make_pair(fd, 0));
+    fid_allocated_map_.insert(std::make_pair(fd, (static_cast<size_t>(st.st_size) + PAGE_SIZE - 1) / PAGE_SIZE));
+    if (compressed != nullptr) {
+      fid_compressed_map_.insert(std::make_pair(fd, std::move(compressed)));
+    }
     return fd;
   }
 }
 
 void DiskManager::CloseFile(file_id_t fid)
 {
+  std::unique_lock lock(latch_);
   if (fid_name_map_.find(fid) == fid_name_map_.end()) {
     NJUDB_THROW(NJUDB_FILE_NOT_OPEN, fmt::format("fid: {}", fid));
   } else {
+    // the page map is up to date, it is written through by WriteCompressedPage
+    fid_compressed_map_.erase(fid);
     name_fid_map_.erase(fid_name_map_[fid]);
     fid_name_map_.erase(fid);
+    fid_offset_map_.erase(fid);
+    fid_allocated_map_.erase(fid);
+    fid_checksum_map_.erase(fid);
+    if (auto it = fid_direct_fd_map_.find(fid); it != fid_direct_fd_map_.end()) {
+      close(it->second);
+      fid_direct_fd_map_.erase(it);
+    }
     close(fid);
   }
 }
 
 void DiskManager::WritePage(file_id_t fid, page_id_t page_id, const char *data)
 {
-  NJUDB_ASSERT(fid_name_map_.find(fid) != fid_name_map_.end(), fmt::format("fid: {}", fid));
-  lseek(fid, static_cast<off_t>(page_id) * static_cast<off_t>(PAGE_SIZE), SEEK_SET);
-  if (write(fid, data, PAGE_SIZE) != PAGE_SIZE) {
-    NJUDB_THROW(
-        NJUDB_FILE_WRITE_ERROR, fmt::format("fid: {}, page_id: {}", fid, page_id));
+  int fd = GetPageFd(fid);
+  NJUDB_ASSERT(fd != -1, fmt::format("fid: {}", fid));
+  if (HasPageChecksum(fid)) {
+    data = StampPages(page_id, &data, 1);
+  }
+  if (auto *file = GetCompressedFile(fid); file != nullptr) {
+    WriteCompressedPage(fid, *file, page_id, data);
+    return;
+  }
+  // positional I/O, the buffer pool issues page I/O from several threads without holding its latch
+  if (!WriteAt(fd, data, PAGE_SIZE, static_cast<off_t>(page_id) * static_cast<off_t>(PAGE_SIZE))) {
+    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("fid: {}, page_id: {}, {}", fid, page_id, strerror(errno)));
   }
 }
 
 void DiskManager::ReadPage(file_id_t fid, page_id_t page_id, char *data)
 {
-  NJUDB_ASSERT(fid_name_map_.find(fid) != fid_name_map_.end(), fmt::format("fid: {}", fid));
-  lseek(fid, static_cast<off_t>(page_id) * static_cast<off_t>(PAGE_SIZE), SEEK_SET);
-  if (read(fid, data, PAGE_SIZE) < 0) {
-    NJUDB_THROW(
-        NJUDB_FILE_READ_ERROR, fmt::format("fid: {}, page_id: {}", fid, page_id));
+  int fd = GetPageFd(fid);
+  NJUDB_ASSERT(fd != -1, fmt::format("fid: {}", fid));
+  if (auto *file = GetCompressedFile(fid); file != nullptr) {
+    ReadCompressedPage(fid, *file, page_id, data);
+    VerifyPages(fid, page_id, &data, 1);
+    return;
+  }
+  auto bytes = ReadAt(fd, data, PAGE_SIZE, static_cast<off_t>(page_id) * static_cast<off_t>(PAGE_SIZE), fd != fid);
+  if (bytes < 0) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("fid: {}, page_id: {}, {}", fid, page_id, strerror(errno)));
+  }
+  // a page that has been allocated but never written lies (partly) beyond the end of the file
+  memset(data + bytes, 0, PAGE_SIZE - bytes);
+  VerifyPages(fid, page_id, &data, 1);
+}
+
+void DiskManager::WritePages(file_id_t fid, page_id_t page_id, const std::vector<const char *> &data)
+{
+  int fd = GetPageFd(fid);
+  NJUDB_ASSERT(fd != -1, fmt::format("fid: {}", fid));
+  if (GetCompressedFile(fid) != nullptr) {
+    // compressed pages are not contiguous on disk
+    for (size_t i = 0; i < data.size(); ++i) {
+      WritePage(fid, page_id + static_cast<page_id_t>(i), data[i]);
+    }
+    return;
   }
+  if (HasPageChecksum(fid)) {
+    // stamped copies of at most STAMP_BATCH_PAGES pages, written by one pwrite each
+    for (size_t i = 0; i < data.size(); i += STAMP_BATCH_PAGES) {
+      auto num    = std::min(STAMP_BATCH_PAGES, data.size() - i);
+      auto copy   = StampPages(page_id + static_cast<page_id_t>(i), data.data() + i, num);
+      auto offset = static_cast<off_t>(page_id + i) * static_cast<off_t>(PAGE_SIZE);
+      if (!WriteAt(fd, copy, num * PAGE_SIZE, offset)) {
+        NJUDB_THROW(NJUDB_FILE_WRITE_ERROR,
+            fmt::format("fid: {}, page_id: {}, pages: {}, {}", fid, page_id + i, num, strerror(errno)));
+      }
+    }
+    return;
+  }
+  std::vector<iovec> iov;
+  iov.reserve(data.size());
+  for (const char *page : data) {
+    iov.push_back({const_cast<char *>(page), PAGE_SIZE});
+  }
+  if (TransferV(fd, iov, static_cast<off_t>(page_id) * static_cast<off_t>(PAGE_SIZE), true, fd != fid) < 0) {
+    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR,
+        fmt::format("fid: {}, page_id: {}, pages: {}, {}", fid, page_id, data.size(), strerror(errno)));
+  }
+}
+
+void DiskManager::ReadPages(file_id_t fid, page_id_t page_id, const std::vector<char *> &data)
+{
+  int fd = GetPageFd(fid);
+  NJUDB_ASSERT(fd != -1, fmt::format("fid: {}", fid));
+  if (GetCompressedFile(fid) != nullptr) {
+    for (size_t i = 0; i < data.size(); ++i) {
+      ReadPage(fid, page_id + static_cast<page_id_t>(i), data[i]);
+    }
+    return;
+  }
+  std::vector<iovec> iov;
+  iov.reserve(data.size());
+  for (char *page : data) {
+    iov.push_back({page, PAGE_SIZE});
+  }
+  auto bytes = TransferV(fd, iov, static_cast<off_t>(page_id) * static_cast<off_t>(PAGE_SIZE), false, fd != fid);
+  if (bytes < 0) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR,
+        fmt::format("fid: {}, page_id: {}, pages: {}, {}", fid, page_id, data.size(), strerror(errno)));
+  }
+  for (size_t i = bytes / PAGE_SIZE; i < data.size(); ++i) {
+    size_t done = i == static_cast<size_t>(bytes) / PAGE_SIZE ? bytes % PAGE_SIZE : 0;
+    memset(data[i] + done, 0, PAGE_SIZE - done);
+  }
+  VerifyPages(fid, page_id, data.data(), data.size());
+}
+
+void DiskManager::SetPageChecksum(file_id_t fid, bool verify)
+{
+  std::unique_lock lock(latch_);
+  NJUDB_ASSERT(fid_name_map_.count(fid) != 0, fmt::format("fid: {}", fid));
+  fid_checksum_map_[fid] = verify;
+}
+
+auto DiskManager::HasPageChecksum(file_id_t fid) -> bool
+{
+  std::shared_lock lock(latch_);
+  return fid_checksum_map_.count(fid) != 0;
+}
+
+auto DiskManager::IsPageChecksumVerified(file_id_t fid) -> bool
+{
+  std::shared_lock lock(latch_);
+  auto             it = fid_checksum_map_.find(fid);
+  return it != fid_checksum_map_.end() && it->second;
+}
+
+auto DiskManager::StampPages(page_id_t page_id, const char *const *data, size_t num) -> char *
+{
+  struct AlignedDelete
+  {
+    void operator()(char *buffer) const { ::operator delete(buffer, std::align_val_t{PAGE_SIZE}); }
+  };
+  // page aligned for the O_DIRECT fd
+  thread_local std::unique_ptr<char, AlignedDelete> buffer;
+  thread_local size_t                               capacity = 0;
+  if (capacity < num) {
+    buffer.reset(static_cast<char *>(::operator new(num * PAGE_SIZE, std::align_val_t{PAGE_SIZE})));
+    capacity = num;
+  }
+  for (size_t i = 0; i < num; ++i) {
+    char *copy = buffer.get() + i * PAGE_SIZE;
+    memcpy(copy, data[i], PAGE_SIZE);
+    if (page_id + static_cast<page_id_t>(i) != FILE_HEADER_PAGE_ID) {
+      StampPageChecksum(copy);
+    }
+  }
+  return buffer.get();
+}
+
+void DiskManager::VerifyPages(file_id_t fid, page_id_t page_id, char *const *data, size_t num)
+{
+  if (!IsPageChecksumVerified(fid)) {
+    return;
+  }
+  for (size_t i = 0; i < num; ++i) {
+    auto pid = page_id + static_cast<page_id_t>(i);
+    if (pid != FILE_HEADER_PAGE_ID && !PageChecksumMatches(data[i])) {
+      NJUDB_THROW(NJUDB_PAGE_CORRUPTED, fmt::format("file: {}, page_id: {}", GetFileName(fid), pid));
+    }
+  }
+}
+
+void DiskManager::AllocatePages(file_id_t fid, size_t page_num)
+{
+  {
+    std::shared_lock lock(latch_);
+    auto             it = fid_allocated_map_.find(fid);
+    NJUDB_ASSERT(it != fid_allocated_map_.end(), fmt::format("fid: {}", fid));
+    // slots of a compressed file are allocated when its pages are written
+    if (extent_pages_ == 0 || page_num <= it->second || fid_compressed_map_.count(fid) != 0) {
+      return;
+    }
+  }
+  size_t reserved;
+  size_t target;
+  {
+    std::unique_lock lock(latch_);
+    auto            &allocated = fid_allocated_map_[fid];
+    if (page_num <= allocated) {
+      return;
+    }
+    // grow by at least a quarter of the file as well, so that a large file is made of few extents
+    target   = std::max(page_num, allocated + allocated / 4);
+    target   = (target + extent_pages_ - 1) / extent_pages_ * extent_pages_;
+    reserved = allocated;
+    // claim the extent so that no other caller reserves it again, the blocks are allocated after the latch is
+    // released. Until then the pages are allocated by their writes, as on file systems without fallocate
+    allocated = target;
+  }
+  auto offset = static_cast<off_t>(reserved * PAGE_SIZE);
+  auto length = static_cast<off_t>((target - reserved) * PAGE_SIZE);
+  // FALLOC_FL_KEEP_SIZE reserves blocks beyond the end of the file without extending it
+  if (fallocate(fid, FALLOC_FL_KEEP_SIZE, offset, length) < 0 && errno != EOPNOTSUPP && errno != ENOSYS) {
+    int err = errno;
+    {
+      std::unique_lock lock(latch_);
+      // give the extent back unless another caller has grown the reservation since
+      if (auto it = fid_allocated_map_.find(fid); it != fid_allocated_map_.end() && it->second == target) {
+        it->second = reserved;
+      }
+    }
+    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("fid: {}, pages: {}, {}", fid, target, strerror(err)));
+  }
+}
+
+auto DiskManager::GetAllocatedPages(file_id_t fid) -> size_t
+{
+  std::shared_lock lock(latch_);
+  auto             it = fid_allocated_map_.find(fid);
+  if (it == fid_allocated_map_.end()) {
+    NJUDB_THROW(NJUDB_FILE_NOT_OPEN, fmt::format("fid: {}", fid));
+  }
+  return it->second;
+}
+
+auto DiskManager::MapFile(file_id_t fid) -> std::unique_ptr<FileMapping>
+{
+  if (GetCompressedFile(fid) != nullptr) {
+    NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("map compressed file {}", GetFileName(fid)));
+  }
+  // the buffered fd, the mapping shares the OS page cache
+  return std::make_unique<FileMapping>(fid, GetFileSize(fid));
+}
+
+auto DiskManager::GetFileSize(file_id_t fid) -> size_t
+{
+  if (!IsOpen(fid)) {
+    NJUDB_THROW(NJUDB_FILE_NOT_OPEN, fmt::format("fid: {}", fid));
+  }
+  if (auto *file = GetCompressedFile(fid); file != nullptr) {
+    std::shared_lock lock(file->latch);
+    return std::max<size_t>(file->slots.size(), 1) * PAGE_SIZE;
+  }
+  struct stat st{};
+  if (fstat(fid, &st) < 0) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("fid: {}, {}", fid, strerror(errno)));
+  }
+  return static_cast<size_t>(st.st_size);
 }
 
 void DiskManager::ReadFile(file_id_t fid, char *data, size_t size, size_t offset, int type)
 {
-  NJUDB_ASSERT(fid_name_map_.find(fid) != fid_name_map_.end(), "File not Opened");
-  lseek(fid, static_cast<off_t>(offset), type);
-  if(read(fid, data, size) < 0) {
-    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("fid: {}", fid));
+  auto pos   = Seek(fid, static_cast<off_t>(offset), type);
+  auto bytes = ReadAt(fid, data, size, pos);
+  if (bytes < 0) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("fid: {}, {}", fid, strerror(errno)));
   }
+  memset(data + bytes, 0, size - bytes);
+  Seek(fid, pos + bytes, SEEK_SET);
 }
 
 void DiskManager::WriteFile(file_id_t fid, const char *data, size_t size, int type, int off)
 {
-  NJUDB_ASSERT(fid_name_map_.find(fid) != fid_name_map_.end(), "File not Opened");
+  auto pos = Seek(fid, off, type);
+  if (!WriteAt(fid, data, size, pos)) {
+    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("fid: {}, {}", fid, strerror(errno)));
+  }
+  Seek(fid, pos + static_cast<off_t>(size), SEEK_SET);
+}
+
+auto DiskManager::GetPageCompression(file_id_t fid) -> PageCompression
+{
+  auto *file = GetCompressedFile(fid);
+  return file == nullptr ? PAGE_COMPRESSION_NONE : file->compression;
+}
+
+auto DiskManager::GetCompressedFile(file_id_t fid) -> CompressedFile *
+{
+  std::shared_lock lock(latch_);
+  auto             it = fid_compressed_map_.find(fid);
+  return it == fid_compressed_map_.end() ? nullptr : it->second.get();
+}
+
+void DiskManager::WriteCompressedPage(file_id_t fid, CompressedFile &file, page_id_t page_id, const char *data)
+{
+  if (page_id == FILE_HEADER_PAGE_ID) {
+    // the header page lies at the beginning of the file as in any other file
+    if (!WriteAt(fid, data, PAGE_SIZE, 0)) {
+      NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("fid: {}, page_id: {}, {}", fid, page_id, strerror(errno)));
+    }
+    return;
+  }
+  thread_local std::vector<char> buffer;
+  buffer.resize(PageCompressor::MaxCompressedSize(file.compression));
+  auto size     = PageCompressor::Compress(file.compression, data, buffer.data(), buffer.size());
+  auto capacity = (size + COMPRESSED_SLOT_SIZE - 1) / COMPRESSED_SLOT_SIZE * COMPRESSED_SLOT_SIZE;
+  if (size == 0 || capacity >= PAGE_SIZE) {
+    // a page that saves no slot is stored as is
+    size     = PAGE_SIZE;
+    capacity = PAGE_SIZE;
+  } else {
+    data = buffer.data();
+  }
+
+  std::unique_lock lock(file.latch);
+  bool             grown = file.slots.size() <= static_cast<size_t>(page_id);
+  if (grown) {
+    file.slots.resize(page_id + 1, PageSlot{0, 0, 0});
+  }
+  auto &slot = file.slots[page_id];
+  auto  old  = slot;
+  if (slot.offset == 0 || slot.capacity < capacity) {
+    // the smallest unused slot the page fits in, or a new one at the end of the file. The old slot is not free yet,
+    // the page map on disk still points at it
+    auto it = file.free_slots.lower_bound(static_cast<uint32_t>(capacity));
+    if (it != file.free_slots.end()) {
+      slot.offset   = it->second.back();
+      slot.capacity = it->first;
+      it->second.pop_back();
+      if (it->second.empty()) {
+        file.free_slots.erase(it);
+      }
+    } else {
+      slot.offset   = file.end;
+      slot.capacity = static_cast<uint32_t>(capacity);
+      file.end += capacity;
+    }
+  }
+  // the rest of a larger slot, e.g. of a page that shrank, is given back once the page map no longer claims it
+  uint64_t rest = slot.capacity > capacity ? slot.capacity - capacity : 0;
+  slot.capacity -= static_cast<uint32_t>(rest);
+  slot.size = static_cast<uint32_t>(size);
+  if (!WriteAt(fid, data, size, static_cast<off_t>(slot.offset))) {
+    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("fid: {}, page_id: {}, {}", fid, page_id, strerror(errno)));
+  }
+  SavePageSlot(file, page_id, grown);
+  if (rest > 0) {
+    file.free_slots[static_cast<uint32_t>(rest)].push_back(slot.offset + slot.capacity);
+  }
+  if (old.offset != 0 && old.offset != slot.offset) {
+    file.free_slots[old.capacity].push_back(old.offset);
+  }
+}
+
+void DiskManager::ReadCompressedPage(file_id_t fid, CompressedFile &file, page_id_t page_id, char *data)
+{
+  if (page_id == FILE_HEADER_PAGE_ID) {
+    auto bytes = ReadAt(fid, data, PAGE_SIZE, 0);
+    if (bytes < 0) {
+      NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("fid: {}, page_id: {}, {}", fid, page_id, strerror(errno)));
+    }
+    memset(data + bytes, 0, PAGE_SIZE - bytes);
+    return;
+  }
+  thread_local std::vector<char> buffer(PAGE_SIZE);
+  std::shared_lock               lock(file.latch);
+  if (static_cast<size_t>(page_id) >= file.slots.size() || file.slots[page_id].offset == 0) {
+    // never written
+    memset(data, 0, PAGE_SIZE);
+    return;
+  }
+  auto  slot   = file.slots[page_id];
+  char *target = slot.size == PAGE_SIZE ? data : buffer.data();
+  auto  bytes  = ReadAt(fid, target, slot.size, static_cast<off_t>(slot.offset));
+  if (bytes < 0) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("fid: {}, page_id: {}, {}", fid, page_id, strerror(errno)));
+  }
+  if (static_cast<size_t>(bytes) != slot.size ||
+      (target != data && !PageCompressor::Decompress(file.compression, target, slot.size, data))) {
+    NJUDB_THROW(
+        NJUDB_PAGE_CORRUPTED, fmt::format("fid: {}, page_id: {}, compressed size: {}", fid, page_id, slot.size));
+  }
+}
+
+auto DiskManager::LoadPageMap(const std::string &fname) -> std::unique_ptr<CompressedFile>
+{
+  std::ifstream in(fname + PAGE_MAP_SUFFIX, std::ios::binary);
+  PageMapHeader header{};
+  in.read(reinterpret_cast<char *>(&header), sizeof(PageMapHeader));
+  if (!in || header.magic != PAGE_MAP_MAGIC) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("bad page map {}", fname + PAGE_MAP_SUFFIX));
+  }
+  auto file         = std::make_unique<CompressedFile>();
+  file->compression = static_cast<PageCompression>(header.compression);
+  if (!PageCompressor::IsAvailable(file->compression)) {
+    NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("page compression {}", PageCompressionToString(file->compression)));
+  }
+  file->slots.resize(header.page_num);
+  in.read(reinterpret_cast<char *>(file->slots.data()),
+      static_cast<std::streamsize>(header.page_num * sizeof(PageSlot)));
+  if (!in) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("bad page map {}", fname + PAGE_MAP_SUFFIX));
+  }
+  file->map_fd = open((fname + PAGE_MAP_SUFFIX).c_str(), O_RDWR);
+  if (file->map_fd == -1) {
+    NJUDB_THROW(NJUDB_FILE_NOT_OPEN, fmt::format("{}, {}", fname + PAGE_MAP_SUFFIX, strerror(errno)));
+  }
+  // slots are never given back to the file system, the space between the slots in use is free
+  std::vector<PageSlot> used;
+  std::copy_if(file->slots.begin(), file->slots.end(), std::back_inserter(used), [](const PageSlot &slot) {
+    return slot.offset != 0;
+  });
+  std::sort(used.begin(), used.end(), [](const PageSlot &a, const PageSlot &b) { return a.offset < b.offset; });
+  for (const auto &slot : used) {
+    if (slot.offset > file->end) {
+      file->free_slots[static_cast<uint32_t>(slot.offset - file->end)].push_back(file->end);
+    }
+    file->end = std::max(file->end, slot.offset + slot.capacity);
+  }
+  return file;
+}
+
+void DiskManager::SavePageMap(const std::string &fname, const CompressedFile &file)
+{
+  std::ofstream out(fname + PAGE_MAP_SUFFIX, std::ios::binary | std::ios::trunc);
+  PageMapHeader header{PAGE_MAP_MAGIC, static_cast<uint32_t>(file.compression), file.slots.size()};
+  out.write(reinterpret_cast<const char *>(&header), sizeof(PageMapHeader));
+  out.write(reinterpret_cast<const char *>(file.slots.data()),
+      static_cast<std::streamsize>(file.slots.size() * sizeof(PageSlot)));
+  if (!out) {
+    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("page map {}", fname + PAGE_MAP_SUFFIX));
+  }
+}
+
+void DiskManager::SavePageSlot(const CompressedFile &file, page_id_t page_id, bool grown)
+{
+  auto offset = static_cast<off_t>(sizeof(PageMapHeader) + static_cast<size_t>(page_id) * sizeof(PageSlot));
+  bool ok     = WriteAt(file.map_fd, reinterpret_cast<const char *>(&file.slots[page_id]), sizeof(PageSlot), offset);
+  if (ok && grown) {
+    // the entry goes first so that the header never claims an entry that is not written, entries of the pages in
+    // between read as zeros, i.e. never written
+    uint64_t page_num = file.slots.size();
+    ok = WriteAt(file.map_fd, reinterpret_cast<const char *>(&page_num), sizeof(page_num),
+        static_cast<off_t>(offsetof(PageMapHeader, page_num)));
+  }
+  if (!ok) {
+    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("page map of page {}, {}", page_id, strerror(errno)));
+  }
+}
+
+DiskManager::CompressedFile::~CompressedFile()
+{
+  if (map_fd != -1) {
+    close(map_fd);
+  }
+}
+
+auto DiskManager::ReadAt(int fd, char *data, size_t size, off_t offset, bool direct) -> ssize_t
+{
+  size_t done = 0;
+  while (done < size) {
+    auto ret = pread(fd, data + done, size - done, offset + static_cast<off_t>(done));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      return -1;
+    }
+    if (ret == 0) {
+      break;
+    }
+    done += static_cast<size_t>(ret);
+    if (direct) {
+      // the rest lies beyond the end of the file, and could not be read from an unaligned offset anyway
+      break;
+    }
+  }
+  return static_cast<ssize_t>(done);
+}
+
+auto DiskManager::WriteAt(int fd, const char *data, size_t size, off_t offset) -> bool
+{
+  size_t done = 0;
+  while (done < size) {
+    auto ret = pwrite(fd, data + done, size - done, offset + static_cast<off_t>(done));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      // a zero-byte write makes no progress, report it as the disk being full
+      if (ret == 0) {
+        errno = ENOSPC;
+      }
+      return false;
+    }
+    done += static_cast<size_t>(ret);
+  }
+  return true;
+}
+
+auto DiskManager::TransferV(int fd, std::vector<iovec> &iov, off_t offset, bool write, bool direct) -> ssize_t
+{
+  size_t done  = 0;
+  size_t first = 0;
+  while (first < iov.size()) {
+    auto count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+    auto ret   = write ? pwritev(fd, &iov[first], count, offset + static_cast<off_t>(done))
+                       : preadv(fd, &iov[first], count, offset + static_cast<off_t>(done));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0 || (ret == 0 && write)) {
+      if (ret == 0) {
+        errno = ENOSPC;
+      }
+      return -1;
+    }
+    if (ret == 0) {
+      break;
+    }
+    done += static_cast<size_t>(ret);
+    // skip the iovecs transferred and trim a partially transferred one
+    auto left = static_cast<size_t>(ret);
+    while (first < iov.size() && left >= iov[first].iov_len) {
+      left -= iov[first].iov_len;
+      first++;
+    }
+    if (left > 0) {
+      if (direct && !write) {
+        // a short direct read only happens at the end of the file
+        break;
+      }
+      iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + left;
+      iov[first].iov_len -= left;
+    }
+  }
+  return static_cast<ssize_t>(done);
+}
+
+auto DiskManager::IsOpen(file_id_t fid) -> bool
+{
+  std::shared_lock lock(latch_);
+  return fid_name_map_.find(fid) != fid_name_map_.end();
+}
+
+auto DiskManager::GetPageFd(file_id_t fid) -> int
+{
+  std::shared_lock lock(latch_);
+  if (fid_name_map_.find(fid) == fid_name_map_.end()) {
+    return -1;
+  }
+  auto it = fid_direct_fd_map_.find(fid);
+  return it == fid_direct_fd_map_.end() ? fid : it->second;
+}
+
+auto DiskManager::Seek(file_id_t fid, off_t off, int type) -> off_t
+{
   NJUDB_ASSERT(type == SEEK_CUR || type == SEEK_SET || type == SEEK_END, "Invalid Type");
-  lseek(fid, off, type);
-  if(write(fid, data, size) < 0) {
-    NJUDB_THROW(NJUDB_FILE_WRITE_ERROR, fmt::format("fid: {}", fid));
+  off_t base = 0;
+  if (type == SEEK_END) {
+    base = static_cast<off_t>(GetFileSize(fid));
+  }
+  std::unique_lock lock(latch_);
+  auto it = fid_offset_map_.find(fid);
+  NJUDB_ASSERT(it != fid_offset_map_.end(), "File not Opened");
+  if (type == SEEK_CUR) {
+    base = it->second;
   }
+  it->second = base + off;
+  return it->second;
 }
 
 void DiskManager::WriteLog(const std::string &log_file, const std::string &log_string) {}
@@ -123,6 +689,7 @@ void DiskManager::ReadLog(const std::string &log_file, std::string &log_string)
 
 auto DiskManager::GetFileId(const std::string &fname) -> file_id_t
 {
+  std::shared_lock lock(latch_);
   auto it = name_fid_map_.find(fname);
   if (it != name_fid_map_.end()) {
     return it->second;
@@ -133,6 +700,7 @@ auto DiskManager::GetFileId(const std::string &fname) -> file_id_t
 
 auto DiskManager::GetFileName(file_id_t fid) -> std::string
 {
+  std::shared_lock lock(latch_);
   auto it = fid_name_map_.find(fid);
   if (it != fid_name_map_.end()) {
     return it->second;
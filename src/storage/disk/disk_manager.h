@@ -25,26 +25,46 @@
 #include <iostream>
 #include <fstream>
 #include <future>
+#include <map>
+#include <memory>
+#include <shared_mutex>
 #include <unordered_map>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+#include "file_mapping.h"
+#include "common/config.h"
 #include "common/types.h"
 
 namespace njudb {
 class DiskManager
 {
 public:
-  DiskManager() = default;
+  /**
+   * @param direct_io open files with O_DIRECT for page I/O, pages then bypass the OS page cache and are only cached by
+   * the buffer pool. ReadFile/WriteFile stay buffered
+   * @param extent_pages pages AllocatePages reserves at a time, 0 disables preallocation
+   */
+  explicit DiskManager(bool direct_io = false, size_t extent_pages = FILE_EXTENT_PAGES)
+      : direct_io_(direct_io), extent_pages_(extent_pages)
+  {}
 
   ~DiskManager() = default;
 
   /**
    * Create a file named file_name and close it immediately
    * @param fname
+   * @param compression codec of the pages of the file. A compressed file keeps its header page as is and stores every
+   * other page compressed in a slot of a multiple of COMPRESSED_SLOT_SIZE bytes behind it, where the page lies is
+   * recorded in a page map kept in the file fname + PAGE_MAP_SUFFIX. The entry of a page is written to the page map
+   * whenever it changes, before the space the page gave up can be taken by another page. Pages of a compressed file
+   * are read and written with the same calls, it is only not possible to map it and it does not use direct I/O
    */
-  static void CreateFile(const std::string &fname);
+  static void CreateFile(const std::string &fname, PageCompression compression = PAGE_COMPRESSION_NONE);
 
   /**
    * Destroy file and should check that the file should not be opened,
-   * if opened, should close and then destroy (unlink)
+   * if opened, should close and then destroy (unlink). The page map of a compressed file is destroyed as well
    * @param fname
    */
   static void DestroyFile(const std::string &fname);
@@ -62,12 +82,91 @@ public:
    */
   void CloseFile(file_id_t fid);
 
+  /**
+   * Write a page with positional I/O, may be called concurrently from many threads. In direct I/O mode data must be
+   * PAGE_SIZE aligned, as the data of a Page is
+   */
   void WritePage(file_id_t fid, page_id_t page_id, const char *data);
 
+  /**
+   * Read a page with positional I/O, may be called concurrently from many threads. The part of the page that lies
+   * beyond the end of the file is filled with zeros. In direct I/O mode data must be PAGE_SIZE aligned
+   */
   void ReadPage(file_id_t fid, page_id_t page_id, char *data);
 
+  /**
+   * Write data.size() contiguous pages starting at page_id with as few pwritev calls as possible
+   */
+  void WritePages(file_id_t fid, page_id_t page_id, const std::vector<const char *> &data);
+
+  /**
+   * Read data.size() contiguous pages starting at page_id with as few preadv calls as possible, the part beyond the
+   * end of the file is filled with zeros
+   */
+  void ReadPages(file_id_t fid, page_id_t page_id, const std::vector<char *> &data);
+
+  /**
+   * Read from the file cursor of fid after moving it by offset relative to type (SEEK_SET, SEEK_CUR, SEEK_END),
+   * bytes beyond the end of the file read as zeros. The cursor is kept by the disk manager instead of the fd so that
+   * it does not interfere with page I/O
+   */
   void ReadFile(file_id_t fid, char *data, size_t size, size_t offset, int type);
 
+  /**
+   * @return the size of the file in bytes, pages that are only cached in the buffer pool are not counted. For a
+   * compressed file the size its pages would have uncompressed
+   */
+  auto GetFileSize(file_id_t fid) -> size_t;
+
+  /**
+   * Make sure that disk space is reserved for the first page_num pages of the file, called when a table or an index
+   * grows. The reservation is grown with fallocate by whole extents and at least a quarter of its size, so that
+   * appending pages does not allocate blocks one page at a time. The file size is left unchanged, pages beyond it
+   * still read as zeros. The extent is claimed under the latch and fallocate runs after it is released, so growing
+   * one file does not stall the I/O of the others
+   */
+  void AllocatePages(file_id_t fid, size_t page_num);
+
+  /**
+   * @return number of pages reserved by AllocatePages, at least the pages the file had when it was opened
+   */
+  auto GetAllocatedPages(file_id_t fid) -> size_t;
+
+  /**
+   * Map the whole file read-only, see FileMapping
+   */
+  auto MapFile(file_id_t fid) -> std::unique_ptr<FileMapping>;
+
+  /**
+   * @return the fd page I/O of fid goes to, the O_DIRECT fd in direct I/O mode, -1 if the file is not open
+   */
+  auto GetPageFd(file_id_t fid) -> int;
+
+  [[nodiscard]] auto IsDirectIo() const -> bool { return direct_io_; }
+
+  /**
+   * @return the codec of the pages of fid, PAGE_COMPRESSION_NONE if the file is not compressed or not open
+   */
+  auto GetPageCompression(file_id_t fid) -> PageCompression;
+
+  /**
+   * Make the pages of fid carry a CRC32C in their header, see ComputePageChecksum. Pages written by WritePage and
+   * WritePages are stamped, and if verify is set the pages read by ReadPage and ReadPages are checked, a mismatch
+   * throws NJUDB_PAGE_CORRUPTED. The file header page is left alone since it is written by WriteFile. Only for files
+   * whose pages start with the page header, i.e. tables and B+ tree indexes
+   */
+  void SetPageChecksum(file_id_t fid, bool verify);
+
+  /**
+   * @return whether the pages of fid are stamped with a checksum when written
+   */
+  auto HasPageChecksum(file_id_t fid) -> bool;
+
+  /**
+   * @return whether the pages of fid are verified when read
+   */
+  auto IsPageChecksumVerified(file_id_t fid) -> bool;
+
   /**
    *
    * @param fid
@@ -88,8 +187,102 @@ public:
   static auto FileExists(const std::string &fname) -> bool;
 
 private:
+  /**
+   * pread until size bytes are read or the end of the file is reached, retrying on EINTR
+   * @param direct fd is opened with O_DIRECT, which only reads less than asked for at the end of the file
+   * @return number of bytes read, -1 on error with errno set
+   */
+  static auto ReadAt(int fd, char *data, size_t size, off_t offset, bool direct = false) -> ssize_t;
+
+  /**
+   * pwrite until all size bytes are written, retrying on EINTR
+   * @return false on error with errno set
+   */
+  static auto WriteAt(int fd, const char *data, size_t size, off_t offset) -> bool;
+
+  /**
+   * preadv or pwritev the iovecs, at most IOV_MAX at a time, until they are transferred or a read reaches the end of
+   * the file. The iovecs are consumed
+   * @return number of bytes transferred, -1 on error with errno set
+   */
+  static auto TransferV(int fd, std::vector<iovec> &iov, off_t offset, bool write, bool direct) -> ssize_t;
+
+  /**
+   * Copy num pages into a page aligned buffer of the calling thread and stamp their checksums there, so that a page
+   * changed in the buffer pool while it is written does not reach the disk with a checksum of another content
+   * @return the buffer, valid until the next call from the same thread
+   */
+  static auto StampPages(page_id_t page_id, const char *const *data, size_t num) -> char *;
+
+  /**
+   * Throw NJUDB_PAGE_CORRUPTED if a page read from fid does not match its checksum
+   */
+  void VerifyPages(file_id_t fid, page_id_t page_id, char *const *data, size_t num);
+
+  // where a page of a compressed file is stored, offset 0 if the page has never been written
+  struct PageSlot
+  {
+    uint64_t offset;
+    uint32_t size;      // compressed size, PAGE_SIZE if the page did not compress and is stored as is
+    uint32_t capacity;  // size rounded up to COMPRESSED_SLOT_SIZE
+  };
+
+  struct CompressedFile
+  {
+    ~CompressedFile();
+
+    std::shared_mutex                         latch;  // taken exclusively to move pages, shared to read them
+    PageCompression                           compression{PAGE_COMPRESSION_NONE};
+    std::vector<PageSlot>                     slots;       // indexed by page id
+    std::map<uint32_t, std::vector<uint64_t>> free_slots;  // offsets of unused slots by capacity
+    uint64_t                                  end{PAGE_SIZE};
+    int                                       map_fd{-1};  // the page map file, entries are written through
+  };
+
+  /**
+   * @return the page map of fid, nullptr if the file is not compressed
+   */
+  auto GetCompressedFile(file_id_t fid) -> CompressedFile *;
+
+  /**
+   * Compress the page and write it to its slot, a page that no longer fits is moved to a free slot or to the end.
+   * The page map entry is saved after the page is written and before the space given up is reused, so that after a
+   * crash the page map never points a page at the bytes of another one
+   */
+  static void WriteCompressedPage(file_id_t fid, CompressedFile &file, page_id_t page_id, const char *data);
+
+  static void ReadCompressedPage(file_id_t fid, CompressedFile &file, page_id_t page_id, char *data);
+
+  /**
+   * Read the page map of fname and keep it open, the unused slots are the gaps between the slots in use
+   */
+  static auto LoadPageMap(const std::string &fname) -> std::unique_ptr<CompressedFile>;
+
+  static void SavePageMap(const std::string &fname, const CompressedFile &file);
+
+  /**
+   * Write the entry of page_id to the page map file, and the number of pages if the entry is a new one
+   */
+  static void SavePageSlot(const CompressedFile &file, page_id_t page_id, bool grown);
+
+  auto IsOpen(file_id_t fid) -> bool;
+
+  /**
+   * Move the cursor of fid and return its new position
+   */
+  auto Seek(file_id_t fid, off_t off, int type) -> off_t;
+
+  // protects the maps below, page I/O only takes it shared to check that the file is open
+  std::shared_mutex                          latch_;
   std::unordered_map<std::string, file_id_t> name_fid_map_;
   std::unordered_map<file_id_t, std::string> fid_name_map_;
+  std::unordered_map<file_id_t, off_t>       fid_offset_map_;
+  std::unordered_map<file_id_t, int>         fid_direct_fd_map_;
+  std::unordered_map<file_id_t, size_t>      fid_allocated_map_;  // pages with disk space reserved
+  std::unordered_map<file_id_t, bool>        fid_checksum_map_;   // files stamping checksums, true if verified
+  std::unordered_map<file_id_t, std::unique_ptr<CompressedFile>> fid_compressed_map_;
+  bool                                       direct_io_{false};
+  size_t                                     extent_pages_{FILE_EXTENT_PAGES};
 };
 
 }  // namespace njudb
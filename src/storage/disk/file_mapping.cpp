@@ -0,0 +1,69 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#include "file_mapping.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include "../../../common/error.h"
+
+namespace njudb {
+
+FileMapping::FileMapping(int fd, size_t size) : size_(size)
+{
+  if (size_ == 0) {
+    return;
+  }
+  void *addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    NJUDB_THROW(NJUDB_FILE_READ_ERROR, fmt::format("fd: {}, mmap: {}", fd, strerror(errno)));
+  }
+  data_ = static_cast<char *>(addr);
+}
+
+FileMapping::~FileMapping()
+{
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+auto FileMapping::GetPage(page_id_t page_id) const -> char *
+{
+  NJUDB_ASSERT(page_id >= 0 && static_cast<size_t>(page_id) < GetPageNum(), fmt::format("page_id: {}", page_id));
+  return data_ + static_cast<size_t>(page_id) * PAGE_SIZE;
+}
+
+void FileMapping::Advise(int advice)
+{
+  if (data_ != nullptr) {
+    madvise(data_, size_, advice);
+  }
+}
+
+void FileMapping::WillNeed(page_id_t page_id, size_t count)
+{
+  if (page_id < 0 || static_cast<size_t>(page_id) >= GetPageNum()) {
+    return;
+  }
+  count = std::min(count, GetPageNum() - static_cast<size_t>(page_id));
+  madvise(GetPage(page_id), count * PAGE_SIZE, MADV_WILLNEED);
+}
+
+}  // namespace njudb
@@ -0,0 +1,66 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_FILE_MAPPING_H
+#define NJUDB_FILE_MAPPING_H
+
+#include <cstddef>
+#include "common/config.h"
+#include "common/types.h"
+#include "../../../common/micro.h"
+
+namespace njudb {
+
+/**
+ * A read-only memory mapping of a whole file, its pages are read straight from the OS page cache instead of being
+ * copied into the buffer pool. The file must not be written or truncated while it is mapped, accessing a page beyond
+ * the end of the file raises SIGBUS.
+ */
+class FileMapping
+{
+public:
+  /**
+   * Map the first size bytes of fd read-only, throws NJUDB_FILE_READ_ERROR if the mapping fails
+   */
+  FileMapping(int fd, size_t size);
+
+  ~FileMapping();
+
+  DISABLE_COPY_MOVE_AND_ASSIGN(FileMapping)
+
+  [[nodiscard]] auto GetPage(page_id_t page_id) const -> char *;
+
+  [[nodiscard]] auto GetPageNum() const -> size_t { return size_ / PAGE_SIZE; }
+
+  /**
+   * madvise the whole mapping, e.g. MADV_RANDOM for index probes so that a fault does not read around the page
+   */
+  void Advise(int advice);
+
+  /**
+   * Ask the kernel to read the pages in the background, used by sequential scans, pages beyond the file are ignored
+   */
+  void WillNeed(page_id_t page_id, size_t count);
+
+private:
+  char  *data_{nullptr};
+  size_t size_{0};
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_FILE_MAPPING_H
@@ -0,0 +1,125 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#include "page_compressor.h"
+
+#include <memory>
+
+#ifdef NJUDB_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef NJUDB_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef NJUDB_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include "../../../common/error.h"
+
+namespace njudb {
+
+auto PageCompressor::IsAvailable(PageCompression compression) -> bool
+{
+  switch (compression) {
+#ifdef NJUDB_HAVE_LZ4
+    case PAGE_COMPRESSION_LZ4: return true;
+#endif
+#ifdef NJUDB_HAVE_ZSTD
+    case PAGE_COMPRESSION_ZSTD: return true;
+#endif
+#ifdef NJUDB_HAVE_ZLIB
+    case PAGE_COMPRESSION_ZLIB: return true;
+#endif
+    default: return false;
+  }
+}
+
+auto PageCompressor::MaxCompressedSize(PageCompression compression) -> size_t
+{
+  switch (compression) {
+#ifdef NJUDB_HAVE_LZ4
+    case PAGE_COMPRESSION_LZ4: return LZ4_COMPRESSBOUND(PAGE_SIZE);
+#endif
+#ifdef NJUDB_HAVE_ZSTD
+    case PAGE_COMPRESSION_ZSTD: return ZSTD_COMPRESSBOUND(PAGE_SIZE);
+#endif
+#ifdef NJUDB_HAVE_ZLIB
+    case PAGE_COMPRESSION_ZLIB: return compressBound(PAGE_SIZE);
+#endif
+    default: NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("page compression {}", PageCompressionToString(compression)));
+  }
+}
+
+auto PageCompressor::Compress(PageCompression compression, const char *page, char *out, size_t out_size) -> size_t
+{
+  size_t size = 0;
+  switch (compression) {
+#ifdef NJUDB_HAVE_LZ4
+    case PAGE_COMPRESSION_LZ4: {
+      auto ret = LZ4_compress_default(page, out, PAGE_SIZE, static_cast<int>(out_size));
+      size     = ret > 0 ? static_cast<size_t>(ret) : 0;
+      break;
+    }
+#endif
+#ifdef NJUDB_HAVE_ZSTD
+    case PAGE_COMPRESSION_ZSTD: {
+      // a context per thread, creating one for every page costs more than compressing it
+      thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> ctx(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+      auto ret = ZSTD_compressCCtx(ctx.get(), out, out_size, page, PAGE_SIZE, PAGE_COMPRESSION_LEVEL);
+      size     = ZSTD_isError(ret) ? 0 : ret;
+      break;
+    }
+#endif
+#ifdef NJUDB_HAVE_ZLIB
+    case PAGE_COMPRESSION_ZLIB: {
+      uLongf len = out_size;
+      auto   ret = compress2(reinterpret_cast<Bytef *>(out), &len, reinterpret_cast<const Bytef *>(page), PAGE_SIZE,
+          PAGE_COMPRESSION_LEVEL);
+      size       = ret == Z_OK ? len : 0;
+      break;
+    }
+#endif
+    default: NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("page compression {}", PageCompressionToString(compression)));
+  }
+  return size < PAGE_SIZE ? size : 0;
+}
+
+auto PageCompressor::Decompress(PageCompression compression, const char *data, size_t size, char *page) -> bool
+{
+  switch (compression) {
+#ifdef NJUDB_HAVE_LZ4
+    case PAGE_COMPRESSION_LZ4:
+      return LZ4_decompress_safe(data, page, static_cast<int>(size), PAGE_SIZE) == static_cast<int>(PAGE_SIZE);
+#endif
+#ifdef NJUDB_HAVE_ZSTD
+    case PAGE_COMPRESSION_ZSTD: {
+      thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+      return ZSTD_decompressDCtx(ctx.get(), page, PAGE_SIZE, data, size) == PAGE_SIZE;
+    }
+#endif
+#ifdef NJUDB_HAVE_ZLIB
+    case PAGE_COMPRESSION_ZLIB: {
+      uLongf len = PAGE_SIZE;
+      auto   ret = uncompress(reinterpret_cast<Bytef *>(page), &len, reinterpret_cast<const Bytef *>(data), size);
+      return ret == Z_OK && len == PAGE_SIZE;
+    }
+#endif
+    default: NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("page compression {}", PageCompressionToString(compression)));
+  }
+}
+
+}  // namespace njudb
@@ -0,0 +1,56 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_PAGE_COMPRESSOR_H
+#define NJUDB_PAGE_COMPRESSOR_H
+
+#include <cstddef>
+#include "common/config.h"
+#include "common/types.h"
+
+namespace njudb {
+
+/**
+ * Compresses single pages with one of the codecs of PageCompression. A codec is available if its library was found
+ * when the storage was built, LZ4 and Zstd are the fast ones, zlib is the fallback found almost everywhere.
+ */
+class PageCompressor
+{
+public:
+  static auto IsAvailable(PageCompression compression) -> bool;
+
+  /**
+   * @return bytes of the output buffer Compress needs for a page
+   */
+  static auto MaxCompressedSize(PageCompression compression) -> size_t;
+
+  /**
+   * Compress PAGE_SIZE bytes of page into out, which holds MaxCompressedSize bytes
+   * @return the compressed size, 0 if the page does not compress
+   */
+  static auto Compress(PageCompression compression, const char *page, char *out, size_t out_size) -> size_t;
+
+  /**
+   * Decompress size bytes of data into the PAGE_SIZE bytes of page
+   * @return false if the data is not a compressed page
+   */
+  static auto Decompress(PageCompression compression, const char *data, size_t size, char *page) -> bool;
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_PAGE_COMPRESSOR_H
@@ -73,6 +73,9 @@ public:
   virtual auto IsEmpty() -> bool = 0;
   virtual auto Size() -> size_t  = 0;
 
+  // write the state kept in memory back to the pages of the index, called before the pages are flushed on close
+  virtual void Flush() {}
+
   // Index statistics and metadata
   virtual auto GetHeight() -> int = 0;
   virtual auto GetKeySchema() -> const RecordSchema * { return key_schema_; }
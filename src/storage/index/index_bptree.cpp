@@ -98,13 +98,19 @@ auto BPTreePage::GetParentPageId() const -> page_id_t
 }
 
 void BPTreePage::SetParentPageId(page_id_t parent_page_id) { parent_page_id_ = parent_page_id; }
+
+auto BPTreePage::GetMinSize() const -> int
+{
+  return IsRoot() ? (IsLeaf() ? 1 : 2) : (max_size_ + 1) / 2;
+}
+
+// whether the node absorbs one more insertion without splitting, or one more deletion without underflowing
 auto BPTreePage::IsSafe(bool is_insert) const -> bool
 {
   if (is_insert) {
     return size_ < max_size_;
   }
-  int min_size = IsRoot() ? (IsLeaf() ? 1 : 2) : (max_size_ + 1) / 2;
-  return size_ > min_size;
+  return size_ > GetMinSize();
 }
 
 // BPTreeLeafPage implementation
@@ -321,12 +327,31 @@ auto BPTreeInternalPage::InsertNodeAfter(page_id_t old_value, const Record &new_
   return size_;
 }
 
-void BPTreeInternalPage::MoveHalfTo(BPTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager)
+void BPTreeInternalPage::InsertAndSplit(page_id_t old_value, const Record &new_key, page_id_t new_value,
+    BPTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager)
 {
-  int move_size = size_ / 2;
-  int start_idx = size_ - move_size;
-  recipient->CopyNFrom(KeyAt(start_idx), GetChildrenArray() + start_idx, move_size, buffer_pool_manager);
-  size_ -= move_size;
+  // the page has no room for max_size_ + 1 entries, lay them out aside and keep the first half
+  int                    total = GetSize() + 1;
+  std::vector<char>      keys(total * key_size_);
+  std::vector<page_id_t> children(total);
+  int                    pos = 0;
+  for (int i = 0; i < GetSize(); i++) {
+    std::memcpy(keys.data() + pos * key_size_, KeyAt(i), key_size_);
+    children[pos++] = ValueAt(i);
+    if (ValueAt(i) == old_value) {
+      std::memcpy(keys.data() + pos * key_size_, new_key.GetData(), key_size_);
+      children[pos++] = new_value;
+    }
+  }
+  NJUDB_ASSERT(pos == total, "the split child is not in the node");
+
+  int keep = total - total / 2;
+  for (int i = 0; i < keep; i++) {
+    SetKeyAt(i, keys.data() + i * key_size_);
+    SetValueAt(i, children[i]);
+  }
+  size_ = keep;
+  recipient->CopyNFrom(keys.data() + keep * key_size_, children.data() + keep, total - keep, buffer_pool_manager);
 }
 
 void BPTreeInternalPage::CopyNFrom(
@@ -377,6 +402,9 @@ void BPTreeIndex::InitializeIndex()
 
   // Check if already initialized
   if (header->page_num_ != 0) {
+    first_free_page_id_ = header->first_free_page_id_;
+    page_num_           = header->page_num_;
+    num_entries_        = header->num_entries_;
     return;
   }
 
@@ -390,7 +418,11 @@ void BPTreeIndex::InitializeIndex()
   header->first_free_page_id_ = INVALID_PAGE_ID;
   header->tree_height_        = 0;
   header->page_num_           = 1;  // Header page counts
+  header->num_entries_        = 0;
   header->key_size_           = key_schema_->GetRecordLength();
+  first_free_page_id_         = INVALID_PAGE_ID;
+  page_num_                   = 1;
+  num_entries_                = 0;
   header->value_size_         = sizeof(RID);
 
   // Note: TEST_BPTREE mode is for testing your B+tree implementation.
@@ -419,41 +451,96 @@ void BPTreeIndex::InitializeIndex()
 
 auto BPTreeIndex::NewPage() -> page_id_t
 {
-  auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
-  page_id_t new_pid;
+  std::lock_guard lock(page_alloc_latch_);
+  page_id_t       new_pid;
 
-  if (header->first_free_page_id_ != INVALID_PAGE_ID) {
-    new_pid = header->first_free_page_id_;
-    auto free_page_guard = buffer_pool_manager_->FetchPageWrite(index_id_, new_pid);
-    header->first_free_page_id_ = free_page_guard.GetPage()->GetNextFreePageId();
+  if (first_free_page_id_ != INVALID_PAGE_ID) {
+    new_pid = first_free_page_id_;
+    // a free page is reachable by no one, latching it never waits
+    auto free_page_guard = buffer_pool_manager_->FetchPageRead(index_id_, new_pid);
+    first_free_page_id_  = free_page_guard.GetPage()->GetNextFreePageId();
   } else {
-    new_pid = header->page_num_++;
+    new_pid = static_cast<page_id_t>(page_num_++);
   }
+  disk_manager_->AllocatePages(index_id_, page_num_);
   return new_pid;
 }
 
-void BPTreeIndex::DeletePage(page_id_t page_id)
+void BPTreeIndex::DeletePage(WritePageGuard &page_guard)
 {
-  auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
+  std::lock_guard lock(page_alloc_latch_);
+  page_guard.GetMutableData();
+  page_guard.GetPage()->SetNextFreePageId(first_free_page_id_);
+  first_free_page_id_ = page_guard.GetPageId();
+  page_guard.Drop();
+}
 
-  auto page_guard = buffer_pool_manager_->FetchPageWrite(index_id_, page_id);
-  page_guard.GetPage()->SetNextFreePageId(header->first_free_page_id_);
-  header->first_free_page_id_ = page_id;
+auto BPTreeIndex::FetchNodeWrite(page_id_t page_id) -> WritePageGuard
+{
+  auto guard = buffer_pool_manager_->FetchPageWrite(index_id_, page_id);
+  if (guard.GetPage() == nullptr) {
+    NJUDB_THROW(NJUDB_NO_FREE_FRAME, fmt::format("Cannot fetch page {}", page_id));
+  }
+  guard.UnsetDirty();
+  return guard;
 }
 
-auto BPTreeIndex::FindLeafPage(const Record &key, bool leftMost) -> page_id_t
+auto BPTreeIndex::FindLeafOptimistic(
+    const std::function<page_id_t(const BPTreeInternalPage *)> &child_of, PageVersion *parent) -> page_id_t
 {
-  auto header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
-  auto header       = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
+  alignas(std::max_align_t) char data[PAGE_SIZE];
+  PageVersion                    version;
+  if (!buffer_pool_manager_->ReadPageOptimistic(index_id_, FILE_HEADER_PAGE_ID, data, &version)) {
+    return INVALID_PAGE_ID;
+  }
+  auto      header   = reinterpret_cast<const BPTreeIndexHeader *>(data);
   page_id_t curr_pid = header->root_page_id_;
+  size_t    height   = header->tree_height_;
+  if (curr_pid == INVALID_PAGE_ID) {
+    return INVALID_PAGE_ID;
+  }
+  // the leaves are the height-th level, only the levels above them are copied
+  for (size_t level = 1; level < height; level++) {
+    PageVersion child_version;
+    // the copy of the child counts only if its parent has not changed since it was copied
+    if (!buffer_pool_manager_->ReadPageOptimistic(index_id_, curr_pid, data, &child_version) ||
+        !buffer_pool_manager_->ValidatePage(version)) {
+      return INVALID_PAGE_ID;
+    }
+    auto node = reinterpret_cast<const BPTreePage *>(PageContentPtr(data));
+    if (node->IsLeaf()) {
+      return INVALID_PAGE_ID;
+    }
+    curr_pid = child_of(reinterpret_cast<const BPTreeInternalPage *>(node));
+    version  = child_version;
+  }
+  *parent = version;
+  return curr_pid;
+}
 
-  if (curr_pid == INVALID_PAGE_ID) return INVALID_PAGE_ID;
+auto BPTreeIndex::FindLeafPage(const Record &key, bool leftMost) -> std::optional<ReadPageGuard>
+{
+  PageVersion parent;
+  page_id_t   leaf_pid = FindLeafOptimistic(
+      [&](const BPTreeInternalPage *node) { return leftMost ? node->ValueAt(0) : node->Lookup(key, key_schema_); },
+      &parent);
+  if (leaf_pid != INVALID_PAGE_ID) {
+    auto leaf_guard = buffer_pool_manager_->FetchPageRead(index_id_, leaf_pid);
+    if (leaf_guard.GetPage() != nullptr && buffer_pool_manager_->ValidatePage(parent)) {
+      return leaf_guard;
+    }
+  }
+
+  auto      guard    = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
+  page_id_t curr_pid = reinterpret_cast<const BPTreeIndexHeader *>(guard.GetData())->root_page_id_;
+
+  if (curr_pid == INVALID_PAGE_ID) return std::nullopt;
 
   while (true) {
-    auto page_guard = buffer_pool_manager_->FetchPageRead(index_id_, curr_pid);
-    auto node       = reinterpret_cast<const BPTreePage *>(PageContentPtr(page_guard.GetData()));
+    // latch the child before letting the parent go
+    auto child_guard = buffer_pool_manager_->FetchPageRead(index_id_, curr_pid);
+    guard            = std::move(child_guard);
+    auto node        = reinterpret_cast<const BPTreePage *>(PageContentPtr(guard.GetData()));
     if (node->IsLeaf()) break;
 
     auto internal_node = reinterpret_cast<const BPTreeInternalPage *>(node);
@@ -463,20 +550,33 @@ auto BPTreeIndex::FindLeafPage(const Record &key, bool leftMost) -> page_id_t
       curr_pid = internal_node->Lookup(key, key_schema_);
     }
   }
-  return curr_pid;
+  return guard;
 }
 
-auto BPTreeIndex::FindLeafPageForRange(const Record &key, bool isLowerBound) -> page_id_t
+auto BPTreeIndex::FindLeafPageForRange(const Record &key, bool isLowerBound) -> std::optional<ReadPageGuard>
 {
-  auto header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
-  auto header       = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
-  page_id_t curr_pid = header->root_page_id_;
+  PageVersion parent;
+  page_id_t   leaf_pid = FindLeafOptimistic(
+      [&](const BPTreeInternalPage *node) {
+        return isLowerBound ? node->LookupForLowerBound(key, key_schema_) : node->LookupForUpperBound(key, key_schema_);
+      },
+      &parent);
+  if (leaf_pid != INVALID_PAGE_ID) {
+    auto leaf_guard = buffer_pool_manager_->FetchPageRead(index_id_, leaf_pid);
+    if (leaf_guard.GetPage() != nullptr && buffer_pool_manager_->ValidatePage(parent)) {
+      return leaf_guard;
+    }
+  }
+
+  auto      guard    = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
+  page_id_t curr_pid = reinterpret_cast<const BPTreeIndexHeader *>(guard.GetData())->root_page_id_;
 
-  if (curr_pid == INVALID_PAGE_ID) return INVALID_PAGE_ID;
+  if (curr_pid == INVALID_PAGE_ID) return std::nullopt;
 
   while (true) {
-    auto page_guard = buffer_pool_manager_->FetchPageRead(index_id_, curr_pid);
-    auto node       = reinterpret_cast<const BPTreePage *>(PageContentPtr(page_guard.GetData()));
+    auto child_guard = buffer_pool_manager_->FetchPageRead(index_id_, curr_pid);
+    guard            = std::move(child_guard);
+    auto node        = reinterpret_cast<const BPTreePage *>(PageContentPtr(guard.GetData()));
     if (node->IsLeaf()) break;
 
     auto internal_node = reinterpret_cast<const BPTreeInternalPage *>(node);
@@ -486,40 +586,112 @@ auto BPTreeIndex::FindLeafPageForRange(const Record &key, bool isLowerBound) ->
       curr_pid = internal_node->LookupForUpperBound(key, key_schema_);
     }
   }
-  return curr_pid;
+  return guard;
 }
 
-void BPTreeIndex::StartNewTree(const Record &key, const RID &value)
+auto BPTreeIndex::FindLeafPageForUpdate(const Record &key) -> std::optional<WritePageGuard>
 {
-  page_id_t new_pid      = NewPage();
-  auto      header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto      header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
-  header->root_page_id_  = new_pid;
-  header->tree_height_   = 1;
-  header->num_entries_   = 1;
+  PageVersion parent;
+  page_id_t   leaf_pid =
+      FindLeafOptimistic([&](const BPTreeInternalPage *node) { return node->Lookup(key, key_schema_); }, &parent);
+  if (leaf_pid != INVALID_PAGE_ID) {
+    // latched exclusively at once, with its parent unchanged nobody has split or merged the leaf
+    auto leaf_guard = buffer_pool_manager_->FetchPageWrite(index_id_, leaf_pid);
+    if (leaf_guard.GetPage() != nullptr && buffer_pool_manager_->ValidatePage(parent)) {
+      leaf_guard.UnsetDirty();
+      return leaf_guard;
+    }
+  }
+
+  auto      parent_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
+  page_id_t curr_pid     = reinterpret_cast<const BPTreeIndexHeader *>(parent_guard.GetData())->root_page_id_;
+
+  if (curr_pid == INVALID_PAGE_ID) return std::nullopt;
 
-  auto page_guard = buffer_pool_manager_->FetchPageWrite(index_id_, new_pid);
+  auto guard = buffer_pool_manager_->FetchPageRead(index_id_, curr_pid);
+  while (true) {
+    auto node = reinterpret_cast<const BPTreePage *>(PageContentPtr(guard.GetData()));
+    if (node->IsLeaf()) {
+      // upgraded while the parent is latched, nobody can split or merge the leaf in between even if the upgrade is
+      // not atomic, changes made in place by other writers meanwhile are fine as the leaf is checked afterwards
+      auto leaf_guard = guard.UpgradeToWrite();
+      leaf_guard.UnsetDirty();
+      return leaf_guard;
+    }
+    auto child_guard = buffer_pool_manager_->FetchPageRead(
+        index_id_, reinterpret_cast<const BPTreeInternalPage *>(node)->Lookup(key, key_schema_));
+    parent_guard = std::move(guard);
+    guard        = std::move(child_guard);
+  }
+}
+
+void BPTreeIndex::FindLeafPageWrite(const Record &key, BPTreeContext &ctx, bool is_insert)
+{
+  auto      header   = reinterpret_cast<const BPTreeIndexHeader *>(ctx.header_guard_->GetData());
+  page_id_t curr_pid = header->root_page_id_;
+
+  while (true) {
+    auto guard = FetchNodeWrite(curr_pid);
+    auto node  = reinterpret_cast<const BPTreePage *>(PageContentPtr(guard.GetData()));
+    if (node->IsSafe(is_insert)) {
+      // the node absorbs the change, none of its ancestors will be modified
+      ctx.header_guard_.reset();
+      ctx.write_set_.clear();
+    }
+    ctx.write_set_.push_back(std::move(guard));
+    if (node->IsLeaf()) return;
+
+    curr_pid = reinterpret_cast<const BPTreeInternalPage *>(node)->Lookup(key, key_schema_);
+  }
+}
+
+void BPTreeIndex::UpdateNumEntries(int delta)
+{
+  // like the page count, the entry count is page_alloc_latch_'s, latching the header would serialize every writer
+  // and block the readers entering the tree
+  std::lock_guard lock(page_alloc_latch_);
+  num_entries_ += delta;
+}
+
+void BPTreeIndex::StartNewTree(BPTreeContext &ctx, const Record &key, const RID &value)
+{
+  page_id_t new_pid     = NewPage();
+  auto      header      = reinterpret_cast<BPTreeIndexHeader *>(ctx.header_guard_->GetMutableData());
+  header->root_page_id_ = new_pid;
+  header->tree_height_  = 1;
+
+  auto page_guard = FetchNodeWrite(new_pid);
   auto leaf_node  = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(page_guard.GetMutableData()));
   leaf_node->Init(index_id_, new_pid, INVALID_PAGE_ID, header->key_size_, header->leaf_max_size_);
   leaf_node->Insert(key, value, key_schema_);
 }
 
-auto BPTreeIndex::InsertIntoLeaf(const Record &key, const RID &value) -> bool
+auto BPTreeIndex::InsertOptimistic(const Record &key, const RID &value) -> bool
 {
-  page_id_t leaf_pid   = FindLeafPage(key);
-  auto      page_guard = buffer_pool_manager_->FetchPageWrite(index_id_, leaf_pid);
-  auto      leaf_node  = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(page_guard.GetMutableData()));
+  auto leaf_guard = FindLeafPageForUpdate(key);
+  if (!leaf_guard.has_value()) return false;
+
+  auto leaf_node = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(leaf_guard->GetData()));
+  if (!leaf_node->IsSafe(true)) return false;
+
+  leaf_guard->GetMutableData();
+  leaf_node->Insert(key, value, key_schema_);
+  return true;
+}
+
+void BPTreeIndex::InsertIntoLeaf(BPTreeContext &ctx, const Record &key, const RID &value)
+{
+  auto leaf_guard = std::move(ctx.write_set_.back());
+  ctx.write_set_.pop_back();
+  auto leaf_node = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(leaf_guard.GetMutableData()));
 
   if (leaf_node->GetSize() < leaf_node->GetMaxSize()) {
     leaf_node->Insert(key, value, key_schema_);
-    auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-    auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
-    header->num_entries_++;
-    return true;
+    return;
   }
 
   page_id_t new_pid        = NewPage();
-  auto      new_page_guard = buffer_pool_manager_->FetchPageWrite(index_id_, new_pid);
+  auto      new_page_guard = FetchNodeWrite(new_pid);
   auto      new_leaf_node  = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(new_page_guard.GetMutableData()));
   new_leaf_node->Init(
       index_id_, new_pid, leaf_node->GetParentPageId(), leaf_node->key_size_, leaf_node->GetMaxSize());
@@ -536,181 +708,192 @@ auto BPTreeIndex::InsertIntoLeaf(const Record &key, const RID &value) -> bool
   new_leaf_node->SetNextPageId(leaf_node->GetNextPageId());
   leaf_node->SetNextPageId(new_pid);
 
-  page_guard.Drop();
-  new_page_guard.Drop();
-
-  InsertIntoParent(leaf_pid, middle_key, new_pid);
-
-  auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
-  header->num_entries_++;
-  return true;
+  InsertIntoParent(ctx, leaf_guard, middle_key, new_page_guard);
 }
 
-void BPTreeIndex::InsertIntoParent(page_id_t old_node_id, const Record &key, page_id_t new_node_id)
+void BPTreeIndex::InsertIntoParent(
+    BPTreeContext &ctx, WritePageGuard &old_guard, const Record &key, WritePageGuard &new_guard)
 {
-  page_id_t parent_id;
-  bool      is_root;
-  {
-    auto old_node_guard = buffer_pool_manager_->FetchPageRead(index_id_, old_node_id);
-    auto old_node       = reinterpret_cast<const BPTreePage *>(PageContentPtr(old_node_guard.GetData()));
-    is_root             = old_node->IsRoot();
-    parent_id           = old_node->GetParentPageId();
-  }
-
-  if (is_root) {
-    InsertIntoNewRoot(old_node_id, key, new_node_id);
+  if (ctx.write_set_.empty()) {
+    InsertIntoNewRoot(ctx, old_guard, key, new_guard);
     return;
   }
 
-  auto parent_guard = buffer_pool_manager_->FetchPageWrite(index_id_, parent_id);
-  auto parent_node  = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(parent_guard.GetMutableData()));
+  // the two nodes are linked, writers reach them only through the parent which is latched, and the parent pointers
+  // of the children the parent split moves are updated under their own latches
+  page_id_t old_node_id = old_guard.GetPageId();
+  page_id_t new_node_id = new_guard.GetPageId();
+  old_guard.Drop();
+  new_guard.Drop();
+
+  auto parent_guard = std::move(ctx.write_set_.back());
+  ctx.write_set_.pop_back();
+  auto parent_node = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(parent_guard.GetMutableData()));
 
-  if (parent_node->GetSize() <= parent_node->GetMaxSize()) {
+  if (parent_node->GetSize() < parent_node->GetMaxSize()) {
     parent_node->InsertNodeAfter(old_node_id, key, new_node_id);
     return;
   }
 
   page_id_t new_parent_pid   = NewPage();
-  auto      new_parent_guard = buffer_pool_manager_->FetchPageWrite(index_id_, new_parent_pid);
-  auto      new_parent_node  = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(new_parent_guard.GetMutableData()));
+  auto      new_parent_guard = FetchNodeWrite(new_parent_pid);
+  auto      new_parent_node =
+      reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(new_parent_guard.GetMutableData()));
   new_parent_node->Init(
       index_id_, new_parent_pid, parent_node->GetParentPageId(), parent_node->GetKeySize(), parent_node->GetMaxSize());
 
-  parent_node->InsertNodeAfter(old_node_id, key, new_node_id);
-  parent_node->MoveHalfTo(new_parent_node, buffer_pool_manager_);
+  parent_node->InsertAndSplit(old_node_id, key, new_node_id, new_parent_node, buffer_pool_manager_);
 
   Record push_key(key_schema_, nullptr, new_parent_node->KeyAt(0), INVALID_RID);
-  
-  parent_guard.Drop();
-  new_parent_guard.Drop();
-
-  InsertIntoParent(parent_id, push_key, new_parent_pid);
+  InsertIntoParent(ctx, parent_guard, push_key, new_parent_guard);
 }
 
-void BPTreeIndex::InsertIntoNewRoot(page_id_t old_root_id, const Record &key, page_id_t new_page_id)
+void BPTreeIndex::InsertIntoNewRoot(
+    BPTreeContext &ctx, WritePageGuard &old_guard, const Record &key, WritePageGuard &new_guard)
 {
+  // the old root was not safe, so the header is still latched
+  NJUDB_ASSERT(ctx.header_guard_.has_value(), "splitting the root without the header latched");
   page_id_t new_root_pid = NewPage();
-  auto      header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto      header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
+  auto      header       = reinterpret_cast<BPTreeIndexHeader *>(ctx.header_guard_->GetMutableData());
   header->root_page_id_  = new_root_pid;
   header->tree_height_++;
 
-  auto page_guard = buffer_pool_manager_->FetchPageWrite(index_id_, new_root_pid);
+  auto page_guard = FetchNodeWrite(new_root_pid);
   auto root_node  = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(page_guard.GetMutableData()));
   root_node->Init(index_id_, new_root_pid, INVALID_PAGE_ID, header->key_size_, header->internal_max_size_);
-  root_node->PopulateNewRoot(old_root_id, key, new_page_id);
+  root_node->PopulateNewRoot(old_guard.GetPageId(), key, new_guard.GetPageId());
 
-  auto old_node_guard = buffer_pool_manager_->FetchPageWrite(index_id_, old_root_id);
-  auto old_node       = reinterpret_cast<BPTreePage *>(PageContentPtr(old_node_guard.GetMutableData()));
+  auto old_node = reinterpret_cast<BPTreePage *>(PageContentPtr(old_guard.GetMutableData()));
   old_node->SetParentPageId(new_root_pid);
 
-  auto new_node_guard = buffer_pool_manager_->FetchPageWrite(index_id_, new_page_id);
-  auto new_node       = reinterpret_cast<BPTreePage *>(PageContentPtr(new_node_guard.GetMutableData()));
+  auto new_node = reinterpret_cast<BPTreePage *>(PageContentPtr(new_guard.GetMutableData()));
   new_node->SetParentPageId(new_root_pid);
 }
 
 void BPTreeIndex::Insert(const Record &key, const RID &rid)
 {
-  std::unique_lock<std::shared_mutex> lock(index_latch_);
-  auto                                header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
-  auto header = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
-
-  if (header->root_page_id_ == INVALID_PAGE_ID) {
-    header_guard.Drop();
-    StartNewTree(key, rid);
-    return;
+  BPTreeContext ctx;
+  if (!InsertOptimistic(key, rid)) {
+    ctx.header_guard_.emplace(FetchNodeWrite(FILE_HEADER_PAGE_ID));
+    auto header = reinterpret_cast<const BPTreeIndexHeader *>(ctx.header_guard_->GetData());
+    if (header->root_page_id_ == INVALID_PAGE_ID) {
+      StartNewTree(ctx, key, rid);
+    } else {
+      FindLeafPageWrite(key, ctx, true);
+      InsertIntoLeaf(ctx, key, rid);
+    }
   }
-  header_guard.Drop();
-  InsertIntoLeaf(key, rid);
+  UpdateNumEntries(1);
 }
 
-auto BPTreeIndex::Delete(const Record &key) -> bool
+auto BPTreeIndex::DeleteOptimistic(const Record &key, bool *found) -> bool
 {
-  std::unique_lock<std::shared_mutex> lock(index_latch_);
-  page_id_t                           leaf_pid = FindLeafPage(key);
-  if (leaf_pid == INVALID_PAGE_ID) return false;
-
-  auto page_guard = buffer_pool_manager_->FetchPageWrite(index_id_, leaf_pid);
-  auto leaf_node  = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(page_guard.GetMutableData()));
-
-  if (leaf_node->RemoveRecord(key, key_schema_) == -1) return false;
-
-  auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
-  header->num_entries_--;
-  header_guard.Drop();
+  auto leaf_guard = FindLeafPageForUpdate(key);
+  if (!leaf_guard.has_value()) {
+    *found = false;
+    return true;
+  }
 
-  bool should_rebalance = !leaf_node->IsSafe(false);
-  page_guard.Drop();
+  auto leaf_node = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(leaf_guard->GetData()));
+  if (!leaf_node->IsSafe(false)) return false;
 
-  if (should_rebalance) {
-    CoalesceOrRedistribute(leaf_pid);
+  *found = leaf_node->RemoveRecord(key, key_schema_) != -1;
+  if (*found) {
+    leaf_guard->GetMutableData();
   }
   return true;
 }
 
-auto BPTreeIndex::CoalesceOrRedistribute(page_id_t node_id) -> bool
+auto BPTreeIndex::Delete(const Record &key) -> bool
+{
+  BPTreeContext ctx;
+  bool          found = false;
+  if (!DeleteOptimistic(key, &found)) {
+    ctx.header_guard_.emplace(FetchNodeWrite(FILE_HEADER_PAGE_ID));
+    auto header = reinterpret_cast<const BPTreeIndexHeader *>(ctx.header_guard_->GetData());
+    if (header->root_page_id_ == INVALID_PAGE_ID) return false;
+
+    FindLeafPageWrite(key, ctx, false);
+    auto leaf_guard = std::move(ctx.write_set_.back());
+    ctx.write_set_.pop_back();
+    auto leaf_node = reinterpret_cast<BPTreeLeafPage *>(PageContentPtr(leaf_guard.GetData()));
+    found          = leaf_node->RemoveRecord(key, key_schema_) != -1;
+    if (found) {
+      leaf_guard.GetMutableData();
+      if (leaf_node->GetSize() < leaf_node->GetMinSize()) {
+        CoalesceOrRedistribute(ctx, leaf_guard);
+      }
+    }
+  }
+  if (found) {
+    UpdateNumEntries(-1);
+  }
+  return found;
+}
+
+void BPTreeIndex::CoalesceOrRedistribute(BPTreeContext &ctx, WritePageGuard &node_guard)
 {
-  auto node_guard = buffer_pool_manager_->FetchPageWrite(index_id_, node_id);
-  auto node       = reinterpret_cast<BPTreePage *>(PageContentPtr(node_guard.GetMutableData()));
+  auto node = reinterpret_cast<BPTreePage *>(PageContentPtr(node_guard.GetMutableData()));
 
   if (node->IsRoot()) {
-    return AdjustRoot(node);
+    AdjustRoot(ctx, node_guard);
+    return;
   }
 
-  page_id_t parent_id    = node->GetParentPageId();
-  auto      parent_guard = buffer_pool_manager_->FetchPageWrite(index_id_, parent_id);
-  auto      parent_node  = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(parent_guard.GetMutableData()));
+  // the node underflows, so its parent is in the latched path
+  auto parent_guard = std::move(ctx.write_set_.back());
+  ctx.write_set_.pop_back();
+  auto parent_node = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(parent_guard.GetMutableData()));
 
-  int index = -1;
+  page_id_t node_id = node_guard.GetPageId();
+  int       index   = -1;
   for (int i = 0; i < parent_node->GetSize(); i++) {
     if (parent_node->ValueAt(i) == node_id) {
       index = i;
       break;
     }
   }
-
-  int neighbor_index = (index == 0) ? 1 : index - 1;
-  page_id_t neighbor_pid = parent_node->ValueAt(neighbor_index);
-  
-  auto neighbor_guard = buffer_pool_manager_->FetchPageWrite(index_id_, neighbor_pid);
-  auto neighbor_node = reinterpret_cast<BPTreePage *>(PageContentPtr(neighbor_guard.GetMutableData()));
-
-  if (neighbor_node->GetSize() + node->GetSize() <= node->GetMaxSize()) {
-    node_guard.Drop();
-    parent_guard.Drop();
-    neighbor_guard.Drop();
-    
-    if (index == 0) {
-      return Coalesce(node_id, neighbor_pid, parent_id, 1);
+  NJUDB_ASSERT(index != -1, "the node is not a child of its parent");
+
+  if (index == 0) {
+    auto neighbor_guard = FetchNodeWrite(parent_node->ValueAt(1));
+    auto neighbor_node  = reinterpret_cast<BPTreePage *>(PageContentPtr(neighbor_guard.GetMutableData()));
+    if (neighbor_node->GetSize() + node->GetSize() <= node->GetMaxSize()) {
+      Coalesce(ctx, parent_guard, node_guard, neighbor_guard, 1);
+      return;
     }
-    return Coalesce(neighbor_pid, node_id, parent_id, index);
+    Redistribute(parent_node, neighbor_node, node, index);
+    return;
   }
 
-  Redistribute(neighbor_node, node, index);
-  return false;
+  // siblings are latched from left to right, so the node is let go while its left sibling is latched, others can
+  // only reach the node through the parent, which stays latched, and it does not change meanwhile
+  node_guard.Drop();
+  auto neighbor_guard = FetchNodeWrite(parent_node->ValueAt(index - 1));
+  node_guard          = FetchNodeWrite(node_id);
+  node                = reinterpret_cast<BPTreePage *>(PageContentPtr(node_guard.GetMutableData()));
+  auto neighbor_node  = reinterpret_cast<BPTreePage *>(PageContentPtr(neighbor_guard.GetMutableData()));
+  if (neighbor_node->GetSize() + node->GetSize() <= node->GetMaxSize()) {
+    Coalesce(ctx, parent_guard, neighbor_guard, node_guard, index);
+    return;
+  }
+  Redistribute(parent_node, neighbor_node, node, index);
 }
 
-auto BPTreeIndex::Coalesce(page_id_t neighbor_node_id, page_id_t node_id, page_id_t parent_id, int index) -> bool
+void BPTreeIndex::Coalesce(BPTreeContext &ctx, WritePageGuard &parent_guard, WritePageGuard &left_guard,
+    WritePageGuard &right_guard, int index)
 {
-  auto neighbor_guard = buffer_pool_manager_->FetchPageWrite(index_id_, neighbor_node_id);
-  auto node_guard     = buffer_pool_manager_->FetchPageWrite(index_id_, node_id);
-  auto parent_guard   = buffer_pool_manager_->FetchPageWrite(index_id_, parent_id);
-
-  auto neighbor_node = reinterpret_cast<BPTreePage *>(PageContentPtr(neighbor_guard.GetMutableData()));
-  auto node          = reinterpret_cast<BPTreePage *>(PageContentPtr(node_guard.GetMutableData()));
-  auto parent_node   = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(parent_guard.GetMutableData()));
+  auto parent_node = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(parent_guard.GetMutableData()));
+  auto left_node   = reinterpret_cast<BPTreePage *>(PageContentPtr(left_guard.GetMutableData()));
+  auto right_node  = reinterpret_cast<BPTreePage *>(PageContentPtr(right_guard.GetMutableData()));
 
-  if (node->IsLeaf()) {
-    auto leaf_node     = reinterpret_cast<BPTreeLeafPage *>(node);
-    auto neighbor_leaf = reinterpret_cast<BPTreeLeafPage *>(neighbor_node);
-    leaf_node->MoveAllTo(neighbor_leaf);
+  // the right node is merged into the left one
+  if (right_node->IsLeaf()) {
+    reinterpret_cast<BPTreeLeafPage *>(right_node)->MoveAllTo(reinterpret_cast<BPTreeLeafPage *>(left_node));
   } else {
-    auto internal_node     = reinterpret_cast<BPTreeInternalPage *>(node);
-    auto neighbor_internal = reinterpret_cast<BPTreeInternalPage *>(neighbor_node);
     Record middle_key(key_schema_, nullptr, parent_node->KeyAt(index), INVALID_RID);
-    internal_node->MoveAllTo(neighbor_internal, middle_key, buffer_pool_manager_);
+    reinterpret_cast<BPTreeInternalPage *>(right_node)
+        ->MoveAllTo(reinterpret_cast<BPTreeInternalPage *>(left_node), middle_key, buffer_pool_manager_);
   }
 
   for (int i = index; i < parent_node->GetSize() - 1; i++) {
@@ -719,26 +902,16 @@ auto BPTreeIndex::Coalesce(page_id_t neighbor_node_id, page_id_t node_id, page_i
   }
   parent_node->SetSize(parent_node->GetSize() - 1);
 
-  DeletePage(node_id);
+  DeletePage(right_guard);
+  left_guard.Drop();
 
-  bool parent_unsafe = !parent_node->IsSafe(false);
-  
-  neighbor_guard.Drop();
-  node_guard.Drop();
-  parent_guard.Drop();
-
-  if (parent_unsafe) {
-    return CoalesceOrRedistribute(parent_id);
+  if (parent_node->GetSize() < parent_node->GetMinSize()) {
+    CoalesceOrRedistribute(ctx, parent_guard);
   }
-  return true;
 }
 
-void BPTreeIndex::Redistribute(BPTreePage *neighbor_node, BPTreePage *node, int index)
+void BPTreeIndex::Redistribute(BPTreeInternalPage *parent_node, BPTreePage *neighbor_node, BPTreePage *node, int index)
 {
-  page_id_t parent_id    = node->GetParentPageId();
-  auto      parent_guard = buffer_pool_manager_->FetchPageWrite(index_id_, parent_id);
-  auto      parent_node  = reinterpret_cast<BPTreeInternalPage *>(PageContentPtr(parent_guard.GetMutableData()));
-
   if (node->IsLeaf()) {
     auto leaf_node     = reinterpret_cast<BPTreeLeafPage *>(node);
     auto neighbor_leaf = reinterpret_cast<BPTreeLeafPage *>(neighbor_node);
@@ -774,7 +947,7 @@ void BPTreeIndex::Redistribute(BPTreePage *neighbor_node, BPTreePage *node, int
       internal_node->SetValueAt(internal_node->GetSize(), neighbor_internal->ValueAt(0));
       internal_node->SetSize(internal_node->GetSize() + 1);
 
-      auto child_guard = buffer_pool_manager_->FetchPageWrite(index_id_, neighbor_internal->ValueAt(0));
+      auto child_guard = FetchNodeWrite(neighbor_internal->ValueAt(0));
       auto child_node  = reinterpret_cast<BPTreePage *>(PageContentPtr(child_guard.GetMutableData()));
       child_node->SetParentPageId(internal_node->GetPageId());
 
@@ -792,7 +965,7 @@ void BPTreeIndex::Redistribute(BPTreePage *neighbor_node, BPTreePage *node, int
       internal_node->SetValueAt(0, neighbor_internal->ValueAt(neighbor_internal->GetSize() - 1));
       internal_node->SetKeyAt(1, parent_node->KeyAt(index));
 
-      auto child_guard = buffer_pool_manager_->FetchPageWrite(index_id_, neighbor_internal->ValueAt(neighbor_internal->GetSize() - 1));
+      auto child_guard = FetchNodeWrite(neighbor_internal->ValueAt(neighbor_internal->GetSize() - 1));
       auto child_node  = reinterpret_cast<BPTreePage *>(PageContentPtr(child_guard.GetMutableData()));
       child_node->SetParentPageId(internal_node->GetPageId());
 
@@ -803,60 +976,55 @@ void BPTreeIndex::Redistribute(BPTreePage *neighbor_node, BPTreePage *node, int
   }
 }
 
-auto BPTreeIndex::AdjustRoot(BPTreePage *old_root_node) -> bool
+void BPTreeIndex::AdjustRoot(BPTreeContext &ctx, WritePageGuard &root_guard)
 {
+  // the old root was not safe, so the header is still latched
+  NJUDB_ASSERT(ctx.header_guard_.has_value(), "adjusting the root without the header latched");
+  auto old_root_node = reinterpret_cast<BPTreePage *>(PageContentPtr(root_guard.GetMutableData()));
+  auto header        = reinterpret_cast<BPTreeIndexHeader *>(ctx.header_guard_->GetMutableData());
+
   if (old_root_node->IsLeaf()) {
     if (old_root_node->GetSize() == 0) {
-      auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-      auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
       header->root_page_id_ = INVALID_PAGE_ID;
       header->tree_height_  = 0;
-      DeletePage(old_root_node->GetPageId());
-      return true;
+      DeletePage(root_guard);
     }
-    return false;
+    return;
   }
 
   if (old_root_node->GetSize() == 1) {
-    auto internal_node = reinterpret_cast<BPTreeInternalPage *>(old_root_node);
-    page_id_t new_root_id = internal_node->ValueAt(0);
+    auto      internal_node = reinterpret_cast<BPTreeInternalPage *>(old_root_node);
+    page_id_t new_root_id   = internal_node->ValueAt(0);
 
-    auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-    auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
     header->root_page_id_ = new_root_id;
     header->tree_height_--;
 
-    auto new_root_guard = buffer_pool_manager_->FetchPageWrite(index_id_, new_root_id);
+    auto new_root_guard = FetchNodeWrite(new_root_id);
     auto new_root_node  = reinterpret_cast<BPTreePage *>(PageContentPtr(new_root_guard.GetMutableData()));
     new_root_node->SetParentPageId(INVALID_PAGE_ID);
 
-    DeletePage(old_root_node->GetPageId());
-    return true;
+    DeletePage(root_guard);
   }
-  return false;
 }
 
 auto BPTreeIndex::Search(const Record &key) -> std::vector<RID>
 {
-  std::shared_lock<std::shared_mutex> lock(index_latch_);
-  page_id_t                           leaf_pid = FindLeafPage(key);
-  if (leaf_pid == INVALID_PAGE_ID) return {};
+  auto page_guard = FindLeafPage(key);
+  if (!page_guard.has_value()) return {};
 
-  auto page_guard = buffer_pool_manager_->FetchPageRead(index_id_, leaf_pid);
-  auto leaf_node  = reinterpret_cast<const BPTreeLeafPage *>(PageContentPtr(page_guard.GetData()));
+  auto leaf_node = reinterpret_cast<const BPTreeLeafPage *>(PageContentPtr(page_guard->GetData()));
   return leaf_node->Lookup(key, key_schema_);
 }
 
 auto BPTreeIndex::SearchRange(const Record &low_key, const Record &high_key) -> std::vector<RID>
 {
-  std::shared_lock<std::shared_mutex> lock(index_latch_);
-  page_id_t                           leaf_pid = FindLeafPageForRange(low_key, true);
-  if (leaf_pid == INVALID_PAGE_ID) return {};
+  auto leaf_guard = FindLeafPageForRange(low_key, true);
+  if (!leaf_guard.has_value()) return {};
 
   std::vector<RID> result;
-  while (leaf_pid != INVALID_PAGE_ID) {
-    auto page_guard = buffer_pool_manager_->FetchPageRead(index_id_, leaf_pid);
-    auto leaf_node  = reinterpret_cast<const BPTreeLeafPage *>(PageContentPtr(page_guard.GetData()));
+  auto             page_guard = std::move(*leaf_guard);
+  while (true) {
+    auto leaf_node = reinterpret_cast<const BPTreeLeafPage *>(PageContentPtr(page_guard.GetData()));
 
     int start_idx = leaf_node->LowerBound(low_key, key_schema_);
     for (int i = start_idx; i < leaf_node->GetSize(); i++) {
@@ -867,7 +1035,11 @@ auto BPTreeIndex::SearchRange(const Record &low_key, const Record &high_key) ->
         return result;
       }
     }
-    leaf_pid = leaf_node->GetNextPageId();
+    page_id_t next_pid = leaf_node->GetNextPageId();
+    if (next_pid == INVALID_PAGE_ID) break;
+    // latch the next leaf before letting this one go, so that it cannot be merged away in between
+    auto next_guard = buffer_pool_manager_->FetchPageRead(index_id_, next_pid);
+    page_guard      = std::move(next_guard);
   }
   return result;
 }
@@ -890,6 +1062,10 @@ void BPTreeIndex::BPTreeIterator::Next()
   auto page_guard = tree_->buffer_pool_manager_->FetchPageRead(tree_->index_id_, leaf_page_id_);
   auto leaf_node  = reinterpret_cast<const BPTreeLeafPage *>(PageContentPtr(page_guard.GetData()));
   index_++;
+  if (index_ == leaf_node->GetSize() / 2 && leaf_node->GetNextPageId() != INVALID_PAGE_ID) {
+    // halfway through the leaf, load the next one in the background
+    tree_->buffer_pool_manager_->PrefetchPages(tree_->index_id_, leaf_node->GetNextPageId(), 1);
+  }
   if (index_ >= leaf_node->GetSize()) {
     leaf_page_id_ = leaf_node->GetNextPageId();
     index_        = 0;
@@ -912,27 +1088,25 @@ auto BPTreeIndex::BPTreeIterator::GetRID() -> RID
 
 auto BPTreeIndex::Begin() -> std::unique_ptr<IIterator>
 {
-  std::shared_lock<std::shared_mutex> lock(index_latch_);
-  page_id_t                           leaf_pid = FindLeafPage(Record(key_schema_), true);
-  return std::make_unique<BPTreeIterator>(this, leaf_pid, 0);
+  auto leaf_guard = FindLeafPage(Record(key_schema_), true);
+  if (!leaf_guard.has_value()) return End();
+  return std::make_unique<BPTreeIterator>(this, leaf_guard->GetPageId(), 0);
 }
 
 auto BPTreeIndex::Begin(const Record &key) -> std::unique_ptr<IIterator>
 {
-  std::shared_lock<std::shared_mutex> lock(index_latch_);
-  page_id_t                           leaf_pid = FindLeafPage(key);
-  if (leaf_pid == INVALID_PAGE_ID) return End();
+  auto leaf_guard = FindLeafPage(key);
+  if (!leaf_guard.has_value()) return End();
 
-  auto page_guard = buffer_pool_manager_->FetchPageRead(index_id_, leaf_pid);
-  auto leaf_node  = reinterpret_cast<const BPTreeLeafPage *>(PageContentPtr(page_guard.GetData()));
-  int  index      = leaf_node->LowerBound(key, key_schema_);
+  auto leaf_node = reinterpret_cast<const BPTreeLeafPage *>(PageContentPtr(leaf_guard->GetData()));
+  int  index     = leaf_node->LowerBound(key, key_schema_);
 
   if (index >= leaf_node->GetSize()) {
     page_id_t next_pid = leaf_node->GetNextPageId();
     return std::make_unique<BPTreeIterator>(this, next_pid, 0);
   }
 
-  return std::make_unique<BPTreeIterator>(this, leaf_pid, index);
+  return std::make_unique<BPTreeIterator>(this, leaf_guard->GetPageId(), index);
 }
 
 auto BPTreeIndex::End() -> std::unique_ptr<IIterator>
@@ -942,23 +1116,26 @@ auto BPTreeIndex::End() -> std::unique_ptr<IIterator>
 
 void BPTreeIndex::Clear()
 {
-  std::unique_lock<std::shared_mutex> lock(index_latch_);
-  auto                                header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto header = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
+  auto header_guard = FetchNodeWrite(FILE_HEADER_PAGE_ID);
+  auto header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
 
   if (header->root_page_id_ != INVALID_PAGE_ID) {
     ClearPage(header->root_page_id_);
   }
+  std::lock_guard lock(page_alloc_latch_);
   header->root_page_id_       = INVALID_PAGE_ID;
   header->tree_height_        = 0;
   header->num_entries_        = 0;
   header->page_num_           = 1;
   header->first_free_page_id_ = INVALID_PAGE_ID;
+  num_entries_                = 0;
+  page_num_                   = 1;
+  first_free_page_id_         = INVALID_PAGE_ID;
 }
 
 void BPTreeIndex::ClearPage(page_id_t page_id)
 {
-  auto page_guard = buffer_pool_manager_->FetchPageRead(index_id_, page_id);
+  auto page_guard = FetchNodeWrite(page_id);
   auto node       = reinterpret_cast<const BPTreePage *>(PageContentPtr(page_guard.GetData()));
 
   if (!node->IsLeaf()) {
@@ -967,30 +1144,36 @@ void BPTreeIndex::ClearPage(page_id_t page_id)
       ClearPage(internal_node->ValueAt(i));
     }
   }
-  DeletePage(page_id);
+  DeletePage(page_guard);
 }
 
 auto BPTreeIndex::IsEmpty() -> bool
 {
-  std::shared_lock<std::shared_mutex> lock(index_latch_);
-  auto                                header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
-  auto header = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
+  auto header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
+  auto header       = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
   return header->root_page_id_ == INVALID_PAGE_ID;
 }
 
 auto BPTreeIndex::Size() -> size_t
 {
-  std::shared_lock<std::shared_mutex> lock(index_latch_);
-  auto                                header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
-  auto header = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
-  return header->num_entries_;
+  std::lock_guard lock(page_alloc_latch_);
+  return num_entries_;
+}
+
+void BPTreeIndex::Flush()
+{
+  auto            header_guard = FetchNodeWrite(FILE_HEADER_PAGE_ID);
+  auto            header       = reinterpret_cast<BPTreeIndexHeader *>(header_guard.GetMutableData());
+  std::lock_guard lock(page_alloc_latch_);
+  header->first_free_page_id_ = first_free_page_id_;
+  header->page_num_           = page_num_;
+  header->num_entries_        = num_entries_;
 }
 
 auto BPTreeIndex::GetHeight() -> int
 {
-  std::shared_lock<std::shared_mutex> lock(index_latch_);
-  auto                                header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
-  auto header = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
+  auto header_guard = buffer_pool_manager_->FetchPageRead(index_id_, FILE_HEADER_PAGE_ID);
+  auto header       = reinterpret_cast<const BPTreeIndexHeader *>(header_guard.GetData());
   return header->tree_height_;
 }
 
@@ -25,9 +25,11 @@
 #include "index_abstract.h"
 #include "common/page.h"
 #include "../buffer/page_guard.h"
+#include <functional>
 #include <vector>
 #include <memory>
-#include <shared_mutex>
+#include <mutex>
+#include <optional>
 
 namespace njudb {
 
@@ -76,6 +78,7 @@ struct BPTreePage
   auto GetPageId() const -> page_id_t;
   auto GetParentPageId() const -> page_id_t;
   void SetParentPageId(page_id_t parent_page_id);
+  auto GetMinSize() const -> int;
   auto IsSafe(bool is_insert) const -> bool;
 };
 
@@ -97,7 +100,8 @@ struct BPTreeInternalPage : public BPTreePage
   auto LookupForUpperBound(const Record &key, const RecordSchema *schema) const -> page_id_t;
   void PopulateNewRoot(page_id_t old_root_id, const Record &new_key, page_id_t new_page_id);
   auto InsertNodeAfter(page_id_t old_value, const Record &new_key, page_id_t new_value) -> int;
-  void MoveHalfTo(BPTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager);
+  void InsertAndSplit(page_id_t old_value, const Record &new_key, page_id_t new_value, BPTreeInternalPage *recipient,
+      BufferPoolManager *buffer_pool_manager);
   void MoveAllTo(BPTreeInternalPage *recipient, const Record &middle_key, BufferPoolManager *buffer_pool_manager);
   void CopyNFrom(const char *keys, const page_id_t *values, int size, BufferPoolManager *buffer_pool_manager);
 
@@ -141,6 +145,28 @@ private:
   auto GetKeysArray() const -> const char * { return data_ + max_size_ * sizeof(RID); }
 };
 
+// the latches a modifying operation holds on its way down, ancestors are let go once a node is safe
+struct BPTreeContext
+{
+  std::optional<WritePageGuard> header_guard_;  // held while the root may change
+  std::vector<WritePageGuard>   write_set_;     // the latched path, root side first
+};
+
+/**
+ * Concurrent operations synchronize by latch crabbing on the pages of the tree. Every operation enters through the
+ * header page, which holds the root page id, and latches a child before letting its parent go, pages are latched top
+ * down and siblings from left to right so that no two operations wait for each other.
+ * - readers descend with shared latches, range scans latch the next leaf before letting the current one go
+ * - before that, every descent tries copies of the header and the inner nodes taken by
+ *   BufferPoolManager::ReadPageOptimistic, it latches only the leaf and keeps it if the node pointing to the leaf has
+ *   not changed meanwhile, otherwise it falls back to the latched descent
+ * - Insert and Delete first descend like readers and upgrade the latch of the leaf while its parent is still latched,
+ *   if the leaf is safe, i.e. it will not split or underflow, the change stays in the leaf
+ * - otherwise they descend again with exclusive latches and keep the ancestors of the first unsafe node latched in a
+ *   BPTreeContext, the header included if the root may change
+ * The free page list, the page count and the entry count are kept in members guarded by page_alloc_latch_ rather than
+ * in the header page, since a writer holding tree nodes must not latch the header. Flush writes them into the header.
+ */
 class BPTreeIndex : public Index
 {
 public:
@@ -190,6 +216,7 @@ public:
   void Clear() override;
   auto IsEmpty() -> bool override;
   auto Size() -> size_t override;
+  void Flush() override;
 
   // Index statistics
   auto GetHeight() -> int override;
@@ -200,27 +227,45 @@ private:
   // Helper functions
   void InitializeIndex();
   auto NewPage() -> page_id_t;
-  void DeletePage(page_id_t page_id);
-  auto FindLeafPage(const Record &key, bool leftMost = false) -> page_id_t;
-  auto FindLeafPageForRange(const Record &key, bool isLowerBound = true) -> page_id_t;
-  void StartNewTree(const Record &key, const RID &value);
-  auto InsertIntoLeaf(const Record &key, const RID &value) -> bool;
-  void InsertIntoParent(page_id_t old_node_id, const Record &key, page_id_t new_node_id);
-  void InsertIntoNewRoot(page_id_t old_root_id, const Record &key, page_id_t new_page_id);
-  auto CoalesceOrRedistribute(page_id_t node_id) -> bool;
-  auto Coalesce(page_id_t neighbor_node_id, page_id_t node_id, page_id_t parent_id, int index) -> bool;
-  void Redistribute(BPTreePage *neighbor_node, BPTreePage *node, int index);
-  auto AdjustRoot(BPTreePage *old_root_node) -> bool;
+  // put the page on the free list, the guard is dropped
+  void DeletePage(WritePageGuard &page_guard);
+  // latch a page exclusively, it is only marked dirty once its data is taken by GetMutableData
+  auto FetchNodeWrite(page_id_t page_id) -> WritePageGuard;
+  // the leaf latched in shared mode, nullopt if the tree is empty
+  auto FindLeafPage(const Record &key, bool leftMost = false) -> std::optional<ReadPageGuard>;
+  auto FindLeafPageForRange(const Record &key, bool isLowerBound = true) -> std::optional<ReadPageGuard>;
+  // the leaf latched in exclusive mode through a shared descent, nullopt if the tree is empty
+  auto FindLeafPageForUpdate(const Record &key) -> std::optional<WritePageGuard>;
+  // the leaf the key routes to through optimistic copies of the header and the inner nodes, child_of picks the child
+  // of an inner node, INVALID_PAGE_ID if a copy fails or the tree is empty, parent is set to the version of the page
+  // pointing to the leaf, which must be validated once the leaf is latched
+  auto FindLeafOptimistic(const std::function<page_id_t(const BPTreeInternalPage *)> &child_of, PageVersion *parent)
+      -> page_id_t;
+  // the exclusive descent, the latched path is left in ctx
+  void FindLeafPageWrite(const Record &key, BPTreeContext &ctx, bool is_insert);
+  auto InsertOptimistic(const Record &key, const RID &value) -> bool;
+  auto DeleteOptimistic(const Record &key, bool *found) -> bool;
+  void UpdateNumEntries(int delta);
+  void StartNewTree(BPTreeContext &ctx, const Record &key, const RID &value);
+  void InsertIntoLeaf(BPTreeContext &ctx, const Record &key, const RID &value);
+  void InsertIntoParent(BPTreeContext &ctx, WritePageGuard &old_guard, const Record &key, WritePageGuard &new_guard);
+  void InsertIntoNewRoot(BPTreeContext &ctx, WritePageGuard &old_guard, const Record &key, WritePageGuard &new_guard);
+  void CoalesceOrRedistribute(BPTreeContext &ctx, WritePageGuard &node_guard);
+  void Coalesce(BPTreeContext &ctx, WritePageGuard &parent_guard, WritePageGuard &left_guard,
+      WritePageGuard &right_guard, int index);
+  void Redistribute(BPTreeInternalPage *parent_node, BPTreePage *neighbor_node, BPTreePage *node, int index);
+  void AdjustRoot(BPTreeContext &ctx, WritePageGuard &root_guard);
   void ClearPage(page_id_t page_id);
 
   // Constants
   static constexpr int LEAF_PAGE_SIZE     = PAGE_SIZE;
   static constexpr int INTERNAL_PAGE_SIZE = PAGE_SIZE;
 
-  // for the current implementation, we use a global latch to synchronize access to the index,
-  // which is not optimal for performance but simplifies the implementation.
-  // a more proper practice is to use Crab Walking (Lock Coupling) Protocol for a fine-grained locking mechanism.
-  mutable std::shared_mutex index_latch_;
+  // guards the fields below, loaded from the header when the index is opened, see the class comment
+  std::mutex page_alloc_latch_;
+  page_id_t  first_free_page_id_{INVALID_PAGE_ID};
+  size_t     page_num_{0};
+  size_t     num_entries_{0};
 };
 
 }  // namespace njudb
@@ -52,8 +52,8 @@ HashIndex::HashIndex(DiskManager *disk_manager, BufferPoolManager *buffer_pool_m
 void HashIndex::InitializeHashIndex()
 {
   // Create header page for hash index
-  auto header_guard = buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
-  auto header_page  = reinterpret_cast<HashHeaderPage *>(header_guard.GetMutableData());
+  auto header_guard = FetchHashHeaderPage();
+  auto header_page  = AsHeaderPage(header_guard);
 
   if (header_page->bucket_count_ != 0) {
     // It is an index that has already been initialized
@@ -68,8 +68,8 @@ void HashIndex::InitializeHashIndex()
   header_page->next_page_id_  = 2;  // Start allocating from page 2 (skip header and directory)
 
   // Initialize bucket directory page
-  auto directory_guard = buffer_pool_manager_->FetchPageWrite(index_id_, HASH_KEY_PAGE);
-  auto directory_page  = reinterpret_cast<HashBucketDirectory *>(directory_guard.GetMutableData());
+  auto directory_guard = FetchBucketDirectory();
+  auto directory_page  = AsBucketDirectory(directory_guard);
 
   // Calculate how many bucket page IDs can fit in the directory page
   size_t available_space = PAGE_SIZE - sizeof(HashBucketDirectory) - PAGE_HEADER_SIZE;
@@ -96,22 +96,34 @@ auto HashIndex::Hash(const Record &key) -> size_t
   return key.Hash() % bucket_count_;
 }
 
-auto HashIndex::GetHashHeaderPage() -> HashHeaderPage *
+auto HashIndex::FetchHashHeaderPage() -> WritePageGuard
 {
-  auto page = buffer_pool_manager_->FetchPage(index_id_, FILE_HEADER_PAGE_ID);
-  return reinterpret_cast<HashHeaderPage *>(page->GetData());
+  return buffer_pool_manager_->FetchPageWrite(index_id_, FILE_HEADER_PAGE_ID);
 }
 
-auto HashIndex::GetBucketDirectory() -> HashBucketDirectory *
+auto HashIndex::FetchBucketDirectory() -> WritePageGuard
 {
-  auto page = buffer_pool_manager_->FetchPage(index_id_, HASH_KEY_PAGE);
-  return reinterpret_cast<HashBucketDirectory *>(page->GetData());
+  return buffer_pool_manager_->FetchPageWrite(index_id_, HASH_KEY_PAGE);
 }
 
-auto HashIndex::GetBucketPage(page_id_t page_id) -> HashBucketPage *
+auto HashIndex::FetchBucketPage(page_id_t page_id) -> WritePageGuard
 {
-  auto page = buffer_pool_manager_->FetchPage(index_id_, page_id);
-  return reinterpret_cast<HashBucketPage *>(PageContentPtr(page->GetData()));
+  return buffer_pool_manager_->FetchPageWrite(index_id_, page_id);
+}
+
+auto HashIndex::AsHeaderPage(WritePageGuard &guard) -> HashHeaderPage *
+{
+  return reinterpret_cast<HashHeaderPage *>(guard.GetMutableData());
+}
+
+auto HashIndex::AsBucketDirectory(WritePageGuard &guard) -> HashBucketDirectory *
+{
+  return reinterpret_cast<HashBucketDirectory *>(guard.GetMutableData());
+}
+
+auto HashIndex::AsBucketPage(WritePageGuard &guard) -> HashBucketPage *
+{
+  return reinterpret_cast<HashBucketPage *>(PageContentPtr(guard.GetMutableData()));
 }
 
 auto HashIndex::AllocateBucketPage() -> page_id_t
@@ -23,6 +23,7 @@
 #define NJUDB_INDEX_HASH_H
 
 #include "index_abstract.h"
+#include "../buffer/page_guard.h"
 #include "common/config.h"
 #include <vector>
 #include <unordered_map>
@@ -118,10 +119,14 @@ private:
   // Hash function
   auto Hash(const Record &key) -> size_t;
 
-  // Page management
-  auto GetHashHeaderPage() -> HashHeaderPage *;
-  auto GetBucketDirectory() -> HashBucketDirectory *;
-  auto GetBucketPage(page_id_t page_id) -> HashBucketPage *;
+  // Page management, the guards keep the pages pinned until they go out of scope, cast their data with
+  // AsHeaderPage, AsBucketDirectory and AsBucketPage
+  auto FetchHashHeaderPage() -> WritePageGuard;
+  auto FetchBucketDirectory() -> WritePageGuard;
+  auto FetchBucketPage(page_id_t page_id) -> WritePageGuard;
+  static auto AsHeaderPage(WritePageGuard &guard) -> HashHeaderPage *;
+  static auto AsBucketDirectory(WritePageGuard &guard) -> HashBucketDirectory *;
+  static auto AsBucketPage(WritePageGuard &guard) -> HashBucketPage *;
   auto AllocateBucketPage() -> page_id_t;
   void InitializeHashIndex();
 
@@ -27,14 +27,14 @@ DatabaseHandle::DatabaseHandle(
     : ref_cnt_(0), db_name_(std::move(db_name)), disk_manager_(disk_manager), tbl_mgr_(tbl_mgr), idx_mgr_(idx_mgr)
 {}
 
-void DatabaseHandle::Open()
+void DatabaseHandle::Open(TableAccessMode access_mode)
 {
   /**
    * open all tables and indexes in the database
    * .db file example:
    * | table_num | table_name_1_len | table_name_1 | storage_model_1 | ... | table_name_n_len | table_name_n |
    * storage_model_n | |index_num | index_name_1_len | index_name_1 | index_type_1 | ... | index_name_n_len |
-   * index_name_n | index_type_n |
+   * index_name_n | index_type_n | skip_checksum |
    */
   // open db_name_.db
   auto db_fd = disk_manager_->OpenFile(FILE_NAME(db_name_, db_name_, DB_SUFFIX));
@@ -56,7 +56,7 @@ void DatabaseHandle::Open()
     StorageModel storage_model;
     disk_manager_->ReadFile(db_fd, reinterpret_cast<char *>(&storage_model), sizeof(StorageModel), 0, SEEK_CUR);
     // create table handle via table manager
-    auto tbl_hdl                   = tbl_mgr_->OpenTable(db_name_, table_name, storage_model);
+    auto tbl_hdl                   = tbl_mgr_->OpenTable(db_name_, table_name, storage_model, access_mode);
     tables_[tbl_hdl->GetTableId()] = std::move(tbl_hdl);
   }
   // read index number
@@ -96,6 +96,18 @@ void DatabaseHandle::Open()
       tab_idx_map_[table_id] = std::list<idx_id_t>();
     tab_idx_map_[table_id].push_back(iid);
   }
+  // read whether page checksums are verified, a .db file without the flag reads zero and verifies them
+  bool skip_checksum = false;
+  disk_manager_->ReadFile(db_fd, reinterpret_cast<char *>(&skip_checksum), sizeof(bool), 0, SEEK_CUR);
+  verify_checksum_ = !skip_checksum;
+  for (auto &table : tables_) {
+    ApplyPageChecksum(table.first);
+  }
+  for (auto &index : indexes_) {
+    if (index.second->GetIndexType() == BPTREE) {
+      ApplyPageChecksum(index.first);
+    }
+  }
   disk_manager_->CloseFile(db_fd);
 }
 
@@ -128,7 +140,7 @@ void DatabaseHandle::FlushMeta()
    * .db file example:
    * | table_num | table_name_1_len | table_name_1 | storage_model_1 | ... | table_name_n_len | table_name_n |
    * storage_model_n | |index_num | index_name_1_len | index_name_1 | index_type_1 | ... | index_name_n_len |
-   * index_name_n | index_type_n |
+   * index_name_n | index_type_n | skip_checksum |
    */
 
   // open db_name_.db
@@ -170,14 +182,34 @@ void DatabaseHandle::FlushMeta()
     IndexType index_type = index.second->GetIndexType();
     disk_manager_->WriteFile(db_fd, reinterpret_cast<const char *>(&index_type), sizeof(IndexType), SEEK_CUR);
   }
+  // write whether page checksums are skipped
+  bool skip_checksum = !verify_checksum_;
+  disk_manager_->WriteFile(db_fd, reinterpret_cast<const char *>(&skip_checksum), sizeof(bool), SEEK_CUR);
   disk_manager_->CloseFile(db_fd);
 }
 
-void DatabaseHandle::CreateTable(
-    const std::string &tab_name, const RecordSchema &rec_schema, StorageModel storage_model)
+void DatabaseHandle::SetPageChecksum(bool verify)
+{
+  verify_checksum_ = verify;
+  for (auto &table : tables_) {
+    ApplyPageChecksum(table.first);
+  }
+  for (auto &index : indexes_) {
+    if (index.second->GetIndexType() == BPTREE) {
+      ApplyPageChecksum(index.first);
+    }
+  }
+  FlushMeta();
+}
+
+void DatabaseHandle::ApplyPageChecksum(file_id_t fid) { disk_manager_->SetPageChecksum(fid, verify_checksum_); }
+
+void DatabaseHandle::CreateTable(const std::string &tab_name, const RecordSchema &rec_schema,
+    StorageModel storage_model, PageCompression compression)
 {
-  tbl_mgr_->CreateTable(db_name_, tab_name, rec_schema, storage_model);
+  tbl_mgr_->CreateTable(db_name_, tab_name, rec_schema, storage_model, compression);
   auto tbl_hdl                   = tbl_mgr_->OpenTable(db_name_, tab_name, storage_model);
+  ApplyPageChecksum(tbl_hdl->GetTableId());
   tables_[tbl_hdl->GetTableId()] = std::move(tbl_hdl);
 
   FlushMeta();
@@ -207,6 +239,10 @@ void DatabaseHandle::CreateIndex(
 
   idx_mgr_->CreateIndex(db_name_, idx_name, tab_name, key_schema, idx_type);
   auto idx_hdl = idx_mgr_->OpenIndex(db_name_, idx_name, tab_name, idx_type);
+  if (idx_type == BPTREE) {
+    // the pages of a hash index do not all start with the page header
+    ApplyPageChecksum(idx_hdl->GetIndexId());
+  }
   // now insert records of the table into the index
   auto table = tables_[table_id].get();
   NJUDB_ASSERT(table != nullptr, fmt::format("Table {} does not exist", tab_name));
@@ -216,10 +252,14 @@ void DatabaseHandle::CreateIndex(
       fmt::format("Table name mismatch: expected {}, got {}", tab_name, table->GetTableName()));
   // insert all records into the index
   auto tab_hdl = tables_[table_id].get();
+  // read the table through a ring so that the backfill does not evict the working set of other queries
+  BufferAccessStrategy strategy;
   try {
-    for (auto rid = tab_hdl->GetFirstRID(); rid != INVALID_RID; rid = tab_hdl->GetNextRID(rid)) {
-      auto rec = tab_hdl->GetRecord(rid);
-      idx_hdl->InsertRecord(*rec);
+    TableScanCursor cursor(tab_hdl, &strategy);
+    Record          rec(&tab_hdl->GetSchema());
+    for (cursor.Rewind(); !cursor.IsEnd(); cursor.Next()) {
+      cursor.ReadRecord(rec);
+      idx_hdl->InsertRecord(rec);
     }
     // catch NJUDB_INDEX_FAIL
   } catch (const NJUDBException_ &e) {
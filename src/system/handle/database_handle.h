@@ -36,13 +36,29 @@ public:
 
   DatabaseHandle(std::string db_name, DiskManager *disk_manager, TableManager *tbl_mgr, IndexManager *idx_mgr);
 
-  void Open();
+  /**
+   * @param access_mode how the existing tables are read, tables created later are always buffered
+   */
+  void Open(TableAccessMode access_mode = TABLE_ACCESS_BUFFERED);
 
   void Close();
 
   void FlushMeta();
 
-  void CreateTable(const std::string &tab_name, const RecordSchema &rec_schema, StorageModel storage_model);
+  /**
+   * Turn the verification of page checksums of the tables and B+ tree indexes on or off, the setting is stored in the
+   * .db file. Pages are stamped with a checksum when written either way, so that none keeps a stale one
+   */
+  void SetPageChecksum(bool verify);
+
+  [[nodiscard]] auto IsPageChecksumVerified() const -> bool { return verify_checksum_; }
+
+  /**
+   * @param compression codec of the pages of the table file, see DiskManager::CreateFile. Meant for cold tables that
+   * are mostly scanned, as every buffer pool miss decompresses a page
+   */
+  void CreateTable(const std::string &tab_name, const RecordSchema &rec_schema, StorageModel storage_model,
+      PageCompression compression = PAGE_COMPRESSION_NONE);
 
   void DropTable(const std::string &tab_name);
 
@@ -83,6 +99,13 @@ private:
   std::unordered_map<table_id_t, std::unique_ptr<TableHandle>> tables_;
   std::unordered_map<idx_id_t, std::unique_ptr<IndexHandle>>   indexes_;
   std::unordered_map<table_id_t, std::list<idx_id_t>>          tab_idx_map_;
+
+  bool verify_checksum_{true};
+
+  /**
+   * Stamp the pages of a table or B+ tree index with checksums, verified if verify_checksum_ is set
+   */
+  void ApplyPageChecksum(file_id_t fid);
 };
 }  // namespace njudb
 
@@ -0,0 +1,76 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#include "free_space_map.h"
+
+#include <limits>
+
+#include "../../../common/error.h"
+
+namespace njudb {
+
+FreeSpaceMap::FreeSpaceMap(size_t num_partitions)
+    : num_partitions_(num_partitions), partitions_(std::make_unique<Partition[]>(num_partitions))
+{
+  NJUDB_ASSERT(num_partitions_ > 0, "free space map needs at least one partition");
+}
+
+auto FreeSpaceMap::FindPage(size_t hint) -> page_id_t
+{
+  for (size_t i = 0; i < num_partitions_; ++i) {
+    auto &part = partitions_[(hint + i) % num_partitions_];
+    std::lock_guard lock(part.latch_);
+    while (!part.candidates_.empty()) {
+      auto page_id = part.candidates_.back();
+      auto index   = static_cast<size_t>(page_id) / num_partitions_;
+      if (part.free_slots_[index] > 0) {
+        return page_id;
+      }
+      part.candidates_.pop_back();
+      part.listed_[index] = false;
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+void FreeSpaceMap::Update(page_id_t page_id, size_t free_slots)
+{
+  NJUDB_ASSERT(page_id >= 0, "invalid page id");
+  NJUDB_ASSERT(free_slots <= std::numeric_limits<uint16_t>::max(), "free slots out of range");
+  auto &part  = partitions_[static_cast<size_t>(page_id) % num_partitions_];
+  auto  index = static_cast<size_t>(page_id) / num_partitions_;
+  std::lock_guard lock(part.latch_);
+  if (index >= part.free_slots_.size()) {
+    part.free_slots_.resize(index + 1, 0);
+    part.listed_.resize(index + 1, false);
+  }
+  part.free_slots_[index] = static_cast<uint16_t>(free_slots);
+  if (free_slots > 0 && !part.listed_[index]) {
+    part.candidates_.push_back(page_id);
+    part.listed_[index] = true;
+  }
+}
+
+auto FreeSpaceMap::GetFreeSlots(page_id_t page_id) -> size_t
+{
+  auto &part  = partitions_[static_cast<size_t>(page_id) % num_partitions_];
+  auto  index = static_cast<size_t>(page_id) / num_partitions_;
+  std::lock_guard lock(part.latch_);
+  return index < part.free_slots_.size() ? part.free_slots_[index] : 0;
+}
+
+}  // namespace njudb
@@ -0,0 +1,83 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+#ifndef NJUDB_FREE_SPACE_MAP_H
+#define NJUDB_FREE_SPACE_MAP_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "common/types.h"
+#include "../../../common/micro.h"
+
+namespace njudb {
+
+/**
+ * FreeSpaceMap keeps the number of empty slots of every data page of a table, so that an inserter can find a page with
+ * room without walking a chain. Pages are distributed among partitions by page id, each partition has its own latch
+ * and a list of the pages that had room when last updated. Inserters start searching at a partition picked by a hint,
+ * e.g. a hash of the thread id, so concurrent inserters fill different pages.
+ *
+ * The map is a hint, the caller must recheck the page after latching it and report the real count back with Update.
+ * Update is expected to be called while the page is still latched, which keeps the counts of one page in order.
+ */
+class FreeSpaceMap
+{
+public:
+  explicit FreeSpaceMap(size_t num_partitions = FSM_PARTITIONS);
+
+  DISABLE_COPY_MOVE_AND_ASSIGN(FreeSpaceMap)
+
+  /**
+   * Find a page that had at least one empty slot when it was last updated
+   * @param hint the partition to search first, inserters with different hints get different pages when possible
+   * @return the page id, INVALID_PAGE_ID if no page has room
+   */
+  auto FindPage(size_t hint) -> page_id_t;
+
+  /**
+   * Record the number of empty slots of a page, a page not in the map yet is added
+   * @param page_id
+   * @param free_slots
+   */
+  void Update(page_id_t page_id, size_t free_slots);
+
+  /**
+   * @return the number of empty slots recorded for the page, 0 for a page not in the map
+   */
+  auto GetFreeSlots(page_id_t page_id) -> size_t;
+
+private:
+  struct Partition
+  {
+    std::mutex latch_;
+    // free slots of the pages of the partition, indexed by page id / number of partitions
+    std::vector<uint16_t> free_slots_;
+    // pages that may have room, a page leaves the list lazily when FindPage sees it full
+    std::vector<page_id_t> candidates_;
+    std::vector<bool>      listed_;
+  };
+
+  size_t                       num_partitions_;
+  std::unique_ptr<Partition[]> partitions_;
+};
+
+}  // namespace njudb
+
+#endif  // NJUDB_FREE_SPACE_MAP_H
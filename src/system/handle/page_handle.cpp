@@ -20,75 +20,188 @@
 //
 
 #include "page_handle.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "../../../common/error.h"
 #include "storage/buffer/buffer_pool_manager.h"
 
 namespace njudb {
-PageHandle::PageHandle(const TableHeader *tab_hdr, Page *page, char *bit_map, char *slots_mem)
-    : tab_hdr_(tab_hdr), page_(page), bitmap_(bit_map), slots_mem_(slots_mem)
+
+static_assert(PAGE_SIZE <= UINT16_MAX, "slotted pages store offsets in 16 bits");
+
+// fields of the slotted header
+static constexpr size_t SLOTTED_SLOT_NUM    = 0;
+static constexpr size_t SLOTTED_TUPLE_BYTES = 1;
+static constexpr size_t SLOTTED_LIVE_BYTES  = 2;
+
+// flags in the size of a slot entry, a forwarded slot holds the rid its record was moved to, a moved slot holds a
+// record whose home slot is on another page
+static constexpr uint16_t SLOT_FORWARDED = 0x8000;
+static constexpr uint16_t SLOT_MOVED     = 0x4000;
+static constexpr uint16_t SLOT_SIZE_MASK = 0x3fff;
+static_assert(PAGE_SIZE <= SLOT_SIZE_MASK, "slotted tuple sizes are stored in 14 bits");
+
+PageHandle::PageHandle(const TableHeader *tab_hdr, char *data, StorageModel storage_model, const RecordSchema *schema,
+    const std::vector<size_t> *offsets)
+    : data_(data),
+      tab_hdr_(tab_hdr),
+      bitmap_(data + PAGE_HEADER_SIZE),
+      slots_mem_(data + PAGE_HEADER_SIZE + tab_hdr->bitmap_size_),
+      storage_model_(storage_model),
+      schema_(schema),
+      offsets_(offsets)
 {
   NJUDB_ASSERT(BITMAP_SIZE(tab_hdr->rec_per_page_) == tab_hdr->bitmap_size_, "bitmap size not match");
+  NJUDB_ASSERT(storage_model != PAX_MODEL || (schema != nullptr && offsets != nullptr), "pax page without schema");
+  NJUDB_ASSERT(storage_model != SLOTTED_MODEL || schema != nullptr, "slotted page without schema");
 }
+
 void PageHandle::WriteSlot(size_t slot_id, const char *null_map, const char *data, bool update)
 {
-  NJUDB_THROW(NJUDB_EXCEPTION_EMPTY, "");
+  NJUDB_ASSERT(slot_id < tab_hdr_->rec_per_page_, "slot_id out of range");
+  NJUDB_ASSERT(BitMap::GetBit(bitmap_, slot_id) == update, fmt::format("update: {}", update));
+  switch (storage_model_) {
+    case NARY_MODEL: WriteNArySlot(slot_id, null_map, data); break;
+    case PAX_MODEL: WritePAXSlot(slot_id, null_map, data); break;
+    case SLOTTED_MODEL: WriteSlottedSlot(slot_id, null_map, data, update); break;
+    default: NJUDB_FATAL("Unknown storage model");
+  }
 }
 
-void PageHandle::ReadSlot(size_t slot_id, char *null_map, char *data) { NJUDB_THROW(NJUDB_EXCEPTION_EMPTY, ""); }
-auto PageHandle::ReadChunk(const RecordSchema *chunk_schema) -> ChunkUptr { NJUDB_THROW(NJUDB_EXCEPTION_EMPTY, ""); }
-
-NAryPageHandle::NAryPageHandle(const TableHeader *tab_hdr, Page *page)
-    : PageHandle(
-          tab_hdr, page, page->GetData() + PAGE_HEADER_SIZE, page->GetData() + PAGE_HEADER_SIZE + tab_hdr->bitmap_size_)
-{}
+void PageHandle::ReadSlot(size_t slot_id, char *null_map, char *data) const
+{
+  NJUDB_ASSERT(slot_id < tab_hdr_->rec_per_page_, "slot_id out of range");
+  NJUDB_ASSERT(BitMap::GetBit(bitmap_, slot_id) == true, "slot is empty");
+  switch (storage_model_) {
+    case NARY_MODEL: ReadNArySlot(slot_id, null_map, data); break;
+    case PAX_MODEL: ReadPAXSlot(slot_id, null_map, data); break;
+    case SLOTTED_MODEL: ReadSlottedSlot(slot_id, null_map, data); break;
+    default: NJUDB_FATAL("Unknown storage model");
+  }
+}
 
-void NAryPageHandle::WriteSlot(size_t slot_id, const char *null_map, const char *data, bool update)
+void PageHandle::DeleteSlot(size_t slot_id)
 {
   NJUDB_ASSERT(slot_id < tab_hdr_->rec_per_page_, "slot_id out of range");
-  NJUDB_ASSERT(BitMap::GetBit(bitmap_, slot_id) == update, fmt::format("update: {}", update));
+  // the slots of the fixed-length models are simply overwritten by the next record
+  if (storage_model_ == SLOTTED_MODEL) {
+    DeleteSlottedSlot(slot_id);
+  }
+}
+
+auto PageHandle::GetFreeSlotNum() const -> size_t
+{
+  uint32_t record_num;
+  memcpy(&record_num, data_ + PAGE_RECORD_NUM_OFFSET, sizeof(record_num));
+  size_t free_slots = tab_hdr_->rec_per_page_ - record_num;
+  if (storage_model_ != SLOTTED_MODEL) {
+    return free_slots;
+  }
+  // a varchar field takes at most its size and the length, a new slot may need a directory entry
+  size_t max_tuple  = std::max(
+      tab_hdr_->nullmap_size_ + tab_hdr_->rec_size_ + tab_hdr_->field_num_ * sizeof(uint16_t), SLOTTED_FORWARD_SIZE);
+  size_t free_bytes = PAGE_SIZE - GetSlottedDirectoryEnd() - GetSlottedField(SLOTTED_LIVE_BYTES);
+  return std::min(free_slots, free_bytes / (max_tuple + SLOT_ENTRY_SIZE));
+}
+
+auto PageHandle::GetMinSlottedTupleSize(const RecordSchema &schema) -> size_t
+{
+  size_t size = BITMAP_SIZE(schema.GetFieldCount());
+  for (const auto &field : schema.GetFields()) {
+    size += field.field_.field_type_ == TYPE_VARCHAR ? sizeof(uint16_t) : field.field_.field_size_;
+  }
+  return std::max(size, SLOTTED_FORWARD_SIZE);
+}
+
+auto PageHandle::HasRoom(size_t slot_id, const char *data, bool update) const -> bool
+{
+  if (storage_model_ != SLOTTED_MODEL) {
+    return true;
+  }
+  return SlottedFits(slot_id, GetSlottedTupleSize(data), update);
+}
+
+auto PageHandle::GetForward(size_t slot_id) const -> RID
+{
+  if (storage_model_ != SLOTTED_MODEL || (GetSlotFlags(slot_id) & SLOT_FORWARDED) == 0) {
+    return INVALID_RID;
+  }
+  page_id_t page_id;
+  slot_id_t slot;
+  const char *tuple = data_ + GetSlotEntry(slot_id).first;
+  memcpy(&page_id, tuple, sizeof(page_id));
+  memcpy(&slot, tuple + sizeof(page_id), sizeof(slot));
+  return {page_id, slot};
+}
+
+auto PageHandle::IsMovedSlot(size_t slot_id) const -> bool
+{
+  return storage_model_ == SLOTTED_MODEL && (GetSlotFlags(slot_id) & SLOT_MOVED) != 0;
+}
+
+void PageHandle::WriteForward(size_t slot_id, const RID &rid)
+{
+  NJUDB_ASSERT(storage_model_ == SLOTTED_MODEL, "only slotted tuples are moved");
+  NJUDB_ASSERT(BitMap::GetBit(bitmap_, slot_id) == true, "slot is empty");
+  // every tuple takes at least the size of a forward, so it is written in place
+  auto [offset, size] = GetSlotEntry(slot_id);
+  NJUDB_ASSERT(size >= SLOTTED_FORWARD_SIZE && (GetSlotFlags(slot_id) & SLOT_MOVED) == 0, "slot cannot be forwarded");
+  auto page_id = rid.PageID();
+  auto slot    = rid.SlotID();
+  memcpy(data_ + offset, &page_id, sizeof(page_id));
+  memcpy(data_ + offset + sizeof(page_id), &slot, sizeof(slot));
+  SetSlotEntry(slot_id, offset, static_cast<uint16_t>(SLOTTED_FORWARD_SIZE), SLOT_FORWARDED);
+  SetSlottedField(
+      SLOTTED_LIVE_BYTES, static_cast<uint16_t>(GetSlottedField(SLOTTED_LIVE_BYTES) - size + SLOTTED_FORWARD_SIZE));
+}
+
+void PageHandle::MarkMoved(size_t slot_id)
+{
+  NJUDB_ASSERT(storage_model_ == SLOTTED_MODEL, "only slotted tuples are moved");
+  auto [offset, size] = GetSlotEntry(slot_id);
+  SetSlotEntry(slot_id, offset, size, SLOT_MOVED);
+}
+
+auto PageHandle::ReadChunk(const RecordSchema *chunk_schema) const -> ChunkUptr
+{
+  if (storage_model_ != PAX_MODEL) {
+    NJUDB_THROW(NJUDB_EXCEPTION_EMPTY, "");
+  }
+  return ReadPAXChunk(chunk_schema);
+}
+
+void PageHandle::WriteNArySlot(size_t slot_id, const char *null_map, const char *data)
+{
   // a record consists of null map and data
   size_t rec_full_size = tab_hdr_->nullmap_size_ + tab_hdr_->rec_size_;
   memcpy(slots_mem_ + slot_id * rec_full_size, null_map, tab_hdr_->nullmap_size_);
   memcpy(slots_mem_ + slot_id * rec_full_size + tab_hdr_->nullmap_size_, data, tab_hdr_->rec_size_);
 }
 
-void NAryPageHandle::ReadSlot(size_t slot_id, char *null_map, char *data)
+void PageHandle::ReadNArySlot(size_t slot_id, char *null_map, char *data) const
 {
-  NJUDB_ASSERT(slot_id < tab_hdr_->rec_per_page_, "slot_id out of range");
-  NJUDB_ASSERT(BitMap::GetBit(bitmap_, slot_id) == true, "slot is empty");
   size_t rec_full_size = tab_hdr_->nullmap_size_ + tab_hdr_->rec_size_;
   memcpy(null_map, slots_mem_ + slot_id * rec_full_size, tab_hdr_->nullmap_size_);
   memcpy(data, slots_mem_ + slot_id * rec_full_size + tab_hdr_->nullmap_size_, tab_hdr_->rec_size_);
 }
 
-PAXPageHandle::PAXPageHandle(
-    const TableHeader *tab_hdr, Page *page, const RecordSchema *schema, const std::vector<size_t> &offsets)
-    : PageHandle(tab_hdr, page, page->GetData() + PAGE_HEADER_SIZE,
-          page->GetData() + PAGE_HEADER_SIZE + tab_hdr->bitmap_size_),
-      schema_(schema),
-      offsets_(offsets)
-{}
-
-PAXPageHandle::~PAXPageHandle() = default;
-
 // slot memery
 // | nullmap_1, nullmap_2, ... , nullmap_n|
 // | field_1_1, field_1_2, ... , field_1_n |
 // | field_2_1, field_2_2, ... , field_2_n |
 // ...
 // | field_m_1, field_m_2, ... , field_m_n |
-void PAXPageHandle::WriteSlot(size_t slot_id, const char *null_map, const char *data, bool update)
+void PageHandle::WritePAXSlot(size_t slot_id, const char *null_map, const char *data)
 {
-  NJUDB_ASSERT(slot_id < tab_hdr_->rec_per_page_, "slot_id out of range");
-  NJUDB_ASSERT(BitMap::GetBit(bitmap_, slot_id) == update, fmt::format("update: {}", update));
-  
   char* nullmap_base = slots_mem_;
   memcpy(nullmap_base + slot_id * tab_hdr_->nullmap_size_, null_map, tab_hdr_->nullmap_size_);
   char* field_base = slots_mem_ + (tab_hdr_->nullmap_size_ * tab_hdr_->rec_per_page_);
   
   for (size_t i = 0; i < schema_->GetFieldCount(); ++i) {
     const auto& field = schema_->GetFieldAt(i);
-    size_t col_offset = offsets_[i]; // Offset of this column block
+    size_t col_offset = (*offsets_)[i]; // Offset of this column block
     size_t field_size = field.field_.field_size_;
     char* target_addr = field_base + col_offset + (slot_id * field_size);
     size_t src_offset = schema_->GetFieldOffset(i);
@@ -97,10 +210,8 @@ void PAXPageHandle::WriteSlot(size_t slot_id, const char *null_map, const char *
   }
 }
 
-void PAXPageHandle::ReadSlot(size_t slot_id, char *null_map, char *data) {
-  NJUDB_ASSERT(slot_id < tab_hdr_->rec_per_page_, "slot_id out of range");
-  NJUDB_ASSERT(BitMap::GetBit(bitmap_, slot_id) == true, "slot is empty");
-  
+void PageHandle::ReadPAXSlot(size_t slot_id, char *null_map, char *data) const
+{
   char* nullmap_base = slots_mem_;
   memcpy(null_map, nullmap_base + slot_id * tab_hdr_->nullmap_size_, tab_hdr_->nullmap_size_);
   
@@ -108,7 +219,7 @@ void PAXPageHandle::ReadSlot(size_t slot_id, char *null_map, char *data) {
   
   for (size_t i = 0; i < schema_->GetFieldCount(); ++i) {
     const auto& field = schema_->GetFieldAt(i);
-    size_t col_offset = offsets_[i];
+    size_t col_offset = (*offsets_)[i];
     size_t field_size = field.field_.field_size_;
     
     char* src_addr = field_base + col_offset + (slot_id * field_size);
@@ -118,7 +229,7 @@ void PAXPageHandle::ReadSlot(size_t slot_id, char *null_map, char *data) {
   }
 }
 
-auto PAXPageHandle::ReadChunk(const RecordSchema *chunk_schema) -> ChunkUptr
+auto PageHandle::ReadPAXChunk(const RecordSchema *chunk_schema) const -> ChunkUptr
 {
   std::vector<ArrayValueSptr> col_arrs;
   col_arrs.reserve(chunk_schema->GetFieldCount());
@@ -131,18 +242,14 @@ auto PAXPageHandle::ReadChunk(const RecordSchema *chunk_schema) -> ChunkUptr
     size_t orig_idx = schema_->GetRTFieldIndex(target_field);
     NJUDB_ASSERT(orig_idx != schema_->GetFieldCount(), "Field not found in schema");
     
-    size_t col_offset = offsets_[orig_idx];
+    size_t col_offset = (*offsets_)[orig_idx];
     size_t field_size = target_field.field_.field_size_;
     char* col_data_start = field_base + col_offset;
     
     std::vector<ValueSptr> values;
-    values.reserve(tab_hdr_->rec_per_page_); // upper bound
+    values.reserve(BitMap::CountSet(bitmap_, tab_hdr_->rec_per_page_));
     
-    for (size_t slot_id = 0; slot_id < tab_hdr_->rec_per_page_; ++slot_id) {
-       if (!BitMap::GetBit(bitmap_, slot_id)) {
-         continue; 
-       }
-       
+    BitMap::ForEachSet(bitmap_, tab_hdr_->rec_per_page_, [&](size_t slot_id) {
        char* slot_nullmap = nullmap_base + slot_id * tab_hdr_->nullmap_size_;
        bool is_null = BitMap::GetBit(slot_nullmap, orig_idx);
        
@@ -152,11 +259,198 @@ auto PAXPageHandle::ReadChunk(const RecordSchema *chunk_schema) -> ChunkUptr
          char* val_ptr = col_data_start + (slot_id * field_size);
          values.push_back(ValueFactory::CreateValue(target_field.field_.field_type_, val_ptr, field_size));
        }
-    }
+    });
     
     col_arrs.push_back(std::make_shared<ArrayValue>(values));
   }
   
   return std::make_unique<Chunk>(chunk_schema, std::move(col_arrs));
 }
+
+void PageHandle::WriteSlottedSlot(size_t slot_id, const char *null_map, const char *data, bool update)
+{
+  auto size     = GetSlottedTupleSize(data);
+  auto slot_num = GetSlottedField(SLOTTED_SLOT_NUM);
+  auto live     = GetSlottedField(SLOTTED_LIVE_BYTES);
+
+  uint16_t offset = 0;
+  uint16_t old    = 0;
+  // a moved record stays moved, a record written over a forward is back in its home slot
+  uint16_t flags  = 0;
+  if (update) {
+    std::tie(offset, old) = GetSlotEntry(slot_id);
+    flags                 = GetSlotFlags(slot_id) & SLOT_MOVED;
+  }
+  if (size > old) {
+    // check before touching the page
+    if (!SlottedFits(slot_id, size, update)) {
+      NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("record of {} bytes does not fit in its page", size));
+    }
+    size_t new_slots = slot_id < slot_num ? 0 : slot_id + 1 - slot_num;
+    size_t dir_end   = GetSlottedDirectoryEnd() + new_slots * SLOT_ENTRY_SIZE;
+    // release the old tuple first, compacting the page may need its space
+    if (update) {
+      SetSlotEntry(slot_id, 0, 0);
+      live -= old;
+      SetSlottedField(SLOTTED_LIVE_BYTES, live);
+    }
+    // compact before the directory grows, its new entry may overlap the lowest tuple
+    if (PAGE_SIZE - GetSlottedField(SLOTTED_TUPLE_BYTES) < dir_end + size) {
+      CompactSlotted();
+    }
+    if (new_slots > 0) {
+      SetSlottedField(SLOTTED_SLOT_NUM, static_cast<uint16_t>(slot_id + 1));
+      for (; slot_num <= slot_id; ++slot_num) {
+        SetSlotEntry(slot_num, 0, 0);
+      }
+    }
+    auto tuple_bytes = static_cast<uint16_t>(GetSlottedField(SLOTTED_TUPLE_BYTES) + size);
+    SetSlottedField(SLOTTED_TUPLE_BYTES, tuple_bytes);
+    offset = static_cast<uint16_t>(PAGE_SIZE - tuple_bytes);
+    old    = 0;
+  }
+  SetSlotEntry(slot_id, offset, static_cast<uint16_t>(size), flags);
+  SetSlottedField(SLOTTED_LIVE_BYTES, static_cast<uint16_t>(live - old + size));
+
+  char *tuple = data_ + offset;
+  memcpy(tuple, null_map, tab_hdr_->nullmap_size_);
+  tuple += tab_hdr_->nullmap_size_;
+  for (size_t i = 0; i < schema_->GetFieldCount(); ++i) {
+    const auto &field = schema_->GetFieldAt(i).field_;
+    const char *src   = data + schema_->GetFieldOffset(i);
+    if (field.field_type_ == TYPE_VARCHAR) {
+      auto len = static_cast<uint16_t>(strnlen(src, field.field_size_));
+      memcpy(tuple, &len, sizeof(len));
+      memcpy(tuple + sizeof(len), src, len);
+      tuple += sizeof(len) + len;
+    } else {
+      memcpy(tuple, src, field.field_size_);
+      tuple += field.field_size_;
+    }
+  }
+}
+
+void PageHandle::ReadSlottedSlot(size_t slot_id, char *null_map, char *data) const
+{
+  auto [offset, size] = GetSlotEntry(slot_id);
+  NJUDB_ASSERT(size > 0, "slot has no tuple");
+  NJUDB_ASSERT((GetSlotFlags(slot_id) & SLOT_FORWARDED) == 0, "record of the slot is moved");
+  const char *tuple = data_ + offset;
+  memcpy(null_map, tuple, tab_hdr_->nullmap_size_);
+  tuple += tab_hdr_->nullmap_size_;
+  for (size_t i = 0; i < schema_->GetFieldCount(); ++i) {
+    const auto &field = schema_->GetFieldAt(i).field_;
+    char       *dst   = data + schema_->GetFieldOffset(i);
+    if (field.field_type_ == TYPE_VARCHAR) {
+      uint16_t len;
+      memcpy(&len, tuple, sizeof(len));
+      memcpy(dst, tuple + sizeof(len), len);
+      memset(dst + len, 0, field.field_size_ - len);
+      tuple += sizeof(len) + len;
+    } else {
+      memcpy(dst, tuple, field.field_size_);
+      tuple += field.field_size_;
+    }
+  }
+}
+
+void PageHandle::DeleteSlottedSlot(size_t slot_id)
+{
+  auto [offset, size] = GetSlotEntry(slot_id);
+  SetSlotEntry(slot_id, 0, 0);
+  SetSlottedField(SLOTTED_LIVE_BYTES, GetSlottedField(SLOTTED_LIVE_BYTES) - size);
+  // trailing empty slots give their directory entries back
+  auto slot_num = GetSlottedField(SLOTTED_SLOT_NUM);
+  while (slot_num > 0 && GetSlotEntry(slot_num - 1).second == 0) {
+    slot_num--;
+  }
+  SetSlottedField(SLOTTED_SLOT_NUM, slot_num);
+}
+
+void PageHandle::CompactSlotted()
+{
+  auto slot_num = GetSlottedField(SLOTTED_SLOT_NUM);
+  // slot ids of the tuples in use, the one closest to the end of the page first
+  std::vector<size_t> slots;
+  for (size_t slot_id = 0; slot_id < slot_num; ++slot_id) {
+    if (GetSlotEntry(slot_id).second > 0) {
+      slots.push_back(slot_id);
+    }
+  }
+  std::sort(slots.begin(), slots.end(), [this](size_t a, size_t b) { return GetSlotEntry(a) > GetSlotEntry(b); });
+  // every tuple moves towards the end of the page, so it never overwrites a tuple not moved yet
+  size_t end = PAGE_SIZE;
+  for (auto slot_id : slots) {
+    auto [offset, size] = GetSlotEntry(slot_id);
+    end -= size;
+    memmove(data_ + end, data_ + offset, size);
+    SetSlotEntry(slot_id, static_cast<uint16_t>(end), size, GetSlotFlags(slot_id));
+  }
+  SetSlottedField(SLOTTED_TUPLE_BYTES, static_cast<uint16_t>(PAGE_SIZE - end));
+}
+
+auto PageHandle::GetSlottedTupleSize(const char *data) const -> size_t
+{
+  size_t size = tab_hdr_->nullmap_size_;
+  for (size_t i = 0; i < schema_->GetFieldCount(); ++i) {
+    const auto &field = schema_->GetFieldAt(i).field_;
+    if (field.field_type_ == TYPE_VARCHAR) {
+      size += sizeof(uint16_t) + strnlen(data + schema_->GetFieldOffset(i), field.field_size_);
+    } else {
+      size += field.field_size_;
+    }
+  }
+  // leave room to replace the tuple by a forward in place
+  return std::max(size, SLOTTED_FORWARD_SIZE);
+}
+
+auto PageHandle::SlottedFits(size_t slot_id, size_t size, bool update) const -> bool
+{
+  uint16_t old = update ? GetSlotEntry(slot_id).second : 0;
+  if (size <= old) {
+    return true;
+  }
+  // the directory grows up to the slot if it has not been used before
+  size_t slot_num  = GetSlottedField(SLOTTED_SLOT_NUM);
+  size_t new_slots = slot_id < slot_num ? 0 : slot_id + 1 - slot_num;
+  size_t dir_end   = GetSlottedDirectoryEnd() + new_slots * SLOT_ENTRY_SIZE;
+  return dir_end + GetSlottedField(SLOTTED_LIVE_BYTES) - old + size <= PAGE_SIZE;
+}
+
+auto PageHandle::GetSlottedDirectoryEnd() const -> size_t
+{
+  return slots_mem_ - data_ + SLOTTED_HEADER_SIZE + GetSlottedField(SLOTTED_SLOT_NUM) * SLOT_ENTRY_SIZE;
+}
+
+auto PageHandle::GetSlotEntry(size_t slot_id) const -> std::pair<uint16_t, uint16_t>
+{
+  uint16_t entry[2];
+  memcpy(entry, slots_mem_ + SLOTTED_HEADER_SIZE + slot_id * SLOT_ENTRY_SIZE, SLOT_ENTRY_SIZE);
+  return {entry[0], static_cast<uint16_t>(entry[1] & SLOT_SIZE_MASK)};
+}
+
+auto PageHandle::GetSlotFlags(size_t slot_id) const -> uint16_t
+{
+  uint16_t size;
+  memcpy(&size, slots_mem_ + SLOTTED_HEADER_SIZE + slot_id * SLOT_ENTRY_SIZE + sizeof(uint16_t), sizeof(size));
+  return size & ~SLOT_SIZE_MASK;
+}
+
+void PageHandle::SetSlotEntry(size_t slot_id, uint16_t offset, uint16_t size, uint16_t flags)
+{
+  uint16_t entry[2] = {offset, static_cast<uint16_t>(size | flags)};
+  memcpy(slots_mem_ + SLOTTED_HEADER_SIZE + slot_id * SLOT_ENTRY_SIZE, entry, SLOT_ENTRY_SIZE);
+}
+
+auto PageHandle::GetSlottedField(size_t index) const -> uint16_t
+{
+  uint16_t value;
+  memcpy(&value, slots_mem_ + index * sizeof(uint16_t), sizeof(value));
+  return value;
+}
+
+void PageHandle::SetSlottedField(size_t index, uint16_t value)
+{
+  memcpy(slots_mem_ + index * sizeof(uint16_t), &value, sizeof(value));
+}
 }  // namespace njudb
@@ -22,17 +22,53 @@
 #ifndef NJUDB_PAGE_HANDLE_H
 #define NJUDB_PAGE_HANDLE_H
 
+#include <utility>
+
 #include "common/meta.h"
 #include "common/page.h"
 #include "common/record.h"
 
 namespace njudb {
+
+/**
+ * A view of the slots of a table page in the layout of the storage model of the table. It is a plain value built on
+ * the stack for every access and neither pins nor owns the page, the caller keeps the page pinned with a page guard
+ * while the handle is used.
+ *
+ * test pax
+ * create table pax_test (id int, f_1 float, f_2 float, i_1 int, i_2 int, s_1 char(10), s_2 char(14)) storage=pax;
+ * insert into pax_test values (1, 1.1, 2.2, 3, 4, 'hello', 'world');
+ * insert into pax_test values (2, 2.1, 3.2, 4, 5, 'world', 'hello');
+ * insert into pax_test values (3, 3.1, 4.2, 5, 6, 'a', 'b');
+ * insert into pax_test values (4, 4.1, 5.2, 6, 7, 'b', 'a');
+ * insert into pax_test values (5, , 6.2, 7, , , 'd');
+ * insert into pax_test values (, 6.1, , 8, 9, 'c', );
+ *
+ * The slotted model stores variable-length tuples, a varchar field only takes its length and its actual characters:
+ * | page header | bitmap | slot num | tuple bytes | live bytes | slot directory | free space | ... | tuple 0 |
+ * The slot directory holds the offset and the size of the tuple of each slot and grows towards the end of the page,
+ * the tuples are stored backwards from the end of the page. Tuple bytes counts the bytes from the lowest tuple to the
+ * end of the page, live bytes only the tuples in use, the gaps left by deleted or moved tuples are reclaimed by
+ * compacting the page when a new tuple does not fit otherwise. A record that outgrows its page is moved to another
+ * page, its home slot keeps the rid of the new place (a forward) so that the rid of the record never changes, and the
+ * moved tuple is marked so that scans only see the record through its home slot.
+ *
+ * test slotted
+ * create table slotted_test (id int, name varchar(50), city char(10)) storage=slotted;
+ * insert into slotted_test values (1, 'bob', 'nanjing');
+ */
 class PageHandle
 {
 public:
   PageHandle() = delete;
 
-  PageHandle(const TableHeader *tab_hdr, Page *page, char *bit_map, char *slots_mem);
+  /**
+   * @param data data of the page
+   * @param schema is used by the PAX and the slotted model, offsets only by the PAX model, offsets are the offsets of
+   * the columns in the slot memory, see TableHandle
+   */
+  PageHandle(const TableHeader *tab_hdr, char *data, StorageModel storage_model, const RecordSchema *schema = nullptr,
+      const std::vector<size_t> *offsets = nullptr);
 
   /**
    * Write a record to the slot
@@ -41,69 +77,114 @@ public:
    * @param data
    * @param update indicate whether there is already a record in the slot, if true, it is an update operation
    */
-  virtual void WriteSlot(size_t slot_id, const char *null_map, const char *data, bool update);
+  void WriteSlot(size_t slot_id, const char *null_map, const char *data, bool update);
+
+  void ReadSlot(size_t slot_id, char *null_map, char *data) const;
+
+  /**
+   * Release the storage of the record in the slot, the caller clears the bit of the slot in the bitmap
+   * @param slot_id
+   */
+  void DeleteSlot(size_t slot_id);
 
-  virtual void ReadSlot(size_t slot_id, char *null_map, char *data);
+  /**
+   * @return the number of records that can still be inserted into the page, for a slotted page it assumes every
+   * record has the largest possible size
+   */
+  [[nodiscard]] auto GetFreeSlotNum() const -> size_t;
 
-  virtual auto ReadChunk(const RecordSchema *chunk_schema) -> ChunkUptr;
+  /**
+   * @return the size of the smallest tuple of the schema in a slotted page, i.e. with all varchar fields empty
+   */
+  static auto GetMinSlottedTupleSize(const RecordSchema &schema) -> size_t;
 
-  virtual ~PageHandle() = default;
+  /**
+   * @return whether the record can be written to the slot, always true for the fixed-length models
+   */
+  [[nodiscard]] auto HasRoom(size_t slot_id, const char *data, bool update) const -> bool;
 
-  [[nodiscard]] auto GetPage() -> Page * { return page_; }
+  /**
+   * @return the rid the record of the slot was moved to, INVALID_RID if the slot holds the record itself
+   */
+  [[nodiscard]] auto GetForward(size_t slot_id) const -> RID;
 
-  [[nodiscard]] auto GetBitmap() -> char * { return bitmap_; }
+  /**
+   * @return whether the slot holds a record moved from its home slot on another page
+   */
+  [[nodiscard]] auto IsMovedSlot(size_t slot_id) const -> bool;
 
-protected:
-  const TableHeader *tab_hdr_{nullptr};
-  Page              *page_{nullptr};
-  char              *bitmap_;
-  char              *slots_mem_{nullptr};
-};
+  /**
+   * Replace the tuple of a slotted slot in place by the rid its record was moved to
+   */
+  void WriteForward(size_t slot_id, const RID &rid);
 
-class NAryPageHandle : public PageHandle
-{
-public:
-  NAryPageHandle() = delete;
+  /**
+   * Mark the tuple just written to a slotted slot as moved from its home slot
+   */
+  void MarkMoved(size_t slot_id);
 
-  NAryPageHandle(const TableHeader *tab_hdr, Page *page);
+  auto ReadChunk(const RecordSchema *chunk_schema) const -> ChunkUptr;
 
-  void WriteSlot(size_t slot_id, const char *null_map, const char *data, bool update) override;
+  [[nodiscard]] auto GetBitmap() const -> char * { return bitmap_; }
 
-  void ReadSlot(size_t slot_id, char *null_map, char *data) override;
-};
+private:
+  void WriteNArySlot(size_t slot_id, const char *null_map, const char *data);
 
-/**
- * test pax
- * create table pax_test (id int, f_1 float, f_2 float, i_1 int, i_2 int, s_1 char(10), s_2 char(14)) storage=pax;
- * insert into pax_test values (1, 1.1, 2.2, 3, 4, 'hello', 'world');
- * insert into pax_test values (2, 2.1, 3.2, 4, 5, 'world', 'hello');
- * insert into pax_test values (3, 3.1, 4.2, 5, 6, 'a', 'b');
- * insert into pax_test values (4, 4.1, 5.2, 6, 7, 'b', 'a');
- * insert into pax_test values (5, , 6.2, 7, , , 'd');
- * insert into pax_test values (, 6.1, , 8, 9, 'c', );
- */
+  void ReadNArySlot(size_t slot_id, char *null_map, char *data) const;
 
-class PAXPageHandle : public PageHandle
-{
-public:
-  PAXPageHandle() = delete;
+  void WritePAXSlot(size_t slot_id, const char *null_map, const char *data);
+
+  void ReadPAXSlot(size_t slot_id, char *null_map, char *data) const;
 
-  PAXPageHandle(const TableHeader *tab_hdr, Page *page, const RecordSchema *schema, const std::vector<size_t> &offsets);
+  auto ReadPAXChunk(const RecordSchema *chunk_schema) const -> ChunkUptr;
 
-  ~PAXPageHandle() override;
+  /**
+   * Write the record to the slot, the tuple of an update stays in place if it does not grow. Throws
+   * NJUDB_UNSUPPORTED_OP if the record does not fit in the page, the page is left unchanged, see HasRoom
+   */
+  void WriteSlottedSlot(size_t slot_id, const char *null_map, const char *data, bool update);
 
-  void WriteSlot(size_t slot_id, const char *null_map, const char *data, bool update) override;
+  void ReadSlottedSlot(size_t slot_id, char *null_map, char *data) const;
 
-  void ReadSlot(size_t slot_id, char *null_map, char *data) override;
+  void DeleteSlottedSlot(size_t slot_id);
 
-  auto ReadChunk(const RecordSchema *chunk_schema) -> ChunkUptr override;
+  /**
+   * Move the tuples in use to the end of the page so that the free space is contiguous
+   */
+  void CompactSlotted();
 
-private:
-  const RecordSchema        *schema_;
-  const std::vector<size_t> &offsets_;
+  /**
+   * @return the size of the record as a slotted tuple, the null map, the fixed-length fields and the length and the
+   * characters of the varchar fields, at least the size of a forward
+   */
+  [[nodiscard]] auto GetSlottedTupleSize(const char *data) const -> size_t;
+
+  [[nodiscard]] auto SlottedFits(size_t slot_id, size_t size, bool update) const -> bool;
+
+  /**
+   * @return the bytes taken by the page header, the bitmap, the slotted header and the slot directory
+   */
+  [[nodiscard]] auto GetSlottedDirectoryEnd() const -> size_t;
+
+  [[nodiscard]] auto GetSlotEntry(size_t slot_id) const -> std::pair<uint16_t, uint16_t>;
+
+  [[nodiscard]] auto GetSlotFlags(size_t slot_id) const -> uint16_t;
+
+  void SetSlotEntry(size_t slot_id, uint16_t offset, uint16_t size, uint16_t flags = 0);
+
+  [[nodiscard]] auto GetSlottedField(size_t index) const -> uint16_t;
+
+  void SetSlottedField(size_t index, uint16_t value);
+
+  char                      *data_{nullptr};
+  const TableHeader         *tab_hdr_{nullptr};
+  char                      *bitmap_{nullptr};
+  char                      *slots_mem_{nullptr};
+  StorageModel               storage_model_;
+  const RecordSchema        *schema_{nullptr};
+  const std::vector<size_t> *offsets_{nullptr};
 };
 
-DEFINE_UNIQUE_PTR(PageHandle);
 }  // namespace njudb
 
 #endif  // NJUDB_PAGE_HANDLE_H
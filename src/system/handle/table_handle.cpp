@@ -20,17 +20,50 @@
 //
 
 #include "table_handle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include <sys/mman.h>
+
 namespace njudb {
 
+/**
+ * @return the first slot from slot_id on whose record is read through it, a moved tuple is read through its home slot
+ */
+static auto FindRecordSlot(const PageHandle &page_handle, size_t rec_per_page, size_t slot_id) -> size_t
+{
+  slot_id = BitMap::FindFirst(page_handle.GetBitmap(), rec_per_page, slot_id, true);
+  while (slot_id != rec_per_page && page_handle.IsMovedSlot(slot_id)) {
+    slot_id = BitMap::FindFirst(page_handle.GetBitmap(), rec_per_page, slot_id + 1, true);
+  }
+  return slot_id;
+}
+
 TableHandle::TableHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, table_id_t table_id,
-    TableHeader &hdr, RecordSchemaUptr &schema, StorageModel storage_model)
+    TableHeader &hdr, RecordSchemaUptr &schema, StorageModel storage_model, TableAccessMode access_mode)
     : tab_hdr_(hdr),
       table_id_(table_id),
       disk_manager_(disk_manager),
       buffer_pool_manager_(buffer_pool_manager),
       schema_(std::move(schema)),
-      storage_model_(storage_model)
+      storage_model_(storage_model),
+      access_mode_(access_mode)
 {
+  if (access_mode_ == TABLE_ACCESS_MMAP) {
+    mapping_ = disk_manager_->MapFile(table_id_);
+    if (mapping_->GetPageNum() < tab_hdr_.page_num_) {
+      NJUDB_THROW(NJUDB_FILE_READ_ERROR,
+          fmt::format("table has {} pages but its file only {}", tab_hdr_.page_num_, mapping_->GetPageNum()));
+    }
+    mapping_verified_ = std::vector<std::atomic<bool>>(mapping_->GetPageNum());
+    // point lookups should not fault in the pages around the one they read, scans ask for their pages explicitly
+    mapping_->Advise(MADV_RANDOM);
+  }
+  // the free space map is not persisted, the pages already in the table enter it when CreatePage needs room
+  unmapped_end_ = static_cast<page_id_t>(tab_hdr_.page_num_);
   // set table id for table handle;
   schema_->SetTableId(table_id_);
   if (storage_model_ == PAX_MODEL) {
@@ -43,144 +76,314 @@ TableHandle::TableHandle(DiskManager *disk_manager, BufferPoolManager *buffer_po
   }
 }
 
-auto TableHandle::GetRecord(const RID &rid) -> RecordUptr
+auto TableHandle::GetRecord(const RID &rid, BufferAccessStrategy *strategy) -> RecordUptr
 {
-  auto nullmap = std::make_unique<char[]>(tab_hdr_.nullmap_size_);
-  auto data    = std::make_unique<char[]>(tab_hdr_.rec_size_);
-  
-  PageHandleUptr page_handle = FetchPageHandle(rid.PageID());
-  
-  if (!BitMap::GetBit(page_handle->GetBitmap(), rid.SlotID())) {
-    buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), false);
-    NJUDB_THROW(NJUDB_RECORD_MISS, "Record not found");
+  auto record = std::make_unique<Record>(schema_.get());
+  GetRecord(rid, *record, strategy);
+  return record;
+}
+
+void TableHandle::GetRecord(const RID &rid, Record &record, BufferAccessStrategy *strategy)
+{
+  NJUDB_ASSERT(record.GetSchema()->GetRecordLength() == tab_hdr_.rec_size_, "record of another schema");
+  RID forward;
+  {
+    auto page_guard  = FetchPageRead(rid.PageID(), strategy);
+    auto page_handle = WrapPageHandle(page_guard);
+
+    if (!BitMap::GetBit(page_handle.GetBitmap(), rid.SlotID())) {
+      NJUDB_THROW(NJUDB_RECORD_MISS, "Record not found");
+    }
+
+    forward = page_handle.GetForward(rid.SlotID());
+    if (forward == INVALID_RID) {
+      page_handle.ReadSlot(rid.SlotID(), record.GetMutableNullMap(), record.GetMutableData());
+      record.SetRID(rid);
+      return;
+    }
+  }
+  // the record was moved to another page, which is fetched after the home page is released
+  GetRecord(forward, record, strategy);
+  record.SetRID(rid);
+}
+
+void TableHandle::GetRecords(
+    std::span<const RID> rids, std::vector<RecordUptr> &records, BufferAccessStrategy *strategy)
+{
+  records.resize(rids.size());
+  std::vector<size_t> order(rids.size());
+  for (size_t i = 0; i < rids.size(); ++i) {
+    order[i] = i;
+    if (records[i] == nullptr) {
+      records[i] = std::make_unique<Record>(schema_.get());
+    }
+  }
+  std::sort(order.begin(), order.end(), [&rids](size_t a, size_t b) {
+    return rids[a].PageID() != rids[b].PageID() ? rids[a].PageID() < rids[b].PageID()
+                                                : rids[a].SlotID() < rids[b].SlotID();
+  });
+
+  // one fetch per run of rids on the same page, moved records are read after their home pages are released
+  std::vector<std::pair<size_t, RID>> moved;
+  for (size_t begin = 0; begin < order.size();) {
+    page_id_t pid         = rids[order[begin]].PageID();
+    auto      page_guard  = FetchPageRead(pid, strategy);
+    auto      page_handle = WrapPageHandle(page_guard);
+    for (; begin < order.size() && rids[order[begin]].PageID() == pid; ++begin) {
+      const auto &rid    = rids[order[begin]];
+      auto       &record = *records[order[begin]];
+      if (!BitMap::GetBit(page_handle.GetBitmap(), rid.SlotID())) {
+        NJUDB_THROW(NJUDB_RECORD_MISS, "Record not found");
+      }
+      if (auto forward = page_handle.GetForward(rid.SlotID()); forward != INVALID_RID) {
+        moved.emplace_back(order[begin], forward);
+        continue;
+      }
+      page_handle.ReadSlot(rid.SlotID(), record.GetMutableNullMap(), record.GetMutableData());
+      record.SetRID(rid);
+    }
+  }
+  for (const auto &[i, forward] : moved) {
+    GetRecord(forward, *records[i], strategy);
+    records[i]->SetRID(rids[i]);
   }
-  
-  page_handle->ReadSlot(rid.SlotID(), nullmap.get(), data.get());
-  
-  buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), false);
-  
-  return std::make_unique<Record>(schema_.get(), nullmap.get(), data.get(), rid);
 }
 
-auto TableHandle::GetChunk(page_id_t pid, const RecordSchema *chunk_schema) -> ChunkUptr { 
-  PageHandleUptr page_handle = FetchPageHandle(pid);
-  auto chunk = page_handle->ReadChunk(chunk_schema);
-  buffer_pool_manager_->UnpinPage(table_id_, pid, false);
-  return chunk;
+auto TableHandle::GetChunk(page_id_t pid, const RecordSchema *chunk_schema, BufferAccessStrategy *strategy) -> ChunkUptr
+{
+  auto page_guard = FetchPageRead(pid, strategy);
+  return WrapPageHandle(page_guard).ReadChunk(chunk_schema);
 }
 
 auto TableHandle::InsertRecord(const Record &record) -> RID { 
-  PageHandleUptr page_handle = CreatePageHandle();
-  
-  size_t slot_id = BitMap::FindFirst(page_handle->GetBitmap(), tab_hdr_.rec_per_page_, 0, false);
-  
-  page_handle->WriteSlot(slot_id, record.GetNullMap(), record.GetData(), false);
+  CheckWritable();
+  return InsertTuple(record, false);
+}
+
+auto TableHandle::InsertTuple(const Record &record, bool moved) -> RID
+{
+  auto page_guard  = CreatePage();
+  auto page_handle = WrapPageHandle(page_guard.GetMutableData());
+  auto page        = page_guard.GetPage();
   
-  BitMap::SetBit(page_handle->GetBitmap(), slot_id, true);
-  page_handle->GetPage()->SetRecordNum(page_handle->GetPage()->GetRecordNum() + 1);
+  size_t slot_id = BitMap::FindFirst(page_handle.GetBitmap(), tab_hdr_.rec_per_page_, 0, false);
   
-  if (page_handle->GetPage()->GetRecordNum() == tab_hdr_.rec_per_page_) {
-    tab_hdr_.first_free_page_ = page_handle->GetPage()->GetNextFreePageId();
-    page_handle->GetPage()->SetNextFreePageId(INVALID_PAGE_ID);
+  page_handle.WriteSlot(slot_id, record.GetNullMap(), record.GetData(), false);
+  if (moved) {
+    page_handle.MarkMoved(slot_id);
   }
   
-  RID rid(page_handle->GetPage()->GetPageId(), static_cast<slot_id_t>(slot_id));
-  buffer_pool_manager_->UnpinPage(table_id_, page_handle->GetPage()->GetPageId(), true);
+  BitMap::SetBit(page_handle.GetBitmap(), slot_id, true);
+  page->SetRecordNum(page->GetRecordNum() + 1);
+  free_space_map_.Update(page->GetPageId(), page_handle.GetFreeSlotNum());
   
-  return rid;
+  return {page->GetPageId(), static_cast<slot_id_t>(slot_id)};
 }
 
 void TableHandle::InsertRecord(const RID &rid, const Record &record)
 {
+  CheckWritable();
   if (rid.PageID() == INVALID_PAGE_ID) {
     NJUDB_THROW(NJUDB_PAGE_MISS, fmt::format("Page: {}", rid.PageID()));
   }
   
-  PageHandleUptr page_handle = FetchPageHandle(rid.PageID());
+  auto page_guard  = FetchPageWrite(rid.PageID());
+  auto page_handle = WrapPageHandle(page_guard.GetMutableData());
+  auto page        = page_guard.GetPage();
   
-  if (BitMap::GetBit(page_handle->GetBitmap(), rid.SlotID())) {
-     buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), false);
+  if (BitMap::GetBit(page_handle.GetBitmap(), rid.SlotID())) {
+     page_guard.UnsetDirty();
      NJUDB_THROW(NJUDB_RECORD_EXISTS, "Record exists");
   }
   
-  page_handle->WriteSlot(rid.SlotID(), record.GetNullMap(), record.GetData(), false);
-  
-  BitMap::SetBit(page_handle->GetBitmap(), rid.SlotID(), true);
-  page_handle->GetPage()->SetRecordNum(page_handle->GetPage()->GetRecordNum() + 1);
+  page_handle.WriteSlot(rid.SlotID(), record.GetNullMap(), record.GetData(), false);
   
-  if (page_handle->GetPage()->GetRecordNum() == tab_hdr_.rec_per_page_ && tab_hdr_.first_free_page_ == rid.PageID()) {
-      tab_hdr_.first_free_page_ = page_handle->GetPage()->GetNextFreePageId();
-      page_handle->GetPage()->SetNextFreePageId(INVALID_PAGE_ID);
-  }
-  
-  buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), true);
+  BitMap::SetBit(page_handle.GetBitmap(), rid.SlotID(), true);
+  page->SetRecordNum(page->GetRecordNum() + 1);
+  free_space_map_.Update(rid.PageID(), page_handle.GetFreeSlotNum());
 }
 
 void TableHandle::DeleteRecord(const RID &rid) { 
-  PageHandleUptr page_handle = FetchPageHandle(rid.PageID());
-  
-  if (!BitMap::GetBit(page_handle->GetBitmap(), rid.SlotID())) {
-    buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), false);
-    NJUDB_THROW(NJUDB_RECORD_MISS, "Record missing");
+  CheckWritable();
+  RID forward;
+  {
+    auto page_guard  = FetchPageWrite(rid.PageID());
+    auto page_handle = WrapPageHandle(page_guard.GetMutableData());
+    auto page        = page_guard.GetPage();
+
+    if (!BitMap::GetBit(page_handle.GetBitmap(), rid.SlotID())) {
+      page_guard.UnsetDirty();
+      NJUDB_THROW(NJUDB_RECORD_MISS, "Record missing");
+    }
+
+    forward = page_handle.GetForward(rid.SlotID());
+    page_handle.DeleteSlot(rid.SlotID());
+    BitMap::SetBit(page_handle.GetBitmap(), rid.SlotID(), false);
+    page->SetRecordNum(page->GetRecordNum() - 1);
+    free_space_map_.Update(rid.PageID(), page_handle.GetFreeSlotNum());
   }
-  
-  BitMap::SetBit(page_handle->GetBitmap(), rid.SlotID(), false);
-  page_handle->GetPage()->SetRecordNum(page_handle->GetPage()->GetRecordNum() - 1);
-  
-  if (page_handle->GetPage()->GetRecordNum() == tab_hdr_.rec_per_page_ - 1) {
-      page_handle->GetPage()->SetNextFreePageId(tab_hdr_.first_free_page_);
-      tab_hdr_.first_free_page_ = rid.PageID();
+  // the tuple the record was moved to goes with it
+  if (forward != INVALID_RID) {
+    DeleteRecord(forward);
   }
-  
-  buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), true);
 }
 
 void TableHandle::UpdateRecord(const RID &rid, const Record &record) { 
-  PageHandleUptr page_handle = FetchPageHandle(rid.PageID());
-  
-  if (!BitMap::GetBit(page_handle->GetBitmap(), rid.SlotID())) {
-    buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), false);
-    NJUDB_THROW(NJUDB_RECORD_MISS, "Record missing");
+  CheckWritable();
+  RID  forward;
+  bool in_place;
+  {
+    auto page_guard  = FetchPageWrite(rid.PageID());
+    auto page_handle = WrapPageHandle(page_guard.GetMutableData());
+
+    if (!BitMap::GetBit(page_handle.GetBitmap(), rid.SlotID())) {
+      page_guard.UnsetDirty();
+      NJUDB_THROW(NJUDB_RECORD_MISS, "Record missing");
+    }
+
+    forward  = page_handle.GetForward(rid.SlotID());
+    in_place = page_handle.HasRoom(rid.SlotID(), record.GetData(), true);
+    if (in_place) {
+      page_handle.WriteSlot(rid.SlotID(), record.GetNullMap(), record.GetData(), true);
+      // a slotted tuple may have changed its size
+      if (storage_model_ == SLOTTED_MODEL) {
+        free_space_map_.Update(rid.PageID(), page_handle.GetFreeSlotNum());
+      }
+    } else {
+      page_guard.UnsetDirty();
+    }
+  }
+  if (in_place) {
+    // a moved record that fits in its home slot again is back there
+    if (forward != INVALID_RID) {
+      DeleteRecord(forward);
+    }
+    return;
+  }
+
+  // the record outgrew its home page, it stays where it was moved to if it still fits there
+  if (forward != INVALID_RID) {
+    auto page_guard  = FetchPageWrite(forward.PageID());
+    auto page_handle = WrapPageHandle(page_guard.GetMutableData());
+    if (page_handle.HasRoom(forward.SlotID(), record.GetData(), true)) {
+      page_handle.WriteSlot(forward.SlotID(), record.GetNullMap(), record.GetData(), true);
+      free_space_map_.Update(forward.PageID(), page_handle.GetFreeSlotNum());
+      return;
+    }
+    page_guard.UnsetDirty();
+  }
+  // otherwise it moves to a page with room and the home slot keeps its new rid, so that the rid of the record and the
+  // indexes on it stay valid. Only one page is latched at a time, scans skip the moved tuple until it is deleted
+  auto moved = InsertTuple(record, true);
+  {
+    auto page_guard  = FetchPageWrite(rid.PageID());
+    auto page_handle = WrapPageHandle(page_guard.GetMutableData());
+    page_handle.WriteForward(rid.SlotID(), moved);
+    free_space_map_.Update(rid.PageID(), page_handle.GetFreeSlotNum());
+  }
+  if (forward != INVALID_RID) {
+    DeleteRecord(forward);
   }
-  
-  page_handle->WriteSlot(rid.SlotID(), record.GetNullMap(), record.GetData(), true);
-  
-  buffer_pool_manager_->UnpinPage(table_id_, rid.PageID(), true);
 }
 
-auto TableHandle::FetchPageHandle(page_id_t page_id) -> PageHandleUptr
+auto TableHandle::FetchPageRead(page_id_t page_id, BufferAccessStrategy *strategy) -> ReadPageGuard
 {
-  auto page = buffer_pool_manager_->FetchPage(table_id_, page_id);
-  return WrapPageHandle(page);
+  if (mapping_ != nullptr) {
+    // bulk readers keep the kernel reading a window ahead of them
+    if (strategy != nullptr && (page_id == FILE_HEADER_PAGE_ID + 1 || page_id % READ_AHEAD_PAGES == 0)) {
+      mapping_->WillNeed(page_id, 2 * READ_AHEAD_PAGES);
+    }
+    // the mapped pages never change, each one is verified once
+    if (!mapping_verified_[page_id].load(std::memory_order_relaxed) &&
+        disk_manager_->IsPageChecksumVerified(table_id_)) {
+      if (!PageChecksumMatches(mapping_->GetPage(page_id))) {
+        NJUDB_THROW(NJUDB_PAGE_CORRUPTED, fmt::format("table: {}, page_id: {}", GetTableName(), page_id));
+      }
+      mapping_verified_[page_id].store(true, std::memory_order_relaxed);
+    }
+    return {table_id_, page_id, mapping_->GetPage(page_id)};
+  }
+  auto guard = buffer_pool_manager_->FetchPageRead(table_id_, page_id, strategy);
+  if (guard.GetPage() == nullptr) {
+    NJUDB_THROW(NJUDB_PAGE_MISS, fmt::format("table: {}, page_id: {}", GetTableName(), page_id));
+  }
+  return guard;
+}
+
+auto TableHandle::FetchPageWrite(page_id_t page_id) -> WritePageGuard
+{
+  auto guard = buffer_pool_manager_->FetchPageWrite(table_id_, page_id);
+  if (guard.GetPage() == nullptr) {
+    NJUDB_THROW(NJUDB_PAGE_MISS, fmt::format("table: {}, page_id: {}", GetTableName(), page_id));
+  }
+  return guard;
 }
 
-auto TableHandle::CreatePageHandle() -> PageHandleUptr
+void TableHandle::CheckWritable() const
 {
-  if (tab_hdr_.first_free_page_ == INVALID_PAGE_ID) {
-    return CreateNewPageHandle();
+  if (access_mode_ != TABLE_ACCESS_BUFFERED) {
+    NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("table {} is opened read-only", table_id_));
   }
-  auto page = buffer_pool_manager_->FetchPage(table_id_, tab_hdr_.first_free_page_);
-  return WrapPageHandle(page);
 }
 
-auto TableHandle::CreateNewPageHandle() -> PageHandleUptr
+auto TableHandle::CreatePage() -> WritePageGuard
 {
-  auto page_id = static_cast<page_id_t>(tab_hdr_.page_num_);
-  tab_hdr_.page_num_++;
-  auto page   = buffer_pool_manager_->FetchPage(table_id_, page_id);
-  auto pg_hdl = WrapPageHandle(page);
-  page->SetNextFreePageId(tab_hdr_.first_free_page_);
-  tab_hdr_.first_free_page_ = page_id;
-  return pg_hdl;
+  // threads start at different partitions of the map and so usually fill different pages
+  auto hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  for (auto page_id = free_space_map_.FindPage(hint); page_id != INVALID_PAGE_ID;
+       page_id      = free_space_map_.FindPage(hint)) {
+    auto guard = FetchPageWrite(page_id);
+    if (WrapPageHandle(guard.GetMutableData()).GetFreeSlotNum() > 0) {
+      return guard;
+    }
+    // another inserter filled the page after the map was searched
+    guard.UnsetDirty();
+    free_space_map_.Update(page_id, 0);
+  }
+  // the pages of the table when it was opened are read once each, before the table grows
+  while (unmapped_page_.load(std::memory_order_relaxed) < unmapped_end_) {
+    auto page_id = unmapped_page_.fetch_add(1, std::memory_order_relaxed);
+    if (page_id >= unmapped_end_) {
+      break;
+    }
+    auto guard      = FetchPageWrite(page_id);
+    auto free_slots = WrapPageHandle(guard.GetMutableData()).GetFreeSlotNum();
+    free_space_map_.Update(page_id, free_slots);
+    if (free_slots > 0) {
+      return guard;
+    }
+    guard.UnsetDirty();
+  }
+  return CreateNewPage();
 }
 
-auto TableHandle::WrapPageHandle(Page *page) -> PageHandleUptr
+auto TableHandle::CreateNewPage() -> WritePageGuard
 {
-  switch (storage_model_) {
-    case StorageModel::NARY_MODEL: return std::make_unique<NAryPageHandle>(&tab_hdr_, page);
-    case StorageModel::PAX_MODEL: return std::make_unique<PAXPageHandle>(&tab_hdr_, page, schema_.get(), field_offset_);
-    default: NJUDB_FATAL("Unknown storage model");
+  page_id_t page_id;
+  {
+    std::lock_guard lock(extend_latch_);
+    page_id = static_cast<page_id_t>(tab_hdr_.page_num_);
+    disk_manager_->AllocatePages(table_id_, tab_hdr_.page_num_ + 1);
+    tab_hdr_.page_num_++;
   }
+  // no other inserter knows the page before its first record is recorded in the free space map
+  return FetchPageWrite(page_id);
+}
+
+auto TableHandle::GetPageNum() -> page_id_t
+{
+  std::lock_guard lock(extend_latch_);
+  return static_cast<page_id_t>(tab_hdr_.page_num_);
+}
+
+auto TableHandle::WrapPageHandle(char *data) -> PageHandle
+{
+  return {&tab_hdr_, data, storage_model_, schema_.get(), &field_offset_};
+}
+
+auto TableHandle::WrapPageHandle(const ReadPageGuard &guard) -> PageHandle
+{
+  return WrapPageHandle(const_cast<char *>(guard.GetData()));
 }
 
 auto TableHandle::GetTableId() const -> table_id_t { return table_id_; }
@@ -197,35 +400,33 @@ auto TableHandle::GetTableName() const -> std::string
 
 auto TableHandle::GetStorageModel() const -> StorageModel { return storage_model_; }
 
-auto TableHandle::GetFirstRID() -> RID
+auto TableHandle::GetAccessMode() const -> TableAccessMode { return access_mode_; }
+
+auto TableHandle::GetFirstRID(BufferAccessStrategy *strategy) -> RID
 {
   auto page_id = FILE_HEADER_PAGE_ID + 1;
-  while (page_id < static_cast<page_id_t>(tab_hdr_.page_num_)) {
-    auto pg_hdl = FetchPageHandle(page_id);
-    auto id     = BitMap::FindFirst(pg_hdl->GetBitmap(), tab_hdr_.rec_per_page_, 0, true);
+  while (page_id < GetPageNum()) {
+    auto page_guard = FetchPageRead(page_id, strategy);
+    auto id         = FindRecordSlot(WrapPageHandle(page_guard), tab_hdr_.rec_per_page_, 0);
     if (id != tab_hdr_.rec_per_page_) {
-      buffer_pool_manager_->UnpinPage(table_id_, page_id, false);
       return {page_id, static_cast<slot_id_t>(id)};
     }
-    buffer_pool_manager_->UnpinPage(table_id_, page_id, false);
     page_id++;
   }
   return INVALID_RID;
 }
 
-auto TableHandle::GetNextRID(const RID &rid) -> RID
+auto TableHandle::GetNextRID(const RID &rid, BufferAccessStrategy *strategy) -> RID
 {
   auto page_id = rid.PageID();
   auto slot_id = rid.SlotID();
-  while (page_id < static_cast<page_id_t>(tab_hdr_.page_num_)) {
-    auto pg_hdl = FetchPageHandle(page_id);
-    slot_id = static_cast<slot_id_t>(BitMap::FindFirst(pg_hdl->GetBitmap(), tab_hdr_.rec_per_page_, slot_id + 1, true));
+  while (page_id < GetPageNum()) {
+    auto page_guard = FetchPageRead(page_id, strategy);
+    slot_id = static_cast<slot_id_t>(FindRecordSlot(WrapPageHandle(page_guard), tab_hdr_.rec_per_page_, slot_id + 1));
     if (slot_id == static_cast<slot_id_t>(tab_hdr_.rec_per_page_)) {
-      buffer_pool_manager_->UnpinPage(table_id_, page_id, false);
       page_id++;
       slot_id = -1;
     } else {
-      buffer_pool_manager_->UnpinPage(table_id_, page_id, false);
       return {page_id, static_cast<slot_id_t>(slot_id)};
     }
   }
@@ -237,4 +438,53 @@ auto TableHandle::HasField(const std::string &field_name) const -> bool
   return schema_->HasField(table_id_, field_name);
 }
 
+TableScanCursor::TableScanCursor(TableHandle *tab, BufferAccessStrategy *strategy)
+    : tab_(tab), strategy_(strategy), page_(std::make_unique<char[]>(PAGE_SIZE))
+{}
+
+void TableScanCursor::Rewind() { LoadPage(FILE_HEADER_PAGE_ID + 1); }
+
+void TableScanCursor::Next()
+{
+  NJUDB_ASSERT(!IsEnd(), "cursor is at the end");
+  auto slot_id = FindRecordSlot(*page_handle_, tab_->tab_hdr_.rec_per_page_, slot_id_ + 1);
+  if (slot_id == tab_->tab_hdr_.rec_per_page_) {
+    LoadPage(page_id_ + 1);
+    return;
+  }
+  slot_id_ = static_cast<slot_id_t>(slot_id);
+}
+
+void TableScanCursor::ReadRecord(Record &record) const
+{
+  NJUDB_ASSERT(!IsEnd(), "cursor is at the end");
+  NJUDB_ASSERT(record.GetSchema()->GetRecordLength() == tab_->tab_hdr_.rec_size_, "record of another schema");
+  if (auto forward = page_handle_->GetForward(slot_id_); forward != INVALID_RID) {
+    tab_->GetRecord(forward, record, strategy_);
+  } else {
+    page_handle_->ReadSlot(slot_id_, record.GetMutableNullMap(), record.GetMutableData());
+  }
+  record.SetRID(GetRID());
+}
+
+void TableScanCursor::LoadPage(page_id_t page_id)
+{
+  const auto &tab_hdr = tab_->tab_hdr_;
+  for (; page_id < tab_->GetPageNum(); ++page_id) {
+    auto page_guard = tab_->FetchPageRead(page_id, strategy_);
+    auto slot_id    = FindRecordSlot(tab_->WrapPageHandle(page_guard), tab_hdr.rec_per_page_, 0);
+    if (slot_id == tab_hdr.rec_per_page_) {
+      continue;
+    }
+    // empty pages are skipped without being copied
+    std::memcpy(page_.get(), page_guard.GetData(), PAGE_SIZE);
+    page_handle_.emplace(tab_->WrapPageHandle(page_.get()));
+    page_id_ = page_id;
+    slot_id_ = static_cast<slot_id_t>(slot_id);
+    return;
+  }
+  page_handle_.reset();
+  page_id_ = INVALID_PAGE_ID;
+}
+
 }  // namespace njudb
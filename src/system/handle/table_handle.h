@@ -21,12 +21,19 @@
 
 #ifndef NJUDB_TABLE_HANDLE_H
 #define NJUDB_TABLE_HANDLE_H
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <utility>
+#include <vector>
 
 #include "../../../common/micro.h"
 #include "common/page.h"
 #include "storage/storage.h"
+#include "storage/buffer/page_guard.h"
 #include "page_handle.h"
+#include "free_space_map.h"
 
 namespace njudb {
 
@@ -38,8 +45,12 @@ class TableHandle
 public:
   TableHandle() = delete;
 
+  /**
+   * @param access_mode TABLE_ACCESS_MMAP maps the table file read-only and reads the pages from the mapping instead of
+   * the buffer pool, inserting, deleting or updating records then throws NJUDB_UNSUPPORTED_OP
+   */
   TableHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, table_id_t table_id, TableHeader &hdr,
-      RecordSchemaUptr &schema, StorageModel storage_model);
+      RecordSchemaUptr &schema, StorageModel storage_model, TableAccessMode access_mode = TABLE_ACCESS_BUFFERED);
 
   /**
    * Get a record by rid
@@ -48,26 +59,47 @@ public:
    * 3. read the record from the slot using page handle
    * 4. unpin the page
    * @param rid
+   * @param strategy bulk readers pass their BufferAccessStrategy, nullptr by default
    * @return record
    */
-  auto GetRecord(const RID &rid) -> RecordUptr;
+  auto GetRecord(const RID &rid, BufferAccessStrategy *strategy = nullptr) -> RecordUptr;
+
+  /**
+   * Read the record at rid into record, a record of the schema of the table, e.g. the record of a scan reused for
+   * every row. Allocates nothing
+   * @param rid
+   * @param record
+   * @param strategy bulk readers pass their BufferAccessStrategy, nullptr by default
+   */
+  void GetRecord(const RID &rid, Record &record, BufferAccessStrategy *strategy = nullptr);
+
+  /**
+   * Get the records of a batch of rids, records[i] is the record of rids[i]. The rids are visited in page order so that
+   * every page is fetched once, however they are ordered, e.g. the rids of a secondary index scan. Records already in
+   * the batch are overwritten, so a batch reused across calls allocates nothing once it has grown
+   * @param rids
+   * @param records resized to the number of rids
+   * @param strategy bulk readers pass their BufferAccessStrategy, nullptr by default
+   */
+  void GetRecords(
+      std::span<const RID> rids, std::vector<RecordUptr> &records, BufferAccessStrategy *strategy = nullptr);
 
   /**
    * Get a chunk in page using record schema indicating which columns should be loaded
    * @param pid
    * @param chunk_schema
+   * @param strategy bulk readers pass their BufferAccessStrategy, nullptr by default
    * @return
    */
-  auto GetChunk(page_id_t pid, const RecordSchema *chunk_schema) -> ChunkUptr;
+  auto GetChunk(page_id_t pid, const RecordSchema *chunk_schema, BufferAccessStrategy *strategy = nullptr) -> ChunkUptr;
 
   /**
    * Insert a record into the table
-   * 1. create a page handle using CreatePageHandle
+   * 1. fetch a page with an empty slot using CreatePage
    * 2. get an empty slot in the page
    * 3. write the record into the slot
    * 4. update the bitmap and the number of records in the page header
-   * 5. if the page is full after inserting the record, update the first free page id in the file header and set the
-   * next page id of the current page
+   * 5. record the empty slots left in the page in the free space map while the page is still latched
    * 6. unpin the page
    * @param record
    * @return rid of the inserted record
@@ -87,10 +119,9 @@ public:
   /**
    * Delete the record by rid
    * 1. if the slot is empty, unpin the page and throw NJUDB_RECORD_MISS
-   * 2. update the bitmap and the number of records in the page header
-   * 3. if the page is not full after deleting the record, update the first free page id in the file header and the next
-   * page id in the page header
-   * 4. unpin the page
+   * 2. release the slot in the page handle, update the bitmap and the number of records in the page header
+   * 3. record the empty slots of the page in the free space map while the page is still latched
+   * 4. unpin the page, then delete the tuple a slotted record was moved to
    * @param rid
    */
   void DeleteRecord(const RID &rid);
@@ -100,6 +131,8 @@ public:
    * 1. if the slot is empty, unpin the page and throw NJUDB_RECORD_MISS
    * 2. write slot
    * 3. unpin the page
+   * A slotted record that no longer fits in its page is moved to another page and its home slot keeps the new rid, the
+   * rid of the record never changes
    * @param rid
    * @param record
    */
@@ -115,38 +148,72 @@ public:
 
   [[nodiscard]] auto GetStorageModel() const -> StorageModel;
 
-  [[nodiscard]] auto GetFirstRID() -> RID;
+  [[nodiscard]] auto GetAccessMode() const -> TableAccessMode;
 
-  [[nodiscard]] auto GetNextRID(const RID &rid) -> RID;
+  [[nodiscard]] auto GetFirstRID(BufferAccessStrategy *strategy = nullptr) -> RID;
+
+  [[nodiscard]] auto GetNextRID(const RID &rid, BufferAccessStrategy *strategy = nullptr) -> RID;
 
   [[nodiscard]] auto HasField(const std::string &field_name) const -> bool;
 
 private:
+  friend class TableScanCursor;
+
   /**
-   * Fetch the page handle by page id
+   * Fetch a page of the table for reading, for a mapped table the guard points into the mapping and pins nothing.
+   * Throws NJUDB_PAGE_MISS if the buffer pool cannot fetch the page
    * @param page_id
+   * @param strategy see BufferPoolManager::FetchPage
    * @return
    */
-  auto FetchPageHandle(page_id_t page_id) -> PageHandleUptr;
+  auto FetchPageRead(page_id_t page_id, BufferAccessStrategy *strategy = nullptr) -> ReadPageGuard;
 
   /**
-   * Create a page handle that has at least one empty slot
+   * Fetch a page of the table for writing, see FetchPageRead
+   */
+  auto FetchPageWrite(page_id_t page_id) -> WritePageGuard;
+
+  /**
+   * Throw NJUDB_UNSUPPORTED_OP if the table is opened read-only
+   */
+  void CheckWritable() const;
+
+  /**
+   * Insert the record into a page with an empty slot, see InsertRecord
+   * @param moved the record is moved from its home slot by UpdateRecord, scans skip the tuple
+   */
+  auto InsertTuple(const Record &record, bool moved) -> RID;
+
+  /**
+   * Fetch a page that has at least one empty slot, the page is picked from the free space map starting at a partition
+   * chosen by the calling thread. If no page in the map has room, the pages the table had when it was opened and that
+   * are not in the map yet are checked in order, and a new page is appended only after that
    * @return
    */
-  auto CreatePageHandle() -> PageHandleUptr;
+  auto CreatePage() -> WritePageGuard;
 
   /**
-   * Create a fresh new page handle
+   * Append a fresh new page to the table
    * @return
    */
-  auto CreateNewPageHandle() -> PageHandleUptr;
+  auto CreateNewPage() -> WritePageGuard;
+
+  /**
+   * @return the number of pages of the table, read under extend_latch_ since inserters append pages concurrently
+   */
+  auto GetPageNum() -> page_id_t;
 
   /**
-   * Wrap the page handle according to the storage model
-   * @param page
+   * Wrap the page data in a page handle according to the storage model
+   * @param data
    * @return
    */
-  auto WrapPageHandle(Page *page) -> PageHandleUptr;
+  auto WrapPageHandle(char *data) -> PageHandle;
+
+  /**
+   * Wrap a page fetched for reading, only the const members of the handle may be used
+   */
+  auto WrapPageHandle(const ReadPageGuard &guard) -> PageHandle;
 
 private:
   TableHeader tab_hdr_;
@@ -157,6 +224,18 @@ private:
 
   RecordSchemaUptr schema_;
   StorageModel     storage_model_;
+  TableAccessMode  access_mode_;
+  // the mapped table file in TABLE_ACCESS_MMAP mode
+  std::unique_ptr<FileMapping> mapping_;
+  // mapped pages whose checksum has been verified
+  std::vector<std::atomic<bool>> mapping_verified_;
+  // empty slots of every data page, replaces the free page chain of the table header
+  FreeSpaceMap free_space_map_;
+  // pages from unmapped_page_ to unmapped_end_ were in the table when it was opened and are not in the map yet
+  std::atomic<page_id_t> unmapped_page_{FILE_HEADER_PAGE_ID + 1};
+  page_id_t              unmapped_end_;
+  // serializes appending pages to the table file and guards the page number of the table header
+  std::mutex extend_latch_;
 
   /// field below is available when storage model is pax
   // field offsets is the offset of each field stored in page
@@ -173,6 +252,58 @@ private:
 
 DEFINE_UNIQUE_PTR(TableHandle);
 
+/**
+ * Sequential scan over the records of a table a page at a time. The cursor fetches each page once and copies it while
+ * it is latched. It then walks the set bits of the bitmap of the copy, so moving to the next record in the same page
+ * does not go through the buffer pool. No latch is held between calls, so the caller may modify the table during the
+ * scan, e.g. delete the record under the cursor. Changes to the page under the cursor are seen once the scan reaches
+ * the next page. A slotted record moved to another page is visited at its home slot.
+ */
+class TableScanCursor
+{
+public:
+  /**
+   * @param tab
+   * @param strategy bulk readers pass their BufferAccessStrategy, nullptr by default
+   */
+  explicit TableScanCursor(TableHandle *tab, BufferAccessStrategy *strategy = nullptr);
+
+  DISABLE_COPY_AND_ASSIGN(TableScanCursor)
+
+  /**
+   * Position the cursor at the first record of the table
+   */
+  void Rewind();
+
+  /**
+   * Move to the next record, the cursor is at the end after the last one
+   */
+  void Next();
+
+  [[nodiscard]] auto IsEnd() const -> bool { return page_id_ == INVALID_PAGE_ID; }
+
+  [[nodiscard]] auto GetRID() const -> RID { return {page_id_, slot_id_}; }
+
+  /**
+   * Read the record under the cursor into record, a record of the schema of the table. Allocates nothing
+   * @param record
+   */
+  void ReadRecord(Record &record) const;
+
+private:
+  /**
+   * Load the first page from page_id on that holds a record and position the cursor at its first record
+   */
+  void LoadPage(page_id_t page_id);
+
+  TableHandle              *tab_;
+  BufferAccessStrategy     *strategy_;
+  page_id_t                 page_id_{INVALID_PAGE_ID};
+  slot_id_t                 slot_id_{0};
+  std::unique_ptr<char[]>   page_;  // copy of the page under the cursor
+  std::optional<PageHandle> page_handle_;
+};
+
 }  // namespace njudb
 
 #endif  // NJUDB_TABLE_HANDLE_H
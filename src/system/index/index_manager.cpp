@@ -138,6 +138,7 @@ IndexHandleUptr IndexManager::OpenIndex(
 void IndexManager::CloseIndex(const IndexHandle &index_handle)
 {
   // Flush all pages in the index file
+  index_handle.GetIndex()->Flush();
   buffer_pool_manager_->FlushAllPages(index_handle.GetIndexId());
   // delete all pages in the index file
   buffer_pool_manager_->DeleteAllPages(index_handle.GetIndexId());
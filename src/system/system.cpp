@@ -19,10 +19,11 @@
 // Created by ziqi on 2024/7/19.
 //
 
+#include <charconv>
 #include <iostream>
 #include <unistd.h>
-#include <regex>
 #include <csignal>
+#include <strings.h>
 
 #include "system.h"
 #include "../common/net/net.h"
@@ -31,7 +32,8 @@
 namespace njudb {
 SystemManager::SystemManager() = default;
 
-void SystemManager::Init()
+void SystemManager::Init(size_t buffer_pool_size, size_t buffer_pool_instances, size_t clean_frames,
+    const std::string &replacer, size_t read_ahead_pages, bool direct_io, TableAccessMode table_access)
 {
   // change working directory to the bin directory
   if (!std::filesystem::exists(DATA_DIR)) {
@@ -39,9 +41,10 @@ void SystemManager::Init()
   }
   std::filesystem::current_path(DATA_DIR);
 
-  disk_manager_        = std::make_unique<DiskManager>();
+  disk_manager_        = std::make_unique<DiskManager>(direct_io);
   log_manager_         = std::make_unique<LogManager>(disk_manager_.get());
-  buffer_pool_manager_ = std::make_unique<BufferPoolManager>(disk_manager_.get(), log_manager_.get(), REPLACER_LRU_K);
+  buffer_pool_manager_ = std::make_unique<BufferPoolManager>(
+      disk_manager_.get(), log_manager_.get(), REPLACER_LRU_K, buffer_pool_size, buffer_pool_instances, replacer);
   recovery_            = std::make_unique<Recovery>(disk_manager_.get(), buffer_pool_manager_.get());
   table_manager_       = std::make_unique<TableManager>(disk_manager_.get(), buffer_pool_manager_.get());
   index_manager_       = std::make_unique<IndexManager>(disk_manager_.get(), buffer_pool_manager_.get());
@@ -51,6 +54,13 @@ void SystemManager::Init()
   optimizer_           = std::make_unique<Optimizer>();
   txn_manager_         = std::make_unique<TxnManager>(log_manager_.get());
   net_controller_      = std::make_unique<NetController>();
+  table_access_        = table_access;
+  if (clean_frames > 0) {
+    buffer_pool_manager_->StartPageCleaner(clean_frames);
+  }
+  if (read_ahead_pages > 0) {
+    buffer_pool_manager_->StartReadAhead(read_ahead_pages);
+  }
 
   // first check TMP_DIR
   if (!std::filesystem::exists(TMP_DIR)) {
@@ -168,7 +178,7 @@ void SystemManager::ClientHandler(int client_fd)
       txn_manager_->SetTransaction(&txn);
       auto gm_tree = parser_->Parse(sql);
       auto plan    = planner_->PlanAST(gm_tree, context.db_);
-      if (plan == nullptr || DoDBPlan(plan, &context) || DoExplainPlan(plan, &context)) {
+      if (plan == nullptr || DoDBPlan(plan, &context) || DoSetPlan(plan, &context) || DoExplainPlan(plan, &context)) {
         net_controller_->SendOK(client_fd);
       } else {
         /// plan is not a db plan
@@ -217,7 +227,7 @@ bool SystemManager::DoDBPlan(const std::shared_ptr<AbstractPlan> &plan, Context
       ctx->db_ = databases_[odb->db_name_].get();
       ctx->db_->ref_cnt_++;
       if (ctx->db_->ref_cnt_ == 1) {
-        ctx->db_->Open();
+        ctx->db_->Open(table_access_);
       }
     }
     return true;
@@ -238,4 +248,37 @@ bool SystemManager::DoExplainPlan(const std::shared_ptr<AbstractPlan> &plan, Con
   return false;
 }
 
-}  // namespace njudb
\ No newline at end of file
+bool SystemManager::DoSetPlan(const std::shared_ptr<AbstractPlan> &plan, Context *ctx)
+{
+  const auto set = std::dynamic_pointer_cast<SetVariablePlan>(plan);
+  if (set == nullptr) {
+    return false;
+  }
+  if (strcasecmp(set->name_.c_str(), "buffer_pool_size") == 0) {
+    size_t pool_size = 0;
+    auto [end, ec]   = std::from_chars(set->value_.data(), set->value_.data() + set->value_.size(), pool_size);
+    if (ec != std::errc() || end != set->value_.data() + set->value_.size()) {
+      NJUDB_THROW(NJUDB_INVALID_SQL, fmt::format("invalid buffer_pool_size: {}", set->value_));
+    }
+    if (!buffer_pool_manager_->Resize(pool_size)) {
+      NJUDB_THROW(NJUDB_UNSUPPORTED_OP, fmt::format("cannot resize buffer pool to {} frames", pool_size));
+    }
+    NJUDB_LOG(fmt::format("Buffer pool resized to {} frames", pool_size));
+    return true;
+  }
+  if (strcasecmp(set->name_.c_str(), "page_checksum") == 0) {
+    if (ctx->db_ == nullptr) {
+      NJUDB_THROW(NJUDB_DB_NOT_OPEN, "set page_checksum");
+    }
+    bool verify = strcasecmp(set->value_.c_str(), "on") == 0;
+    if (!verify && strcasecmp(set->value_.c_str(), "off") != 0) {
+      NJUDB_THROW(NJUDB_INVALID_SQL, fmt::format("invalid page_checksum: {}", set->value_));
+    }
+    ctx->db_->SetPageChecksum(verify);
+    NJUDB_LOG(fmt::format("Page checksums of {} turned {}", ctx->db_->GetName(), verify ? "on" : "off"));
+    return true;
+  }
+  NJUDB_THROW(NJUDB_INVALID_SQL, fmt::format("unknown variable: {}", set->name_));
+}
+
+}  // namespace njudb
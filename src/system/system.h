@@ -50,7 +50,21 @@ public:
 
   void DropDatabase(const std::string &db_name);
 
-  void Init();
+  /**
+   * Create all components of the system
+   * @param buffer_pool_size number of frames in the buffer pool, can be changed online by
+   * "set buffer_pool_size = <n>;"
+   * @param buffer_pool_instances number of partitions of the buffer pool
+   * @param clean_frames number of clean frames kept by the page cleaner, 0 disables the page cleaner
+   * @param replacer class name of the replacement policy of the buffer pool
+   * @param read_ahead_pages number of pages read ahead of sequential readers, 0 disables the read-ahead
+   * @param direct_io read and write pages with O_DIRECT, bypassing the OS page cache
+   * @param table_access how the tables of an opened database are read, TABLE_ACCESS_MMAP makes them read-only
+   */
+  void Init(size_t buffer_pool_size = BUFFER_POOL_SIZE, size_t buffer_pool_instances = BUFFER_POOL_INSTANCES,
+      size_t clean_frames = PAGE_CLEANER_CLEAN_FRAMES, const std::string &replacer = REPLACER,
+      size_t read_ahead_pages = READ_AHEAD_PAGES, bool direct_io = false,
+      TableAccessMode table_access = TABLE_ACCESS_BUFFERED);
 
   void Run();
 
@@ -59,6 +73,13 @@ private:
 
   bool DoExplainPlan(const std::shared_ptr<AbstractPlan> &plan, Context *ctx);
 
+  /**
+   * Apply "set <name> = <value>;", buffer_pool_size resizes the buffer pool and page_checksum = on|off turns the
+   * verification of page checksums of the opened database on or off
+   * @return true if the plan is a SetVariablePlan
+   */
+  bool DoSetPlan(const std::shared_ptr<AbstractPlan> &plan, Context *ctx);
+
   void SIGINTHandler(int sig);
 
   void ClientHandler(int client_fd);
@@ -86,6 +107,7 @@ private:
   std::unique_ptr<Optimizer>         optimizer_;
   std::unique_ptr<TxnManager>        txn_manager_;
   std::unique_ptr<NetController>     net_controller_;
+  TableAccessMode                    table_access_{TABLE_ACCESS_BUFFERED};
 
   bool                  is_running_{false};  // indicates whether the system is running
 
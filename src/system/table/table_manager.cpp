@@ -23,15 +23,15 @@
 #include "common/page.h"
 
 namespace njudb {
-void TableManager::CreateTable(
-    const std::string &db_name, const std::string &table_name, const RecordSchema &schema, StorageModel storage_model)
+void TableManager::CreateTable(const std::string &db_name, const std::string &table_name, const RecordSchema &schema,
+    StorageModel storage_model, PageCompression compression)
 {
   if (schema.GetRecordLength() > MAX_REC_SIZE || schema.GetRecordLength() < 1) {
     NJUDB_THROW(NJUDB_RECLEN_ERROR, fmt::format("{}", schema.GetRecordLength()));
   }
 
   // 1. create and open table file
-  DiskManager::CreateFile(FILE_NAME(db_name, table_name, TAB_SUFFIX));
+  DiskManager::CreateFile(FILE_NAME(db_name, table_name, TAB_SUFFIX), compression);
   auto table_file = disk_manager_->OpenFile(FILE_NAME(db_name, table_name, TAB_SUFFIX));
   // 2. prepare table header
   TableHeader table_header;
@@ -40,9 +40,17 @@ void TableManager::CreateTable(
   table_header.rec_num_         = 0;
   table_header.rec_size_        = schema.GetRecordLength();
   table_header.nullmap_size_    = BITMAP_SIZE(schema.GetFieldCount());
-  // n = rec_per_page, PAGE_HDR_SIZE + BITMAP_SIZE(n) + n * (rec_size + nullmap_size) <= PAGE_SIZE
-  table_header.rec_per_page_ = (BITMAP_WIDTH * (PAGE_SIZE - PAGE_HEADER_SIZE - 1) + 1) /
-                               (1 + (table_header.rec_size_ + table_header.nullmap_size_) * BITMAP_WIDTH);
+  if (storage_model == SLOTTED_MODEL) {
+    // the most tuples of the smallest size a slotted page can hold, n = rec_per_page,
+    // PAGE_HDR_SIZE + BITMAP_SIZE(n) + SLOTTED_HEADER_SIZE + n * (SLOT_ENTRY_SIZE + min_tuple_size) <= PAGE_SIZE
+    size_t min_tuple_size      = PageHandle::GetMinSlottedTupleSize(schema);
+    table_header.rec_per_page_ = (BITMAP_WIDTH * (PAGE_SIZE - PAGE_HEADER_SIZE - SLOTTED_HEADER_SIZE - 1) + 1) /
+                                 (1 + (SLOT_ENTRY_SIZE + min_tuple_size) * BITMAP_WIDTH);
+  } else {
+    // n = rec_per_page, PAGE_HDR_SIZE + BITMAP_SIZE(n) + n * (rec_size + nullmap_size) <= PAGE_SIZE
+    table_header.rec_per_page_ = (BITMAP_WIDTH * (PAGE_SIZE - PAGE_HEADER_SIZE - 1) + 1) /
+                                 (1 + (table_header.rec_size_ + table_header.nullmap_size_) * BITMAP_WIDTH);
+  }
   table_header.field_num_   = schema.GetFieldCount();
   table_header.bitmap_size_ = BITMAP_SIZE(table_header.rec_per_page_);
   // 3. write table header to the zero page
@@ -57,7 +65,7 @@ void TableManager::DropTable(const std::string &db_name, const std::string &tabl
 }
 
 TableHandleUptr TableManager::OpenTable(
-    const std::string &db_name, const std::string &table_name, StorageModel storage_model)
+    const std::string &db_name, const std::string &table_name, StorageModel storage_model, TableAccessMode access_mode)
 {
   auto table_file    = disk_manager_->OpenFile(FILE_NAME(db_name, table_name, TAB_SUFFIX));
   auto file_hdr_data = new char[PAGE_SIZE];
@@ -72,11 +80,17 @@ TableHandleUptr TableManager::OpenTable(
   schema = std::make_unique<RecordSchema>();
   cursor += schema->Deserialize(cursor);
   delete[] file_hdr_data;
-  return std::make_unique<TableHandle>(disk_manager_, buffer_pool_manager_, table_file, header, schema, storage_model);
+  return std::make_unique<TableHandle>(
+      disk_manager_, buffer_pool_manager_, table_file, header, schema, storage_model, access_mode);
 }
 
 void TableManager::CloseTable(const std::string &db_name, const TableHandle &table_handle)
 {
+  // a mapped table is read-only and has no page in the buffer pool
+  if (table_handle.GetAccessMode() == TABLE_ACCESS_MMAP) {
+    disk_manager_->CloseFile(table_handle.GetTableId());
+    return;
+  }
   // 1. write table header to the zero page
   WriteTableHeader(table_handle.GetTableId(), table_handle.GetTableHeader(), table_handle.GetSchema());
   // 2. flush all pages to disk
@@ -95,7 +109,7 @@ void TableManager::WriteTableHeader(table_id_t tid, const TableHeader &header, c
   auto serialized_size = schema.SerializeSize();
   auto serialized_data = new char[serialized_size];
   schema.Serialize(serialized_data);
-  disk_manager_->WriteFile(tid, serialized_data, serialized_size, SEEK_END);
+  disk_manager_->WriteFile(tid, serialized_data, serialized_size, SEEK_CUR);
   delete[] serialized_data;
 }
 
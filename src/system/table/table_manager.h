@@ -36,11 +36,13 @@ public:
   {}
   ~TableManager() = default;
 
-  void CreateTable(const std::string &db_name, const std::string &table_name, const RecordSchema &schema, StorageModel storage_model);
+  void CreateTable(const std::string &db_name, const std::string &table_name, const RecordSchema &schema,
+      StorageModel storage_model, PageCompression compression = PAGE_COMPRESSION_NONE);
 
   static void DropTable(const std::string &db_name, const std::string &table_name);
 
-  TableHandleUptr OpenTable(const std::string &db_name, const std::string &table_name, StorageModel storage_model);
+  TableHandleUptr OpenTable(const std::string &db_name, const std::string &table_name, StorageModel storage_model,
+      TableAccessMode access_mode = TABLE_ACCESS_BUFFERED);
 
   void CloseTable(const std::string &db_name, const TableHandle &table_handle);
 
@@ -12,6 +12,7 @@
 #include <vector>
 #include <unordered_set>
 #include <shared_mutex>
+#include <thread>
 
 #include "gtest/gtest.h"
 using namespace njudb;
@@ -1109,6 +1110,108 @@ TEST_F(BPTreeTest, MixedOperations)
   std::cout << "  Final keys in tree: " << inserted_keys.size() << std::endl;
 }
 
+TEST_F(BPTreeTest, ConcurrentCrabbing)
+{
+  const int NUM_THREADS = 8;
+  const int NUM_KEYS    = 20000;
+
+  // the latched paths of all threads must fit in the pool at once
+  index_.reset();
+  buffer_pool_manager_ = std::make_unique<BufferPoolManager>(
+      disk_manager_.get(), log_manager_.get(), REPLACER_LRU_K, BUFFER_POOL_SIZE);
+  index_ = std::make_unique<BPTreeIndex>(disk_manager_.get(), buffer_pool_manager_.get(), file_id_, schema_.get());
+
+  // every thread owns the keys congruent to its id, inserts them all, deletes the odd ones among them and searches its
+  // own keys in between, while the others split and merge the same pages
+  auto key_of = [](const RID &rid) { return (static_cast<int>(rid.PageID()) - 1) * 10 + rid.SlotID(); };
+
+  std::atomic<int>         errors(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < NUM_THREADS; ++t) {
+    threads.emplace_back([&, t]() {
+      std::mt19937     gen(t);
+      std::vector<int> keys;
+      for (int key = t; key < NUM_KEYS; key += NUM_THREADS) {
+        keys.push_back(key);
+      }
+      std::shuffle(keys.begin(), keys.end(), gen);
+
+      for (size_t i = 0; i < keys.size(); ++i) {
+        index_->Insert(*CreateRecord(keys[i]), CreateRID(keys[i] / 10 + 1, keys[i] % 10));
+        int  probe   = keys[gen() % (i + 1)];
+        auto results = index_->Search(*CreateRecord(probe));
+        if (results.size() != 1 || results[0].PageID() != probe / 10 + 1) {
+          errors++;
+        }
+      }
+      for (int key : keys) {
+        if (key / NUM_THREADS % 2 == 1 && !index_->Delete(*CreateRecord(key))) {
+          errors++;
+        }
+        auto low     = static_cast<int>(gen() % NUM_KEYS);
+        auto results = index_->SearchRange(*CreateRecord(low), *CreateRecord(low + 100));
+        for (size_t j = 1; j < results.size(); ++j) {
+          if (key_of(results[j - 1]) >= key_of(results[j])) {
+            errors++;
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(errors.load(), 0);
+
+  EXPECT_EQ(index_->Size(), NUM_KEYS / 2);
+  for (int key = 0; key < NUM_KEYS; ++key) {
+    auto results = index_->Search(*CreateRecord(key));
+    if (key / NUM_THREADS % 2 == 1) {
+      EXPECT_TRUE(results.empty()) << key;
+    } else {
+      ASSERT_EQ(results.size(), 1) << key;
+      EXPECT_EQ(results[0].PageID(), key / 10 + 1);
+      EXPECT_EQ(results[0].SlotID(), key % 10);
+    }
+  }
+  auto all = index_->SearchRange(*CreateRecord(0), *CreateRecord(NUM_KEYS));
+  EXPECT_EQ(all.size(), NUM_KEYS / 2);
+}
+
+TEST_F(BPTreeTest, Reopen)
+{
+  const int NUM_KEYS = 2000;
+
+  for (int key = 0; key < NUM_KEYS; ++key) {
+    index_->Insert(*CreateRecord(key), CreateRID(key / 10 + 1, key % 10));
+  }
+  // merges put pages on the free list
+  for (int key = NUM_KEYS / 2; key < NUM_KEYS; ++key) {
+    ASSERT_TRUE(index_->Delete(*CreateRecord(key)));
+  }
+  // the counters kept in memory reach the header only through Flush
+  index_->Flush();
+  index_.reset();
+  buffer_pool_manager_->FlushAllPages(file_id_);
+  ASSERT_TRUE(buffer_pool_manager_->DeleteAllPages(file_id_));
+  index_ = std::make_unique<BPTreeIndex>(disk_manager_.get(), buffer_pool_manager_.get(), file_id_, schema_.get());
+  EXPECT_EQ(index_->Size(), NUM_KEYS / 2);
+
+  auto file_size = disk_manager_->GetFileSize(file_id_);
+  for (int key = NUM_KEYS / 2; key < NUM_KEYS; ++key) {
+    index_->Insert(*CreateRecord(key), CreateRID(key / 10 + 1, key % 10));
+  }
+  EXPECT_EQ(index_->Size(), NUM_KEYS);
+  buffer_pool_manager_->FlushAllPages(file_id_);
+  // the pages freed before the reopen are reused
+  EXPECT_EQ(disk_manager_->GetFileSize(file_id_), file_size);
+  for (int key = 0; key < NUM_KEYS; ++key) {
+    auto results = index_->Search(*CreateRecord(key));
+    ASSERT_EQ(results.size(), 1) << key;
+    EXPECT_EQ(results[0].SlotID(), key % 10);
+  }
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,627 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+#include "storage/buffer/buffer_pool_manager.h"
+#include "storage/buffer/page_guard.h"
+#include "storage/buffer/page_table.h"
+#include "storage/disk/async_disk_manager.h"
+#include "../config.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+
+// every page of the working set is cached, so the benchmark only measures the hit path
+constexpr size_t BENCH_POOL_SIZE  = 256;
+constexpr int    BENCH_PAGES      = 128;
+constexpr int    BENCH_OPS        = 200000;  // per thread
+constexpr size_t BENCH_INSTANCES  = 16;
+// a complete tree of inner pages holding the ids of their children, every descent goes through the root
+constexpr int    BENCH_FANOUT     = 16;
+constexpr int    BENCH_INNER      = 1 + BENCH_FANOUT;  // root and the second level
+constexpr int    BENCH_TREE_PAGES = BENCH_INNER + BENCH_FANOUT * BENCH_FANOUT;
+// 1M resident pages spread over a few files, page ids of different files overlap
+constexpr int    BENCH_TABLE_FILES       = 64;
+constexpr int    BENCH_PAGES_PER_FILE    = 16384;
+constexpr int    BENCH_TABLE_LOOKUPS     = 4000000;  // per thread
+
+constexpr int    BENCH_IO_PAGES = 16384;
+constexpr int    BENCH_IO_READS = 20000;
+
+constexpr int    BENCH_DIRECT_PAGES = 16384;
+constexpr int    BENCH_DIRECT_READS = 100000;
+
+constexpr int    BENCH_PREALLOC_PAGES = 2048;  // per file
+
+static auto RunHitPath(njudb::BufferPoolManager &bpm, file_id_t fd, int num_threads) -> double
+{
+  std::vector<std::thread> threads;
+  std::atomic<bool>        start{false};
+  std::atomic<int>         failed{0};
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::mt19937 gen(t);
+      while (!start.load()) {
+        std::this_thread::yield();
+      }
+      for (int i = 0; i < BENCH_OPS; ++i) {
+        auto pid  = static_cast<page_id_t>(gen() % BENCH_PAGES);
+        auto page = bpm.FetchPage(fd, pid);
+        if (page == nullptr) {
+          failed++;
+          continue;
+        }
+        bpm.UnpinPage(fd, pid, false);
+      }
+    });
+  }
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  EXPECT_EQ(failed.load(), 0);
+  return static_cast<double>(BENCH_OPS) * num_threads / seconds;
+}
+
+TEST(BufferPoolBenchmark, HitPathScaling)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("bench_bpm.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("bench_bpm.tbl");
+    njudb::DiskManager::CreateFile("bench_bpm.tbl");
+  }
+  njudb::DiskManager disk_manager{};
+  auto               fd = disk_manager.OpenFile("bench_bpm.tbl");
+
+  std::cout << fmt::format("{:>10} {:>8} {:>16}", "instances", "threads", "ops/s") << std::endl;
+  for (size_t num_instances : {static_cast<size_t>(1), BENCH_INSTANCES}) {
+    njudb::BufferPoolManager bpm(&disk_manager, nullptr, 0, BENCH_POOL_SIZE, num_instances);
+    ASSERT_EQ(bpm.GetInstanceNum(), num_instances);
+    ASSERT_EQ(bpm.GetPoolSize(), BENCH_POOL_SIZE);
+    // warm up the pool so that no fetch goes to disk during measurement
+    for (int i = 0; i < BENCH_PAGES; ++i) {
+      ASSERT_NE(bpm.FetchPage(fd, i), nullptr);
+      bpm.UnpinPage(fd, i, false);
+    }
+    for (int num_threads : {1, 2, 4, 8}) {
+      auto ops = RunHitPath(bpm, fd, num_threads);
+      std::cout << fmt::format("{:>10} {:>8} {:>16.0f}", num_instances, num_threads, ops) << std::endl;
+    }
+    bpm.DeleteAllPages(fd);
+  }
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("bench_bpm.tbl");
+}
+
+TEST(BufferPoolBenchmark, HotPageLatencyUnderMisses)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("bench_bpm_miss.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("bench_bpm_miss.tbl");
+    njudb::DiskManager::CreateFile("bench_bpm_miss.tbl");
+  }
+  njudb::DiskManager       disk_manager{};
+  auto                     fd = disk_manager.OpenFile("bench_bpm_miss.tbl");
+  constexpr int            hot_pages  = 8;
+  constexpr int            cold_pages = 4096;
+  njudb::BufferPoolManager bpm(&disk_manager, nullptr, 0, 64);
+
+  // the hot pages stay pinned by nobody but are touched all the time, the cold scan keeps missing and evicting
+  std::atomic<bool> stop{false};
+  std::thread       cold([&]() {
+    for (int round = 0; !stop.load(); round++) {
+      for (int i = 0; i < cold_pages && !stop.load(); ++i) {
+        page_id_t pid  = hot_pages + i;
+        auto      page = bpm.FetchPage(fd, pid);
+        if (page == nullptr) {
+          continue;
+        }
+        page->GetData()[PAGE_HEADER_SIZE] = static_cast<char>(round);
+        bpm.UnpinPage(fd, pid, true);
+      }
+    }
+  });
+  std::vector<double> latencies;
+  latencies.reserve(BENCH_OPS / 10);
+  std::mt19937 gen(0);
+  for (int i = 0; i < BENCH_OPS / 10; ++i) {
+    auto pid   = static_cast<page_id_t>(gen() % hot_pages);
+    auto begin = std::chrono::steady_clock::now();
+    auto page  = bpm.FetchPage(fd, pid);
+    latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+    ASSERT_NE(page, nullptr);
+    bpm.UnpinPage(fd, pid, false);
+  }
+  stop.store(true);
+  cold.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  std::cout << fmt::format("hot fetch latency(us): p50 {:.2f}, p99 {:.2f}, p999 {:.2f}, max {:.2f}",
+                   latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100],
+                   latencies[latencies.size() * 999 / 1000], latencies.back())
+            << std::endl;
+  bpm.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("bench_bpm_miss.tbl");
+}
+
+static auto ChildAt(const char *data, int i) -> page_id_t
+{
+  return reinterpret_cast<const page_id_t *>(data + PAGE_HEADER_SIZE)[i];
+}
+
+static auto RunDescents(njudb::BufferPoolManager &bpm, file_id_t fd, int num_threads, bool optimistic) -> double
+{
+  std::vector<std::thread> threads;
+  std::atomic<bool>        start{false};
+  std::atomic<int>         failed{0};
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::mt19937                   gen(t);
+      alignas(std::max_align_t) char data[PAGE_SIZE];
+      while (!start.load()) {
+        std::this_thread::yield();
+      }
+      for (int i = 0; i < BENCH_OPS; ++i) {
+        page_id_t pid = 0;
+        while (pid < BENCH_INNER) {
+          auto slot = static_cast<int>(gen() % BENCH_FANOUT);
+          if (optimistic && bpm.ReadPageOptimistic(fd, pid, data)) {
+            pid = ChildAt(data, slot);
+            continue;
+          }
+          auto guard = bpm.FetchPageRead(fd, pid);
+          pid        = ChildAt(guard.GetData(), slot);
+        }
+        if (pid >= BENCH_TREE_PAGES) {
+          failed++;
+        }
+      }
+    });
+  }
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  EXPECT_EQ(failed.load(), 0);
+  return static_cast<double>(BENCH_OPS) * num_threads / seconds;
+}
+
+TEST(BufferPoolBenchmark, OptimisticDescent)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("bench_bpm_tree.idx");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("bench_bpm_tree.idx");
+    njudb::DiskManager::CreateFile("bench_bpm_tree.idx");
+  }
+  njudb::DiskManager       disk_manager{};
+  auto                     fd = disk_manager.OpenFile("bench_bpm_tree.idx");
+  njudb::BufferPoolManager bpm(&disk_manager, nullptr, 0, BENCH_POOL_SIZE);
+  for (int i = 0; i < BENCH_INNER; ++i) {
+    auto page     = bpm.FetchPage(fd, i);
+    auto children = reinterpret_cast<page_id_t *>(page->GetData() + PAGE_HEADER_SIZE);
+    for (int j = 0; j < BENCH_FANOUT; ++j) {
+      children[j] = i * BENCH_FANOUT + j + 1;
+    }
+    bpm.UnpinPage(fd, i, true);
+  }
+
+  std::cout << fmt::format("{:>12} {:>8} {:>16}", "mode", "threads", "descents/s") << std::endl;
+  for (bool optimistic : {false, true}) {
+    for (int num_threads : {1, 2, 4, 8}) {
+      auto ops = RunDescents(bpm, fd, num_threads, optimistic);
+      std::cout << fmt::format("{:>12} {:>8} {:>16.0f}", optimistic ? "optimistic" : "pinned", num_threads, ops)
+                << std::endl;
+    }
+  }
+  bpm.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("bench_bpm_tree.idx");
+}
+
+
+// random page reads from a file dropped from the OS page cache, by one thread keeping queue_depth reads in flight
+static auto RunRandomReads(njudb::DiskManager &disk_manager, file_id_t fd, size_t queue_depth, bool use_io_uring)
+    -> double
+{
+  std::mt19937                   rng(42);
+  std::uniform_int_distribution  dist(0, BENCH_IO_PAGES - 1);
+  std::vector<char>              buffers(queue_depth * PAGE_SIZE);
+  fsync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  auto start = std::chrono::steady_clock::now();
+  if (queue_depth == 1 && !use_io_uring) {
+    for (int i = 0; i < BENCH_IO_READS; ++i) {
+      disk_manager.ReadPage(fd, dist(rng), buffers.data());
+    }
+  } else {
+    njudb::AsyncDiskManager                       async_disk_manager(&disk_manager, queue_depth, use_io_uring);
+    std::vector<njudb::AsyncDiskManager::Request> requests;
+    for (int i = 0; i < BENCH_IO_READS; ++i) {
+      // the queue depth bounds the reads in flight, so a buffer is free again by the time it is reused
+      requests.push_back({false, fd, dist(rng), buffers.data() + (i % queue_depth) * PAGE_SIZE, nullptr});
+    }
+    async_disk_manager.Submit(std::move(requests));
+    async_disk_manager.Wait();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return BENCH_IO_READS / elapsed.count();
+}
+
+TEST(BufferPoolBenchmark, AsyncRandomReads)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("bench_async_io.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("bench_async_io.tbl");
+    njudb::DiskManager::CreateFile("bench_async_io.tbl");
+  }
+  njudb::DiskManager disk_manager{};
+  auto               fd = disk_manager.OpenFile("bench_async_io.tbl");
+  std::vector<char>  page(PAGE_SIZE, 'x');
+  for (int i = 0; i < BENCH_IO_PAGES; ++i) {
+    disk_manager.WritePage(fd, i, page.data());
+  }
+
+  std::cout << fmt::format("{:>12} {:>8} {:>16}", "backend", "depth", "reads/s") << std::endl;
+  std::cout << fmt::format("{:>12} {:>8} {:>16.0f}", "sync", 1, RunRandomReads(disk_manager, fd, 1, false))
+            << std::endl;
+  for (size_t queue_depth : {1, 8, 32, 64}) {
+    auto ops = RunRandomReads(disk_manager, fd, queue_depth, true);
+    std::cout << fmt::format("{:>12} {:>8} {:>16.0f}", "io_uring", queue_depth, ops) << std::endl;
+  }
+  std::cout << fmt::format("{:>12} {:>8} {:>16.0f}",
+                   "threads",
+                   ASYNC_IO_QUEUE_DEPTH,
+                   RunRandomReads(disk_manager, fd, ASYNC_IO_QUEUE_DEPTH, false))
+            << std::endl;
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("bench_async_io.tbl");
+}
+
+static auto ResidentBytes() -> size_t
+{
+  std::ifstream statm("/proc/self/statm");
+  size_t        size     = 0;
+  size_t        resident = 0;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+// bytes of the file held by the OS page cache
+static auto CachedBytes(const std::string &fname) -> size_t
+{
+  int         fd   = open(fname.c_str(), O_RDONLY);
+  size_t      size = std::filesystem::file_size(fname);
+  auto        os_page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  void       *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  std::vector<unsigned char> resident((size + os_page - 1) / os_page);
+  mincore(addr, size, resident.data());
+  munmap(addr, size);
+  close(fd);
+  return std::count_if(resident.begin(), resident.end(), [](unsigned char r) { return r & 1; }) * os_page;
+}
+
+// random fetches of a file larger than the pool, returns fetches/s after a warm-up pass and reports the memory used,
+// the RSS of the process grows with the largest pool so far as page data is recycled
+static auto RunDirectIo(bool direct_io, size_t pool_size, size_t *rss_bytes, size_t *cached_bytes) -> double
+{
+  {
+    // drop the file from the page cache
+    int fd = open("bench_direct_io.tbl", O_RDONLY);
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+  njudb::DiskManager       disk_manager(direct_io);
+  auto                     fd = disk_manager.OpenFile("bench_direct_io.tbl");
+  njudb::BufferPoolManager bpm(&disk_manager, nullptr, 0, pool_size);
+  std::mt19937             rng(42);
+  std::uniform_int_distribution dist(0, BENCH_DIRECT_PAGES - 1);
+  auto run = [&]() {
+    for (int i = 0; i < BENCH_DIRECT_READS; ++i) {
+      auto pid = dist(rng);
+      bpm.FetchPage(fd, pid);
+      bpm.UnpinPage(fd, pid, false);
+    }
+  };
+  run();
+  auto start = std::chrono::steady_clock::now();
+  run();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  *rss_bytes    = ResidentBytes();
+  *cached_bytes = CachedBytes("bench_direct_io.tbl");
+  bpm.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  return BENCH_DIRECT_READS / elapsed.count();
+}
+
+TEST(BufferPoolBenchmark, DirectIo)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("bench_direct_io.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("bench_direct_io.tbl");
+    njudb::DiskManager::CreateFile("bench_direct_io.tbl");
+  }
+  {
+    njudb::DiskManager disk_manager{};
+    auto               fd = disk_manager.OpenFile("bench_direct_io.tbl");
+    std::vector<char>  page(PAGE_SIZE, 'x');
+    for (int i = 0; i < BENCH_DIRECT_PAGES; ++i) {
+      disk_manager.WritePage(fd, i, page.data());
+    }
+    disk_manager.CloseFile(fd);
+  }
+
+  constexpr size_t pool_size = BENCH_DIRECT_PAGES / 4;
+  auto             print     = [](const char *mode, size_t frames, double ops, size_t rss_bytes, size_t cached_bytes) {
+    std::cout << fmt::format("{:>10} {:>8} {:>12.0f} {:>10} {:>10} {:>10}",
+                     mode,
+                     frames,
+                     ops,
+                     rss_bytes >> 20,
+                     cached_bytes >> 20,
+                     (rss_bytes + cached_bytes) >> 20)
+              << std::endl;
+  };
+  std::cout << fmt::format("{:>10} {:>8} {:>12} {:>10} {:>10} {:>10}",
+                   "mode",
+                   "frames",
+                   "fetches/s",
+                   "rss MB",
+                   "cache MB",
+                   "total MB")
+            << std::endl;
+  size_t rss_bytes    = 0;
+  size_t cached_bytes = 0;
+  auto   ops          = RunDirectIo(false, pool_size, &rss_bytes, &cached_bytes);
+  print("buffered", pool_size, ops, rss_bytes, cached_bytes);
+  // the memory the buffered run spent on the page cache goes to the buffer pool instead
+  auto equal_memory = pool_size + cached_bytes / PAGE_SIZE;
+  for (size_t frames : {pool_size, equal_memory}) {
+    ops = RunDirectIo(true, frames, &rss_bytes, &cached_bytes);
+    print("direct", frames, ops, rss_bytes, cached_bytes);
+  }
+  njudb::DiskManager::DestroyFile("bench_direct_io.tbl");
+}
+
+TEST(BufferPoolBenchmark, VectoredWrites)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("bench_vectored_io.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("bench_vectored_io.tbl");
+    njudb::DiskManager::CreateFile("bench_vectored_io.tbl");
+  }
+  std::cout << fmt::format("{:>10} {:>10} {:>14}", "mode", "writes", "pages/s") << std::endl;
+  for (bool direct_io : {false, true}) {
+    njudb::DiskManager disk_manager(direct_io);
+    auto               fd = disk_manager.OpenFile("bench_vectored_io.tbl");
+    // a dirty pool being flushed, the pages are aligned for O_DIRECT
+    njudb::BufferPoolManager bpm(&disk_manager, nullptr, 0, BENCH_IO_PAGES);
+    for (int i = 0; i < BENCH_IO_PAGES; ++i) {
+      bpm.FetchPage(fd, i);
+      bpm.UnpinPage(fd, i, true);
+    }
+    for (bool vectored : {false, true}) {
+      auto start = std::chrono::steady_clock::now();
+      if (vectored) {
+        bpm.FlushAllPages(fd);
+      } else {
+        for (int i = 0; i < BENCH_IO_PAGES; ++i) {
+          disk_manager.WritePage(fd, i, bpm.FetchPage(fd, i)->GetData());
+          bpm.UnpinPage(fd, i, false);
+        }
+      }
+      fsync(fd);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << fmt::format("{:>10} {:>10} {:>14.0f}",
+                       direct_io ? "direct" : "buffered",
+                       vectored ? "vectored" : "per page",
+                       BENCH_IO_PAGES / elapsed.count())
+                << std::endl;
+    }
+    bpm.DeleteAllPages(fd);
+    disk_manager.CloseFile(fd);
+  }
+  njudb::DiskManager::DestroyFile("bench_vectored_io.tbl");
+}
+
+// number of extents the file system maps the file with
+static auto FileExtents(int fd) -> size_t
+{
+  fiemap map{};
+  map.fm_length = FIEMAP_MAX_OFFSET;
+  map.fm_flags  = FIEMAP_FLAG_SYNC;
+  return ioctl(fd, FS_IOC_FIEMAP, &map) < 0 ? 0 : map.fm_mapped_extents;
+}
+
+TEST(BufferPoolBenchmark, Preallocation)
+{
+  constexpr int num_files = 4;
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  std::cout << fmt::format("{:>10} {:>14} {:>16}", "extent", "appends/s", "extents per file") << std::endl;
+  for (size_t extent_pages : {0UL, 8UL, FILE_EXTENT_PAGES}) {
+    // several tables growing at the same time, each append is flushed as by a checkpoint
+    njudb::DiskManager     disk_manager(false, extent_pages);
+    std::vector<file_id_t> fds;
+    for (int f = 0; f < num_files; ++f) {
+      auto fname = fmt::format("bench_prealloc_{}.tbl", f);
+      try {
+        njudb::DiskManager::CreateFile(fname);
+      } catch (njudb::NJUDBException_ &e) {
+        njudb::DiskManager::DestroyFile(fname);
+        njudb::DiskManager::CreateFile(fname);
+      }
+      fds.push_back(disk_manager.OpenFile(fname));
+    }
+    std::vector<char> page(PAGE_SIZE, 'x');
+    auto              start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_PREALLOC_PAGES; ++i) {
+      for (auto fd : fds) {
+        disk_manager.AllocatePages(fd, i + 1);
+        disk_manager.WritePage(fd, i, page.data());
+        fdatasync(fd);
+      }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    size_t                        extents = 0;
+    for (int f = 0; f < num_files; ++f) {
+      extents += FileExtents(fds[f]);
+      disk_manager.CloseFile(fds[f]);
+      njudb::DiskManager::DestroyFile(fmt::format("bench_prealloc_{}.tbl", f));
+    }
+    std::cout << fmt::format("{:>10} {:>14.0f} {:>16.1f}",
+                     extent_pages,
+                     num_files * BENCH_PREALLOC_PAGES / elapsed.count(),
+                     static_cast<double>(extents) / num_files)
+              << std::endl;
+  }
+}
+
+// the hash the page table used to be keyed by
+struct XorHash
+{
+  auto operator()(const njudb::fid_pid_t &fp) const -> size_t
+  {
+    return std::hash<file_id_t>()(fp.fid) ^ std::hash<page_id_t>()(fp.pid);
+  }
+};
+
+template <typename F>
+static auto RunLookups(int num_threads, F &&find) -> double
+{
+  std::vector<std::thread> threads;
+  std::atomic<bool>        start{false};
+  std::atomic<int>         failed{0};
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::mt19937 gen(t);
+      while (!start.load()) {
+        std::this_thread::yield();
+      }
+      for (int i = 0; i < BENCH_TABLE_LOOKUPS; ++i) {
+        auto fid = static_cast<file_id_t>(gen() % BENCH_TABLE_FILES);
+        auto pid = static_cast<page_id_t>(gen() % BENCH_PAGES_PER_FILE);
+        if (find(fid, pid) != fid * BENCH_PAGES_PER_FILE + pid) {
+          failed++;
+        }
+      }
+    });
+  }
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  EXPECT_EQ(failed.load(), 0);
+  return static_cast<double>(BENCH_TABLE_LOOKUPS) * num_threads / seconds;
+}
+
+TEST(BufferPoolBenchmark, PageTableLookup)
+{
+  constexpr size_t num_pages = static_cast<size_t>(BENCH_TABLE_FILES) * BENCH_PAGES_PER_FILE;
+  njudb::PageTable page_table(num_pages);
+  std::unordered_map<njudb::fid_pid_t, frame_id_t, XorHash> xor_map;
+  std::unordered_map<njudb::fid_pid_t, frame_id_t>          mixed_map;
+  for (file_id_t fid = 0; fid < BENCH_TABLE_FILES; ++fid) {
+    for (page_id_t pid = 0; pid < BENCH_PAGES_PER_FILE; ++pid) {
+      frame_id_t frame_id = fid * BENCH_PAGES_PER_FILE + pid;
+      page_table.Insert(fid, pid, frame_id);
+      xor_map[{fid, pid}]   = frame_id;
+      mixed_map[{fid, pid}] = frame_id;
+    }
+  }
+  ASSERT_EQ(page_table.Size(), num_pages);
+
+  std::cout << fmt::format("{:>24} {:>8} {:>16}", "table", "threads", "lookups/s") << std::endl;
+  for (int num_threads : {1, 2, 4}) {
+    auto ops = RunLookups(num_threads, [&](file_id_t fid, page_id_t pid) { return page_table.Find(fid, pid); });
+    std::cout << fmt::format("{:>24} {:>8} {:>16.0f}", "PageTable", num_threads, ops) << std::endl;
+  }
+  for (int num_threads : {1, 2, 4}) {
+    auto ops =
+        RunLookups(num_threads, [&](file_id_t fid, page_id_t pid) { return mixed_map.find({fid, pid})->second; });
+    std::cout << fmt::format("{:>24} {:>8} {:>16.0f}", "unordered_map", num_threads, ops) << std::endl;
+  }
+  // the xor hash maps the 1M keys to about 16K distinct values, a single thread is enough to see it
+  auto ops = RunLookups(1, [&](file_id_t fid, page_id_t pid) { return xor_map.find({fid, pid})->second; });
+  std::cout << fmt::format("{:>24} {:>8} {:>16.0f}", "unordered_map(xor hash)", 1, ops) << std::endl;
+
+  // erasing shifts entries back, everything left must still be found
+  for (file_id_t fid = 0; fid < BENCH_TABLE_FILES; fid += 2) {
+    for (const auto &[pid, frame_id] : page_table.GetFilePages(fid)) {
+      ASSERT_TRUE(page_table.Erase(fid, pid));
+    }
+  }
+  ASSERT_EQ(page_table.Size(), num_pages / 2);
+  for (file_id_t fid = 0; fid < BENCH_TABLE_FILES; ++fid) {
+    for (page_id_t pid = 0; pid < BENCH_PAGES_PER_FILE; ++pid) {
+      ASSERT_EQ(page_table.Find(fid, pid), fid % 2 == 0 ? INVALID_FRAME_ID : fid * BENCH_PAGES_PER_FILE + pid);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
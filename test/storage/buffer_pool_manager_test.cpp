@@ -15,9 +15,14 @@
  - along with this program.  If not, see <https://www.gnu.org/licenses/>.
  -----------------------------------------------------------------------------*/
 #include "storage/buffer/buffer_pool_manager.h"
+#include "storage/buffer/page_guard.h"
 #include "storage/buffer/replacer/lru_replacer.h"
+#include "storage/disk/async_disk_manager.h"
+#include "storage/disk/page_compressor.h"
 #include "../config.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <ctime>
@@ -27,6 +32,7 @@
 #include <filesystem>
 #include <vector>
 #include <unordered_set>
+#include <sys/stat.h>
 
 #include "gtest/gtest.h"
 
@@ -169,6 +175,271 @@ TEST(BufferPoolManagerTest, SimpleTest)
   }
 }
 
+TEST(BufferPoolManagerTest, Resize)
+{
+  njudb::DiskManager       disk_manager{};
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, 4);
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_resize.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_resize.tbl");
+    njudb::DiskManager::CreateFile("test_resize.tbl");
+  }
+  auto fd = disk_manager.OpenFile("test_resize.tbl");
+  ASSERT_EQ(buffer_pool_manager.GetPoolSize(), 4);
+  SUB_TEST(Grow)
+  {
+    // all frames are pinned, the next fetch fails until the pool grows
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_NE(buffer_pool_manager.FetchPage(fd, i), nullptr);
+    }
+    ASSERT_EQ(buffer_pool_manager.FetchPage(fd, 4), nullptr);
+    ASSERT_TRUE(buffer_pool_manager.Resize(MAX_PAGES));
+    ASSERT_EQ(buffer_pool_manager.GetPoolSize(), MAX_PAGES);
+    for (int i = 4; i < MAX_PAGES; ++i) {
+      auto page = buffer_pool_manager.FetchPage(fd, i);
+      ASSERT_NE(page, nullptr);
+      std::string data = std::to_string(i);
+      memcpy(page->GetData(), data.c_str(), data.size());
+    }
+    for (int i = 0; i < MAX_PAGES; ++i) {
+      ASSERT_TRUE(buffer_pool_manager.UnpinPage(fd, i, i >= 4));
+    }
+  }
+  SUB_TEST(Shrink)
+  {
+    // a pinned frame at the tail prevents shrinking
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, MAX_PAGES - 1), nullptr);
+    ASSERT_FALSE(buffer_pool_manager.Resize(2));
+    ASSERT_EQ(buffer_pool_manager.GetPoolSize(), MAX_PAGES);
+    ASSERT_TRUE(buffer_pool_manager.UnpinPage(fd, MAX_PAGES - 1, false));
+    ASSERT_FALSE(buffer_pool_manager.Resize(0));
+    ASSERT_TRUE(buffer_pool_manager.Resize(2));
+    ASSERT_EQ(buffer_pool_manager.GetPoolSize(), 2);
+    // released dirty frames are written back, pages are still readable through the smaller pool
+    for (int i = 4; i < MAX_PAGES; ++i) {
+      auto page = buffer_pool_manager.FetchPage(fd, i);
+      ASSERT_NE(page, nullptr);
+      std::string data = std::to_string(i);
+      ASSERT_EQ(memcmp(page->GetData(), data.c_str(), data.size()), 0);
+      buffer_pool_manager.UnpinPage(fd, i, false);
+    }
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, 0), nullptr);
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, 1), nullptr);
+    ASSERT_EQ(buffer_pool_manager.FetchPage(fd, 2), nullptr);
+    buffer_pool_manager.UnpinPage(fd, 0, false);
+    buffer_pool_manager.UnpinPage(fd, 1, false);
+  }
+  buffer_pool_manager.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_resize.tbl");
+}
+
+TEST(BufferPoolManagerTest, PageCleaner)
+{
+  constexpr int            pool_size = 8;
+  njudb::DiskManager       disk_manager{};
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, pool_size);
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_cleaner.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_cleaner.tbl");
+    njudb::DiskManager::CreateFile("test_cleaner.tbl");
+  }
+  auto fd = disk_manager.OpenFile("test_cleaner.tbl");
+  for (int i = 0; i < pool_size; ++i) {
+    auto page = buffer_pool_manager.FetchPage(fd, i);
+    ASSERT_NE(page, nullptr);
+    std::string data = std::to_string(i);
+    memcpy(page->GetData(), data.c_str(), data.size());
+    buffer_pool_manager.UnpinPage(fd, i, true);
+  }
+  // the cleaner writes back every dirty frame ahead of eviction
+  buffer_pool_manager.StartPageCleaner(pool_size);
+  for (int retry = 0; retry < 100 && buffer_pool_manager.GetStats().background_flushes < pool_size; ++retry) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  buffer_pool_manager.StopPageCleaner();
+  ASSERT_EQ(buffer_pool_manager.GetStats().background_flushes, pool_size);
+  // so misses evict clean frames only
+  for (int i = pool_size; i < 2 * pool_size; ++i) {
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, i), nullptr);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+  }
+  ASSERT_EQ(buffer_pool_manager.GetStats().foreground_flushes, 0);
+  for (int i = 0; i < pool_size; ++i) {
+    auto page = buffer_pool_manager.FetchPage(fd, i);
+    ASSERT_NE(page, nullptr);
+    std::string data = std::to_string(i);
+    ASSERT_EQ(memcmp(page->GetData(), data.c_str(), data.size()), 0);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+  }
+  buffer_pool_manager.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_cleaner.tbl");
+}
+
+TEST(BufferPoolManagerTest, ReadAhead)
+{
+  constexpr int            pool_size = 32;
+  constexpr int            num_pages = 64;
+  njudb::DiskManager       disk_manager{};
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, pool_size);
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_read_ahead.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_read_ahead.tbl");
+    njudb::DiskManager::CreateFile("test_read_ahead.tbl");
+  }
+  auto fd = disk_manager.OpenFile("test_read_ahead.tbl");
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = buffer_pool_manager.FetchPage(fd, i);
+    ASSERT_NE(page, nullptr);
+    std::string data = std::to_string(i);
+    memcpy(page->GetData(), data.c_str(), data.size());
+    buffer_pool_manager.UnpinPage(fd, i, true);
+  }
+  buffer_pool_manager.FlushAllPages(fd);
+  buffer_pool_manager.DeleteAllPages(fd);
+  auto wait_prefetches = [&](size_t expected) {
+    for (int retry = 0; retry < 100 && buffer_pool_manager.GetStats().prefetches < expected; ++retry) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(buffer_pool_manager.GetStats().prefetches, expected);
+  };
+
+  buffer_pool_manager.StartReadAhead(8);
+  // an explicit hint, pages beyond the end of the file are skipped
+  buffer_pool_manager.PrefetchPages(fd, num_pages - 2, 4);
+  wait_prefetches(2);
+  // READ_AHEAD_TRIGGER sequential misses start the read-ahead of the next 8 pages
+  auto before = buffer_pool_manager.GetStats();
+  for (int i = 0; i < static_cast<int>(READ_AHEAD_TRIGGER); ++i) {
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, i), nullptr);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+  }
+  wait_prefetches(2 + 8);
+  // the reader hits the prefetched pages, and each cold hit keeps the read-ahead going
+  for (int i = READ_AHEAD_TRIGGER; i < num_pages; ++i) {
+    auto page = buffer_pool_manager.FetchPage(fd, i);
+    ASSERT_NE(page, nullptr);
+    std::string data = std::to_string(i);
+    ASSERT_EQ(memcmp(page->GetData(), data.c_str(), data.size()), 0);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+  }
+  auto after = buffer_pool_manager.GetStats();
+  ASSERT_EQ(after.misses - before.misses + after.hits - before.hits, num_pages);
+  ASSERT_GE(after.hits - before.hits, 8);
+  // the pages at the beginning are evicted, a second scan of the file is read ahead again once the read-ahead of the
+  // first one is done
+  auto settle = [&]() {
+    size_t settled;
+    do {
+      settled = buffer_pool_manager.GetStats().prefetches;
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    } while (buffer_pool_manager.GetStats().prefetches != settled);
+  };
+  settle();
+  before = buffer_pool_manager.GetStats();
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, i), nullptr);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+    if (i + 1 == static_cast<int>(READ_AHEAD_TRIGGER)) {
+      wait_prefetches(before.prefetches + 8);
+    }
+  }
+  after = buffer_pool_manager.GetStats();
+  ASSERT_EQ(after.misses - before.misses + after.hits - before.hits, num_pages);
+  ASSERT_GE(after.hits - before.hits, 8);
+  // shrinking the pool shrinks the window to half of the new pool size
+  settle();
+  ASSERT_TRUE(buffer_pool_manager.DeleteAllPages(fd));
+  ASSERT_TRUE(buffer_pool_manager.Resize(8));
+  before = buffer_pool_manager.GetStats();
+  for (int i = 0; i < static_cast<int>(READ_AHEAD_TRIGGER); ++i) {
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, i), nullptr);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+  }
+  wait_prefetches(before.prefetches + 4);
+  settle();
+  ASSERT_EQ(buffer_pool_manager.GetStats().prefetches, before.prefetches + 4);
+  buffer_pool_manager.StopReadAhead();
+  buffer_pool_manager.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_read_ahead.tbl");
+}
+
+TEST(BufferPoolManagerTest, OptimisticRead)
+{
+  constexpr int            pool_size = 4;
+  njudb::DiskManager       disk_manager{};
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, pool_size);
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_optimistic.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_optimistic.tbl");
+    njudb::DiskManager::CreateFile("test_optimistic.tbl");
+  }
+  auto fd = disk_manager.OpenFile("test_optimistic.tbl");
+  char data[PAGE_SIZE];
+  // not cached yet
+  ASSERT_FALSE(buffer_pool_manager.ReadPageOptimistic(fd, 0, data));
+  for (int i = 0; i < pool_size; ++i) {
+    auto page = buffer_pool_manager.FetchPage(fd, i);
+    ASSERT_NE(page, nullptr);
+    std::string str = std::to_string(i);
+    memcpy(page->GetData(), str.c_str(), str.size());
+    buffer_pool_manager.UnpinPage(fd, i, true);
+  }
+  for (int i = 0; i < pool_size; ++i) {
+    ASSERT_TRUE(buffer_pool_manager.ReadPageOptimistic(fd, i, data));
+    std::string str = std::to_string(i);
+    ASSERT_EQ(memcmp(data, str.c_str(), str.size()), 0);
+  }
+  // a page held by a write guard is never copied, shared latches do not get in the way
+  njudb::PageVersion version;
+  ASSERT_TRUE(buffer_pool_manager.ReadPageOptimistic(fd, 1, data, &version));
+  {
+    auto guard = buffer_pool_manager.FetchPageRead(fd, 1);
+    ASSERT_TRUE(buffer_pool_manager.ReadPageOptimistic(fd, 1, data));
+    ASSERT_TRUE(buffer_pool_manager.ValidatePage(version));
+  }
+  {
+    auto guard = buffer_pool_manager.FetchPageWrite(fd, 1);
+    ASSERT_FALSE(buffer_pool_manager.ReadPageOptimistic(fd, 1, data));
+    ASSERT_FALSE(buffer_pool_manager.ValidatePage(version));
+  }
+  ASSERT_FALSE(buffer_pool_manager.ValidatePage(version));
+  ASSERT_TRUE(buffer_pool_manager.ReadPageOptimistic(fd, 1, data, &version));
+  ASSERT_TRUE(buffer_pool_manager.ValidatePage(version));
+  // a deleted or evicted page is no longer readable, even if its frame is found
+  ASSERT_TRUE(buffer_pool_manager.DeletePage(fd, 0));
+  ASSERT_FALSE(buffer_pool_manager.ReadPageOptimistic(fd, 0, data));
+  for (int i = pool_size; i < 2 * pool_size; ++i) {
+    ASSERT_NE(buffer_pool_manager.FetchPage(fd, i), nullptr);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+  }
+  for (int i = 0; i < pool_size; ++i) {
+    ASSERT_FALSE(buffer_pool_manager.ReadPageOptimistic(fd, i, data));
+  }
+  buffer_pool_manager.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_optimistic.tbl");
+}
+
+
 class Progress
 {
 public:
@@ -197,6 +468,513 @@ private:
   std::mutex       mtx_;
 };
 
+TEST(BufferPoolManagerTest, ConcurrentDiskIO)
+{
+  constexpr int      num_threads = 4;
+  constexpr int      num_pages   = 64;
+  njudb::DiskManager disk_manager{};
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_disk_io.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_disk_io.tbl");
+    njudb::DiskManager::CreateFile("test_disk_io.tbl");
+  }
+  auto fd = disk_manager.OpenFile("test_disk_io.tbl");
+  // each thread writes and reads back its own pages of the shared fd, no page may see another one's data
+  std::vector<std::thread> threads;
+  std::atomic<int>         mismatches{0};
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<char> out(PAGE_SIZE);
+      std::vector<char> in(PAGE_SIZE);
+      for (int round = 0; round < 8; ++round) {
+        for (int i = t; i < num_pages; i += num_threads) {
+          memset(out.data(), 'a' + (i + round) % 26, PAGE_SIZE);
+          disk_manager.WritePage(fd, i, out.data());
+          disk_manager.ReadPage(fd, i, in.data());
+          if (memcmp(in.data(), out.data(), PAGE_SIZE) != 0) {
+            mismatches++;
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(mismatches, 0);
+  ASSERT_EQ(disk_manager.GetFileSize(fd), static_cast<size_t>(num_pages) * PAGE_SIZE);
+
+  // a page beyond the end of the file reads as zeros
+  std::vector<char> page(PAGE_SIZE, 'x');
+  disk_manager.ReadPage(fd, num_pages + 1, page.data());
+  ASSERT_EQ(std::count(page.begin(), page.end(), 0), PAGE_SIZE);
+
+  // the file cursor is not moved by page I/O
+  const char header[] = "header";
+  disk_manager.WriteFile(fd, header, 3, SEEK_SET);
+  disk_manager.WritePage(fd, 1, page.data());
+  disk_manager.WriteFile(fd, header + 3, 3, SEEK_CUR);
+  char buf[6];
+  disk_manager.ReadFile(fd, buf, sizeof(buf), 0, SEEK_SET);
+  ASSERT_EQ(memcmp(buf, header, sizeof(buf)), 0);
+  // reading past the end of the file fills the rest with zeros
+  char tail[8];
+  memset(tail, 'x', sizeof(tail));
+  disk_manager.ReadFile(fd, tail, sizeof(tail), num_pages * PAGE_SIZE - 4, SEEK_SET);
+  ASSERT_EQ(std::count(tail, tail + 4, 'a' + (num_pages - 1 + 7) % 26), 4);
+  ASSERT_EQ(std::count(tail + 4, tail + 8, 0), 4);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_disk_io.tbl");
+}
+
+TEST(BufferPoolManagerTest, DirectIO)
+{
+  constexpr int            pool_size = 8;
+  constexpr int            num_pages = 32;
+  njudb::DiskManager       disk_manager(true);
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, pool_size);
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_direct_io.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_direct_io.tbl");
+    njudb::DiskManager::CreateFile("test_direct_io.tbl");
+  }
+  auto fd = disk_manager.OpenFile("test_direct_io.tbl");
+  ASSERT_NE(disk_manager.GetPageFd(fd), fd);
+  // an unaligned header written through the buffered cursor, as the table manager does, is seen by page I/O
+  const char header[] = "header";
+  disk_manager.WriteFile(fd, header, sizeof(header), SEEK_SET);
+  {
+    auto page = buffer_pool_manager.FetchPage(fd, 0);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(page->GetData()) % PAGE_SIZE, 0);
+    ASSERT_EQ(memcmp(page->GetData(), header, sizeof(header)), 0);
+    buffer_pool_manager.UnpinPage(fd, 0, false);
+  }
+  // the pool is smaller than the file, pages go to and come back from the disk through the O_DIRECT fd
+  for (int i = 1; i < num_pages; ++i) {
+    auto        page = buffer_pool_manager.FetchPage(fd, i);
+    std::string data = std::to_string(i);
+    memcpy(page->GetData(), data.c_str(), data.size());
+    buffer_pool_manager.UnpinPage(fd, i, true);
+  }
+  for (int i = 1; i < num_pages; ++i) {
+    auto        page = buffer_pool_manager.FetchPage(fd, i);
+    std::string data = std::to_string(i);
+    ASSERT_EQ(memcmp(page->GetData(), data.c_str(), data.size()), 0);
+    buffer_pool_manager.UnpinPage(fd, i, false);
+  }
+  buffer_pool_manager.FlushAllPages(fd);
+  char buf[2];
+  disk_manager.ReadFile(fd, buf, sizeof(buf), (num_pages - 1) * PAGE_SIZE, SEEK_SET);
+  ASSERT_EQ(memcmp(buf, std::to_string(num_pages - 1).c_str(), sizeof(buf)), 0);
+  buffer_pool_manager.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_direct_io.tbl");
+}
+
+TEST(BufferPoolManagerTest, VectoredIO)
+{
+  constexpr int      num_pages = 2048 + 3;  // more than IOV_MAX
+  njudb::DiskManager disk_manager{};
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_vectored_io.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_vectored_io.tbl");
+    njudb::DiskManager::CreateFile("test_vectored_io.tbl");
+  }
+  auto                      fd = disk_manager.OpenFile("test_vectored_io.tbl");
+  std::vector<char>         out(static_cast<size_t>(num_pages) * PAGE_SIZE);
+  std::vector<const char *> out_pages;
+  for (int i = 0; i < num_pages; ++i) {
+    memset(out.data() + i * PAGE_SIZE, 'a' + i % 26, PAGE_SIZE);
+    out_pages.push_back(out.data() + i * PAGE_SIZE);
+  }
+  disk_manager.WritePages(fd, 1, out_pages);
+  ASSERT_EQ(disk_manager.GetFileSize(fd), static_cast<size_t>(num_pages + 1) * PAGE_SIZE);
+  // the read starts in the middle and runs 2 pages past the end of the file
+  std::vector<char>   in(static_cast<size_t>(num_pages) * PAGE_SIZE, 'x');
+  std::vector<char *> in_pages;
+  for (int i = 0; i < num_pages; ++i) {
+    in_pages.push_back(in.data() + i * PAGE_SIZE);
+  }
+  disk_manager.ReadPages(fd, 3, in_pages);
+  ASSERT_EQ(memcmp(in.data(), out.data() + 2 * PAGE_SIZE, (num_pages - 2) * PAGE_SIZE), 0);
+  ASSERT_EQ(std::count(in.end() - 2 * PAGE_SIZE, in.end(), 0), 2 * PAGE_SIZE);
+
+  // FlushAllPages writes the dirty pages in page id order, with and without holes between them
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, 64);
+  for (int i = 0; i < 64; ++i) {
+    if (i % 8 == 7) {
+      continue;
+    }
+    auto page = buffer_pool_manager.FetchPage(fd, i);
+    memset(page->GetData(), 'A' + i % 26, PAGE_SIZE);
+    buffer_pool_manager.UnpinPage(fd, i, true);
+  }
+  buffer_pool_manager.FlushAllPages(fd);
+  std::vector<char> page(PAGE_SIZE);
+  for (int i = 0; i < 64; ++i) {
+    disk_manager.ReadPage(fd, i, page.data());
+    char expected = i % 8 == 7 ? 'a' + (i - 1) % 26 : 'A' + i % 26;
+    ASSERT_EQ(std::count(page.begin(), page.end(), expected), PAGE_SIZE) << i;
+  }
+  buffer_pool_manager.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_vectored_io.tbl");
+}
+
+TEST(BufferPoolManagerTest, Preallocation)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  for (size_t extent_pages : {0, 16}) {
+    njudb::DiskManager disk_manager(false, extent_pages);
+    try {
+      njudb::DiskManager::CreateFile("test_prealloc.tbl");
+    } catch (njudb::NJUDBException_ &e) {
+      njudb::DiskManager::DestroyFile("test_prealloc.tbl");
+      njudb::DiskManager::CreateFile("test_prealloc.tbl");
+    }
+    auto              fd = disk_manager.OpenFile("test_prealloc.tbl");
+    std::vector<char> page(PAGE_SIZE, 'x');
+    for (int i = 0; i < 20; ++i) {
+      disk_manager.AllocatePages(fd, i + 1);
+      disk_manager.WritePage(fd, i, page.data());
+    }
+    // the reservation is a whole number of extents, the file size is what has been written
+    ASSERT_EQ(disk_manager.GetAllocatedPages(fd), extent_pages == 0 ? 0 : 32);
+    ASSERT_EQ(disk_manager.GetFileSize(fd), 20 * PAGE_SIZE);
+    struct stat st{};
+    fstat(fd, &st);
+    ASSERT_GE(static_cast<size_t>(st.st_blocks) * 512, (extent_pages == 0 ? 20 : 32) * PAGE_SIZE);
+    disk_manager.CloseFile(fd);
+    // a reopened file counts its pages as allocated
+    fd = disk_manager.OpenFile("test_prealloc.tbl");
+    ASSERT_EQ(disk_manager.GetAllocatedPages(fd), 20);
+    // concurrent growers claim different extents and the reservation covers all of them
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&disk_manager, fd, t]() {
+        for (size_t i = 20; i < 200; i += 4) {
+          disk_manager.AllocatePages(fd, i + t + 1);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    if (extent_pages != 0) {
+      ASSERT_GE(disk_manager.GetAllocatedPages(fd), 200);
+      ASSERT_EQ(disk_manager.GetAllocatedPages(fd) % extent_pages, 0);
+      fstat(fd, &st);
+      ASSERT_GE(static_cast<size_t>(st.st_blocks) * 512, 200 * PAGE_SIZE);
+    }
+    disk_manager.CloseFile(fd);
+    njudb::DiskManager::DestroyFile("test_prealloc.tbl");
+  }
+}
+
+TEST(BufferPoolManagerTest, AsyncDiskIO)
+{
+  constexpr int      num_pages = 64;
+  njudb::DiskManager disk_manager{};
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  for (bool use_io_uring : {true, false}) {
+    try {
+      njudb::DiskManager::CreateFile("test_async_io.tbl");
+    } catch (njudb::NJUDBException_ &e) {
+      njudb::DiskManager::DestroyFile("test_async_io.tbl");
+      njudb::DiskManager::CreateFile("test_async_io.tbl");
+    }
+    auto fd = disk_manager.OpenFile("test_async_io.tbl");
+    {
+      // a queue depth smaller than the batch makes Submit wait for completions
+      njudb::AsyncDiskManager async_disk_manager(&disk_manager, 16, use_io_uring);
+      std::vector<std::vector<char>>                pages(num_pages, std::vector<char>(PAGE_SIZE));
+      std::vector<njudb::AsyncDiskManager::Request> requests;
+      std::atomic<int>                              completed{0};
+      for (int i = 0; i < num_pages; ++i) {
+        memset(pages[i].data(), 'a' + i % 26, PAGE_SIZE);
+        requests.push_back({true, fd, i, pages[i].data(), [&completed](int err) {
+                              if (err == 0) {
+                                completed++;
+                              }
+                            }});
+      }
+      async_disk_manager.Submit(std::move(requests));
+      async_disk_manager.Wait();
+      ASSERT_EQ(completed, num_pages);
+
+      std::vector<std::vector<char>> in(num_pages + 1, std::vector<char>(PAGE_SIZE, 'x'));
+      std::vector<std::future<void>> futures;
+      for (int i = 0; i <= num_pages; ++i) {
+        futures.push_back(async_disk_manager.ReadPage(fd, i, in[i].data()));
+      }
+      for (auto &future : futures) {
+        future.get();
+      }
+      for (int i = 0; i < num_pages; ++i) {
+        ASSERT_EQ(memcmp(in[i].data(), pages[i].data(), PAGE_SIZE), 0);
+      }
+      // the page beyond the end of the file reads as zeros
+      ASSERT_EQ(std::count(in[num_pages].begin(), in[num_pages].end(), 0), PAGE_SIZE);
+    }
+    disk_manager.CloseFile(fd);
+    njudb::DiskManager::DestroyFile("test_async_io.tbl");
+  }
+}
+
+TEST(BufferPoolManagerTest, PageChecksum)
+{
+  // known answer of CRC32C, the hardware and the table driven implementations agree
+  ASSERT_EQ(njudb::Crc32c::Compute("123456789", 9), 0xe3069283u);
+  std::vector<char> random(PAGE_SIZE + 7);
+  for (auto &c : random) {
+    c = static_cast<char>(rand());
+  }
+  ASSERT_EQ(njudb::Crc32c::Compute(random.data() + 3, PAGE_SIZE + 1),
+      njudb::Crc32c::ExtendTable(0, random.data() + 3, PAGE_SIZE + 1));
+
+  njudb::DiskManager disk_manager{};
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  try {
+    njudb::DiskManager::CreateFile("test_page_checksum.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_page_checksum.tbl");
+    njudb::DiskManager::CreateFile("test_page_checksum.tbl");
+  }
+  auto              fd = disk_manager.OpenFile("test_page_checksum.tbl");
+  std::vector<char> page(PAGE_SIZE, 'p');
+  memset(page.data() + PAGE_CHECKSUM_OFFSET, 0, sizeof(uint32_t));
+  // a page written without a checksum still reads once checksums are verified
+  disk_manager.WritePage(fd, 1, page.data());
+  disk_manager.SetPageChecksum(fd, true);
+  disk_manager.ReadPage(fd, 1, page.data());
+
+  // pages written one by one and by FlushAllPages are stamped, the pages in the buffer pool are left untouched
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, 64);
+  for (int i = 1; i < 32; ++i) {
+    auto pg = buffer_pool_manager.FetchPage(fd, i);
+    memset(pg->GetData() + PAGE_HEADER_SIZE, 'A' + i % 26, PAGE_SIZE - PAGE_HEADER_SIZE);
+    buffer_pool_manager.UnpinPage(fd, i, true);
+    if (i % 2 == 0) {
+      buffer_pool_manager.FlushPage(fd, i);
+    }
+  }
+  buffer_pool_manager.FlushAllPages(fd);
+  ASSERT_EQ(*reinterpret_cast<uint32_t *>(buffer_pool_manager.FetchPage(fd, 5)->GetData() + PAGE_CHECKSUM_OFFSET), 0);
+  buffer_pool_manager.UnpinPage(fd, 5, false);
+  buffer_pool_manager.DeleteAllPages(fd);
+  for (int i = 1; i < 32; ++i) {
+    disk_manager.ReadPage(fd, i, page.data());
+    ASSERT_NE(*reinterpret_cast<uint32_t *>(page.data() + PAGE_CHECKSUM_OFFSET), 0);
+    ASSERT_EQ(page[PAGE_SIZE - 1], 'A' + i % 26);
+  }
+
+  // flip a bit behind the back of the disk manager
+  char byte;
+  ASSERT_EQ(pread(fd, &byte, 1, 7 * PAGE_SIZE + 100), 1);
+  byte ^= 0x10;
+  ASSERT_EQ(pwrite(fd, &byte, 1, 7 * PAGE_SIZE + 100), 1);
+  try {
+    disk_manager.ReadPage(fd, 7, page.data());
+    FAIL() << "corrupted page read";
+  } catch (njudb::NJUDBException_ &e) {
+    ASSERT_EQ(e.type_, njudb::NJUDB_PAGE_CORRUPTED);
+  }
+  std::vector<char *> pages{page.data(), page.data()};
+  ASSERT_THROW(disk_manager.ReadPages(fd, 6, pages), njudb::NJUDBException_);
+  // the buffer pool fails the fetch as it does for other read errors
+  ASSERT_EQ(buffer_pool_manager.FetchPage(fd, 7), nullptr);
+  for (bool use_io_uring : {true, false}) {
+    njudb::AsyncDiskManager async_disk_manager(&disk_manager, ASYNC_IO_QUEUE_DEPTH, use_io_uring);
+    ASSERT_THROW(async_disk_manager.ReadPage(fd, 7, page.data()).get(), njudb::NJUDBException_);
+    int err = 0;
+    async_disk_manager.Submit({{false, fd, 7, page.data(), [&err](int e) { err = e; }}});
+    async_disk_manager.Wait();
+    ASSERT_EQ(err, EBADMSG);
+    async_disk_manager.ReadPage(fd, 8, page.data()).get();
+    // the page written is stamped on disk, not in the buffer of the caller
+    memset(page.data() + PAGE_CHECKSUM_OFFSET, 0, sizeof(uint32_t));
+    async_disk_manager.WritePage(fd, 8, page.data()).get();
+    ASSERT_EQ(*reinterpret_cast<uint32_t *>(page.data() + PAGE_CHECKSUM_OFFSET), 0);
+    async_disk_manager.ReadPage(fd, 8, page.data()).get();
+    ASSERT_NE(*reinterpret_cast<uint32_t *>(page.data() + PAGE_CHECKSUM_OFFSET), 0);
+  }
+  // the pages are still stamped but no longer verified
+  disk_manager.SetPageChecksum(fd, false);
+  disk_manager.ReadPage(fd, 7, page.data());
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_page_checksum.tbl");
+}
+
+TEST(BufferPoolManagerTest, PageCompression)
+{
+  std::vector<PageCompression> codecs;
+  for (auto codec : {PAGE_COMPRESSION_LZ4, PAGE_COMPRESSION_ZSTD, PAGE_COMPRESSION_ZLIB}) {
+    if (njudb::PageCompressor::IsAvailable(codec)) {
+      codecs.push_back(codec);
+    }
+  }
+  if (codecs.empty()) {
+    GTEST_SKIP() << "no page compression codec available";
+  }
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+  // a page of repeated records compresses well, a page of random bytes does not compress at all
+  auto fill_page = [](char *data, int pid, bool random) {
+    for (size_t i = PAGE_HEADER_SIZE; i < PAGE_SIZE; ++i) {
+      data[i] = random ? static_cast<char>(rand()) : static_cast<char>('a' + (i / 64 + pid) % 26);
+    }
+  };
+  const int num_pages = 64;
+  for (auto codec : codecs) {
+    std::cout << "Page compression " << PageCompressionToString(codec) << std::endl;
+    try {
+      njudb::DiskManager::CreateFile("test_page_compression.tbl", codec);
+    } catch (njudb::NJUDBException_ &e) {
+      njudb::DiskManager::DestroyFile("test_page_compression.tbl");
+      njudb::DiskManager::CreateFile("test_page_compression.tbl", codec);
+    }
+    // compressed files do not use direct I/O
+    njudb::DiskManager disk_manager(true);
+    auto               fd = disk_manager.OpenFile("test_page_compression.tbl");
+    ASSERT_EQ(disk_manager.GetPageCompression(fd), codec);
+    ASSERT_EQ(disk_manager.GetPageFd(fd), fd);
+    ASSERT_THROW(disk_manager.MapFile(fd), njudb::NJUDBException_);
+    disk_manager.SetPageChecksum(fd, true);
+    std::vector<char> header(PAGE_SIZE, 'h');
+    disk_manager.WriteFile(fd, header.data(), PAGE_SIZE, SEEK_SET);
+    {
+      njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, 16);
+      for (int i = 1; i < num_pages; ++i) {
+        auto pg = buffer_pool_manager.FetchPage(fd, i);
+        fill_page(pg->GetData(), i, i % 8 == 0);
+        buffer_pool_manager.UnpinPage(fd, i, true);
+      }
+      buffer_pool_manager.FlushAllPages(fd);
+      buffer_pool_manager.DeleteAllPages(fd);
+    }
+    ASSERT_EQ(disk_manager.GetFileSize(fd), num_pages * PAGE_SIZE);
+    disk_manager.CloseFile(fd);
+    // the header page is stored as is, the other pages take far less space
+    auto file_size = std::filesystem::file_size("test_page_compression.tbl");
+    ASSERT_LT(file_size, num_pages * PAGE_SIZE / 2);
+
+    fd = disk_manager.OpenFile("test_page_compression.tbl");
+    disk_manager.SetPageChecksum(fd, true);
+    std::vector<char> page(PAGE_SIZE);
+    std::vector<char> expected(PAGE_SIZE);
+    disk_manager.ReadPage(fd, 0, page.data());
+    ASSERT_EQ(page, header);
+    for (int i = 1; i < num_pages; ++i) {
+      disk_manager.ReadPage(fd, i, page.data());
+      if (i % 8 != 0) {
+        fill_page(expected.data(), i, false);
+        ASSERT_EQ(memcmp(page.data() + PAGE_HEADER_SIZE, expected.data() + PAGE_HEADER_SIZE,
+                      PAGE_SIZE - PAGE_HEADER_SIZE), 0);
+      }
+    }
+    // a page never written reads as zeros
+    disk_manager.ReadPage(fd, num_pages + 10, page.data());
+    ASSERT_TRUE(std::all_of(page.begin(), page.end(), [](char c) { return c == 0; }));
+
+    // pages that grow move to another slot, pages that shrink stay in theirs and leave room to the others
+    std::vector<char *> pages;
+    std::vector<std::vector<char>> contents(num_pages, std::vector<char>(PAGE_SIZE, 0));
+    for (int i = 1; i < num_pages; ++i) {
+      fill_page(contents[i].data(), i + 1, i % 2 == 0);
+      pages.push_back(contents[i].data());
+    }
+    disk_manager.WritePages(fd, 1, {pages.begin(), pages.end()});
+    for (int i = 1; i < num_pages; ++i) {
+      fill_page(contents[i].data(), i + 2, i % 2 != 0);
+      disk_manager.WritePage(fd, i, contents[i].data());
+    }
+    disk_manager.CloseFile(fd);
+    // half of the pages grew twice, the file is still far from holding two copies of the pages
+    file_size = std::filesystem::file_size("test_page_compression.tbl");
+    ASSERT_LT(file_size, 2 * num_pages * PAGE_SIZE);
+    // the free slots are found again when the file is reopened, pages that keep their size stay in place
+    fd = disk_manager.OpenFile("test_page_compression.tbl");
+    for (int i = 1; i < num_pages; ++i) {
+      disk_manager.WritePage(fd, i, contents[i].data());
+    }
+    disk_manager.CloseFile(fd);
+    ASSERT_EQ(std::filesystem::file_size("test_page_compression.tbl"), file_size);
+
+    fd = disk_manager.OpenFile("test_page_compression.tbl");
+    disk_manager.SetPageChecksum(fd, true);
+    std::vector<char *> read(num_pages - 1);
+    std::vector<std::vector<char>> buffers(num_pages, std::vector<char>(PAGE_SIZE));
+    for (int i = 1; i < num_pages; ++i) {
+      read[i - 1] = buffers[i].data();
+    }
+    disk_manager.ReadPages(fd, 1, read);
+    for (int i = 1; i < num_pages; ++i) {
+      ASSERT_EQ(memcmp(buffers[i].data() + PAGE_HEADER_SIZE, contents[i].data() + PAGE_HEADER_SIZE,
+                    PAGE_SIZE - PAGE_HEADER_SIZE), 0);
+      ASSERT_TRUE(PageChecksumMatches(buffers[i].data()));
+    }
+    {
+      njudb::AsyncDiskManager async_disk_manager(&disk_manager);
+      async_disk_manager.ReadPage(fd, 3, page.data()).get();
+      ASSERT_EQ(memcmp(page.data() + PAGE_HEADER_SIZE, contents[3].data() + PAGE_HEADER_SIZE, 16), 0);
+    }
+
+    // a compressed page that is damaged on disk no longer decompresses or no longer matches its checksum
+    std::vector<char> garbage(PAGE_SIZE, 0x5a);
+    ASSERT_EQ(pwrite(fd, garbage.data(), PAGE_SIZE, PAGE_SIZE), static_cast<ssize_t>(PAGE_SIZE));
+    int corrupted = 0;
+    for (int i = 1; i < num_pages; ++i) {
+      try {
+        disk_manager.ReadPage(fd, i, page.data());
+      } catch (njudb::NJUDBException_ &e) {
+        ASSERT_EQ(e.type_, njudb::NJUDB_PAGE_CORRUPTED);
+        corrupted++;
+      }
+    }
+    ASSERT_GT(corrupted, 0);
+
+    // the page map is written through, another disk manager opening the file without it being closed, as after a
+    // crash, finds the pages that moved, reused the slots of others or were added since it was opened
+    contents.resize(num_pages + 1, std::vector<char>(PAGE_SIZE, 0));
+    for (int i = 1; i <= num_pages; ++i) {
+      fill_page(contents[i].data(), i + 3, i % 2 == 0);
+      disk_manager.WritePage(fd, i, contents[i].data());
+    }
+    {
+      njudb::DiskManager other_disk_manager;
+      auto               other_fd = other_disk_manager.OpenFile("test_page_compression.tbl");
+      for (int i = 1; i <= num_pages; ++i) {
+        other_disk_manager.ReadPage(other_fd, i, page.data());
+        ASSERT_EQ(memcmp(page.data() + PAGE_HEADER_SIZE, contents[i].data() + PAGE_HEADER_SIZE,
+                      PAGE_SIZE - PAGE_HEADER_SIZE), 0);
+      }
+      other_disk_manager.CloseFile(other_fd);
+    }
+    disk_manager.CloseFile(fd);
+    njudb::DiskManager::DestroyFile("test_page_compression.tbl");
+    ASSERT_FALSE(std::filesystem::exists("test_page_compression.tbl" + PAGE_MAP_SUFFIX));
+  }
+}
+
 TEST(BufferPoolManagerTest, MultiThread)
 {
   njudb::DiskManager       disk_manager{};
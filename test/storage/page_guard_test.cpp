@@ -340,6 +340,101 @@ TEST(PageGuardTest, MultiThreadTest)
   njudb::DiskManager::DestroyFile("test_page_guard_mt.tbl");
 }
 
+TEST(PageGuardTest, LatchStress)
+{
+  constexpr int NUM_PAGES    = 4;
+  constexpr int NUM_READERS  = 8;
+  constexpr int NUM_WRITERS  = 4;
+  constexpr int NUM_UPGRADES = 4;
+  constexpr int ITERATIONS   = 2000;
+
+  njudb::DiskManager       disk_manager{};
+  njudb::BufferPoolManager buffer_pool_manager(&disk_manager, nullptr, 0, MAX_PAGES);
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+
+  try {
+    njudb::DiskManager::CreateFile("test_page_guard_latch.tbl");
+  } catch (njudb::NJUDBException_ &e) {
+    njudb::DiskManager::DestroyFile("test_page_guard_latch.tbl");
+    njudb::DiskManager::CreateFile("test_page_guard_latch.tbl");
+  }
+  auto fd = disk_manager.OpenFile("test_page_guard_latch.tbl");
+
+  // every page holds two counters which writers bump one after the other, a reader seeing them differ has raced a
+  // writer
+  for (int i = 0; i < NUM_PAGES; ++i) {
+    auto guard = buffer_pool_manager.FetchPageWrite(fd, i);
+    std::memset(guard.GetMutableData(), 0, 2 * sizeof(int));
+  }
+  auto bump = [](char *data) {
+    auto counters = reinterpret_cast<volatile int *>(data);
+    counters[0]   = counters[0] + 1;
+    std::this_thread::yield();
+    counters[1] = counters[1] + 1;
+  };
+  auto torn = [](const char *data) {
+    auto counters = reinterpret_cast<const volatile int *>(data);
+    return counters[0] != counters[1];
+  };
+
+  std::atomic<int>         torn_reads(0);
+  std::atomic<int>         in_place_upgrades(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < NUM_READERS; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < ITERATIONS; ++i) {
+        auto guard = buffer_pool_manager.FetchPageRead(fd, (t + i) % NUM_PAGES);
+        if (torn(guard.GetData())) {
+          torn_reads++;
+        }
+      }
+    });
+  }
+  for (int t = 0; t < NUM_WRITERS; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < ITERATIONS; ++i) {
+        auto guard = buffer_pool_manager.FetchPageWrite(fd, (t + i) % NUM_PAGES);
+        bump(guard.GetMutableData());
+      }
+    });
+  }
+  for (int t = 0; t < NUM_UPGRADES; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < ITERATIONS; ++i) {
+        auto read_guard = buffer_pool_manager.FetchPageRead(fd, (t + i) % NUM_PAGES);
+        if (torn(read_guard.GetData())) {
+          torn_reads++;
+        }
+        bool in_place    = false;
+        auto write_guard = read_guard.UpgradeToWrite(&in_place);
+        ASSERT_EQ(read_guard.GetPage(), nullptr);
+        in_place_upgrades += in_place ? 1 : 0;
+        bump(write_guard.GetMutableData());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(torn_reads.load(), 0);
+  EXPECT_GT(in_place_upgrades.load(), 0);
+  long total = 0;
+  for (int i = 0; i < NUM_PAGES; ++i) {
+    auto guard    = buffer_pool_manager.FetchPageRead(fd, i);
+    auto counters = reinterpret_cast<const int *>(guard.GetData());
+    EXPECT_EQ(counters[0], counters[1]);
+    total += counters[0];
+  }
+  EXPECT_EQ(total, static_cast<long>(NUM_WRITERS + NUM_UPGRADES) * ITERATIONS);
+
+  buffer_pool_manager.DeleteAllPages(fd);
+  disk_manager.CloseFile(fd);
+  njudb::DiskManager::DestroyFile("test_page_guard_latch.tbl");
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,173 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+#include "../config.h"
+#include "common/types.h"
+#include "common/value.h"
+#include "storage/index/index_bptree.h"
+#include "storage/buffer/buffer_pool_manager.h"
+#include "storage/disk/disk_manager.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+
+using namespace njudb;
+
+// the index (about 30 pages) fits in the pool, the scanned table (1024 pages) does not
+constexpr size_t BENCH_POOL_SIZE        = 64;
+constexpr int    BENCH_INDEX_KEYS       = 4000;
+constexpr int    BENCH_TABLE_PAGES      = 1024;
+constexpr int    BENCH_LOOKUPS          = 20000;
+constexpr int    BENCH_SCANNERS         = 2;
+constexpr int    BENCH_PAGES_PER_LOOKUP = 2;  // pages each scanner reads per point lookup, keeps the mix stable
+
+static auto MakeKey(const RecordSchema *schema, int key) -> RecordUptr
+{
+  std::vector<ValueSptr> values;
+  values.emplace_back(ValueFactory::CreateValue(TYPE_INT, reinterpret_cast<char *>(&key), sizeof(int)));
+  return std::make_unique<Record>(schema, values, INVALID_RID);
+}
+
+static void CreateFileIfNotExists(const std::string &fname)
+{
+  try {
+    DiskManager::CreateFile(fname);
+  } catch (NJUDBException_ &e) {
+    DiskManager::DestroyFile(fname);
+    DiskManager::CreateFile(fname);
+  }
+}
+
+/**
+ * Probe the index from the foreground while BENCH_SCANNERS threads scan the table, print the hit ratio of the pool
+ * @param replacer replacer of the buffer pool
+ * @param ring whether the scanners read through a BufferAccessStrategy
+ */
+static void RunLookupsWithScans(const std::string &replacer, bool ring)
+{
+  CreateFileIfNotExists("bench_replacer.idx");
+  CreateFileIfNotExists("bench_replacer.tbl");
+  DiskManager disk_manager{};
+  auto        index_fd = disk_manager.OpenFile("bench_replacer.idx");
+  auto        table_fd = disk_manager.OpenFile("bench_replacer.tbl");
+  {
+    BufferPoolManager bpm(&disk_manager, nullptr, 2, BENCH_POOL_SIZE, 1, replacer);
+
+    std::vector<RTField> fields;
+    RTField              key_field;
+    key_field.field_.field_name_ = "key";
+    key_field.field_.field_type_ = TYPE_INT;
+    key_field.field_.field_size_ = sizeof(int);
+    key_field.field_.table_id_   = index_fd;
+    fields.push_back(key_field);
+    RecordSchema schema(fields);
+    BPTreeIndex  index(&disk_manager, &bpm, index_fd, &schema);
+    for (int i = 0; i < BENCH_INDEX_KEYS; ++i) {
+      index.Insert(*MakeKey(&schema, i), RID{i / 100, i % 100});
+    }
+    for (int i = 0; i < BENCH_TABLE_PAGES; ++i) {
+      ASSERT_NE(bpm.FetchPage(table_fd, i), nullptr);
+      bpm.UnpinPage(table_fd, i, true);
+    }
+    bpm.FlushAllPages(table_fd);
+    auto before = bpm.GetStats();
+
+    // large scans run in the background while the foreground keeps probing the index
+    std::atomic<bool>        stop{false};
+    std::atomic<int>         lookups{0};
+    std::vector<std::thread> scanners;
+    for (int t = 0; t < BENCH_SCANNERS; ++t) {
+      scanners.emplace_back([&, t]() {
+        BufferAccessStrategy strategy;
+        for (long scanned = 0; !stop.load(); scanned++) {
+          while (scanned >= static_cast<long>(lookups.load()) * BENCH_PAGES_PER_LOOKUP && !stop.load()) {
+            std::this_thread::yield();
+          }
+          auto pid = static_cast<page_id_t>((scanned + t * BENCH_TABLE_PAGES / BENCH_SCANNERS) % BENCH_TABLE_PAGES);
+          if (bpm.FetchPage(table_fd, pid, ring ? &strategy : nullptr) != nullptr) {
+            bpm.UnpinPage(table_fd, pid, false);
+          }
+        }
+      });
+    }
+    std::mt19937 gen(0);
+    auto         begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_LOOKUPS; ++i) {
+      int  key    = static_cast<int>(gen() % BENCH_INDEX_KEYS);
+      auto result = index.Search(*MakeKey(&schema, key));
+      ASSERT_EQ(result.size(), 1);
+      lookups++;
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    stop.store(true);
+    for (auto &scanner : scanners) {
+      scanner.join();
+    }
+
+    auto after  = bpm.GetStats();
+    auto hits   = after.hits - before.hits;
+    auto misses = after.misses - before.misses;
+    std::cout << fmt::format("{:>18} {:>10} {:>10} {:>10.3f} {:>14.0f}", ring ? replacer + "+ring" : replacer, hits, misses,
+                     static_cast<double>(hits) / static_cast<double>(hits + misses), BENCH_LOOKUPS / seconds)
+              << std::endl;
+    bpm.DeleteAllPages(index_fd);
+    bpm.DeleteAllPages(table_fd);
+  }
+  disk_manager.CloseFile(index_fd);
+  disk_manager.CloseFile(table_fd);
+  DiskManager::DestroyFile("bench_replacer.idx");
+  DiskManager::DestroyFile("bench_replacer.tbl");
+}
+
+static void PrintHeader()
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::filesystem::current_path(TEST_DIR);
+
+  std::cout << fmt::format("{:>18} {:>10} {:>10} {:>10} {:>14}", "replacer", "hits", "misses", "hit ratio", "lookups/s")
+            << std::endl;
+}
+
+TEST(ReplacerBenchmark, PointLookupsWithScans)
+{
+  PrintHeader();
+  for (const std::string replacer : {"LRUReplacer", "LRUKReplacer", "TwoQueueReplacer"}) {
+    RunLookupsWithScans(replacer, false);
+  }
+}
+
+// the same workload with the scanners confined to their rings, the index should stay cached even under plain LRU
+TEST(ReplacerBenchmark, PointLookupsWithRingScans)
+{
+  PrintHeader();
+  RunLookupsWithScans("LRUReplacer", false);
+  RunLookupsWithScans("LRUReplacer", true);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -20,6 +20,7 @@
 //
 #include "storage/buffer/replacer/lru_replacer.h"
 #include "storage/buffer/replacer/lru_k_replacer.h"
+#include "storage/buffer/replacer/two_queue_replacer.h"
 
 #include "../config.h"
 #include "common/types.h"
@@ -244,6 +245,59 @@ TEST(ReplacerTest, LRUK)
     ASSERT_EQ(replacer.Size(), 0);
   }
 
+  // compare with a scan over all frames, which is how the victim used to be chosen
+  SUB_TEST(RandomlyCompareWithScan)
+  {
+    struct ModelNode
+    {
+      std::list<timestamp_t> history;
+      bool                   evictable{false};
+    };
+    constexpr int                             num_frames      = 64;
+    auto                                      custom_replacer = njudb::LRUKReplacer(k, num_frames);
+    std::unordered_map<frame_id_t, ModelNode> model;
+    timestamp_t                               ts = 0;
+    for (int i = 0; i < 100000; ++i) {
+      frame_id_t frame_id = rand() % num_frames;
+      int        op       = rand() % 3;
+      if (op == 0) {
+        custom_replacer.Pin(frame_id);
+        auto &node = model[frame_id];
+        node.history.push_back(ts++);
+        if (node.history.size() > static_cast<size_t>(k)) {
+          node.history.pop_front();
+        }
+        node.evictable = false;
+      } else if (op == 1) {
+        custom_replacer.Unpin(frame_id);
+        model[frame_id].evictable = true;
+      } else {
+        frame_id_t  expected     = INVALID_FRAME_ID;
+        bool        expected_inf = false;
+        timestamp_t expected_ts  = 0;
+        for (auto &[fid, node] : model) {
+          if (!node.evictable) {
+            continue;
+          }
+          bool        inf   = node.history.size() < static_cast<size_t>(k);
+          timestamp_t front = node.history.empty() ? 0 : node.history.front();
+          if (expected == INVALID_FRAME_ID || (inf && !expected_inf) ||
+              (inf == expected_inf && (front < expected_ts || (front == expected_ts && fid < expected)))) {
+            expected     = fid;
+            expected_inf = inf;
+            expected_ts  = front;
+          }
+        }
+        frame_id_t victim = INVALID_FRAME_ID;
+        ASSERT_EQ(custom_replacer.Victim(&victim), expected != INVALID_FRAME_ID);
+        ASSERT_EQ(victim, expected);
+        if (expected != INVALID_FRAME_ID) {
+          model.erase(expected);
+        }
+      }
+    }
+  }
+
   /// will be released in the next semester
   // SUB_TEST(RandomlyAccessInf){
   //   auto custom_replacer = njudb::LRUKReplacer(3, 1024);
@@ -281,6 +335,73 @@ TEST(ReplacerTest, LRUK)
 
 }
 
+TEST(ReplacerTest, TwoQueue)
+{
+  // A1in keeps 2 frames, A1out remembers 4 pages
+  auto replacer = njudb::TwoQueueReplacer(8);
+  for (frame_id_t frame_id = 0; frame_id < 8; ++frame_id) {
+    replacer.Bind(frame_id, 0, frame_id);
+    replacer.Pin(frame_id);
+    replacer.Unpin(frame_id);
+  }
+  ASSERT_EQ(replacer.Size(), 8);
+  SUB_TEST(Fifo)
+  {
+    // re-references in A1in do not change the order
+    replacer.Pin(0);
+    replacer.Unpin(0);
+    frame_id_t frame_id;
+    ASSERT_TRUE(replacer.Victim(&frame_id));
+    ASSERT_EQ(frame_id, 0);
+  }
+  SUB_TEST(ScanResistant)
+  {
+    // page 0 is remembered in A1out, loading it again puts it into Am
+    replacer.Bind(0, 0, 0);
+    replacer.Pin(0);
+    replacer.Unpin(0);
+    ASSERT_EQ(replacer.Candidates(1), std::vector<frame_id_t>{1});
+    // pages loaded once are evicted before the re-referenced one while A1in is over its share
+    frame_id_t frame_id;
+    for (frame_id_t expected = 1; expected <= 5; ++expected) {
+      ASSERT_TRUE(replacer.Victim(&frame_id));
+      ASSERT_EQ(frame_id, expected);
+    }
+    ASSERT_TRUE(replacer.Victim(&frame_id));
+    ASSERT_EQ(frame_id, 0);
+    ASSERT_EQ(replacer.Size(), 2);
+  }
+  SUB_TEST(Pinned)
+  {
+    replacer.Pin(6);
+    replacer.Pin(7);
+    frame_id_t frame_id;
+    ASSERT_FALSE(replacer.Victim(&frame_id));
+    replacer.Remove(6);
+    replacer.Unpin(7);
+    ASSERT_TRUE(replacer.Victim(&frame_id));
+    ASSERT_EQ(frame_id, 7);
+    ASSERT_EQ(replacer.Size(), 0);
+  }
+  SUB_TEST(PinnedHead)
+  {
+    // a pinned frame at the head of A1in is skipped and keeps its turn once unpinned
+    for (frame_id_t frame_id = 0; frame_id < 4; ++frame_id) {
+      replacer.Bind(frame_id, 0, 10 + frame_id);
+      replacer.Pin(frame_id);
+      replacer.Unpin(frame_id);
+    }
+    replacer.Pin(0);
+    frame_id_t frame_id;
+    ASSERT_TRUE(replacer.Victim(&frame_id));
+    ASSERT_EQ(frame_id, 1);
+    replacer.Unpin(0);
+    ASSERT_EQ(replacer.Candidates(3), (std::vector<frame_id_t>{0, 2, 3}));
+    ASSERT_TRUE(replacer.Victim(&frame_id));
+    ASSERT_EQ(frame_id, 0);
+  }
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -8,7 +8,10 @@
 #include "system/handle/table_handle.h"
 #include "system/table/table_manager.h"
 
+#include <algorithm>
 #include <cassert>
+#include <map>
+#include <random>
 #include <unordered_map>
 #include <vector>
 #include <unordered_set>
@@ -304,8 +307,418 @@ TEST(TableHandle, PAX_MultiThread)
   ASSERT_EQ(cnt, rids.size());
 }
 
+TEST(TableHandle, MmapReadOnly)
+{
+  auto        disk_manager        = std::make_unique<DiskManager>();
+  auto        buffer_pool_manager = std::make_unique<BufferPoolManager>(disk_manager.get(), nullptr);
+  auto        table_manager       = std::make_unique<TableManager>(disk_manager.get(), buffer_pool_manager.get());
+  std::string table_name          = "table_handle_mmap_read_only";
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  if (std::filesystem::exists(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX)))
+    std::filesystem::remove(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX));
+  auto tbl_schema = GenTableSchema(10);
+  table_manager->CreateTable(TEST_DIR, table_name, *tbl_schema, NARY_MODEL);
+  auto tbl = table_manager->OpenTable(TEST_DIR, table_name, NARY_MODEL);
+  std::vector<std::pair<RID, RecordUptr>> records;
+  for (int i = 0; i < 3000; ++i) {
+    auto record = GenRecordUnderSchema(tbl->GetSchema());
+    auto rid    = tbl->InsertRecord(*record);
+    records.emplace_back(rid, std::move(record));
+  }
+  for (int i = 0; i < 3000; i += 3) {
+    tbl->DeleteRecord(records[i].first);
+  }
+  table_manager->CloseTable(TEST_DIR, *tbl);
+
+  // reopen the table through the mapping, a scan and point lookups see exactly the records left, the records are
+  // defined under another schema object so their bytes are compared
+  auto mapped = table_manager->OpenTable(TEST_DIR, table_name, NARY_MODEL, TABLE_ACCESS_MMAP);
+  ASSERT_EQ(mapped->GetAccessMode(), TABLE_ACCESS_MMAP);
+  BufferAccessStrategy strategy;
+  size_t               scanned = 0;
+  for (auto rid = mapped->GetFirstRID(&strategy); rid != INVALID_RID; rid = mapped->GetNextRID(rid, &strategy)) {
+    scanned++;
+  }
+  ASSERT_EQ(scanned, 2000);
+  for (int i = 0; i < 3000; ++i) {
+    if (i % 3 == 0) {
+      ASSERT_THROW(mapped->GetRecord(records[i].first), NJUDBException_);
+      continue;
+    }
+    auto record = mapped->GetRecord(records[i].first);
+    ASSERT_EQ(memcmp(record->GetData(), records[i].second->GetData(), record->GetSchema()->GetRecordLength()), 0);
+  }
+  // nothing went through the buffer pool and the table cannot be modified
+  ASSERT_EQ(buffer_pool_manager->GetFrame(mapped->GetTableId(), FILE_HEADER_PAGE_ID + 1), nullptr);
+  ASSERT_THROW(mapped->InsertRecord(*records[1].second), NJUDBException_);
+  ASSERT_THROW(mapped->DeleteRecord(records[1].first), NJUDBException_);
+  ASSERT_THROW(mapped->UpdateRecord(records[1].first, *records[2].second), NJUDBException_);
+  table_manager->CloseTable(TEST_DIR, *mapped);
+  table_manager->DropTable(TEST_DIR, table_name);
+}
+
+TEST(TableHandle, GetRecordsBatch)
+{
+  auto        disk_manager        = std::make_unique<DiskManager>();
+  auto        buffer_pool_manager = std::make_unique<BufferPoolManager>(disk_manager.get(), nullptr);
+  auto        table_manager       = std::make_unique<TableManager>(disk_manager.get(), buffer_pool_manager.get());
+  std::string table_name          = "table_handle_get_records";
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  if (std::filesystem::exists(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX)))
+    std::filesystem::remove(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX));
+  for (auto model : {NARY_MODEL, PAX_MODEL}) {
+    auto tbl_schema = GenTableSchema(10);
+    table_manager->CreateTable(TEST_DIR, table_name, *tbl_schema, model);
+    auto tbl = table_manager->OpenTable(TEST_DIR, table_name, model);
+    std::vector<RID>        rids;
+    std::vector<RecordUptr> expected;
+    for (int i = 0; i < 3000; ++i) {
+      expected.push_back(GenRecordUnderSchema(tbl->GetSchema()));
+      rids.push_back(tbl->InsertRecord(*expected.back()));
+    }
+    // the rids of a secondary index come in key order, i.e. scattered over the pages
+    std::vector<size_t> order(rids.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    std::vector<RID> shuffled;
+    for (auto i : order) {
+      shuffled.push_back(rids[i]);
+    }
+
+    std::vector<RecordUptr> batch;
+    tbl->GetRecords(shuffled, batch);
+    ASSERT_EQ(batch.size(), shuffled.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      ASSERT_EQ(batch[i]->GetRID(), shuffled[i]);
+      ASSERT_TRUE(*batch[i] == *expected[order[i]]);
+    }
+
+    // a smaller batch reuses the records already allocated
+    auto *first = batch[0].get();
+    tbl->GetRecords(std::span<const RID>(shuffled).subspan(100, 200), batch);
+    ASSERT_EQ(batch.size(), 200);
+    ASSERT_EQ(batch[0].get(), first);
+    for (size_t i = 0; i < 200; ++i) {
+      ASSERT_TRUE(*batch[i] == *expected[order[100 + i]]);
+    }
+
+    tbl->DeleteRecord(shuffled[150]);
+    ASSERT_THROW(tbl->GetRecords(std::span<const RID>(shuffled).subspan(100, 100), batch), NJUDBException_);
+    table_manager->CloseTable(TEST_DIR, *tbl);
+    table_manager->DropTable(TEST_DIR, table_name);
+  }
+}
+
+TEST(TableHandle, ScanCursor)
+{
+  auto        disk_manager        = std::make_unique<DiskManager>();
+  auto        buffer_pool_manager = std::make_unique<BufferPoolManager>(disk_manager.get(), nullptr);
+  auto        table_manager       = std::make_unique<TableManager>(disk_manager.get(), buffer_pool_manager.get());
+  std::string table_name          = "table_handle_scan_cursor";
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  if (std::filesystem::exists(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX)))
+    std::filesystem::remove(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX));
+  for (auto model : {NARY_MODEL, PAX_MODEL}) {
+    auto tbl_schema = GenTableSchema(10);
+    table_manager->CreateTable(TEST_DIR, table_name, *tbl_schema, model);
+    auto tbl = table_manager->OpenTable(TEST_DIR, table_name, model);
+    std::vector<std::pair<RID, RecordUptr>> records;
+    for (int i = 0; i < 3000; ++i) {
+      auto record = GenRecordUnderSchema(tbl->GetSchema());
+      auto rid    = tbl->InsertRecord(*record);
+      records.emplace_back(rid, std::move(record));
+    }
+    // leave some pages empty and holes in the others
+    size_t left = 0;
+    for (int i = 0; i < 3000; ++i) {
+      if (i % 3 == 0 || (i >= 1000 && i < 1500)) {
+        tbl->DeleteRecord(records[i].first);
+      } else {
+        left++;
+      }
+    }
+
+    // the cursor visits the records left in rid order, the same as GetFirstRID and GetNextRID
+    std::vector<RID> expected;
+    for (auto rid = tbl->GetFirstRID(); rid != INVALID_RID; rid = tbl->GetNextRID(rid)) {
+      expected.push_back(rid);
+    }
+    TableScanCursor cursor(tbl.get());
+    Record          record(&tbl->GetSchema());
+    size_t          cnt = 0;
+    for (cursor.Rewind(); !cursor.IsEnd(); cursor.Next()) {
+      ASSERT_LT(cnt, expected.size());
+      ASSERT_EQ(cursor.GetRID(), expected[cnt]);
+      cursor.ReadRecord(record);
+      ASSERT_EQ(record.GetRID(), expected[cnt]);
+      ASSERT_TRUE(record == *tbl->GetRecord(expected[cnt]));
+      cnt++;
+    }
+    ASSERT_EQ(cnt, expected.size());
+    ASSERT_EQ(cnt, left);
+
+    // no latch is held between the calls, the records under the cursor can be deleted during the scan
+    for (cursor.Rewind(); !cursor.IsEnd(); cursor.Next()) {
+      tbl->DeleteRecord(cursor.GetRID());
+    }
+    ASSERT_EQ(tbl->GetFirstRID(), INVALID_RID);
+    cursor.Rewind();
+    ASSERT_TRUE(cursor.IsEnd());
+    table_manager->CloseTable(TEST_DIR, *tbl);
+    table_manager->DropTable(TEST_DIR, table_name);
+  }
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
 }
+
+TEST(TableHandle, ConcurrentInsertDelete)
+{
+  auto        disk_manager        = std::make_unique<DiskManager>();
+  auto        buffer_pool_manager = std::make_unique<BufferPoolManager>(disk_manager.get(), nullptr, 0, 64);
+  auto        table_manager       = std::make_unique<TableManager>(disk_manager.get(), buffer_pool_manager.get());
+  std::string table_name          = "table_handle_concurrent";
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  if (std::filesystem::exists(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX)))
+    std::filesystem::remove(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX));
+  auto tbl_schema = GenTableSchema(10);
+  table_manager->CreateTable(TEST_DIR, table_name, *tbl_schema, NARY_MODEL);
+  auto tbl = table_manager->OpenTable(TEST_DIR, table_name, NARY_MODEL);
+
+  // no external lock, the page latches and the free space map keep the inserters apart
+  const int                                            thread_num = 8;
+  const int                                            per_thread = 1000;
+  std::vector<std::vector<std::pair<RID, RecordUptr>>> inserted(thread_num);
+  std::vector<std::thread>                             threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < per_thread; ++i) {
+        auto record = GenRecordUnderSchema(tbl->GetSchema());
+        auto rid    = tbl->InsertRecord(*record);
+        inserted[t].emplace_back(rid, std::move(record));
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  std::unordered_set<RID> rids;
+  for (auto &records : inserted) {
+    for (auto &[rid, record] : records) {
+      ASSERT_TRUE(rids.insert(rid).second);
+      ASSERT_TRUE(*tbl->GetRecord(rid) == *record);
+    }
+  }
+  // every page but the ones that were being filled when another inserter found no room is full
+  auto rec_per_page = tbl->GetTableHeader().rec_per_page_;
+  auto page_num     = tbl->GetTableHeader().page_num_;
+  ASSERT_LE(page_num - 1, (thread_num * per_thread + rec_per_page - 1) / rec_per_page + thread_num);
+
+  // deleted slots are reused, the table does not grow
+  threads.clear();
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < per_thread; i += 2) {
+        tbl->DeleteRecord(inserted[t][i].first);
+      }
+      for (int i = 0; i < per_thread; i += 2) {
+        inserted[t][i].first = tbl->InsertRecord(*inserted[t][i].second);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(tbl->GetTableHeader().page_num_, page_num);
+  rids.clear();
+  for (auto &records : inserted) {
+    for (auto &[rid, record] : records) {
+      ASSERT_TRUE(rids.insert(rid).second);
+      ASSERT_TRUE(*tbl->GetRecord(rid) == *record);
+    }
+  }
+
+  // the pages of a reopened table enter the map when the inserters need room, before the table grows
+  for (int t = 0; t < thread_num; ++t) {
+    tbl->DeleteRecord(inserted[t][t * 100].first);
+  }
+  table_manager->CloseTable(TEST_DIR, *tbl);
+  tbl = table_manager->OpenTable(TEST_DIR, table_name, NARY_MODEL);
+  threads.clear();
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      auto &[rid, record] = inserted[t][t * 100];
+      rid                 = tbl->InsertRecord(*record);
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(tbl->GetTableHeader().page_num_, page_num);
+  // the reopened table has its own schema object, so the bytes are compared
+  for (int t = 0; t < thread_num; ++t) {
+    auto &[rid, expected] = inserted[t][t * 100];
+    ASSERT_EQ(memcmp(tbl->GetRecord(rid)->GetData(), expected->GetData(), tbl->GetSchema().GetRecordLength()), 0);
+  }
+  table_manager->CloseTable(TEST_DIR, *tbl);
+  table_manager->DropTable(TEST_DIR, table_name);
+}
+
+TEST(TableHandle, SlottedVarchar)
+{
+  auto        disk_manager        = std::make_unique<DiskManager>();
+  auto        buffer_pool_manager = std::make_unique<BufferPoolManager>(disk_manager.get(), nullptr);
+  auto        table_manager       = std::make_unique<TableManager>(disk_manager.get(), buffer_pool_manager.get());
+  std::string table_name          = "table_handle_slotted";
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  if (std::filesystem::exists(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX)))
+    std::filesystem::remove(FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX));
+  std::vector<RTField> fields(3);
+  fields[0].field_ = {.field_name_ = "id", .field_size_ = 4, .field_type_ = TYPE_INT};
+  fields[1].field_ = {.field_name_ = "name", .field_size_ = 50, .field_type_ = TYPE_VARCHAR};
+  fields[2].field_ = {.field_name_ = "city", .field_size_ = 20, .field_type_ = TYPE_STRING};
+  RecordSchema schema(fields);
+  auto gen_record = [&schema](int id, size_t name_len) {
+    std::string name(name_len, static_cast<char>('a' + id % 26));
+    return std::make_unique<Record>(&schema,
+        std::vector<ValueSptr>{ValueFactory::CreateIntValue(id),
+            ValueFactory::CreateStringValue(name.c_str(), name.size()),
+            ValueFactory::CreateStringValue("nanjing", 7)},
+        INVALID_RID);
+  };
+
+  // short names take much less room in slotted pages than in fixed-length slots
+  std::map<StorageModel, size_t> page_num;
+  for (auto model : {NARY_MODEL, SLOTTED_MODEL}) {
+    table_manager->CreateTable(TEST_DIR, table_name, schema, model);
+    auto tbl = table_manager->OpenTable(TEST_DIR, table_name, model);
+    for (int i = 0; i < 3000; ++i) {
+      tbl->InsertRecord(*gen_record(i, 4));
+    }
+    page_num[model] = tbl->GetTableHeader().page_num_;
+    table_manager->CloseTable(TEST_DIR, *tbl);
+    table_manager->DropTable(TEST_DIR, table_name);
+  }
+  ASSERT_LT(page_num[SLOTTED_MODEL] * 3, page_num[NARY_MODEL] * 2);
+
+  table_manager->CreateTable(TEST_DIR, table_name, schema, SLOTTED_MODEL);
+  auto tbl = table_manager->OpenTable(TEST_DIR, table_name, SLOTTED_MODEL);
+  std::vector<std::pair<RID, RecordUptr>> records;
+  for (int i = 0; i < 3000; ++i) {
+    auto record = gen_record(i, i % 8);
+    auto rid    = tbl->InsertRecord(*record);
+    records.emplace_back(rid, std::move(record));
+  }
+  auto check = [&]() {
+    size_t scanned = 0;
+    auto   record  = std::make_unique<Record>(&tbl->GetSchema());
+    TableScanCursor cursor(tbl.get());
+    for (cursor.Rewind(); !cursor.IsEnd(); cursor.Next()) {
+      cursor.ReadRecord(*record);
+      scanned++;
+    }
+    size_t walked = 0;
+    for (auto rid = tbl->GetFirstRID(); rid != INVALID_RID; rid = tbl->GetNextRID(rid)) {
+      walked++;
+    }
+    size_t           left = 0;
+    std::vector<RID> rids;
+    for (auto &[rid, expected] : records) {
+      if (expected == nullptr) {
+        ASSERT_THROW(tbl->GetRecord(rid), NJUDBException_);
+        continue;
+      }
+      // the expected records are defined under another schema object so their bytes are compared
+      auto record = tbl->GetRecord(rid);
+      ASSERT_EQ(record->GetRID(), rid);
+      ASSERT_EQ(memcmp(record->GetData(), expected->GetData(), schema.GetRecordLength()), 0);
+      ASSERT_EQ(memcmp(record->GetNullMap(), expected->GetNullMap(), BITMAP_SIZE(schema.GetFieldCount())), 0);
+      rids.push_back(rid);
+      left++;
+    }
+    ASSERT_EQ(scanned, left);
+    ASSERT_EQ(walked, left);
+    std::vector<RecordUptr> batch;
+    tbl->GetRecords(rids, batch);
+    for (size_t i = 0; i < rids.size(); ++i) {
+      ASSERT_EQ(batch[i]->GetRID(), rids[i]);
+      ASSERT_EQ(memcmp(batch[i]->GetData(), tbl->GetRecord(rids[i])->GetData(), schema.GetRecordLength()), 0);
+    }
+  };
+  check();
+
+  // deleted tuples leave gaps, longer tuples written later are placed after compacting the page
+  for (int i = 0; i < 3000; i += 2) {
+    tbl->DeleteRecord(records[i].first);
+    records[i].second = nullptr;
+  }
+  for (int i = 1; i < 3000; i += 8) {
+    records[i].second = gen_record(i, 50);
+    tbl->UpdateRecord(records[i].first, *records[i].second);
+  }
+  for (int i = 3; i < 3000; i += 4) {
+    records[i].second = gen_record(i, 1);
+    tbl->UpdateRecord(records[i].first, *records[i].second);
+  }
+  check();
+  // the new records reuse the slots of the deleted ones
+  std::erase_if(records, [](const auto &entry) { return entry.second == nullptr; });
+  auto pages = tbl->GetTableHeader().page_num_;
+  for (int i = 0; i < 200; ++i) {
+    auto record = gen_record(i, 20);
+    auto rid    = tbl->InsertRecord(*record);
+    records.emplace_back(rid, std::move(record));
+  }
+  ASSERT_EQ(tbl->GetTableHeader().page_num_, pages);
+  check();
+
+  // tuples that cannot grow within their page move to other pages and keep their rids
+  auto first_page = records[1].first.PageID();
+  auto on_first_page = [&](const auto &visit) {
+    for (auto &[rid, expected] : records) {
+      if (expected != nullptr && rid.PageID() == first_page) {
+        visit(rid, expected);
+      }
+    }
+  };
+  on_first_page([&](const RID &rid, RecordUptr &expected) {
+    expected = gen_record(rid.SlotID(), 50);
+    tbl->UpdateRecord(rid, *expected);
+  });
+  check();
+  // a moved record is updated where it was moved to, returns to its home slot once it fits there again and is
+  // deleted together with its moved tuple
+  on_first_page([&](const RID &rid, RecordUptr &expected) {
+    expected = gen_record(rid.SlotID() + 1, 50);
+    tbl->UpdateRecord(rid, *expected);
+  });
+  check();
+  int n = 0;
+  on_first_page([&](const RID &rid, RecordUptr &expected) {
+    if (n++ % 3 == 0) {
+      tbl->DeleteRecord(rid);
+      expected = nullptr;
+    } else {
+      expected = gen_record(rid.SlotID(), 2);
+      tbl->UpdateRecord(rid, *expected);
+    }
+  });
+  check();
+
+  // the varchar fields and the free space survive reopening the table
+  table_manager->CloseTable(TEST_DIR, *tbl);
+  tbl = table_manager->OpenTable(TEST_DIR, table_name, SLOTTED_MODEL);
+  check();
+  table_manager->CloseTable(TEST_DIR, *tbl);
+  table_manager->DropTable(TEST_DIR, table_name);
+}
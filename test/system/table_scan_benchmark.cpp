@@ -0,0 +1,449 @@
+/*------------------------------------------------------------------------------
+ - Copyright (c) 2024. Websoft research group, Nanjing University.
+ -
+ - This program is free software: you can redistribute it and/or modify
+ - it under the terms of the GNU General Public License as published by
+ - the Free Software Foundation, either version 3 of the License, or
+ - (at your option) any later version.
+ -
+ - This program is distributed in the hope that it will be useful,
+ - but WITHOUT ANY WARRANTY; without even the implied warranty of
+ - MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ - GNU General Public License for more details.
+ -
+ - You should have received a copy of the GNU General Public License
+ - along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+#include "../config.h"
+#include "common/types.h"
+#include "storage/storage.h"
+#include "storage/disk/page_compressor.h"
+#include "system/handle/table_handle.h"
+#include "system/table/table_manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+
+using namespace njudb;
+
+// count the heap allocations of the benchmark thread while alloc_counting is set
+static std::atomic<bool>   alloc_counting{false};
+static std::atomic<size_t> alloc_count{0};
+
+auto operator new(size_t size) -> void *
+{
+  if (alloc_counting.load(std::memory_order_relaxed)) {
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+// a table several times larger than the buffer pool, the scans go through a BufferAccessStrategy ring
+constexpr int    BENCH_SCAN_RECORDS  = 1000000;
+constexpr int    BENCH_SCAN_PROBES   = 1000000;
+constexpr size_t BENCH_SCAN_POOL     = 1024;
+constexpr int    BENCH_SCAN_REPEATS  = 3;
+constexpr int    BENCH_ALLOC_RECORDS = 100000;
+
+static auto GenBenchSchema() -> RecordSchemaUptr
+{
+  std::vector<RTField> fields(4);
+  fields[0].field_.field_name_ = "id";
+  fields[0].field_.field_type_ = TYPE_INT;
+  fields[0].field_.field_size_ = sizeof(int);
+  fields[1].field_.field_name_ = "score";
+  fields[1].field_.field_type_ = TYPE_FLOAT;
+  fields[1].field_.field_size_ = sizeof(float);
+  fields[2].field_.field_name_ = "name";
+  fields[2].field_.field_type_ = TYPE_STRING;
+  fields[2].field_.field_size_ = 16;
+  fields[3].field_.field_name_ = "age";
+  fields[3].field_.field_type_ = TYPE_INT;
+  fields[3].field_.field_size_ = sizeof(int);
+  return std::make_unique<RecordSchema>(fields);
+}
+
+// drop the clean pages of the table file from the OS page cache
+static void DropFileCache(const std::string &path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+static auto RunScan(TableHandle &tbl, size_t *records) -> double
+{
+  BufferAccessStrategy strategy;
+  auto                 start = std::chrono::steady_clock::now();
+  size_t               cnt   = 0;
+  for (auto rid = tbl.GetFirstRID(&strategy); rid != INVALID_RID; rid = tbl.GetNextRID(rid, &strategy)) {
+    auto record = tbl.GetRecord(rid, &strategy);
+    cnt += record->GetValueAt(0) != nullptr;
+  }
+  *records = cnt;
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static auto RunProbes(TableHandle &tbl, const std::vector<RID> &rids) -> double
+{
+  std::mt19937 gen(42);
+  auto         start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_SCAN_PROBES; ++i) {
+    auto record = tbl.GetRecord(rids[gen() % rids.size()]);
+    EXPECT_NE(record, nullptr);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// create the table and insert BENCH_SCAN_RECORDS records, the rids are returned in rids
+static auto LoadTable(DiskManager &disk_manager, TableManager &table_manager, const std::string &table_name,
+    bool checksum, std::vector<RID> *rids, PageCompression compression = PAGE_COMPRESSION_NONE) -> double
+{
+  auto schema = GenBenchSchema();
+  table_manager.CreateTable(TEST_DIR, table_name, *schema, NARY_MODEL, compression);
+  rids->clear();
+  rids->reserve(BENCH_SCAN_RECORDS);
+  auto start = std::chrono::steady_clock::now();
+  auto tbl   = table_manager.OpenTable(TEST_DIR, table_name, NARY_MODEL);
+  if (checksum) {
+    disk_manager.SetPageChecksum(tbl->GetTableId(), true);
+  }
+  char name[16]{};
+  for (int i = 0; i < BENCH_SCAN_RECORDS; ++i) {
+    fmt::format_to_n(name, sizeof(name), "user_{}", i);
+    std::vector<ValueSptr> values{ValueFactory::CreateIntValue(i),
+        ValueFactory::CreateFloatValue(static_cast<float>(i) / 3),
+        ValueFactory::CreateStringValue(name, sizeof(name)),
+        ValueFactory::CreateIntValue(i % 100)};
+    Record record(&tbl->GetSchema(), values, INVALID_RID);
+    rids->push_back(tbl->InsertRecord(record));
+  }
+  table_manager.CloseTable(TEST_DIR, *tbl);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(TableScanBenchmark, BufferedVsMmap)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::string table_name = "bench_table_scan";
+  std::string path       = FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX);
+  if (std::filesystem::exists(path))
+    std::filesystem::remove(path);
+
+  DiskManager       disk_manager;
+  BufferPoolManager bpm(&disk_manager, nullptr, REPLACER_LRU_K, BENCH_SCAN_POOL);
+  TableManager      table_manager(&disk_manager, &bpm);
+  std::vector<RID>  rids;
+  LoadTable(disk_manager, table_manager, table_name, false, &rids);
+  std::cout << fmt::format("{} records, {} frames", BENCH_SCAN_RECORDS, BENCH_SCAN_POOL) << std::endl;
+
+  std::cout << fmt::format("{:>10} {:>8} {:>14} {:>14}", "mode", "cache", "scan rec/s", "probes/s") << std::endl;
+  for (auto mode : {TABLE_ACCESS_BUFFERED, TABLE_ACCESS_MMAP}) {
+    for (bool cold : {true, false}) {
+      auto tbl = table_manager.OpenTable(TEST_DIR, table_name, NARY_MODEL, mode);
+      if (cold) {
+        DropFileCache(path);
+      }
+      size_t records   = 0;
+      auto   scan_secs = RunScan(*tbl, &records);
+      ASSERT_EQ(records, BENCH_SCAN_RECORDS);
+      if (cold) {
+        DropFileCache(path);
+      }
+      auto probe_secs = RunProbes(*tbl, rids);
+      std::cout << fmt::format("{:>10} {:>8} {:>14.0f} {:>14.0f}",
+                       mode == TABLE_ACCESS_MMAP ? "mmap" : "buffered",
+                       cold ? "cold" : "warm",
+                       records / scan_secs,
+                       BENCH_SCAN_PROBES / probe_secs)
+                << std::endl;
+      table_manager.CloseTable(TEST_DIR, *tbl);
+    }
+  }
+  table_manager.DropTable(TEST_DIR, table_name);
+}
+
+TEST(TableScanBenchmark, PageChecksum)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::string table_name = "bench_page_checksum";
+  std::string path       = FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX);
+
+  // the cost of one checksum, paid once per page read or written
+  {
+    auto page  = std::make_unique<Page>();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_SCAN_PROBES; ++i) {
+      page->GetData()[PAGE_SIZE - 1] = static_cast<char>(i);
+      StampPageChecksum(page->GetData());
+    }
+    auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << fmt::format("crc32c: {:.0f} ns/page, {:.2f} GB/s", secs * 1e9 / BENCH_SCAN_PROBES,
+                     static_cast<double>(BENCH_SCAN_PROBES) * PAGE_SIZE / secs / 1e9)
+              << std::endl;
+  }
+  // warm and mmap scans are the best of BENCH_SCAN_REPEATS
+  std::cout << fmt::format("{:>10} {:>14} {:>14} {:>14} {:>14}", "checksum", "load rec/s", "cold rec/s",
+                   "warm rec/s", "mmap rec/s")
+            << std::endl;
+  for (bool checksum : {false, true}) {
+    if (std::filesystem::exists(path))
+      std::filesystem::remove(path);
+    DiskManager       disk_manager;
+    BufferPoolManager bpm(&disk_manager, nullptr, REPLACER_LRU_K, BENCH_SCAN_POOL);
+    TableManager      table_manager(&disk_manager, &bpm);
+    std::vector<RID>  rids;
+    auto              load_secs = LoadTable(disk_manager, table_manager, table_name, checksum, &rids);
+    // every page of the buffered scans is read through the disk manager, the table is larger than the pool
+    std::vector<double> rates;
+    for (auto mode : {TABLE_ACCESS_BUFFERED, TABLE_ACCESS_BUFFERED, TABLE_ACCESS_MMAP}) {
+      auto tbl = table_manager.OpenTable(TEST_DIR, table_name, NARY_MODEL, mode);
+      if (checksum) {
+        disk_manager.SetPageChecksum(tbl->GetTableId(), true);
+      }
+      bool cold = rates.empty();
+      if (cold) {
+        DropFileCache(path);
+      }
+      double best = 0;
+      for (int r = 0; r < (cold ? 1 : BENCH_SCAN_REPEATS); ++r) {
+        size_t records = 0;
+        auto   secs    = RunScan(*tbl, &records);
+        ASSERT_EQ(records, BENCH_SCAN_RECORDS);
+        best = std::max(best, records / secs);
+      }
+      rates.push_back(best);
+      table_manager.CloseTable(TEST_DIR, *tbl);
+    }
+    std::cout << fmt::format("{:>10} {:>14.0f} {:>14.0f} {:>14.0f} {:>14.0f}", checksum ? "on" : "off",
+                     BENCH_SCAN_RECORDS / load_secs, rates[0], rates[1], rates[2])
+              << std::endl;
+    table_manager.DropTable(TEST_DIR, table_name);
+  }
+}
+
+TEST(TableScanBenchmark, PageCompression)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::string table_name = "bench_page_compression";
+  std::string path       = FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX);
+
+  // warm scans are the best of BENCH_SCAN_REPEATS, every page of them is read through the disk manager
+  std::cout << fmt::format("{:>22} {:>10} {:>14} {:>14} {:>14}", "compression", "disk MB", "load rec/s",
+                   "cold rec/s", "warm rec/s")
+            << std::endl;
+  for (auto compression :
+      {PAGE_COMPRESSION_NONE, PAGE_COMPRESSION_LZ4, PAGE_COMPRESSION_ZSTD, PAGE_COMPRESSION_ZLIB}) {
+    if (compression != PAGE_COMPRESSION_NONE && !PageCompressor::IsAvailable(compression)) {
+      continue;
+    }
+    DiskManager       disk_manager;
+    BufferPoolManager bpm(&disk_manager, nullptr, REPLACER_LRU_K, BENCH_SCAN_POOL);
+    TableManager      table_manager(&disk_manager, &bpm);
+    std::vector<RID>  rids;
+    auto              load_secs = LoadTable(disk_manager, table_manager, table_name, false, &rids, compression);
+    // blocks in use, the page map of a compressed file included
+    size_t disk_bytes = 0;
+    for (const auto &file : {path, path + PAGE_MAP_SUFFIX}) {
+      struct stat st{};
+      if (stat(file.c_str(), &st) == 0) {
+        disk_bytes += static_cast<size_t>(st.st_blocks) * 512;
+      }
+    }
+    std::vector<double> rates;
+    for (bool cold : {true, false}) {
+      auto tbl = table_manager.OpenTable(TEST_DIR, table_name, NARY_MODEL);
+      if (cold) {
+        DropFileCache(path);
+      }
+      double best = 0;
+      for (int r = 0; r < (cold ? 1 : BENCH_SCAN_REPEATS); ++r) {
+        size_t records = 0;
+        auto   secs    = RunScan(*tbl, &records);
+        ASSERT_EQ(records, BENCH_SCAN_RECORDS);
+        best = std::max(best, records / secs);
+      }
+      rates.push_back(best);
+      table_manager.CloseTable(TEST_DIR, *tbl);
+    }
+    std::cout << fmt::format("{:>22} {:>10.1f} {:>14.0f} {:>14.0f} {:>14.0f}", PageCompressionToString(compression),
+                     static_cast<double>(disk_bytes) / (1 << 20), BENCH_SCAN_RECORDS / load_secs, rates[0], rates[1])
+              << std::endl;
+    table_manager.DropTable(TEST_DIR, table_name);
+  }
+}
+
+TEST(TableScanBenchmark, ScanCursor)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::string table_name = "bench_scan_cursor";
+  std::string path       = FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX);
+  if (std::filesystem::exists(path))
+    std::filesystem::remove(path);
+
+  // scans are the best of BENCH_SCAN_REPEATS, the table is larger than the pool and read through a ring
+  DiskManager       disk_manager;
+  BufferPoolManager bpm(&disk_manager, nullptr, REPLACER_LRU_K, BENCH_SCAN_POOL);
+  TableManager      table_manager(&disk_manager, &bpm);
+  std::vector<RID>  rids;
+  LoadTable(disk_manager, table_manager, table_name, false, &rids);
+  auto tbl = table_manager.OpenTable(TEST_DIR, table_name, NARY_MODEL);
+
+  Record out(&tbl->GetSchema());
+  auto   rid_scan = [&](size_t *records) {
+    BufferAccessStrategy strategy;
+    size_t               cnt = 0;
+    for (auto rid = tbl->GetFirstRID(&strategy); rid != INVALID_RID; rid = tbl->GetNextRID(rid, &strategy)) {
+      tbl->GetRecord(rid, out, &strategy);
+      ++cnt;
+    }
+    *records = cnt;
+  };
+  auto cursor_scan = [&](size_t *records) {
+    BufferAccessStrategy strategy;
+    TableScanCursor      cursor(tbl.get(), &strategy);
+    size_t               cnt = 0;
+    for (cursor.Rewind(); !cursor.IsEnd(); cursor.Next()) {
+      cursor.ReadRecord(out);
+      ++cnt;
+    }
+    *records = cnt;
+  };
+
+  std::cout << fmt::format("{:>10} {:>14}", "scan", "rec/s") << std::endl;
+  std::vector<double> rates;
+  for (bool use_cursor : {false, true}) {
+    double best = 0;
+    for (int r = 0; r < BENCH_SCAN_REPEATS; ++r) {
+      size_t records = 0;
+      auto   start   = std::chrono::steady_clock::now();
+      use_cursor ? cursor_scan(&records) : rid_scan(&records);
+      auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      ASSERT_EQ(records, BENCH_SCAN_RECORDS);
+      best = std::max(best, records / secs);
+    }
+    rates.push_back(best);
+    std::cout << fmt::format("{:>10} {:>14.0f}", use_cursor ? "cursor" : "rid", best) << std::endl;
+  }
+  // the rid scan fetches a page twice per record, the cursor once per page
+  EXPECT_GT(rates[1], rates[0]);
+
+  table_manager.CloseTable(TEST_DIR, *tbl);
+  table_manager.DropTable(TEST_DIR, table_name);
+}
+
+// the allocations of one pass of fn over BENCH_ALLOC_RECORDS rows, divided by the number of rows
+template <typename Fn>
+static auto AllocsPerRow(Fn &&fn) -> double
+{
+  alloc_count.store(0);
+  alloc_counting.store(true);
+  fn();
+  alloc_counting.store(false);
+  return static_cast<double>(alloc_count.load()) / BENCH_ALLOC_RECORDS;
+}
+
+TEST(TableScanBenchmark, AllocationsPerRow)
+{
+  if (!std::filesystem::exists(TEST_DIR))
+    std::filesystem::create_directory(TEST_DIR);
+  std::string table_name = "bench_table_alloc";
+  std::string path       = FILE_NAME(TEST_DIR, table_name, TAB_SUFFIX);
+  if (std::filesystem::exists(path))
+    std::filesystem::remove(path);
+
+  // the pool holds the whole table, so the numbers below are the cost of the table handle rather than of page misses
+  DiskManager       disk_manager;
+  BufferPoolManager bpm(&disk_manager, nullptr, REPLACER_LRU_K, BENCH_SCAN_POOL);
+  TableManager      table_manager(&disk_manager, &bpm);
+  auto              schema = GenBenchSchema();
+  table_manager.CreateTable(TEST_DIR, table_name, *schema, NARY_MODEL);
+  auto tbl = table_manager.OpenTable(TEST_DIR, table_name, NARY_MODEL);
+
+  char                   name[16]{};
+  std::vector<ValueSptr> values{ValueFactory::CreateIntValue(0),
+      ValueFactory::CreateFloatValue(0),
+      ValueFactory::CreateStringValue(name, sizeof(name)),
+      ValueFactory::CreateIntValue(0)};
+  Record           record(&tbl->GetSchema(), values, INVALID_RID);
+  std::vector<RID> rids(BENCH_ALLOC_RECORDS);
+  auto insert = AllocsPerRow([&] {
+    for (int i = 0; i < BENCH_ALLOC_RECORDS; ++i) {
+      rids[i] = tbl->InsertRecord(record);
+    }
+  });
+
+  Record               out(&tbl->GetSchema());
+  BufferAccessStrategy strategy;
+  size_t               cnt       = 0;
+  auto                 scan_pass = [&] {
+    cnt = 0;
+    for (auto rid = tbl->GetFirstRID(&strategy); rid != INVALID_RID; rid = tbl->GetNextRID(rid, &strategy)) {
+      tbl->GetRecord(rid, out, &strategy);
+      ++cnt;
+    }
+  };
+  // the first pass sets up the rings of the strategy
+  scan_pass();
+  auto scan = AllocsPerRow(scan_pass);
+  ASSERT_EQ(cnt, BENCH_ALLOC_RECORDS);
+  TableScanCursor cursor(tbl.get(), &strategy);
+  auto            cursor_scan = AllocsPerRow([&] {
+    cnt = 0;
+    for (cursor.Rewind(); !cursor.IsEnd(); cursor.Next()) {
+      cursor.ReadRecord(out);
+      ++cnt;
+    }
+  });
+  ASSERT_EQ(cnt, BENCH_ALLOC_RECORDS);
+  auto probe = AllocsPerRow([&] {
+    for (const auto &rid : rids) {
+      tbl->GetRecord(rid, out);
+    }
+  });
+
+  std::cout << fmt::format("{:>8} {:>12}", "op", "allocs/row") << std::endl;
+  std::cout << fmt::format("{:>8} {:>12.4f}", "insert", insert) << std::endl;
+  std::cout << fmt::format("{:>8} {:>12.4f}", "scan", scan) << std::endl;
+  std::cout << fmt::format("{:>8} {:>12.4f}", "cursor", cursor_scan) << std::endl;
+  std::cout << fmt::format("{:>8} {:>12.4f}", "get", probe) << std::endl;
+  // inserting only allocates when a new page enters the page table
+  EXPECT_LT(insert, 0.1);
+  EXPECT_EQ(scan, 0);
+  EXPECT_EQ(cursor_scan, 0);
+  EXPECT_EQ(probe, 0);
+
+  table_manager.CloseTable(TEST_DIR, *tbl);
+  table_manager.DropTable(TEST_DIR, table_name);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}